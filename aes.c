@@ -1,10 +1,17 @@
+#include <pthread.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "aes.h"
 #include "error.h"
 #include "types.h"
 
+#if AES_X86
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
 #define AES_BLOCK_SIZE 16
 
 typedef struct aes_block_t
@@ -12,12 +19,6 @@ typedef struct aes_block_t
     byte data[AES_BLOCK_SIZE];
 }* aes_block_p;
 
-struct polynom_red_cache_item_t
-{
-    byte p;
-    byte set;
-};
-
 typedef uint32_t word;
 
 typedef struct aes_keys_t
@@ -48,7 +49,26 @@ typedef struct cfb_iterator_t
     int                n;
 }* cfb_iterator_p;
 
-static struct polynom_red_cache_item_t polynom_red_cache[256][256] = {0};
+/* Also the state of the streaming interface, see aes_ctr_new */
+typedef struct ctr_iterator_t
+{
+    struct aes_block_t counter; /* Next counter block to encrypt */
+    struct aes_block_t subkey;  /* Current keystream block */
+    struct aes_keys_t  KEY;
+    int                n;
+}* ctr_iterator_p;
+
+/* Features of the CPU (aes_cpu) and the ones in use (aes_in_use), see
+ * aes_features */
+static pthread_once_t aes_once   = PTHREAD_ONCE_INIT;
+static int            aes_cpu    = 0;
+static int            aes_in_use = 0;
+
+/* Reduction is linear: the reduction of h * x^8 + l is l + polynom_red_high[h].
+ * The table is filled once, before the first key schedule, and only read
+ * afterwards, so that threads can share an expanded key (see aes_key_new) */
+static pthread_once_t polynom_once = PTHREAD_ONCE_INIT;
+static byte           polynom_red_high[256];
 
 static char aes_err_custom[1024];
 const char* AES_ERR_COLLECTION[] = {
@@ -194,6 +214,9 @@ static byte polynom_sum(byte p, byte q);
  * Reduction in modulo x^8 + x^4 + x^3 + x + 1 */
 static byte polynom_red(byte* P);
 
+/* Fill polynom_red_high, once: see polynom_once */
+static void polynom_red_init(void);
+
 /* Return the scalar product between `P` and `Q`, reduced.
  * `P` and `Q` are two vector of polynomials and have size `D`. */
 static byte polynom_scalar_prod(const byte* P, const byte* Q, int D);
@@ -270,6 +293,25 @@ static void aes_block_decrypt(aes_block_p dst, aes_block_p src, aes_keys_p KEY);
 
 static void aes_block_copy(aes_block_p dst, aes_block_p src);
 
+/* Fill aes_cpu and aes_in_use, once: see aes_once */
+static void aes_detect(void);
+
+#if AES_X86
+/* Same as aes_block_encrypt, with the AES instructions */
+__attribute__((target("aes,sse2"))) static void
+aes_block_encrypt_aesni(aes_block_p dst, aes_block_p src, aes_keys_p KEY);
+
+/* dst <- src ^ keystream of the next `blocks` counter blocks of it (whose
+ * keystream block must have been used up), 8 blocks encrypted at a time so
+ * that the latency of AESENC is hidden */
+__attribute__((target("aes,sse2"))) static void ctr_it_xor_aesni(
+    ctr_iterator_p it, char* dst, const char* src, size_t blocks
+);
+#endif
+
+/* Counter block <- counter block + 1 (mod 2^128) */
+static void ctr_it_increment(ctr_iterator_p it);
+
 /* --- AES Keys */
 
 static word aes_keys_schedule_h(word w);
@@ -297,6 +339,15 @@ static byte ofb_it_next(ofb_iterator_p it);
 static void cfb_it_init(cfb_iterator_p it, aes_keys_p KEY);
 static byte cfb_it_next(cfb_iterator_p it, aes_block_p CT);
 
+/* --- CTR Iterator: the counter block starts from IV and is incremented as a
+ * 128-bit big-endian number (as OpenSSL and NIST SP 800-38A do) */
+static void ctr_it_init(ctr_iterator_p it, aes_keys_p KEY, aes_block_p IV);
+static byte ctr_it_next(ctr_iterator_p it);
+
+/* dst[i] <- src[i] ^ keystream, for 0 <= i < N; whole keystream blocks are
+ * XORed at once */
+static void ctr_it_xor(ctr_iterator_p it, char* dst, char* src, int N);
+
 /* --- AES MODES */
 
 /*
@@ -340,6 +391,14 @@ static int aes_decrypt_ecb_cbc(
 static int
 aes_XXcrypt_ofb(char* dst, char* src, int N, aes_keys_p KEY, aes_block_p IV);
 
+/*
+ * U.B. if:
+ * - sizeof(dst) < sizeof(src);
+ * - N < 0;
+ */
+static int
+aes_XXcrypt_ctr(char* dst, char* src, int N, aes_keys_p KEY, aes_block_p IV);
+
 /*
  * U.B. if:
  * - sizeof(dst) < sizeof(src);
@@ -442,41 +501,39 @@ static void polynom_shift(byte* DST, byte* SRC, int n)
 
 static byte polynom_red(byte* P)
 {
-    int i = 0;
+    return polynom_sum(P[0], polynom_red_high[P[1]]);
+}
 
+static void polynom_red_init(void)
+{
+    int  h;
+    int  i;
     byte PP[2];
     byte PRIME[2] = {0x1B, 0x01};
     byte SUBTRAHEND[2];
 
-    struct polynom_red_cache_item_t* cached;
-
-    cached = &polynom_red_cache[P[1]][P[0]];
-
-    PP[0]  = P[0];
-    PP[1]  = P[1];
-
-    if (cached->set)
-        return cached->p;
-
-    while (PP[1]) /* PP[1] != 0 is equivalent to not reduced */
+    for (h = 0; h < 256; ++h)
     {
-        for (i = 7; i >= 0; --i)
+        PP[0] = 0x00;
+        PP[1] = (byte)h;
+
+        while (PP[1]) /* PP[1] != 0 is equivalent to not reduced */
         {
-            /* Bit not set: not to be reduced */
-            if (byte_or(PP[1], i) == 0)
-                continue;
+            for (i = 7; i >= 0; --i)
+            {
+                /* Bit not set: not to be reduced */
+                if (byte_or(PP[1], i) == 0)
+                    continue;
 
-            polynom_shift(SUBTRAHEND, PRIME, i);
+                polynom_shift(SUBTRAHEND, PRIME, i);
 
-            PP[1] = polynom_sum(PP[1], SUBTRAHEND[1]);
-            PP[0] = polynom_sum(PP[0], SUBTRAHEND[0]);
+                PP[1] = polynom_sum(PP[1], SUBTRAHEND[1]);
+                PP[0] = polynom_sum(PP[0], SUBTRAHEND[0]);
+            }
         }
-    }
-
-    cached->p   = PP[0];
-    cached->set = 1;
 
-    return cached->p;
+        polynom_red_high[h] = PP[0];
+    }
 }
 
 static byte polynom_scalar_prod(const byte* P, const byte* Q, int D)
@@ -623,6 +680,10 @@ static void aes_block_round_n_inv(
 
 static void aes_keys_init(aes_keys_p KEY, byte* extern_key, int DIM)
 {
+    /* Every operation starts from a key schedule */
+    pthread_once(&aes_once, aes_detect);
+    pthread_once(&polynom_once, polynom_red_init);
+
     switch (DIM)
     {
     case 32:
@@ -777,6 +838,14 @@ static void aes_block_encrypt(aes_block_p dst, aes_block_p src, aes_keys_p KEY)
     struct aes_block_t block[2];
     int                i;
 
+#if AES_X86
+    if (aes_in_use & AES_AESNI)
+    {
+        aes_block_encrypt_aesni(dst, src, KEY);
+        return;
+    }
+#endif
+
     aes_block_key_addition(&block[1], src, &KEY->subkeys[0]);
 
     for (i = 0; i < KEY->N - 1; ++i)
@@ -930,6 +999,17 @@ aes_XXcrypt_ofb(char* dst, char* src, int N, aes_keys_p KEY, aes_block_p IV)
     return 0;
 }
 
+static int
+aes_XXcrypt_ctr(char* dst, char* src, int N, aes_keys_p KEY, aes_block_p IV)
+{
+    struct ctr_iterator_t it;
+
+    ctr_it_init(&it, KEY, IV);
+    ctr_it_xor(&it, dst, src, N);
+
+    return 0;
+}
+
 static int
 aes_encrypt_cfb(char* dst, char* src, int N, aes_keys_p KEY, aes_block_p IV)
 {
@@ -1006,7 +1086,29 @@ int aes_encrypt(
     int            block_mode
 )
 {
-    struct aes_keys_t  KEY;
+    struct aes_keys_t KEY;
+    int               res;
+
+    aes_keys_init(&KEY, key, keyN);
+    res = aes_encrypt_key(
+        plain, enc, &KEY, plainN, encN, IV, pad_mode, block_mode
+    );
+    memset(&KEY, 0, sizeof(KEY));
+
+    return res;
+}
+
+int aes_encrypt_key(
+    char*     plain,
+    char*     enc,
+    aes_key_p KEY,
+    int       plainN,
+    int       encN,
+    char*     IV,
+    int       pad_mode,
+    int       block_mode
+)
+{
     struct aes_block_t oIV;
 
     if (encN < plainN || plainN < 0 || encN < 0)
@@ -1020,8 +1122,6 @@ int aes_encrypt(
         return AES_ERR_CUSTOM;
     }
 
-    aes_keys_init(&KEY, key, keyN);
-
     if (IV != NULL)
         memcpy(oIV.data, IV, 16);
     else
@@ -1032,18 +1132,20 @@ int aes_encrypt(
     case MODE_ECB:
     case MODE_CBC:
         return aes_encrypt_ecb_cbc(
-            plain, enc, plainN, encN, &KEY, &oIV, pad_mode, block_mode
+            plain, enc, plainN, encN, KEY, &oIV, pad_mode, block_mode
         );
     case MODE_OFB:
-        return aes_XXcrypt_ofb(enc, plain, plainN, &KEY, &oIV);
+        return aes_XXcrypt_ofb(enc, plain, plainN, KEY, &oIV);
+    case MODE_CTR:
+        return aes_XXcrypt_ctr(enc, plain, plainN, KEY, &oIV);
     case MODE_CFB:
-        return aes_encrypt_cfb(enc, plain, plainN, &KEY, &oIV);
+        return aes_encrypt_cfb(enc, plain, plainN, KEY, &oIV);
     default:
         return AES_ERR_MODE_NOT_SUPPORTED;
     }
 
     /* Exit, for it should be unreachable */
-    EXIT(FATAL_LOGIC, "aes_encrypt", "### no statement ###");
+    EXIT(FATAL_LOGIC, "aes_encrypt_key", "### no statement ###");
 }
 
 static int aes_decrypt_ecb_cbc(
@@ -1132,7 +1234,29 @@ int aes_decrypt(
     int            block_mode
 )
 {
-    struct aes_keys_t  KEY;
+    struct aes_keys_t KEY;
+    int               res;
+
+    aes_keys_init(&KEY, key, keyN);
+    res = aes_decrypt_key(
+        plain, enc, &KEY, plainN, encN, IV, pad_mode, block_mode
+    );
+    memset(&KEY, 0, sizeof(KEY));
+
+    return res;
+}
+
+int aes_decrypt_key(
+    char*     plain,
+    char*     enc,
+    aes_key_p KEY,
+    int       plainN,
+    int       encN,
+    char*     IV,
+    int       pad_mode,
+    int       block_mode
+)
+{
     struct aes_block_t iv;
 
     if (plainN < encN || plainN < 0 || encN < 0)
@@ -1143,7 +1267,7 @@ int aes_decrypt(
             encN,
             plainN
         );
-        EXIT(FATAL_LOGIC, "aes_decrypt", aes_err_custom);
+        EXIT(FATAL_LOGIC, "aes_decrypt_key", aes_err_custom);
     }
 
     if (IV != NULL)
@@ -1151,19 +1275,19 @@ int aes_decrypt(
     else
         memset(iv.data, 0, 16);
 
-    aes_keys_init(&KEY, key, keyN);
-
     switch (block_mode)
     {
     case MODE_ECB:
     case MODE_CBC:
         return aes_decrypt_ecb_cbc(
-            plain, enc, encN, &KEY, &iv, pad_mode, block_mode
+            plain, enc, encN, KEY, &iv, pad_mode, block_mode
         );
     case MODE_OFB:
-        return aes_XXcrypt_ofb(plain, enc, encN, &KEY, &iv);
+        return aes_XXcrypt_ofb(plain, enc, encN, KEY, &iv);
+    case MODE_CTR:
+        return aes_XXcrypt_ctr(plain, enc, encN, KEY, &iv);
     case MODE_CFB:
-        return aes_decrypt_cfb(plain, enc, encN, &KEY, &iv);
+        return aes_decrypt_cfb(plain, enc, encN, KEY, &iv);
     default:
         return AES_ERR_MODE_NOT_SUPPORTED;
     }
@@ -1171,6 +1295,74 @@ int aes_decrypt(
     return 0;
 }
 
+aes_key_p aes_key_new(unsigned char* key, int keyN)
+{
+    aes_key_p KEY;
+
+    if (keyN != 16 && keyN != 24 && keyN != 32)
+        return NULL;
+
+    KEY = malloc(sizeof(struct aes_keys_t));
+    EXIT_EALLOC(KEY);
+
+    aes_keys_init(KEY, key, keyN);
+
+    return KEY;
+}
+
+void aes_key_free(aes_key_p KEY)
+{
+    memset(KEY, 0, sizeof(struct aes_keys_t));
+    free(KEY);
+}
+
+aes_ctr_p aes_ctr_new(unsigned char* key, int keyN, char* IV)
+{
+    struct aes_keys_t  KEY;
+    struct aes_block_t iv;
+    aes_ctr_p          it;
+
+    if (keyN != 16 && keyN != 24 && keyN != 32)
+        return NULL;
+
+    it = malloc(sizeof(struct ctr_iterator_t));
+    EXIT_EALLOC(it);
+
+    aes_keys_init(&KEY, key, keyN);
+    memcpy(iv.data, IV, AES_BLOCK_SIZE);
+    ctr_it_init(it, &KEY, &iv);
+
+    return it;
+}
+
+void aes_ctr_update(aes_ctr_p it, char* dst, char* src, int N)
+{
+    ctr_it_xor(it, dst, src, N);
+}
+
+void aes_ctr_free(aes_ctr_p it)
+{
+    /* Key schedule included */
+    memset(it, 0, sizeof(struct ctr_iterator_t));
+    free(it);
+}
+
+int aes_features(void)
+{
+    pthread_once(&aes_once, aes_detect);
+
+    return aes_in_use;
+}
+
+int aes_features_set(int mask)
+{
+    pthread_once(&aes_once, aes_detect);
+
+    aes_in_use = aes_cpu & mask;
+
+    return aes_in_use;
+}
+
 const char* aes_err(int code)
 {
     if (code == AES_ERR_CUSTOM)
@@ -1227,3 +1419,171 @@ static byte cfb_it_next(cfb_iterator_p it, aes_block_p CT)
     it->n += 1;
     return it->subkey.data[it->n - 1];
 }
+
+static void ctr_it_init(ctr_iterator_p it, aes_keys_p KEY, aes_block_p IV)
+{
+    aes_block_copy(&it->counter, IV);
+    aes_keys_copy(&it->KEY, KEY);
+    it->n = AES_BLOCK_SIZE;
+}
+
+static byte ctr_it_next(ctr_iterator_p it)
+{
+    if (it->n == AES_BLOCK_SIZE)
+    {
+        it->n = 0;
+        aes_block_encrypt(&it->subkey, &it->counter, &it->KEY);
+        ctr_it_increment(it);
+    }
+
+    it->n += 1;
+    return it->subkey.data[it->n - 1];
+}
+
+static void ctr_it_xor(ctr_iterator_p it, char* dst, char* src, int N)
+{
+    int i = 0;
+    int j;
+
+    /* Leftover of the current keystream block */
+    for (; i < N && it->n != AES_BLOCK_SIZE; ++i)
+        dst[i] = (char)(src[i] ^ ctr_it_next(it));
+
+#if AES_X86
+    if (aes_in_use & AES_AESNI)
+    {
+        j = (N - i) / AES_BLOCK_SIZE;
+        ctr_it_xor_aesni(it, &dst[i], &src[i], (size_t)j);
+        i += j * AES_BLOCK_SIZE;
+    }
+#endif
+
+    for (; N - i >= AES_BLOCK_SIZE; i += AES_BLOCK_SIZE)
+    {
+        ctr_it_next(it);
+        for (j = 0; j < AES_BLOCK_SIZE; ++j)
+            dst[i + j] = (char)(src[i + j] ^ it->subkey.data[j]);
+        it->n = AES_BLOCK_SIZE;
+    }
+
+    for (; i < N; ++i)
+        dst[i] = (char)(src[i] ^ ctr_it_next(it));
+}
+
+static void ctr_it_increment(ctr_iterator_p it)
+{
+    int i;
+
+    for (i = AES_BLOCK_SIZE - 1; i >= 0; --i)
+        if (++it->counter.data[i] != 0)
+            break;
+}
+
+static void aes_detect(void)
+{
+#if AES_X86
+    unsigned int a;
+    unsigned int b;
+    unsigned int c;
+    unsigned int d;
+
+    if (__get_cpuid(1, &a, &b, &c, &d) && (c & 1u << 25) && (d & 1u << 26))
+        aes_cpu |= AES_AESNI;
+#endif
+
+    aes_in_use = aes_cpu;
+}
+
+#if AES_X86
+__attribute__((target("aes,sse2"))) static void
+aes_block_encrypt_aesni(aes_block_p dst, aes_block_p src, aes_keys_p KEY)
+{
+    __m128i B;
+    int     i;
+
+    B = _mm_loadu_si128((const __m128i*)src->data);
+    B = _mm_xor_si128(B, _mm_loadu_si128((const __m128i*)KEY->subkeys[0].data));
+
+    for (i = 1; i < KEY->N - 1; ++i)
+        B = _mm_aesenc_si128(
+            B, _mm_loadu_si128((const __m128i*)KEY->subkeys[i].data)
+        );
+
+    B = _mm_aesenclast_si128(
+        B, _mm_loadu_si128((const __m128i*)KEY->subkeys[i].data)
+    );
+    _mm_storeu_si128((__m128i*)dst->data, B);
+}
+
+__attribute__((target("aes,sse2"))) static void ctr_it_xor_aesni(
+    ctr_iterator_p it, char* dst, const char* src, size_t blocks
+)
+{
+    __m128i K[15];
+    __m128i B[8];
+    __m128i C;
+    __m128i one;
+    size_t  n;
+    size_t  j;
+    int     i;
+
+    for (i = 0; i < it->KEY.N; ++i)
+        K[i] = _mm_loadu_si128((const __m128i*)it->KEY.subkeys[i].data);
+
+    /* 1 in the last byte of the block */
+    one = _mm_set_epi8(1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+
+    while (blocks > 0)
+    {
+        n = blocks < 8 ? blocks : 8;
+
+        if (n == 8 && it->counter.data[AES_BLOCK_SIZE - 1] < 256 - 8)
+        {
+            /* The last byte does not wrap around: the 8 counter blocks
+             * differ in it only, and are computed in registers */
+            C = _mm_loadu_si128((const __m128i*)it->counter.data);
+            for (j = 0; j < 8; ++j)
+            {
+                B[j] = _mm_xor_si128(C, K[0]);
+                C    = _mm_add_epi8(C, one);
+            }
+            it->counter.data[AES_BLOCK_SIZE - 1] =
+                (byte)(it->counter.data[AES_BLOCK_SIZE - 1] + 8);
+
+            for (i = 1; i < it->KEY.N - 1; ++i)
+                for (j = 0; j < 8; ++j)
+                    B[j] = _mm_aesenc_si128(B[j], K[i]);
+        }
+        else
+        {
+            for (j = 0; j < n; ++j)
+            {
+                B[j] = _mm_xor_si128(
+                    _mm_loadu_si128((const __m128i*)it->counter.data), K[0]
+                );
+                ctr_it_increment(it);
+            }
+
+            for (i = 1; i < it->KEY.N - 1; ++i)
+                for (j = 0; j < n; ++j)
+                    B[j] = _mm_aesenc_si128(B[j], K[i]);
+        }
+
+        for (j = 0; j < n; ++j)
+        {
+            B[j] = _mm_aesenclast_si128(B[j], K[i]);
+            B[j] = _mm_xor_si128(
+                B[j], _mm_loadu_si128((const __m128i*)&src[j * AES_BLOCK_SIZE])
+            );
+            _mm_storeu_si128((__m128i*)&dst[j * AES_BLOCK_SIZE], B[j]);
+        }
+
+        dst += n * AES_BLOCK_SIZE;
+        src += n * AES_BLOCK_SIZE;
+        blocks -= n;
+    }
+
+    memset(K, 0, sizeof(K));
+    memset(B, 0, sizeof(B));
+}
+#endif /* AES_X86 */
@@ -3,6 +3,22 @@
 
 #include "block_cipher.h"
 
+/* x86 backend (AES-NI), chosen at run time, see aes_features:
+ * 1 -> built, if the compiler supports it; 0 -> portable code only */
+#ifndef AES_X86
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define AES_X86 1
+#else
+#define AES_X86 0
+#endif
+#endif
+
+/* CPU features used by AES, see aes_features */
+enum
+{
+    AES_AESNI = 1 /* AES instructions: block encryption, CTR 8 blocks at once */
+};
+
 enum
 {
     AES_ERR_NONE = 0,
@@ -17,6 +33,7 @@ enum
 /*
  * IV: NULL or 16 bytes long
  * Pad Mode is only used in ECB and CBC modes.
+ * In CTR mode, IV is the first counter block.
  */
 extern int aes_encrypt(
     char*          plain,
@@ -49,6 +66,62 @@ extern int aes_decrypt(
     int            block_mode
 );
 
+/* Expanded key, for many messages under the same key: aes_key_new computes
+ * the key schedule of key (16, 24 or 32 bytes, otherwise NULL is returned)
+ * once, and aes_encrypt_key and aes_decrypt_key work as aes_encrypt and
+ * aes_decrypt with it. The schedule is only read afterwards: threads can
+ * share it. */
+typedef struct aes_keys_t* aes_key_p;
+
+extern aes_key_p aes_key_new(unsigned char* key, int keyN);
+extern void      aes_key_free(aes_key_p KEY);
+
+extern int aes_encrypt_key(
+    char*     plain,
+    char*     enc,
+    aes_key_p KEY,
+    int       plainN,
+    int       encN,
+    char*     IV,
+    int       pad_mode,
+    int       block_mode
+);
+
+extern int aes_decrypt_key(
+    char*     plain,
+    char*     enc,
+    aes_key_p KEY,
+    int       plainN,
+    int       encN,
+    char*     IV,
+    int       pad_mode,
+    int       block_mode
+);
+
+/* Streaming AES-CTR, for data that does not fit memory: aes_ctr_new expands
+ * the key (16, 24 or 32 bytes, otherwise NULL is returned) and sets the first
+ * counter block to IV (16 bytes); each aes_ctr_update call then goes on with
+ * the keystream where the previous one stopped, so that a file can be
+ * processed in chunks of any size. Encryption and decryption are the same
+ * operation; dst and src can be the same buffer. */
+typedef struct ctr_iterator_t* aes_ctr_p;
+
+extern aes_ctr_p aes_ctr_new(unsigned char* key, int keyN, char* IV);
+extern void      aes_ctr_update(aes_ctr_p ctx, char* dst, char* src, int N);
+extern void      aes_ctr_free(aes_ctr_p ctx);
+
+/* CPU features in use (AES_AESNI), detected on first use */
+extern int aes_features(void);
+
+/* Use only the features in mask (0 -> portable code only) that the CPU has,
+ * e.g. to benchmark or to test the backends against each other. Not thread
+ * safe: no encryption must be in progress.
+ *
+ * RETURN
+ * Features in use
+ */
+extern int aes_features_set(int mask);
+
 /* DO NOT FREE */
 extern const char* aes_err(int code);
 
@@ -0,0 +1,2021 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "aes.h"
+#include "dh.h"
+#include "ed25519.h"
+#include "error.h"
+#include "hmac.h"
+#include "p256.h"
+#include "random.h"
+#include "rsa.h"
+#include "sha2.h"
+#include "x25519.h"
+
+/* Time stamp counter, for cycles per byte: 1 -> read with RDTSC; 0 -> no
+ * cycle counts */
+#ifndef BENCH_TSC
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BENCH_TSC 1
+#else
+#define BENCH_TSC 0
+#endif
+#endif
+
+#if BENCH_TSC
+#include <x86intrin.h>
+#endif
+
+/* Key generation time is a random variable: each configuration is run this
+ * many times and the mean is reported. */
+#ifndef BENCH_KEYGEN_RUNS
+#define BENCH_KEYGEN_RUNS 3
+#endif
+
+/* Default number of inputs of a verify batch */
+#ifndef BENCH_VERIFY_BATCH
+#define BENCH_VERIFY_BATCH 4096
+#endif
+
+/* Default number of imports per key format */
+#ifndef BENCH_KEYIO_COUNT
+#define BENCH_KEYIO_COUNT 1000
+#endif
+
+/* Conversions per base and direction, see bench_conv */
+#ifndef BENCH_CONV_COUNT
+#define BENCH_CONV_COUNT 10000
+#endif
+
+/* Default number of operations per mode, see bench_keyctx */
+#ifndef BENCH_KEYCTX_COUNT
+#define BENCH_KEYCTX_COUNT 200
+#endif
+
+/* Default number of timings per exponentiation, see bench_ct */
+#ifndef BENCH_CT_MEASUREMENTS
+#define BENCH_CT_MEASUREMENTS 2000
+#endif
+
+/* Welch's t above which bench_ct reports a timing leak, as dudect does */
+#define BENCH_CT_THRESHOLD 4.5
+
+/* Same as BENCH_KEYGEN_RUNS, for the time needed to find a single prime */
+#ifndef BENCH_PRIME_RUNS
+#define BENCH_PRIME_RUNS 10
+#endif
+
+/* Default number of messages, see bench_sha2 */
+#ifndef BENCH_SHA2_COUNT
+#define BENCH_SHA2_COUNT 4096
+#endif
+
+/* Bytes hashed per measurement, at least, see bench_sha2 */
+#ifndef BENCH_SHA2_BYTES
+#define BENCH_SHA2_BYTES (64 << 20)
+#endif
+
+/* Default number of messages, see bench_hmac */
+#ifndef BENCH_HMAC_COUNT
+#define BENCH_HMAC_COUNT 100000
+#endif
+
+/* Default number of handshakes per group, see bench_dh */
+#ifndef BENCH_DH_COUNT
+#define BENCH_DH_COUNT 50
+#endif
+
+/* Default number of X25519 handshakes, see bench_x25519 */
+#ifndef BENCH_X25519_COUNT
+#define BENCH_X25519_COUNT 2000
+#endif
+
+/* Default number of Ed25519 signatures, see bench_ed25519 */
+#ifndef BENCH_ED25519_COUNT
+#define BENCH_ED25519_COUNT 2000
+#endif
+
+/* Bytes of the messages signed by bench_ed25519, e.g. log records */
+#define BENCH_ED25519_MSG_SIZE 256
+
+/* Defaults of bench_random: threads, bytes per call (an IV), calls per
+ * thread */
+#ifndef BENCH_RANDOM_THREADS
+#define BENCH_RANDOM_THREADS 32
+#endif
+#ifndef BENCH_RANDOM_SIZE
+#define BENCH_RANDOM_SIZE 16
+#endif
+#ifndef BENCH_RANDOM_COUNT
+#define BENCH_RANDOM_COUNT 100000
+#endif
+
+/* Default megabytes per request size of bench_random_size */
+#ifndef BENCH_RANDOM_MB
+#define BENCH_RANDOM_MB 64
+#endif
+
+/* Default number of P-256 operations, see bench_p256 */
+#ifndef BENCH_P256_COUNT
+#define BENCH_P256_COUNT 1000
+#endif
+
+/* Minimum seconds of each measurement of bench_suite, that follows a warm-up
+ * of a quarter of it */
+#ifndef BENCH_SUITE_TIME
+#define BENCH_SUITE_TIME 0.25
+#endif
+
+/* Output formats of bench_suite */
+enum
+{
+    BENCH_TEXT,
+    BENCH_CSV,
+    BENCH_JSON
+};
+
+/* State of bench_suite: how results are printed, and which ones */
+typedef struct bench_suite_t
+{
+    int         format;
+    double      time;  /* Minimum seconds per measurement */
+    const char* only;  /* Prefix of the groups to run, NULL -> all */
+    int         count; /* Results printed so far */
+}* bench_suite_p;
+
+/* Operation measured by bench_suite_run, on its argument */
+typedef void (*bench_op_t)(void* arg);
+
+/* Arguments of the operations of bench_suite */
+typedef struct bench_aes_t
+{
+    char*         src;
+    char*         dst;
+    unsigned char key[32];
+    char          iv[16];
+    int           keyN;
+    int           size;
+    int           mode;
+    int           decrypt;
+}* bench_aes_p;
+
+typedef struct bench_bigint_t
+{
+    struct bigint_t N;
+    struct bigint_t M;
+    struct bigint_t E;
+    struct bigint_t DST;
+}* bench_bigint_p;
+
+typedef struct bench_buffer_t
+{
+    char*  buf;
+    size_t size;
+}* bench_buffer_p;
+
+/* Work of each thread of bench_random */
+typedef struct bench_random_t
+{
+    int size;  /* Bytes per call */
+    int count; /* Calls */
+}* bench_random_p;
+
+void exit_usage(void);
+
+/* Source of random_get_buffer, see main: "kernel" or "ctr-drbg" */
+static const char* bench_random_name;
+
+/* Monotonic wall-clock time, in seconds */
+static double bench_now(void);
+
+/* Time stamp counter (0 if BENCH_TSC is 0) */
+static uint64_t bench_tsc(void);
+
+/* - [0] maximum number of threads;
+ * - [1...] key bit lengths.
+ *
+ * Each bit length is measured with 1, 2, 4, ... threads, up to the maximum.
+ */
+static void bench_keygen(int argc, char** argv);
+
+/* - [0...] prime bit lengths.
+ *
+ * Mean time needed to find a prime, as key generation does for p and q.
+ */
+static void bench_prime(int argc, char** argv);
+
+/* - [0] maximum number of threads;
+ * - [1] key bit length;
+ * - [2] batch size (optional, BENCH_VERIFY_BATCH by default).
+ *
+ * Public key operations (signature verification) per second, one input at a
+ * time with rsa_decrypt_signed and then with rsa_decrypt_signed_batch using 1,
+ * 2, 4, ... threads, up to the maximum.
+ */
+static void bench_verify(int argc, char** argv);
+
+/* - [0] key bit length;
+ * - [1] number of imports (optional, BENCH_KEYIO_COUNT by default).
+ *
+ * Key pair imports per second, for each key file format.
+ */
+static void bench_keyio(int argc, char** argv);
+
+/* - [0...] bit lengths.
+ *
+ * bigint_tostring and bigint_import(_dec) conversions per second, in base 16
+ * and 10, of random numbers of each bit length.
+ */
+static void bench_conv(int argc, char** argv);
+
+/* - [0] key bit length;
+ * - [1] number of operations (optional, BENCH_KEYCTX_COUNT by default).
+ *
+ * Private and public key operations per second, on the key (rsa_sign and
+ * rsa_decrypt_signed) and on a key context (rsa_ctx_sign and
+ * rsa_ctx_decrypt_signed), followed by key context cache lookups per second
+ * and the cache counters.
+ */
+static void bench_keyctx(int argc, char** argv);
+
+/* - [0] modulus bit length;
+ * - [1] number of timings (optional, BENCH_CT_MEASUREMENTS by default).
+ *
+ * Timing leakage test, in the fashion of dudect, of bigint_mont_exp (variable
+ * time), bigint_mont_exp_ct and bigint_mont_ladder_ct: each timing uses either
+ * a fixed exponent (only the top bit set) or a random one, picked at random,
+ * with a random base. Welch's t-test tells whether the two classes have
+ * different mean times: |t| above BENCH_CT_THRESHOLD is a leak.
+ */
+static void bench_ct(int argc, char** argv);
+
+/* - [0] message size, in bytes;
+ * - [1] number of messages (optional, BENCH_SHA2_COUNT by default).
+ *
+ * MB/s of SHA-256 and SHA-512, one message at a time (sha256, sha512) and in
+ * batches (sha256_multi, sha512_multi), with each set of CPU features (see
+ * sha2_features_set) the CPU has: none, AVX2, SHA-NI and AVX2.
+ */
+static void bench_sha2(int argc, char** argv);
+
+/* - [0] message size, in bytes;
+ * - [1] number of messages (optional, BENCH_HMAC_COUNT by default).
+ *
+ * HMAC-SHA256 and HMAC-SHA512 tags per second, with the key states computed
+ * once (hmac_sha256_key, then hmac_sha256 for each message) and, to compare,
+ * for each message.
+ */
+static void bench_hmac(int argc, char** argv);
+
+/* - [0] number of handshakes (optional, BENCH_DH_COUNT by default).
+ *
+ * For each Diffie-Hellman group: time to build it (comb of the generator
+ * included), key pairs per second with the comb (dh_keypair) and, to compare,
+ * with bigint_exp_mod on the same exponents, shared secrets per second and
+ * handshakes per second, a handshake being a key pair and a shared secret.
+ */
+static void bench_dh(int argc, char** argv);
+
+/* - [0] number of X25519 handshakes (optional, BENCH_X25519_COUNT by default);
+ * - [1] number of DH handshakes (optional, BENCH_DH_COUNT by default).
+ *
+ * Key pairs, shared secrets and handshakes per second of X25519 and, to
+ * compare, of finite-field DH over ffdhe2048 and ffdhe3072, the latter having
+ * about the same strength as Curve25519.
+ */
+static void bench_x25519(int argc, char** argv);
+
+/* - [0] number of signatures (optional, BENCH_ED25519_COUNT by default);
+ * - [1] number of RSA signatures (optional, BENCH_KEYCTX_COUNT by default).
+ *
+ * Signatures and verifications per second of Ed25519, verifying one
+ * signature at a time (ed25519_verify) and in batches (ed25519_verify_batch),
+ * and, to compare, of RSA-PSS with a 2048-bit key on a key context. Messages
+ * are BENCH_ED25519_MSG_SIZE bytes long.
+ */
+static void bench_ed25519(int argc, char** argv);
+
+/* - [0] number of operations (optional, BENCH_P256_COUNT by default);
+ * - [1] number of RSA operations (optional, BENCH_KEYCTX_COUNT by default).
+ *
+ * Operations per second of P-256 and, to compare, of RSA with a 2048-bit key
+ * (about the same strength), on a key context:
+ * - keypair: p256_keypair (RSA key generation is left to bench_keygen);
+ * - sign: ECDSA and RSA-PSS, of a SHA-256 hash;
+ * - verify: ECDSA and RSA-PSS;
+ * - exchange: ECDH secret, and RSA-OAEP decryption of a 32-byte secret.
+ */
+static void bench_p256(int argc, char** argv);
+
+/* - [0] maximum number of threads (optional, BENCH_RANDOM_THREADS by
+ *   default);
+ * - [1] bytes per call (optional, BENCH_RANDOM_SIZE by default);
+ * - [2] calls per thread (optional, BENCH_RANDOM_COUNT by default).
+ *
+ * MB/s of random_get_buffer with 1, 2, 4, ... threads, up to the maximum,
+ * all of them calling it at the same time: in all, and per thread.
+ */
+static void bench_random(int argc, char** argv);
+
+/* Thread routine of bench_random: arg is a bench_random_p */
+static void* bench_random_worker(void* arg);
+
+/* - [0] megabytes drawn per request size (optional, BENCH_RANDOM_MB by
+ *   default).
+ *
+ * MB/s of random_get_buffer from one thread, for requests of 16 bytes to
+ * 1 MiB, with the source chosen by --random (see main): small requests are
+ * served by the per-thread buffer, large ones (RANDOM_DIRECT_MIN bytes or
+ * more) are written directly.
+ */
+static void bench_random_size(int argc, char** argv);
+
+/* - [0] output format: text, csv or json (optional, text by default);
+ * - [1] minimum seconds per measurement (optional, BENCH_SUITE_TIME by
+ *   default);
+ * - [2] group: aes, bigint, rsa or random (optional, all by default).
+ *
+ * Every primitive, in process, each measurement after a warm-up:
+ * - aes-128, aes-192, aes-256: encryption and decryption in each mode, for
+ *   buffers of 16 bytes (one block, key schedule included), 1 KiB, 16 KiB;
+ * - bigint: bigint_mul and bigint_mod (of the product) of operands of 1024
+ *   bits and more, bigint_exp_mod with moduli of 1024 bits and more, up to
+ *   what BIGINT_MAX allows;
+ * - rsa: rsa_key_generate, 1024 and 2048 bits;
+ * - random: random_get_buffer with the source chosen by --random (see main),
+ *   16 bytes to 1 MiB.
+ *
+ * For each: operations/s, MB/s and cycles (time stamp counter ticks) per
+ * operation and per byte. CSV and JSON are meant to be kept, and compared
+ * across commits.
+ */
+static void bench_suite(int argc, char** argv);
+
+/* Measure op(arg): warm-up, then 1, 2, 4, ... operations until they last
+ * S->time seconds at least; the last run is printed. bytes: processed by
+ * each operation, 0 -> no MB/s nor cycles per byte. */
+static void bench_suite_run(
+    bench_suite_p S,
+    const char*   group,
+    const char*   name,
+    int           param,
+    size_t        bytes,
+    bench_op_t    op,
+    void*         arg
+);
+
+/* Operations of bench_suite: arg is a bench_aes_p, a bench_bigint_p, a
+ * pointer to the bit length (keygen) and a bench_buffer_p (random) */
+static void bench_op_aes(void* arg);
+static void bench_op_mul(void* arg);
+static void bench_op_mod(void* arg);
+static void bench_op_exp_mod(void* arg);
+static void bench_op_keygen(void* arg);
+static void bench_op_random(void* arg);
+
+/*
+ * - [0]
+ * - [1] benchmark
+ * - [ ] benchmark-specific options.
+ */
+int main(int argc, char** argv)
+{
+    int source = RANDOM_SOURCE_DEFAULT;
+
+    /* The source is chosen once, before any random byte is drawn: to compare
+     * the sources, run a benchmark once with each */
+    if (argc > 2 && strcmp(argv[1], "--random") == 0)
+    {
+        if (strcmp(argv[2], "kernel") == 0)
+            source = RANDOM_SOURCE_KERNEL;
+        else if (strcmp(argv[2], "ctr-drbg") == 0)
+            source = RANDOM_SOURCE_CTR_DRBG;
+        else
+            exit_usage();
+
+        argc -= 2;
+        argv += 2;
+    }
+
+    random_set_source(source);
+    bench_random_name =
+        source == RANDOM_SOURCE_CTR_DRBG ? "ctr-drbg" : "kernel";
+
+    if (argc < 2)
+        exit_usage();
+
+    if (strcmp(argv[1], "keygen") == 0)
+        bench_keygen(argc - 2, argv + 2);
+    else if (strcmp(argv[1], "prime") == 0)
+        bench_prime(argc - 2, argv + 2);
+    else if (strcmp(argv[1], "verify") == 0)
+        bench_verify(argc - 2, argv + 2);
+    else if (strcmp(argv[1], "keyio") == 0)
+        bench_keyio(argc - 2, argv + 2);
+    else if (strcmp(argv[1], "conv") == 0)
+        bench_conv(argc - 2, argv + 2);
+    else if (strcmp(argv[1], "keyctx") == 0)
+        bench_keyctx(argc - 2, argv + 2);
+    else if (strcmp(argv[1], "ct") == 0)
+        bench_ct(argc - 2, argv + 2);
+    else if (strcmp(argv[1], "sha2") == 0)
+        bench_sha2(argc - 2, argv + 2);
+    else if (strcmp(argv[1], "hmac") == 0)
+        bench_hmac(argc - 2, argv + 2);
+    else if (strcmp(argv[1], "dh") == 0)
+        bench_dh(argc - 2, argv + 2);
+    else if (strcmp(argv[1], "x25519") == 0)
+        bench_x25519(argc - 2, argv + 2);
+    else if (strcmp(argv[1], "ed25519") == 0)
+        bench_ed25519(argc - 2, argv + 2);
+    else if (strcmp(argv[1], "p256") == 0)
+        bench_p256(argc - 2, argv + 2);
+    else if (strcmp(argv[1], "random") == 0)
+        bench_random(argc - 2, argv + 2);
+    else if (strcmp(argv[1], "random-size") == 0)
+        bench_random_size(argc - 2, argv + 2);
+    else if (strcmp(argv[1], "suite") == 0)
+        bench_suite(argc - 2, argv + 2);
+    else
+        exit_usage();
+
+    return 0;
+}
+
+void exit_usage(void)
+{
+    printf(
+        "Usage: cmc-bench [--random kernel|ctr-drbg] <benchmark> "
+        "[benchmark options...]\n"
+    );
+
+    printf("\nAvailable benchmarks, and specific options:\n");
+    printf("\tkeygen <max threads> <bit length> [bit length...]\n");
+    printf("\tprime <bit length> [bit length...]\n");
+    printf("\tverify <max threads> <bit length> [batch size]\n");
+    printf("\tkeyio <bit length> [imports]\n");
+    printf("\tconv <bit length> [bit length...]\n");
+    printf("\tkeyctx <bit length> [operations]\n");
+    printf("\tct <bit length> [timings]\n");
+    printf("\tsha2 <message size> [messages]\n");
+    printf("\thmac <message size> [messages]\n");
+    printf("\tdh [handshakes]\n");
+    printf("\tx25519 [handshakes] [DH handshakes]\n");
+    printf("\ted25519 [signatures] [RSA signatures]\n");
+    printf("\tp256 [operations] [RSA operations]\n");
+    printf("\trandom [max threads] [bytes per call] [calls per thread]\n");
+    printf("\trandom-size [megabytes]\n");
+    printf("\tsuite [text|csv|json] [seconds] [aes|bigint|rsa|random]\n");
+
+    printf("\nExamples:\n");
+    printf("\tcmc-bench keygen 8 2048 4096\n");
+    printf("\tcmc-bench prime 512 1024\n");
+    printf("\tcmc-bench verify 8 2048\n");
+    printf("\tcmc-bench keyio 4096\n");
+    printf("\tcmc-bench conv 2048 4096\n");
+    printf("\tcmc-bench keyctx 2048\n");
+    printf("\tcmc-bench ct 1024 5000\n");
+    printf("\tcmc-bench sha2 64 100000\n");
+    printf("\tcmc-bench hmac 32\n");
+    printf("\tcmc-bench dh 100\n");
+    printf("\tcmc-bench x25519 5000 50\n");
+    printf("\tcmc-bench ed25519 10000\n");
+    printf("\tcmc-bench p256 2000 200\n");
+    printf("\tcmc-bench random 32 16\n");
+    printf("\tcmc-bench random-size 256\n");
+    printf("\tcmc-bench --random ctr-drbg random-size 256\n");
+    printf("\tcmc-bench suite csv 0.5 > bench.csv\n");
+
+    exit(FATAL_GENERIC);
+}
+
+static double bench_now(void)
+{
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0)
+        EXIT(FATAL_GENERIC, "bench_now", "clock_gettime failed");
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t bench_tsc(void)
+{
+#if BENCH_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static void bench_keygen(int argc, char** argv)
+{
+    struct rsa_key_t K;
+    int              max_threads;
+    int              threads;
+    int              bit_length;
+    int              i;
+    int              run;
+    int              err;
+    double           start;
+    double           elapsed;
+    double           single = 0;
+
+    if (argc < 2)
+        exit_usage();
+
+    max_threads = atoi(argv[0]);
+    if (max_threads < 1)
+        exit_usage();
+
+    printf("%8s %8s %12s %8s\n", "bits", "threads", "seconds", "speedup");
+
+    for (i = 1; i < argc; ++i)
+    {
+        bit_length = atoi(argv[i]);
+
+        err = rsa_key_bit_length_supported(bit_length);
+        if (err != RSA_OK)
+        {
+            printf("%8d %s\n", bit_length, rsa_err(err));
+            continue;
+        }
+
+        for (threads = 1; threads <= max_threads; threads *= 2)
+        {
+            start = bench_now();
+
+            for (run = 0; run < BENCH_KEYGEN_RUNS; ++run)
+                rsa_key_generate_mt(&K, bit_length, RSA_EXP_F4, threads);
+
+            elapsed = (bench_now() - start) / BENCH_KEYGEN_RUNS;
+            if (threads == 1)
+                single = elapsed;
+
+            printf(
+                "%8d %8d %12.3f %8.2f\n",
+                bit_length,
+                threads,
+                elapsed,
+                single / elapsed
+            );
+            fflush(stdout);
+        }
+    }
+}
+
+static void bench_prime(int argc, char** argv)
+{
+    struct bigint_t P;
+    int             bit_length;
+    int             i;
+    int             run;
+    int             err;
+    double          start;
+    double          elapsed;
+
+    if (argc < 1)
+        exit_usage();
+
+    printf("%8s %12s\n", "bits", "seconds");
+
+    for (i = 0; i < argc; ++i)
+    {
+        bit_length = atoi(argv[i]);
+        err        = RSA_OK;
+
+        start = bench_now();
+
+        for (run = 0; run < BENCH_PRIME_RUNS && err == RSA_OK; ++run)
+            err = rsa_prime_generate(&P, bit_length);
+
+        if (err != RSA_OK)
+        {
+            printf("%8d %s\n", bit_length, rsa_err(err));
+            continue;
+        }
+
+        elapsed = (bench_now() - start) / BENCH_PRIME_RUNS;
+
+        printf("%8d %12.3f\n", bit_length, elapsed);
+        fflush(stdout);
+    }
+}
+
+static void bench_verify(int argc, char** argv)
+{
+    struct rsa_key_t K;
+    bigint_p         B;
+    bigint_p         DST;
+    int              max_threads;
+    int              bit_length;
+    int              count = BENCH_VERIFY_BATCH;
+    int              threads;
+    int              i;
+    int              err;
+    double           start;
+    double           rate;
+
+    if (argc < 2)
+        exit_usage();
+
+    max_threads = atoi(argv[0]);
+    bit_length  = atoi(argv[1]);
+    if (argc > 2)
+        count = atoi(argv[2]);
+
+    if (max_threads < 1 || count < 1)
+        exit_usage();
+
+    err = rsa_key_generate_exp(&K, bit_length, RSA_EXP_F4);
+    if (err != RSA_OK)
+    {
+        printf("%d %s\n", bit_length, rsa_err(err));
+        return;
+    }
+
+    B = malloc(sizeof(struct bigint_t) * (size_t)count);
+    EXIT_EALLOC(B);
+    DST = malloc(sizeof(struct bigint_t) * (size_t)count);
+    EXIT_EALLOC(DST);
+
+    /* Inputs one byte shorter than n, hence less than it */
+    for (i = 0; i < count; ++i)
+        bigint_init_rand(&B[i], (size_t)(bit_length / 8 - 1));
+
+    printf(
+        "%8s %8s %8s %12s %12s\n",
+        "bits",
+        "mode",
+        "threads",
+        "ops/s",
+        "ops/s/thread"
+    );
+
+    start = bench_now();
+    for (i = 0; i < count; ++i)
+        rsa_decrypt_signed(&DST[i], &B[i], &K);
+    rate = count / (bench_now() - start);
+
+    printf(
+        "%8d %8s %8d %12.1f %12.1f\n", bit_length, "single", 1, rate, rate
+    );
+
+    for (threads = 1; threads <= max_threads; threads *= 2)
+    {
+        start = bench_now();
+        rsa_decrypt_signed_batch(DST, B, count, &K, threads);
+        rate = count / (bench_now() - start);
+
+        printf(
+            "%8d %8s %8d %12.1f %12.1f\n",
+            bit_length,
+            "batch",
+            threads,
+            rate,
+            rate / threads
+        );
+        fflush(stdout);
+    }
+
+    free(DST);
+    free(B);
+}
+
+static void bench_keyio(int argc, char** argv)
+{
+    static const char* names[] = {"hex", "bin", "der"};
+
+    struct rsa_key_t K;
+    struct rsa_key_t I;
+    FILE*            pub;
+    FILE*            priv;
+    int              bit_length;
+    int              count = BENCH_KEYIO_COUNT;
+    int              fmt;
+    int              i;
+    int              err;
+    double           start;
+    double           rate;
+
+    if (argc < 1)
+        exit_usage();
+
+    bit_length = atoi(argv[0]);
+    if (argc > 1)
+        count = atoi(argv[1]);
+
+    if (count < 1)
+        exit_usage();
+
+    err = rsa_key_generate_exp(&K, bit_length, RSA_EXP_F4);
+    if (err != RSA_OK)
+    {
+        printf("%d %s\n", bit_length, rsa_err(err));
+        return;
+    }
+
+    printf("%8s %8s %12s %12s\n", "bits", "format", "bytes", "imports/s");
+
+    for (fmt = RSA_FMT_HEX; fmt <= RSA_FMT_DER; ++fmt)
+    {
+        pub  = tmpfile();
+        priv = tmpfile();
+        if (pub == NULL || priv == NULL)
+            EXIT(FATAL_GENERIC, "bench_keyio", "tmpfile failed");
+
+        rsa_key_dump_fmt(&K, pub, priv, fmt);
+
+        start = bench_now();
+        for (i = 0; i < count; ++i)
+        {
+            rewind(pub);
+            rewind(priv);
+            rsa_key_import_fmt(&I, pub, priv, fmt);
+        }
+        rate = count / (bench_now() - start);
+
+        printf(
+            "%8d %8s %12ld %12.1f\n",
+            bit_length,
+            names[fmt],
+            ftell(pub) + ftell(priv),
+            rate
+        );
+        fflush(stdout);
+
+        fclose(pub);
+        fclose(priv);
+    }
+}
+
+static void bench_conv(int argc, char** argv)
+{
+    static char     hex[BIGINT_DUMP_SIZE];
+    static char     dec[BIGINT_DUMP10_SIZE];
+    struct bigint_t N;
+    struct bigint_t M;
+    int             bit_length;
+    int             i;
+    int             j;
+    double          start;
+    double          rate[4];
+
+    if (argc < 1)
+        exit_usage();
+
+    printf(
+        "%8s %12s %12s %12s %12s\n",
+        "bits",
+        "tostring16",
+        "import16",
+        "tostring10",
+        "import10"
+    );
+
+    for (i = 0; i < argc; ++i)
+    {
+        bit_length = atoi(argv[i]);
+        if (bit_length < 8 || bit_length > 8 * BIGINT_MAX)
+        {
+            printf("%8d unsupported bit length\n", bit_length);
+            continue;
+        }
+
+        bigint_init_rand(&N, (size_t)(bit_length / 8));
+        bigint_tostring(hex, &N, 16);
+        bigint_tostring(dec, &N, 10);
+
+        start = bench_now();
+        for (j = 0; j < BENCH_CONV_COUNT; ++j)
+            bigint_tostring(hex, &N, 16);
+        rate[0] = BENCH_CONV_COUNT / (bench_now() - start);
+
+        start = bench_now();
+        for (j = 0; j < BENCH_CONV_COUNT; ++j)
+            bigint_import(&M, hex);
+        rate[1] = BENCH_CONV_COUNT / (bench_now() - start);
+
+        start = bench_now();
+        for (j = 0; j < BENCH_CONV_COUNT; ++j)
+            bigint_tostring(dec, &N, 10);
+        rate[2] = BENCH_CONV_COUNT / (bench_now() - start);
+
+        start = bench_now();
+        for (j = 0; j < BENCH_CONV_COUNT; ++j)
+            bigint_import_dec(&M, dec);
+        rate[3] = BENCH_CONV_COUNT / (bench_now() - start);
+
+        printf(
+            "%8d %12.0f %12.0f %12.0f %12.0f\n",
+            bit_length,
+            rate[0],
+            rate[1],
+            rate[2],
+            rate[3]
+        );
+        fflush(stdout);
+    }
+}
+
+static void bench_keyctx(int argc, char** argv)
+{
+    static struct rsa_key_ctx_t  C;
+    struct rsa_key_t             K;
+    struct rsa_key_cache_stats_t S;
+    struct bigint_t              B;
+    struct bigint_t              DST;
+    int                          bit_length;
+    int                          count = BENCH_KEYCTX_COUNT;
+    int                          i;
+    int                          err;
+    double                       start;
+    double                       rate[4];
+
+    if (argc < 1)
+        exit_usage();
+
+    bit_length = atoi(argv[0]);
+    if (argc > 1)
+        count = atoi(argv[1]);
+
+    if (count < 1)
+        exit_usage();
+
+    err = rsa_key_generate_exp(&K, bit_length, RSA_EXP_F4);
+    if (err != RSA_OK)
+    {
+        printf("%d %s\n", bit_length, rsa_err(err));
+        return;
+    }
+
+    /* Input one byte shorter than n, hence less than it */
+    bigint_init_rand(&B, (size_t)(bit_length / 8 - 1));
+
+    /* A key that can not be blinded is refused at each operation */
+    err = rsa_sign(&DST, &B, &K);
+    if (err != RSA_OK)
+    {
+        printf("%d %s\n", bit_length, rsa_err(err));
+        return;
+    }
+
+    start = bench_now();
+    for (i = 0; i < count; ++i)
+        rsa_sign(&DST, &B, &K);
+    rate[0] = count / (bench_now() - start);
+
+    start = bench_now();
+    for (i = 0; i < count; ++i)
+        rsa_decrypt_signed(&DST, &B, &K);
+    rate[1] = count / (bench_now() - start);
+
+    rsa_key_ctx_init(&C, &K);
+
+    start = bench_now();
+    for (i = 0; i < count; ++i)
+        rsa_ctx_sign(&DST, &B, &C);
+    rate[2] = count / (bench_now() - start);
+
+    start = bench_now();
+    for (i = 0; i < count; ++i)
+        rsa_ctx_decrypt_signed(&DST, &B, &C);
+    rate[3] = count / (bench_now() - start);
+
+    printf("%8s %8s %12s %12s\n", "bits", "mode", "sign/s", "verify/s");
+    printf("%8d %8s %12.1f %12.1f\n", bit_length, "key", rate[0], rate[1]);
+    printf("%8d %8s %12.1f %12.1f\n", bit_length, "ctx", rate[2], rate[3]);
+
+    /* A service looking up the context of the same key at each request */
+    rsa_key_cache_clear();
+
+    start = bench_now();
+    for (i = 0; i < count; ++i)
+        rsa_key_ctx_get(&C, &K);
+    rate[0] = count / (bench_now() - start);
+
+    rsa_key_cache_stats(&S);
+
+    printf(
+        "\n%8s %12s %8s %8s %12s\n",
+        "bits",
+        "lookups/s",
+        "hits",
+        "misses",
+        "build ms"
+    );
+    printf(
+        "%8d %12.1f %8lu %8lu %12.3f\n",
+        bit_length,
+        rate[0],
+        S.hits,
+        S.misses,
+        S.build_seconds * 1e3
+    );
+}
+
+static void bench_ct(int argc, char** argv)
+{
+    static const char* names[] = {"vartime", "window", "ladder"};
+
+    struct bigint_mont_t C;
+    struct bigint_t      M;
+    struct bigint_t      E[2]; /* Fixed, random */
+    struct bigint_t      B;
+    struct bigint_t      DST;
+    int                  bit_length;
+    int                  bytes;
+    int                  count = BENCH_CT_MEASUREMENTS;
+    int                  impl;
+    int                  i;
+    int                  n[2];
+    char                 cls;
+    double               start;
+    double               elapsed;
+    double               sum[2];
+    double               sq[2];
+    double               mean[2];
+    double               var[2];
+    double               t;
+
+    if (argc < 1)
+        exit_usage();
+
+    bit_length = atoi(argv[0]);
+    if (argc > 1)
+        count = atoi(argv[1]);
+
+    if (bit_length < 16 || bit_length % 8 != 0 ||
+        bit_length >= 8 * BIGINT_MAX || count < 2)
+        exit_usage();
+
+    bytes = bit_length / 8;
+
+    /* Any odd modulus of exactly bit_length bits */
+    bigint_init_rand(&M, (size_t)bytes);
+    M.num[bytes - 1] |= 0x80;
+    M.num[0] |= 0x01;
+    bigint_set_internal(&M);
+    bigint_mont_init(&C, &M);
+
+    bigint_init(&E[0]);
+    E[0].num[bytes - 1] = 0x80;
+    bigint_set_internal(&E[0]);
+
+    printf(
+        "%8s %8s %12s %12s %10s %8s\n",
+        "bits",
+        "exp",
+        "fixed us",
+        "random us",
+        "t",
+        "leak"
+    );
+
+    for (impl = 0; impl < 3; ++impl)
+    {
+        n[0] = n[1] = 0;
+        sum[0] = sum[1] = sq[0] = sq[1] = 0;
+
+        for (i = 0; i < count; ++i)
+        {
+            /* Inputs are drawn outside the timed section */
+            random_get_buffer(&cls, 1);
+            cls &= 1;
+            bigint_init_rand(&B, (size_t)(bytes - 1));
+            bigint_init_rand(&E[1], (size_t)bytes);
+
+            start = bench_now();
+            if (impl == 0)
+                bigint_mont_exp(&DST, &B, &E[(int)cls], &C);
+            else if (impl == 1)
+                bigint_mont_exp_ct(&DST, &B, &E[(int)cls], bit_length, &C);
+            else
+                bigint_mont_ladder_ct(&DST, &B, &E[(int)cls], bit_length, &C);
+            elapsed = (bench_now() - start) * 1e6;
+
+            ++n[(int)cls];
+            sum[(int)cls] += elapsed;
+            sq[(int)cls] += elapsed * elapsed;
+        }
+
+        if (n[0] < 2 || n[1] < 2)
+            continue;
+
+        for (i = 0; i < 2; ++i)
+        {
+            mean[i] = sum[i] / n[i];
+            var[i]  = (sq[i] - n[i] * mean[i] * mean[i]) / (n[i] - 1);
+        }
+
+        /* Welch's t statistic */
+        t = (mean[0] - mean[1]) / sqrt(var[0] / n[0] + var[1] / n[1]);
+
+        printf(
+            "%8d %8s %12.1f %12.1f %10.2f %8s\n",
+            bit_length,
+            names[impl],
+            mean[0],
+            mean[1],
+            t,
+            fabs(t) > BENCH_CT_THRESHOLD ? "yes" : "no"
+        );
+        fflush(stdout);
+    }
+}
+
+static void bench_sha2(int argc, char** argv)
+{
+    static const char* names[] = {"portable", "avx2", "sha-ni+avx2"};
+    static const int   masks[] = {0, SHA2_AVX2, SHA2_SHANI | SHA2_AVX2};
+    byte*              data;
+    byte*              digests;
+    byte**             dst;
+    const byte**       src;
+    size_t*            len;
+    size_t             size;
+    int                count = BENCH_SHA2_COUNT;
+    int                passes;
+    int                i;
+    int                j;
+    int                k;
+    double             start;
+    double             rate[4];
+
+    if (argc < 1)
+        exit_usage();
+
+    size = (size_t)atol(argv[0]);
+    if (argc > 1)
+        count = atoi(argv[1]);
+
+    if (size < 1 || count < 1)
+        exit_usage();
+
+    passes = (int)(BENCH_SHA2_BYTES / (size * (size_t)count)) + 1;
+
+    data    = malloc(size * (size_t)count);
+    digests = malloc((size_t)count * SHA512_DIGEST_SIZE);
+    dst     = malloc((size_t)count * sizeof(byte*));
+    src     = malloc((size_t)count * sizeof(byte*));
+    len     = malloc((size_t)count * sizeof(size_t));
+    EXIT_EALLOC(data);
+    EXIT_EALLOC(digests);
+    EXIT_EALLOC(dst);
+    EXIT_EALLOC(src);
+    EXIT_EALLOC(len);
+
+    random_get_buffer((char*)data, size * (size_t)count);
+    for (i = 0; i < count; ++i)
+    {
+        dst[i] = &digests[(size_t)i * SHA512_DIGEST_SIZE];
+        src[i] = &data[(size_t)i * size];
+        len[i] = size;
+    }
+
+    printf(
+        "%12s %10s %12s %12s %12s %12s\n",
+        "backend",
+        "size",
+        "sha256 MB/s",
+        "multi MB/s",
+        "sha512 MB/s",
+        "multi MB/s"
+    );
+
+    for (k = 0; k < 3; ++k)
+    {
+        if (sha2_features_set(masks[k]) != masks[k])
+            continue;
+
+        start = bench_now();
+        for (j = 0; j < passes; ++j)
+            for (i = 0; i < count; ++i)
+                sha256(dst[i], src[i], len[i]);
+        rate[0] = bench_now() - start;
+
+        start = bench_now();
+        for (j = 0; j < passes; ++j)
+            sha256_multi(dst, src, len, count);
+        rate[1] = bench_now() - start;
+
+        start = bench_now();
+        for (j = 0; j < passes; ++j)
+            for (i = 0; i < count; ++i)
+                sha512(dst[i], src[i], len[i]);
+        rate[2] = bench_now() - start;
+
+        start = bench_now();
+        for (j = 0; j < passes; ++j)
+            sha512_multi(dst, src, len, count);
+        rate[3] = bench_now() - start;
+
+        for (i = 0; i < 4; ++i)
+            rate[i] = (double)size * count * passes / rate[i] / 1e6;
+
+        printf(
+            "%12s %10lu %12.1f %12.1f %12.1f %12.1f\n",
+            names[k],
+            (unsigned long)size,
+            rate[0],
+            rate[1],
+            rate[2],
+            rate[3]
+        );
+    }
+
+    sha2_features_set(~0);
+
+    free(data);
+    free(digests);
+    free(dst);
+    free(src);
+    free(len);
+}
+
+static void bench_hmac(int argc, char** argv)
+{
+    struct hmac_sha256_key_t K256;
+    struct hmac_sha512_key_t K512;
+    byte                     key[32];
+    byte                     tag[SHA512_DIGEST_SIZE];
+    byte*                    msg;
+    size_t                   size;
+    int                      count = BENCH_HMAC_COUNT;
+    int                      i;
+    double                   start;
+    double                   rate[4];
+
+    if (argc < 1)
+        exit_usage();
+
+    size = (size_t)atol(argv[0]);
+    if (argc > 1)
+        count = atoi(argv[1]);
+
+    if (count < 1)
+        exit_usage();
+
+    msg = malloc(size + 1);
+    EXIT_EALLOC(msg);
+
+    random_get_buffer((char*)msg, size + 1);
+    random_get_buffer((char*)key, sizeof(key));
+
+    hmac_sha256_key(&K256, key, sizeof(key));
+    start = bench_now();
+    for (i = 0; i < count; ++i)
+        hmac_sha256(tag, &K256, msg, size);
+    rate[0] = count / (bench_now() - start);
+
+    start = bench_now();
+    for (i = 0; i < count; ++i)
+    {
+        hmac_sha256_key(&K256, key, sizeof(key));
+        hmac_sha256(tag, &K256, msg, size);
+    }
+    rate[1] = count / (bench_now() - start);
+
+    hmac_sha512_key(&K512, key, sizeof(key));
+    start = bench_now();
+    for (i = 0; i < count; ++i)
+        hmac_sha512(tag, &K512, msg, size);
+    rate[2] = count / (bench_now() - start);
+
+    start = bench_now();
+    for (i = 0; i < count; ++i)
+    {
+        hmac_sha512_key(&K512, key, sizeof(key));
+        hmac_sha512(tag, &K512, msg, size);
+    }
+    rate[3] = count / (bench_now() - start);
+
+    printf("%8s %10s %14s %14s\n", "hash", "size", "key once/s", "key each/s");
+    printf(
+        "%8s %10lu %14.1f %14.1f\n",
+        "sha256",
+        (unsigned long)size,
+        rate[0],
+        rate[1]
+    );
+    printf(
+        "%8s %10lu %14.1f %14.1f\n",
+        "sha512",
+        (unsigned long)size,
+        rate[2],
+        rate[3]
+    );
+
+    free(msg);
+}
+
+static void bench_dh(int argc, char** argv)
+{
+    struct dh_key_t A;
+    struct dh_key_t B;
+    struct bigint_t g;
+    struct bigint_t y;
+    byte            secret[BIGINT_MAX];
+    dh_group_p      G;
+    int             count = BENCH_DH_COUNT;
+    int             id;
+    int             i;
+    double          start;
+    double          setup;
+    double          comb;
+    double          generic;
+    double          shared;
+
+    if (argc > 0)
+        count = atoi(argv[0]);
+
+    if (count < 1)
+        exit_usage();
+
+    bigint_init_by_int(&g, 2);
+
+    printf(
+        "%10s %10s %12s %12s %8s %12s %12s\n",
+        "group",
+        "setup ms",
+        "comb/s",
+        "exp_mod/s",
+        "speedup",
+        "secret/s",
+        "handshake/s"
+    );
+
+    for (id = 0; id < __dh_group_sentinel; ++id)
+    {
+        start = bench_now();
+        G     = dh_group_get(id);
+        setup = bench_now() - start;
+
+        dh_keypair(&B, G);
+
+        start = bench_now();
+        for (i = 0; i < count; ++i)
+            dh_keypair(&A, G);
+        comb = bench_now() - start;
+
+        start = bench_now();
+        for (i = 0; i < count; ++i)
+            bigint_exp_mod(&y, &g, &A.x, &G->C.M);
+        generic = bench_now() - start;
+
+        if (bigint_cmp(&y, &A.y) != 0)
+            EXIT(FATAL_LOGIC, "bench_dh", "comb and bigint_exp_mod differ");
+
+        start = bench_now();
+        for (i = 0; i < count; ++i)
+            if (dh_shared_secret(secret, &A, &B.y) != 0)
+                EXIT(FATAL_LOGIC, "bench_dh", "invalid public key");
+        shared = bench_now() - start;
+
+        printf(
+            "%10s %10.2f %12.1f %12.1f %8.2f %12.1f %12.1f\n",
+            G->name,
+            setup * 1e3,
+            count / comb,
+            count / generic,
+            generic / comb,
+            count / shared,
+            count / (comb + shared)
+        );
+    }
+}
+
+static void bench_x25519(int argc, char** argv)
+{
+    struct dh_key_t A;
+    struct dh_key_t B;
+    byte            priv[X25519_SIZE];
+    byte            pub[X25519_SIZE];
+    byte            peer[X25519_SIZE];
+    byte            secret[BIGINT_MAX];
+    dh_group_p      G;
+    int             count    = BENCH_X25519_COUNT;
+    int             dh_count = BENCH_DH_COUNT;
+    int             id;
+    int             i;
+    double          start;
+    double          keypair;
+    double          shared;
+
+    if (argc > 0)
+        count = atoi(argv[0]);
+    if (argc > 1)
+        dh_count = atoi(argv[1]);
+
+    if (count < 1 || dh_count < 1)
+        exit_usage();
+
+    printf(
+        "%10s %12s %12s %12s\n",
+        "exchange",
+        "keypair/s",
+        "secret/s",
+        "handshake/s"
+    );
+
+    x25519_keypair(peer, priv);
+
+    start = bench_now();
+    for (i = 0; i < count; ++i)
+        x25519_keypair(pub, priv);
+    keypair = bench_now() - start;
+
+    start = bench_now();
+    for (i = 0; i < count; ++i)
+        if (x25519(secret, priv, peer) != 0)
+            EXIT(FATAL_LOGIC, "bench_x25519", "invalid public key");
+    shared = bench_now() - start;
+
+    printf(
+        "%10s %12.1f %12.1f %12.1f\n",
+        "x25519",
+        count / keypair,
+        count / shared,
+        count / (keypair + shared)
+    );
+
+    for (id = DH_FFDHE2048; id <= DH_FFDHE3072; ++id)
+    {
+        G = dh_group_get(id);
+        dh_keypair(&B, G);
+
+        start = bench_now();
+        for (i = 0; i < dh_count; ++i)
+            dh_keypair(&A, G);
+        keypair = bench_now() - start;
+
+        start = bench_now();
+        for (i = 0; i < dh_count; ++i)
+            if (dh_shared_secret(secret, &A, &B.y) != 0)
+                EXIT(FATAL_LOGIC, "bench_x25519", "invalid public key");
+        shared = bench_now() - start;
+
+        printf(
+            "%10s %12.1f %12.1f %12.1f\n",
+            G->name,
+            dh_count / keypair,
+            dh_count / shared,
+            dh_count / (keypair + shared)
+        );
+    }
+}
+
+static void bench_ed25519(int argc, char** argv)
+{
+    static struct rsa_key_ctx_t C;
+    struct rsa_key_t            K;
+    byte                        seed[ED25519_SEED_SIZE];
+    byte                        pub[ED25519_PUBLIC_SIZE];
+    byte                        hash[SHA256_DIGEST_SIZE];
+    byte                        rsa_sig[BIGINT_MAX];
+    byte*                       msg;
+    byte*                       sig;
+    const byte**                sig_p;
+    const byte**                msg_p;
+    const byte**                pub_p;
+    size_t*                     len;
+    int*                        valid;
+    int                         count     = BENCH_ED25519_COUNT;
+    int                         rsa_count = BENCH_KEYCTX_COUNT;
+    int                         err;
+    int                         i;
+    double                      start;
+    double                      rate[3];
+
+    if (argc > 0)
+        count = atoi(argv[0]);
+    if (argc > 1)
+        rsa_count = atoi(argv[1]);
+
+    if (count < 1 || rsa_count < 1)
+        exit_usage();
+
+    msg   = malloc((size_t)count * BENCH_ED25519_MSG_SIZE);
+    sig   = malloc((size_t)count * ED25519_SIGNATURE_SIZE);
+    sig_p = malloc(sizeof(byte*) * (size_t)count);
+    msg_p = malloc(sizeof(byte*) * (size_t)count);
+    pub_p = malloc(sizeof(byte*) * (size_t)count);
+    len   = malloc(sizeof(size_t) * (size_t)count);
+    valid = malloc(sizeof(int) * (size_t)count);
+    EXIT_EALLOC(msg);
+    EXIT_EALLOC(sig);
+    EXIT_EALLOC(sig_p);
+    EXIT_EALLOC(msg_p);
+    EXIT_EALLOC(pub_p);
+    EXIT_EALLOC(len);
+    EXIT_EALLOC(valid);
+
+    random_get_buffer((char*)msg, (size_t)count * BENCH_ED25519_MSG_SIZE);
+    for (i = 0; i < count; ++i)
+    {
+        msg_p[i] = &msg[BENCH_ED25519_MSG_SIZE * i];
+        sig_p[i] = &sig[ED25519_SIGNATURE_SIZE * i];
+        pub_p[i] = pub;
+        len[i]   = BENCH_ED25519_MSG_SIZE;
+    }
+
+    ed25519_keypair(pub, seed);
+
+    start = bench_now();
+    for (i = 0; i < count; ++i)
+    {
+        ed25519_sign(
+            &sig[ED25519_SIGNATURE_SIZE * i], msg_p[i], len[i], seed, pub
+        );
+    }
+    rate[0] = count / (bench_now() - start);
+
+    start = bench_now();
+    for (i = 0; i < count; ++i)
+        if (ed25519_verify(sig_p[i], msg_p[i], len[i], pub) != 0)
+            EXIT(FATAL_LOGIC, "bench_ed25519", "invalid signature");
+    rate[1] = count / (bench_now() - start);
+
+    start = bench_now();
+    if (ed25519_verify_batch(sig_p, msg_p, len, pub_p, count, valid) != 0)
+        EXIT(FATAL_LOGIC, "bench_ed25519", "invalid signature");
+    rate[2] = count / (bench_now() - start);
+
+    printf(
+        "%10s %12s %12s %12s\n", "signature", "sign/s", "verify/s", "batch/s"
+    );
+    printf("%10s %12.1f %12.1f %12.1f\n", "ed25519", rate[0], rate[1], rate[2]);
+
+    err = rsa_key_generate_exp(&K, 2048, RSA_EXP_F4);
+    if (err != RSA_OK)
+        EXIT(FATAL_LOGIC, "bench_ed25519", rsa_err(err));
+    rsa_key_ctx_init(&C, &K);
+
+    start = bench_now();
+    for (i = 0; i < rsa_count; ++i)
+    {
+        sha256(hash, msg_p[i % count], BENCH_ED25519_MSG_SIZE);
+        if (rsa_ctx_sign_pss(rsa_sig, hash, &C) != RSA_OK)
+            EXIT(FATAL_LOGIC, "bench_ed25519", "RSA-PSS signature");
+    }
+    rate[0] = rsa_count / (bench_now() - start);
+
+    /* Hashing included, as Ed25519 does: the last signature, over and over */
+    start = bench_now();
+    for (i = 0; i < rsa_count; ++i)
+    {
+        sha256(hash, msg_p[(rsa_count - 1) % count], BENCH_ED25519_MSG_SIZE);
+        if (rsa_verify_pss(rsa_sig, hash, &K) != RSA_OK)
+            EXIT(FATAL_LOGIC, "bench_ed25519", "invalid signature");
+    }
+    rate[1] = rsa_count / (bench_now() - start);
+
+    printf("%10s %12.1f %12.1f %12s\n", "rsa-pss", rate[0], rate[1], "-");
+
+    free(msg);
+    free(sig);
+    free(sig_p);
+    free(msg_p);
+    free(pub_p);
+    free(len);
+    free(valid);
+}
+
+static void bench_p256(int argc, char** argv)
+{
+    static struct rsa_key_ctx_t C;
+    struct rsa_key_t            K;
+    byte                        priv[P256_SIZE];
+    byte                        pub[P256_PUBLIC_SIZE];
+    byte                        peer[P256_PUBLIC_SIZE];
+    byte                        sig[P256_SIGNATURE_SIZE];
+    byte                        hash[SHA256_DIGEST_SIZE];
+    byte                        secret[P256_SIZE];
+    byte                        rsa_sig[BIGINT_MAX];
+    byte                        rsa_msg[BIGINT_MAX];
+    int                         count     = BENCH_P256_COUNT;
+    int                         rsa_count = BENCH_KEYCTX_COUNT;
+    int                         len;
+    int                         err;
+    int                         i;
+    double                      start;
+    double                      ec[4];
+    double                      rsa[4];
+
+    if (argc > 0)
+        count = atoi(argv[0]);
+    if (argc > 1)
+        rsa_count = atoi(argv[1]);
+
+    if (count < 1 || rsa_count < 1)
+        exit_usage();
+
+    random_get_buffer((char*)hash, sizeof(hash));
+    p256_keypair(peer, priv);
+
+    start = bench_now();
+    for (i = 0; i < count; ++i)
+        p256_keypair(pub, priv);
+    ec[0] = count / (bench_now() - start);
+
+    /* A different hash each time, as the nonce is derived from it */
+    start = bench_now();
+    for (i = 0; i < count; ++i)
+    {
+        hash[0] = (byte)i;
+        p256_ecdsa_sign(sig, hash, sizeof(hash), priv);
+    }
+    ec[1] = count / (bench_now() - start);
+
+    start = bench_now();
+    for (i = 0; i < count; ++i)
+        if (p256_ecdsa_verify(sig, hash, sizeof(hash), pub) != 0)
+            EXIT(FATAL_LOGIC, "bench_p256", "invalid signature");
+    ec[2] = count / (bench_now() - start);
+
+    start = bench_now();
+    for (i = 0; i < count; ++i)
+        if (p256_ecdh(secret, priv, peer) != 0)
+            EXIT(FATAL_LOGIC, "bench_p256", "invalid public key");
+    ec[3] = count / (bench_now() - start);
+
+    err = rsa_key_generate_exp(&K, 2048, RSA_EXP_F4);
+    if (err != RSA_OK)
+        EXIT(FATAL_LOGIC, "bench_p256", rsa_err(err));
+    rsa_key_ctx_init(&C, &K);
+
+    start = bench_now();
+    for (i = 0; i < rsa_count; ++i)
+        if (rsa_ctx_sign_pss(rsa_sig, hash, &C) != RSA_OK)
+            EXIT(FATAL_LOGIC, "bench_p256", "RSA-PSS signature");
+    rsa[1] = rsa_count / (bench_now() - start);
+
+    start = bench_now();
+    for (i = 0; i < rsa_count; ++i)
+        if (rsa_verify_pss(rsa_sig, hash, &K) != RSA_OK)
+            EXIT(FATAL_LOGIC, "bench_p256", "invalid signature");
+    rsa[2] = rsa_count / (bench_now() - start);
+
+    err = rsa_encrypt_oaep(rsa_sig, secret, P256_SIZE, NULL, 0, &K);
+    if (err != RSA_OK)
+        EXIT(FATAL_LOGIC, "bench_p256", rsa_err(err));
+
+    start = bench_now();
+    for (i = 0; i < rsa_count; ++i)
+        if (rsa_decrypt_oaep(rsa_msg, &len, rsa_sig, NULL, 0, &K) != RSA_OK)
+            EXIT(FATAL_LOGIC, "bench_p256", "RSA-OAEP decryption");
+    rsa[3] = rsa_count / (bench_now() - start);
+
+    printf("%10s %12s %12s\n", "operation", "p-256/s", "rsa-2048/s");
+    printf("%10s %12.1f %12s\n", "keypair", ec[0], "-");
+    printf("%10s %12.1f %12.1f\n", "sign", ec[1], rsa[1]);
+    printf("%10s %12.1f %12.1f\n", "verify", ec[2], rsa[2]);
+    printf("%10s %12.1f %12.1f\n", "exchange", ec[3], rsa[3]);
+}
+
+static void bench_random(int argc, char** argv)
+{
+    struct bench_random_t R;
+    pthread_t*            workers;
+    int*                  started;
+    int                   max_threads = BENCH_RANDOM_THREADS;
+    int                   threads;
+    int                   i;
+    double                start;
+    double                rate;
+
+    R.size  = BENCH_RANDOM_SIZE;
+    R.count = BENCH_RANDOM_COUNT;
+
+    if (argc > 0)
+        max_threads = atoi(argv[0]);
+    if (argc > 1)
+        R.size = atoi(argv[1]);
+    if (argc > 2)
+        R.count = atoi(argv[2]);
+
+    if (max_threads < 1 || R.size < 1 || R.count < 1)
+        exit_usage();
+
+    workers = malloc(sizeof(pthread_t) * (size_t)max_threads);
+    EXIT_EALLOC(workers);
+    started = malloc(sizeof(int) * (size_t)max_threads);
+    EXIT_EALLOC(started);
+
+    printf("%8s %8s %12s %12s\n", "threads", "bytes", "MB/s", "MB/s/thread");
+
+    for (threads = 1; threads <= max_threads; threads *= 2)
+    {
+        /* As in rsa_batch_run, the calling thread is a worker as well */
+        start = bench_now();
+        for (i = 1; i < threads; ++i)
+            started[i] = pthread_create(
+                             &workers[i], NULL, bench_random_worker, &R
+                         ) == 0;
+
+        bench_random_worker(&R);
+
+        for (i = 1; i < threads; ++i)
+            if (started[i])
+                pthread_join(workers[i], NULL);
+
+        rate = (double)R.size * R.count * threads / 1e6 /
+               (bench_now() - start);
+
+        printf(
+            "%8d %8d %12.1f %12.1f\n", threads, R.size, rate, rate / threads
+        );
+    }
+
+    free(started);
+    free(workers);
+}
+
+static void* bench_random_worker(void* arg)
+{
+    bench_random_p R = (bench_random_p)arg;
+    char*          buf;
+    int            i;
+
+    buf = malloc((size_t)R->size);
+    EXIT_EALLOC(buf);
+
+    for (i = 0; i < R->count; ++i)
+        random_get_buffer(buf, (size_t)R->size);
+
+    free(buf);
+
+    return NULL;
+}
+
+static void bench_random_size(int argc, char** argv)
+{
+    char*  buf;
+    size_t size;
+    size_t total = (size_t)BENCH_RANDOM_MB << 20;
+    long   calls;
+    long   i;
+    double rate;
+
+    if (argc > 0)
+    {
+        if (atoi(argv[0]) < 1)
+            exit_usage();
+        total = (size_t)atoi(argv[0]) << 20;
+    }
+
+    buf = malloc((size_t)1 << 20);
+    EXIT_EALLOC(buf);
+
+    printf("source: %s\n", bench_random_name);
+    printf("%8s %10s %12s\n", "bytes", "calls", "MB/s");
+
+    for (size = 16; size <= (size_t)1 << 20; size *= 16)
+    {
+        calls = (long)(total / size);
+
+        rate = bench_now();
+        for (i = 0; i < calls; ++i)
+            random_get_buffer(buf, size);
+        rate = (double)size * (double)calls / 1e6 / (bench_now() - rate);
+
+        printf("%8lu %10ld %12.1f\n", (unsigned long)size, calls, rate);
+    }
+
+    free(buf);
+}
+
+static void bench_suite(int argc, char** argv)
+{
+    static const char* modes[]        = {"ecb", "cbc", "ofb", "cfb", "ctr"};
+    static const int   sizes[]        = {16, 1024, 16384};
+    static const int   random_sizes[] = {16, 4096, 1 << 20};
+
+    struct bench_suite_t  S;
+    struct bench_aes_t    A;
+    struct bench_bigint_t B;
+    struct bench_buffer_t R;
+    char                  name[32];
+    char                  group[32];
+    int                   keyN;
+    int                   bits;
+    int                   j;
+
+    S.format = BENCH_TEXT;
+    S.time   = BENCH_SUITE_TIME;
+    S.only   = NULL;
+    S.count  = 0;
+
+    if (argc > 0)
+    {
+        if (strcmp(argv[0], "csv") == 0)
+            S.format = BENCH_CSV;
+        else if (strcmp(argv[0], "json") == 0)
+            S.format = BENCH_JSON;
+        else if (strcmp(argv[0], "text") != 0)
+            exit_usage();
+    }
+    if (argc > 1)
+        S.time = atof(argv[1]);
+    if (argc > 2 && strcmp(argv[2], "all") != 0)
+        S.only = argv[2];
+
+    if (S.time <= 0)
+        exit_usage();
+
+    if (S.format == BENCH_TEXT)
+        printf(
+            "%-8s %-8s %8s %12s %10s %14s %10s\n",
+            "group",
+            "name",
+            "param",
+            "ops/s",
+            "MB/s",
+            "cycles/op",
+            "cycles/B"
+        );
+    else if (S.format == BENCH_CSV)
+        printf(
+            "group,name,param,bytes,ops_per_sec,mb_per_sec,cycles_per_op,"
+            "cycles_per_byte\n"
+        );
+    else
+        printf(
+            "{\"time\": %g, \"aes_features\": %d, \"sha2_features\": %d, "
+            "\"results\": [\n",
+            S.time,
+            aes_features(),
+            sha2_features()
+        );
+
+    /* AES: every mode, both directions, each key size */
+    A.src = malloc((size_t)sizes[2]);
+    EXIT_EALLOC(A.src);
+    A.dst = malloc((size_t)sizes[2]);
+    EXIT_EALLOC(A.dst);
+    random_get_buffer(A.src, (size_t)sizes[2]);
+    random_get_buffer((char*)A.key, sizeof(A.key));
+    random_get_buffer(A.iv, sizeof(A.iv));
+
+    for (keyN = 16; keyN <= 32; keyN += 8)
+    {
+        sprintf(group, "aes-%d", keyN * 8);
+        A.keyN = keyN;
+
+        for (A.mode = MODE_ECB; A.mode <= MODE_CTR; ++A.mode)
+            for (A.decrypt = 0; A.decrypt < 2; ++A.decrypt)
+                for (j = 0; j < 3; ++j)
+                {
+                    sprintf(
+                        name,
+                        "%s-%s",
+                        modes[A.mode - MODE_ECB],
+                        A.decrypt ? "dec" : "enc"
+                    );
+                    A.size = sizes[j];
+                    bench_suite_run(
+                        &S,
+                        group,
+                        name,
+                        A.size,
+                        (size_t)A.size,
+                        bench_op_aes,
+                        &A
+                    );
+                }
+    }
+
+    free(A.dst);
+    free(A.src);
+
+    /* bigint: products (and their remainders) must fit BIGINT_MAX bytes */
+    for (bits = 1024; 2 * bits <= 8 * BIGINT_MAX; bits *= 2)
+    {
+        bigint_init_rand(&B.N, (size_t)(bits / 8));
+        bigint_init_rand(&B.M, (size_t)(bits / 8));
+        bigint_setbit(&B.N, bits - 1, 1);
+        bigint_setbit(&B.M, bits - 1, 1);
+        bench_suite_run(&S, "bigint", "mul", bits, 0, bench_op_mul, &B);
+
+        bigint_mul(&B.E, &B.N, &B.M);
+        bigint_copy(&B.N, &B.E);
+        bench_suite_run(&S, "bigint", "mod", bits, 0, bench_op_mod, &B);
+    }
+
+    for (bits = 1024; bits <= 8 * BIGINT_MAX; bits *= 2)
+    {
+        bigint_init_rand(&B.N, (size_t)(bits / 8));
+        bigint_init_rand(&B.E, (size_t)(bits / 8));
+        bigint_init_rand(&B.M, (size_t)(bits / 8));
+        bigint_setbit(&B.M, bits - 1, 1);
+        bigint_setbit(&B.M, 0, 1);
+        bigint_mod(&B.DST, &B.N, &B.M);
+        bigint_copy(&B.N, &B.DST);
+        bench_suite_run(
+            &S, "bigint", "exp_mod", bits, 0, bench_op_exp_mod, &B
+        );
+    }
+
+    /* RSA key generation */
+    for (bits = 1024; bits <= 2048; bits *= 2)
+        bench_suite_run(&S, "rsa", "keygen", bits, 0, bench_op_keygen, &bits);
+
+    /* random_get_buffer */
+    R.buf = malloc((size_t)random_sizes[2]);
+    EXIT_EALLOC(R.buf);
+
+    for (j = 0; j < 3; ++j)
+    {
+        R.size = (size_t)random_sizes[j];
+        bench_suite_run(
+            &S,
+            "random",
+            bench_random_name,
+            random_sizes[j],
+            R.size,
+            bench_op_random,
+            &R
+        );
+    }
+
+    free(R.buf);
+
+    if (S.format == BENCH_JSON)
+        printf("\n]}\n");
+}
+
+static void bench_suite_run(
+    bench_suite_p S,
+    const char*   group,
+    const char*   name,
+    int           param,
+    size_t        bytes,
+    bench_op_t    op,
+    void*         arg
+)
+{
+    long     n;
+    long     i;
+    double   start;
+    double   elapsed;
+    double   ops;
+    double   cycles;
+    uint64_t tsc;
+
+    if (S->only != NULL && strncmp(group, S->only, strlen(S->only)) != 0)
+        return;
+
+    /* Warm-up: caches, tables built on first use, clock frequency */
+    start = bench_now();
+    do
+        op(arg);
+    while (bench_now() - start < S->time / 4);
+
+    for (n = 1;; n *= 2)
+    {
+        tsc   = bench_tsc();
+        start = bench_now();
+        for (i = 0; i < n; ++i)
+            op(arg);
+        elapsed = bench_now() - start;
+        tsc     = bench_tsc() - tsc;
+
+        if (elapsed >= S->time)
+            break;
+    }
+
+    ops    = (double)n / elapsed;
+    cycles = (double)tsc / (double)n;
+
+    if (S->format == BENCH_TEXT)
+    {
+        printf("%-8s %-8s %8d %12.1f ", group, name, param, ops);
+        if (bytes > 0)
+            printf("%10.2f ", ops * (double)bytes / 1e6);
+        else
+            printf("%10s ", "-");
+        if (BENCH_TSC && bytes > 0)
+            printf("%14.0f %10.2f\n", cycles, cycles / (double)bytes);
+        else if (BENCH_TSC)
+            printf("%14.0f %10s\n", cycles, "-");
+        else
+            printf("%14s %10s\n", "-", "-");
+    }
+    else if (S->format == BENCH_CSV)
+    {
+        printf(
+            "%s,%s,%d,%lu,%.3f,", group, name, param, (unsigned long)bytes, ops
+        );
+        if (bytes > 0)
+            printf("%.3f,", ops * (double)bytes / 1e6);
+        else
+            printf(",");
+        if (BENCH_TSC)
+            printf("%.1f,", cycles);
+        else
+            printf(",");
+        if (BENCH_TSC && bytes > 0)
+            printf("%.3f\n", cycles / (double)bytes);
+        else
+            printf("\n");
+    }
+    else
+    {
+        printf(
+            "%s  {\"group\": \"%s\", \"name\": \"%s\", \"param\": %d, "
+            "\"bytes\": %lu, \"ops_per_sec\": %.3f, ",
+            S->count > 0 ? ",\n" : "",
+            group,
+            name,
+            param,
+            (unsigned long)bytes,
+            ops
+        );
+        if (bytes > 0)
+            printf("\"mb_per_sec\": %.3f, ", ops * (double)bytes / 1e6);
+        else
+            printf("\"mb_per_sec\": null, ");
+        if (BENCH_TSC)
+            printf("\"cycles_per_op\": %.1f, ", cycles);
+        else
+            printf("\"cycles_per_op\": null, ");
+        if (BENCH_TSC && bytes > 0)
+            printf("\"cycles_per_byte\": %.3f}", cycles / (double)bytes);
+        else
+            printf("\"cycles_per_byte\": null}");
+    }
+
+    ++S->count;
+    fflush(stdout);
+}
+
+static void bench_op_aes(void* arg)
+{
+    bench_aes_p A = (bench_aes_p)arg;
+
+    if (A->decrypt)
+        aes_decrypt(
+            A->dst,
+            A->src,
+            A->key,
+            A->size,
+            A->size,
+            A->keyN,
+            A->iv,
+            PAD_NONE,
+            A->mode
+        );
+    else
+        aes_encrypt(
+            A->src,
+            A->dst,
+            A->key,
+            A->size,
+            A->size,
+            A->keyN,
+            A->iv,
+            PAD_NONE,
+            A->mode
+        );
+}
+
+static void bench_op_mul(void* arg)
+{
+    bench_bigint_p B = (bench_bigint_p)arg;
+
+    bigint_mul(&B->DST, &B->N, &B->M);
+}
+
+static void bench_op_mod(void* arg)
+{
+    bench_bigint_p B = (bench_bigint_p)arg;
+
+    bigint_mod(&B->DST, &B->N, &B->M);
+}
+
+static void bench_op_exp_mod(void* arg)
+{
+    bench_bigint_p B = (bench_bigint_p)arg;
+
+    bigint_exp_mod(&B->DST, &B->N, &B->E, &B->M);
+}
+
+static void bench_op_keygen(void* arg)
+{
+    struct rsa_key_t K;
+
+    rsa_key_generate(&K, *(int*)arg);
+}
+
+static void bench_op_random(void* arg)
+{
+    bench_buffer_p R = (bench_buffer_p)arg;
+
+    random_get_buffer(R->buf, R->size);
+}
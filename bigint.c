@@ -18,22 +18,86 @@ static int CACHE_1BITS_IN_BYTE[] = {
     4, 5, 5, 6, 5, 6, 6, 7, 5, 6, 6, 7, 6, 7, 7, 8
 };
 
+/* Value of each hexadecimal digit, -1 for any other character */
+static int CACHE_HEX_VALUE[] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, -1,
+    -1, -1, -1, -1, -1, -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1
+};
+
+static const char HEX_DIGITS[] = "0123456789abcdef";
+
 /* --- HELPERS --- */
 static int max(int, int);
 static int max(int a, int b) { return a > b ? a : b; }
 
-int hex2int(char);
-int hex2int(char ch)
-{
-    if (ch >= '0' && ch <= '9')
-        return ch - '0';
-    if (ch >= 'a' && ch <= 'f')
-        return ch - 'a' + 10;
-    if (ch >= 'A' && ch <= 'F')
-        return ch - 'A' + 10;
-
-    return -1;
-}
+static int min(int, int);
+static int min(int a, int b) { return a < b ? a : b; }
+
+/* 32-bit limbs of a number of BIGINT_MAX bytes */
+#define BIGINT_LIMBS (BIGINT_MAX / 4)
+
+/* Decimal conversions work on chunks of 9 digits, 10^9 being the greatest power
+ * of 10 that fits a 32-bit limb */
+#define BIGINT_DEC_CHUNK 9
+#define BIGINT_DEC_BASE 1000000000
+
+/* Decimal form of N (see bigint_tostring) */
+static void bigint_tostring_dec(char* dst, bigint_p N);
+
+/* N -> L, where L has n limbs; N must fit them */
+static void bigint_to_limbs(uint32_t* L, bigint_p N, int n);
+
+/* L -> N, where L has n limbs */
+static void bigint_from_limbs(bigint_p N, uint32_t* L, int n);
+
+/* DST <- A * B * R^-1 mod C->M (CIOS method). A and B have C->n limbs, A is
+ * less than C->M and B less than R; DST can overlap with both. */
+static void
+bigint_mont_mul_limbs(uint32_t* DST, uint32_t* A, uint32_t* B, bigint_mont_p C);
+
+/* DST <- T * R^-1 mod C->M (Montgomery reduction). T has 2 * C->n limbs and
+ * must be less than C->M * R. */
+static void bigint_mont_redc(uint32_t* DST, uint32_t* T, bigint_mont_p C);
+
+/* x <- 2 * x mod C->M, x < C->M */
+static void bigint_mont_double(uint32_t* x, bigint_mont_p C);
+
+/* Constant-time helpers, on n limbs; `mask` is either all ones or zero.
+ * - bigint_ct_select: DST <- mask ? A : B (DST can overlap with both);
+ * - bigint_ct_swap: A <-> B if mask;
+ * - bigint_ct_lookup: DST <- table[index], reading every entry.
+ */
+static void
+bigint_ct_select(uint32_t* DST, uint32_t* A, uint32_t* B, uint32_t mask, int n);
+static void bigint_ct_swap(uint32_t* A, uint32_t* B, uint32_t mask, int n);
+static void bigint_ct_lookup(
+    uint32_t* DST,
+    uint32_t (*table)[BIGINT_MONT_LIMBS],
+    int      size,
+    uint32_t index,
+    int      n
+);
+
+/* All ones if x is zero, zero otherwise, without branches */
+static uint32_t bigint_ct_iszero(uint32_t x);
+
+/* Base of the exponentiations: N mod C->M and R mod C->M (the Montgomery
+ * representation of 1), both in Montgomery representation */
+static void bigint_mont_exp_init(
+    uint32_t* base, uint32_t* one, bigint_p N, bigint_mont_p C
+);
 /* --- END HELPERS --- */
 
 /* --- BIGINT IMPL --- */
@@ -70,8 +134,8 @@ void bigint_init_rand(bigint_p N, size_t max_bytes)
 
     random_get_buffer((char*)N->num, max_bytes);
     memset(&N->num[max_bytes], 0, sizeof(N->num) - max_bytes);
-    bigint_set_internal(N);
     N->overflow = 0;
+    bigint_set_internal(N);
 }
 
 void bigint_copy(bigint_p DST, bigint_p N)
@@ -100,6 +164,19 @@ int bigint_eq_byte(bigint_p N, byte n)
 
 int bigint_iseven(bigint_p N) { return !(N->num[0] & 1); }
 
+int bigint_mod_int(bigint_p N, int m)
+{
+    int i;
+    int r = 0;
+
+    /* Horner, from the most significant byte: r * 256 + 255 fits an int as
+     * long as m < 2^23 */
+    for (i = N->max_exp; i >= 0; --i)
+        r = (r * 256 + N->num[i]) % m;
+
+    return r;
+}
+
 void bigint_or(bigint_p DST, bigint_p N, bigint_p M)
 {
     int i;
@@ -164,6 +241,10 @@ void bigint_sub(bigint_p DST, bigint_p N, bigint_p M)
 
     bigint_sum(DST, N, &complM); /* Subtraction using compl. 2 */
     DST->overflow = 0;           /* Overflow is not an error */
+
+    /* bigint_sum skips bigint_set_internal on overflow, which here is the
+     * expected outcome: internals must be refreshed. */
+    bigint_set_internal(DST);
 }
 
 void bigint_sub_int(bigint_p DST, bigint_p N, int m)
@@ -176,53 +257,45 @@ void bigint_sub_int(bigint_p DST, bigint_p N, int m)
 
 void bigint_mul(bigint_p DST, bigint_p N, bigint_p M)
 {
-    int      hm1N;        /* How many 1-value bits there are in N */
-    int      hm1M;        /*                                    M */
-    bigint_p tmp = NULL;  /* Used to swap */
-    int      i;           /* iterator */
-    int      done_shifts; /* Number of shifts already done */
-
-    /* ADDEE */
-    struct bigint_t ADDEE;
-    struct bigint_t PROD;
+    uint32_t a[2 * BIGINT_LIMBS];
+    uint32_t b[2 * BIGINT_LIMBS];
+    uint32_t prod[4 * BIGINT_LIMBS];
+    uint64_t acc;
+    int      na; /* Limbs in use of N */
+    int      nb; /*                 M */
+    int      i;
+    int      j;
 
     DST->overflow = N->overflow || M->overflow;
     if (DST->overflow)
         return;
 
-    hm1N = bigint_how_many_1bits(N);
-    hm1M = bigint_how_many_1bits(M);
-
-    if (hm1N > hm1M)
-    {
-        tmp = N;
-        N   = M;
-        M   = tmp;
-    }
-
-    /* Now N has got the smallest amount of 1 bits.
-     * N will be used to shift M and in order to find addees */
+    /* Schoolbook, on 32-bit limbs; N and M are read before DST is written,
+     * hence any overlap is fine */
+    na = N->max_exp / 4 + 1;
+    nb = M->max_exp / 4 + 1;
+    bigint_to_limbs(a, N, na);
+    bigint_to_limbs(b, M, nb);
 
-    bigint_init(&PROD);
-    bigint_copy(&ADDEE, M);
-    done_shifts = 0;
+    memset(prod, 0, sizeof(uint32_t) * (size_t)(na + nb));
 
-    for (i = 0; i < 8 * 2 * BIGINT_MAX; ++i)
+    for (i = 0; i < na; ++i)
     {
-        if (bigint_getbit(N, i) == 0)
-            continue;
-
-        /* ADDEE <- M << i
-         * Shift M by i; since ADDEE is M shifted by done_shifts, it is
-         * sufficiend to shift it by i - done_shifts */
-        bigint_shiftl(&ADDEE, &ADDEE, i - done_shifts);
-        done_shifts = i;
-
-        /* PROD <- PROD + ADDEE */
-        bigint_sum(&PROD, &PROD, &ADDEE);
+        acc = 0;
+        for (j = 0; j < nb; ++j)
+        {
+            acc = (uint64_t)prod[i + j] + (uint64_t)a[i] * b[j] + (acc >> 32);
+            prod[i + j] = (uint32_t)acc;
+        }
+        prod[i + nb] = (uint32_t)(acc >> 32);
     }
 
-    bigint_copy(DST, &PROD);
+    bigint_from_limbs(DST, prod, min(na + nb, 2 * BIGINT_LIMBS));
+
+    /* Digits beyond 2 * BIGINT_MAX are lost */
+    for (i = 2 * BIGINT_LIMBS; i < na + nb; ++i)
+        if (prod[i])
+            DST->overflow = 1;
 }
 
 void bigint_square(bigint_p DST, bigint_p N)
@@ -325,21 +398,35 @@ int bigint_getbit(bigint_p N, int weight)
 void bigint_shiftl(bigint_p DST, bigint_p N, int n)
 {
     int i;
+    int byte_shift = n >> 3;
+    int bit_shift  = n & 7;
+    int hi;
+    int lo;
 
     DST->overflow = N->overflow || n < 0;
     if (DST->overflow)
         return;
 
-    bigint_copy(DST, N);
-
-    if (n == 0)
+    if (byte_shift >= 2 * BIGINT_MAX)
+    {
+        bigint_init(DST);
         return;
+    }
+
+    /* Going from the most significant byte down, each byte of N is read before
+     * it can be overwritten, hence DST and N can overlap. */
+    for (i = 2 * BIGINT_MAX - 1; i >= byte_shift; --i)
+    {
+        hi = N->num[i - byte_shift] << bit_shift;
+        lo = 0;
 
-    for (i = 8 * 2 * BIGINT_MAX - 1; i >= n; --i)
-        bigint_setbit(DST, i, bigint_getbit(N, i - n));
+        if (bit_shift && i - byte_shift - 1 >= 0)
+            lo = N->num[i - byte_shift - 1] >> (8 - bit_shift);
+
+        DST->num[i] = (byte)((hi | lo) & 0xff);
+    }
 
-    for (i = 0; i < n && i < 8 * 2 * BIGINT_MAX; ++i)
-        bigint_setbit(DST, i, 0);
+    memset(DST->num, 0, (size_t)byte_shift);
 
     bigint_set_internal(DST);
 }
@@ -347,21 +434,34 @@ void bigint_shiftl(bigint_p DST, bigint_p N, int n)
 void bigint_shiftr(bigint_p DST, bigint_p N, int n)
 {
     int i;
+    int byte_shift = n >> 3;
+    int bit_shift  = n & 7;
+    int hi;
+    int lo;
 
     DST->overflow = N->overflow || n < 0;
     if (DST->overflow)
         return;
 
-    bigint_copy(DST, N);
-
-    if (n == 0)
+    if (byte_shift >= 2 * BIGINT_MAX)
+    {
+        bigint_init(DST);
         return;
+    }
+
+    /* Going from the least significant byte up: see bigint_shiftl */
+    for (i = 0; i < 2 * BIGINT_MAX - byte_shift; ++i)
+    {
+        lo = N->num[i + byte_shift] >> bit_shift;
+        hi = 0;
+
+        if (bit_shift && i + byte_shift + 1 < 2 * BIGINT_MAX)
+            hi = N->num[i + byte_shift + 1] << (8 - bit_shift);
 
-    for (i = 0; i < 8 * 2 * BIGINT_MAX - n; ++i)
-        bigint_setbit(DST, i, bigint_getbit(N, i + n));
+        DST->num[i] = (byte)((hi | lo) & 0xff);
+    }
 
-    for (i = 8 * 2 * BIGINT_MAX - n; i < 2 * 8 * BIGINT_MAX; ++i)
-        bigint_setbit(DST, i, 0);
+    memset(&DST->num[2 * BIGINT_MAX - byte_shift], 0, (size_t)byte_shift);
 
     bigint_set_internal(DST);
 }
@@ -486,28 +586,39 @@ void bigint_eec(bigint_p DST, bigint_p T, bigint_p N, bigint_p M)
 
 void bigint_exp_mod(bigint_p DST, bigint_p N, bigint_p E, bigint_p M)
 {
-    struct bigint_t base;
-    struct bigint_t e;
-    struct bigint_t one;
+    struct bigint_t      base;
+    struct bigint_t      e;
+    struct bigint_mont_t C;
+    int                  i;
+
+    if (bigint_mont_init(&C, M))
+    {
+        bigint_mont_exp(DST, N, E, &C);
+        return;
+    }
 
-    bigint_copy(&base, N);
+    /* Left-to-right square and multiply: E is only scanned, never modified,
+     * and the loop stops at its most significant 1 bit. The cost is hence
+     * proportional to the bit length of E, which makes short exponents (e.g.
+     * 65537) much cheaper than full-length ones. */
     bigint_copy(&e, E);
+    bigint_mod(&base, N, M);
     bigint_init_by_int(DST, 1);
-    bigint_init_by_int(&one, 1);
 
-    while (!bigint_iszero(&e))
+    if (bigint_iszero(&e))
+        return;
+
+    bigint_copy(DST, &base);
+
+    for (i = e.max_digit2 - 1; i >= 0; --i)
     {
-        if (bigint_iseven(&e))
-        {
-            bigint_square(&base, &base);
-            bigint_shiftr(&e, &e, 1);
-            bigint_mod(&base, &base, M);
-        }
-        else
+        bigint_square(DST, DST);
+        bigint_mod(DST, DST, M);
+
+        if (bigint_getbit(&e, i))
         {
             bigint_mul(DST, DST, &base);
             bigint_mod(DST, DST, M);
-            bigint_sub(&e, &e, &one);
         }
     }
 }
@@ -520,6 +631,538 @@ void bigint_exp(bigint_p DST, bigint_p N, bigint_p E)
     bigint_exp_mod(DST, N, E, &MAX_BIGINT);
 }
 
+/* --- MONTGOMERY IMPL --- */
+static void bigint_to_limbs(uint32_t* L, bigint_p N, int n)
+{
+    int i;
+
+    for (i = 0; i < n; ++i)
+        L[i] = (uint32_t)N->num[4 * i] | (uint32_t)N->num[4 * i + 1] << 8 |
+               (uint32_t)N->num[4 * i + 2] << 16 |
+               (uint32_t)N->num[4 * i + 3] << 24;
+}
+
+static void bigint_from_limbs(bigint_p N, uint32_t* L, int n)
+{
+    int i;
+
+    bigint_init(N);
+
+    for (i = 0; i < n; ++i)
+    {
+        N->num[4 * i]     = (byte)(L[i] & 0xff);
+        N->num[4 * i + 1] = (byte)(L[i] >> 8 & 0xff);
+        N->num[4 * i + 2] = (byte)(L[i] >> 16 & 0xff);
+        N->num[4 * i + 3] = (byte)(L[i] >> 24 & 0xff);
+    }
+
+    bigint_set_internal(N);
+}
+
+static void
+bigint_mont_mul_limbs(uint32_t* DST, uint32_t* A, uint32_t* B, bigint_mont_p C)
+{
+    uint32_t t[BIGINT_MONT_LIMBS + 2];
+    uint32_t d[BIGINT_MONT_LIMBS];
+    uint64_t acc;
+    uint64_t borrow;
+    uint32_t u;
+    int      n = C->n;
+    int      i;
+    int      j;
+
+    memset(t, 0, sizeof(uint32_t) * (size_t)(n + 2));
+
+    for (i = 0; i < n; ++i)
+    {
+        /* t <- t + A * B[i] */
+        acc = 0;
+        for (j = 0; j < n; ++j)
+        {
+            acc  = (uint64_t)t[j] + (uint64_t)A[j] * B[i] + (acc >> 32);
+            t[j] = (uint32_t)acc;
+        }
+        acc      = (uint64_t)t[n] + (acc >> 32);
+        t[n]     = (uint32_t)acc;
+        t[n + 1] = (uint32_t)(acc >> 32);
+
+        /* t <- (t + u * M) / 2^32, where u makes the sum divisible */
+        u   = t[0] * C->minv;
+        acc = (uint64_t)t[0] + (uint64_t)u * C->m[0];
+        for (j = 1; j < n; ++j)
+        {
+            acc      = (uint64_t)t[j] + (uint64_t)u * C->m[j] + (acc >> 32);
+            t[j - 1] = (uint32_t)acc;
+        }
+        acc      = (uint64_t)t[n] + (acc >> 32);
+        t[n - 1] = (uint32_t)acc;
+        t[n]     = t[n + 1] + (uint32_t)(acc >> 32);
+    }
+
+    /* t < 2M: t - M is kept unless it borrows; selected with a mask, for
+     * the constant-time exponentiations */
+    borrow = 0;
+    for (j = 0; j < n; ++j)
+    {
+        acc    = (uint64_t)t[j] - C->m[j] - borrow;
+        d[j]   = (uint32_t)acc;
+        borrow = (acc >> 32) & 1;
+    }
+
+    bigint_ct_select(
+        DST, d, t, ~bigint_ct_iszero(t[n] | (uint32_t)(borrow ^ 1)), n
+    );
+}
+
+static void bigint_mont_redc(uint32_t* DST, uint32_t* T, bigint_mont_p C)
+{
+    uint32_t t[2 * BIGINT_MONT_LIMBS + 1];
+    uint32_t d[BIGINT_MONT_LIMBS];
+    uint64_t acc;
+    uint64_t borrow;
+    uint32_t u;
+    int      n = C->n;
+    int      i;
+    int      j;
+
+    memcpy(t, T, sizeof(uint32_t) * (size_t)(2 * n));
+    t[2 * n] = 0;
+
+    /* Limb by limb, t <- t + u * M * 2^(32 * i), where u clears limb i */
+    for (i = 0; i < n; ++i)
+    {
+        u   = t[i] * C->minv;
+        acc = 0;
+        for (j = 0; j < n; ++j)
+        {
+            acc = (uint64_t)t[i + j] + (uint64_t)u * C->m[j] + (acc >> 32);
+            t[i + j] = (uint32_t)acc;
+        }
+
+        /* The carry goes all the way up, whatever its value */
+        for (j = i + n; j <= 2 * n; ++j)
+        {
+            acc  = (uint64_t)t[j] + (acc >> 32);
+            t[j] = (uint32_t)acc;
+        }
+    }
+
+    /* t / R < 2M: t / R - M is kept unless it borrows */
+    borrow = 0;
+    for (j = 0; j < n; ++j)
+    {
+        acc    = (uint64_t)t[n + j] - C->m[j] - borrow;
+        d[j]   = (uint32_t)acc;
+        borrow = (acc >> 32) & 1;
+    }
+
+    bigint_ct_select(
+        DST, d, &t[n], ~bigint_ct_iszero(t[2 * n] | (uint32_t)(borrow ^ 1)), n
+    );
+}
+
+static void bigint_mont_double(uint32_t* x, bigint_mont_p C)
+{
+    uint32_t d[BIGINT_MONT_LIMBS];
+    uint64_t acc;
+    uint64_t borrow;
+    uint32_t carry = 0;
+    int      j;
+
+    for (j = 0; j < C->n; ++j)
+    {
+        acc   = (uint64_t)x[j] << 1 | carry;
+        x[j]  = (uint32_t)acc;
+        carry = (uint32_t)(acc >> 32);
+    }
+
+    borrow = 0;
+    for (j = 0; j < C->n; ++j)
+    {
+        acc    = (uint64_t)x[j] - C->m[j] - borrow;
+        d[j]   = (uint32_t)acc;
+        borrow = (acc >> 32) & 1;
+    }
+
+    if (carry || !borrow)
+        memcpy(x, d, sizeof(uint32_t) * (size_t)C->n);
+}
+
+static void
+bigint_ct_select(uint32_t* DST, uint32_t* A, uint32_t* B, uint32_t mask, int n)
+{
+    int j;
+
+    for (j = 0; j < n; ++j)
+        DST[j] = (A[j] & mask) | (B[j] & ~mask);
+}
+
+static void bigint_ct_swap(uint32_t* A, uint32_t* B, uint32_t mask, int n)
+{
+    uint32_t x;
+    int      j;
+
+    for (j = 0; j < n; ++j)
+    {
+        x = (A[j] ^ B[j]) & mask;
+        A[j] ^= x;
+        B[j] ^= x;
+    }
+}
+
+static void bigint_ct_lookup(
+    uint32_t* DST,
+    uint32_t (*table)[BIGINT_MONT_LIMBS],
+    int      size,
+    uint32_t index,
+    int      n
+)
+{
+    uint32_t mask;
+    int      i;
+    int      j;
+
+    memset(DST, 0, sizeof(uint32_t) * (size_t)n);
+
+    for (i = 0; i < size; ++i)
+    {
+        mask = bigint_ct_iszero((uint32_t)i ^ index);
+        for (j = 0; j < n; ++j)
+            DST[j] |= table[i][j] & mask;
+    }
+}
+
+static uint32_t bigint_ct_iszero(uint32_t x)
+{
+    /* x | -x has the top bit set unless x is zero */
+    return ((x | (0 - x)) >> 31) - 1;
+}
+
+static void bigint_mont_exp_init(
+    uint32_t* base, uint32_t* one, bigint_p N, bigint_mont_p C
+)
+{
+    uint32_t        x[BIGINT_MONT_LIMBS];
+    struct bigint_t B;
+
+    if (bigint_cmp(N, &C->M) >= 0)
+        bigint_mont_mod(&B, N, C);
+    else
+        bigint_copy(&B, N);
+
+    memset(x, 0, sizeof(x));
+    x[0] = 1;
+    bigint_mont_mul_limbs(one, C->rr, x, C);
+
+    bigint_to_limbs(x, &B, C->n);
+    bigint_mont_mul_limbs(base, C->rr, x, C);
+}
+
+int bigint_mont_init(bigint_mont_p C, bigint_p M)
+{
+    uint32_t inv;
+    uint64_t acc;
+    uint64_t borrow;
+    uint32_t two[BIGINT_MONT_LIMBS];
+    int      b;
+    int      i;
+    int      j;
+
+    if (M->overflow || bigint_iseven(M) || M->max_exp >= BIGINT_MAX)
+        return 0;
+
+    memset(C, 0, sizeof(struct bigint_mont_t));
+    bigint_copy(&C->M, M);
+    C->n = M->max_exp / 4 + 1;
+    bigint_to_limbs(C->m, M, C->n);
+
+    /* Newton's iteration doubles the correct low bits of M^-1 mod 2^32 at
+     * each step; m itself is correct to 3 bits, as m * m = 1 mod 8 */
+    inv = C->m[0];
+    for (i = 0; i < 4; ++i)
+        inv *= 2 - C->m[0] * inv;
+    C->minv = (uint32_t)0 - inv;
+
+    /* 2^b mod M = 2^b - M, where b is the bit length of M: that is -M mod
+     * 2^(32 * n), truncated to b bits */
+    borrow = 0;
+    for (j = 0; j < C->n; ++j)
+    {
+        acc      = (uint64_t)0 - C->m[j] - borrow;
+        C->rr[j] = (uint32_t)acc;
+        borrow   = (acc >> 32) & 1;
+    }
+    b = M->max_digit2 + 1;
+    if (b % 32)
+        C->rr[C->n - 1] &= ((uint32_t)1 << (b % 32)) - 1;
+
+    /* 2R mod M, the Montgomery representation of 2 */
+    for (i = b; i <= 32 * C->n; ++i)
+        bigint_mont_double(C->rr, C);
+
+    /* R^2 mod M is the Montgomery representation of R = 2^(32 * n), that is
+     * of 2 raised to 32 * n: square and multiply, left-to-right */
+    memcpy(two, C->rr, sizeof(uint32_t) * (size_t)C->n);
+    for (i = 0; (32 * C->n) >> (i + 1); ++i)
+        ;
+    for (--i; i >= 0; --i)
+    {
+        bigint_mont_mul_limbs(C->rr, C->rr, C->rr, C);
+        if ((32 * C->n) >> i & 1)
+            bigint_mont_mul_limbs(C->rr, C->rr, two, C);
+    }
+
+    return 1;
+}
+
+void bigint_mont_exp(bigint_p DST, bigint_p N, bigint_p E, bigint_mont_p C)
+{
+    uint32_t table[16][BIGINT_MONT_LIMBS]; /* base^i, Montgomery */
+    uint32_t x[BIGINT_MONT_LIMBS];
+    uint32_t one[BIGINT_MONT_LIMBS];
+    int      w;
+    int      nibble;
+    int      i;
+
+    DST->overflow = N->overflow || E->overflow;
+    if (DST->overflow)
+        return;
+
+    bigint_mont_exp_init(table[1], table[0], N, C);
+    for (i = 2; i < 16; ++i)
+        bigint_mont_mul_limbs(table[i], table[i - 1], table[1], C);
+
+    /* Left-to-right, one nibble of E at a time; E is only read, and DST is
+     * written last, hence they can overlap */
+    memcpy(x, table[0], sizeof(uint32_t) * (size_t)C->n);
+
+    for (w = E->max_digit2 / 4; w >= 0; --w)
+    {
+        for (i = 0; i < 4; ++i)
+            bigint_mont_mul_limbs(x, x, x, C);
+
+        nibble = E->num[w / 2] >> (4 * (w % 2)) & 0xf;
+        if (nibble)
+            bigint_mont_mul_limbs(x, x, table[nibble], C);
+    }
+
+    memset(one, 0, sizeof(one));
+    one[0] = 1;
+    bigint_mont_mul_limbs(x, x, one, C);
+    bigint_from_limbs(DST, x, C->n);
+}
+
+void bigint_mont_exp_ct(
+    bigint_p DST, bigint_p N, bigint_p E, int bits, bigint_mont_p C
+)
+{
+    uint32_t table[16][BIGINT_MONT_LIMBS]; /* base^i, Montgomery */
+    uint32_t x[BIGINT_MONT_LIMBS];
+    uint32_t y[BIGINT_MONT_LIMBS];
+    uint32_t nibble;
+    int      w;
+    int      i;
+
+    DST->overflow = N->overflow || E->overflow;
+    if (DST->overflow)
+        return;
+
+    bigint_mont_exp_init(table[1], table[0], N, C);
+    for (i = 2; i < 16; ++i)
+        bigint_mont_mul_limbs(table[i], table[i - 1], table[1], C);
+
+    /* Same as bigint_mont_exp, but the number of nibbles depends on `bits`
+     * only, and there is a multiplication for zero nibbles as well (by
+     * table[0], that is 1) */
+    memcpy(x, table[0], sizeof(uint32_t) * (size_t)C->n);
+
+    for (w = (bits + 3) / 4 - 1; w >= 0; --w)
+    {
+        for (i = 0; i < 4; ++i)
+            bigint_mont_mul_limbs(x, x, x, C);
+
+        nibble = (uint32_t)(E->num[w / 2] >> (4 * (w % 2)) & 0xf);
+        bigint_ct_lookup(y, table, 16, nibble, C->n);
+        bigint_mont_mul_limbs(x, x, y, C);
+    }
+
+    memset(y, 0, sizeof(y));
+    y[0] = 1;
+    bigint_mont_mul_limbs(x, x, y, C);
+    bigint_from_limbs(DST, x, C->n);
+}
+
+void bigint_mont_ladder_ct(
+    bigint_p DST, bigint_p N, bigint_p E, int bits, bigint_mont_p C
+)
+{
+    uint32_t r0[BIGINT_MONT_LIMBS];
+    uint32_t r1[BIGINT_MONT_LIMBS];
+    uint32_t mask;
+    int      i;
+
+    DST->overflow = N->overflow || E->overflow;
+    if (DST->overflow)
+        return;
+
+    /* r0 = base^k, r1 = base^(k + 1), where k is the part of E read so far */
+    bigint_mont_exp_init(r1, r0, N, C);
+
+    for (i = bits - 1; i >= 0; --i)
+    {
+        mask = 0 - (uint32_t)(E->num[i / 8] >> (i % 8) & 1);
+
+        /* Bit set: r0 <- r0 * r1, r1 <- r1^2; else the other way around */
+        bigint_ct_swap(r0, r1, mask, C->n);
+        bigint_mont_mul_limbs(r1, r0, r1, C);
+        bigint_mont_mul_limbs(r0, r0, r0, C);
+        bigint_ct_swap(r0, r1, mask, C->n);
+    }
+
+    memset(r1, 0, sizeof(r1));
+    r1[0] = 1;
+    bigint_mont_mul_limbs(r0, r0, r1, C);
+    bigint_from_limbs(DST, r0, C->n);
+}
+
+void bigint_mont_mod(bigint_p DST, bigint_p N, bigint_mont_p C)
+{
+    uint32_t t[2 * BIGINT_MONT_LIMBS];
+    uint32_t s[2 * BIGINT_MONT_LIMBS];
+    uint64_t acc;
+    int      n = C->n;
+    int      j;
+
+    /* Up to R^2 only */
+    if (N->overflow || N->max_exp >= 8 * n)
+    {
+        bigint_mod(DST, N, &C->M);
+        return;
+    }
+
+    /* N = H * R + L, with H and L less than R. H * R mod M is the Montgomery
+     * product of R^2 and H: R^2 goes first, as only the first operand of
+     * bigint_mont_mul_limbs must be less than M */
+    bigint_to_limbs(t, N, 2 * n);
+    bigint_mont_mul_limbs(&t[n], C->rr, &t[n], C);
+
+    /* s = H * R mod M + L < M + R <= M * R, a valid input of REDC */
+    memset(s, 0, sizeof(uint32_t) * (size_t)(2 * n));
+    acc = 0;
+    for (j = 0; j < n; ++j)
+    {
+        acc  = (uint64_t)t[j] + t[n + j] + (acc >> 32);
+        s[j] = (uint32_t)acc;
+    }
+    s[n] = (uint32_t)(acc >> 32);
+
+    /* REDC(s) = s * R^-1, then multiplied by R^2 in Montgomery form: s */
+    bigint_mont_redc(s, s, C);
+    bigint_mont_mul_limbs(s, C->rr, s, C);
+    bigint_from_limbs(DST, s, n);
+}
+
+void bigint_mont_to(bigint_p DST, bigint_p N, bigint_mont_p C)
+{
+    uint32_t x[BIGINT_MONT_LIMBS];
+
+    bigint_to_limbs(x, N, C->n);
+    bigint_mont_mul_limbs(x, x, C->rr, C);
+    bigint_from_limbs(DST, x, C->n);
+}
+
+void bigint_mont_from(bigint_p DST, bigint_p N, bigint_mont_p C)
+{
+    uint32_t x[BIGINT_MONT_LIMBS];
+    uint32_t one[BIGINT_MONT_LIMBS];
+
+    memset(one, 0, sizeof(one));
+    one[0] = 1;
+
+    bigint_to_limbs(x, N, C->n);
+    bigint_mont_mul_limbs(x, x, one, C);
+    bigint_from_limbs(DST, x, C->n);
+}
+
+void bigint_mont_mul(bigint_p DST, bigint_p N, bigint_p M, bigint_mont_p C)
+{
+    uint32_t a[BIGINT_MONT_LIMBS];
+    uint32_t b[BIGINT_MONT_LIMBS];
+
+    bigint_to_limbs(a, N, C->n);
+    bigint_to_limbs(b, M, C->n);
+    bigint_mont_mul_limbs(a, a, b, C);
+    bigint_from_limbs(DST, a, C->n);
+}
+
+void bigint_comb_init(bigint_comb_p T, bigint_p G, int bits, bigint_mont_p C)
+{
+    uint32_t tooth[BIGINT_COMB_TEETH][BIGINT_MONT_LIMBS]; /* G^(2^(i * d)) */
+    int      a;
+    int      i;
+    int      j;
+
+    T->bits = bits;
+    T->d    = (bits + BIGINT_COMB_TEETH - 1) / BIGINT_COMB_TEETH;
+
+    bigint_mont_exp_init(tooth[0], T->table[0], G, C);
+    for (i = 1; i < BIGINT_COMB_TEETH; ++i)
+    {
+        memcpy(tooth[i], tooth[i - 1], sizeof(uint32_t) * (size_t)C->n);
+        for (j = 0; j < T->d; ++j)
+            bigint_mont_mul_limbs(tooth[i], tooth[i], tooth[i], C);
+    }
+
+    /* Each combination is the one without its highest tooth, times that
+     * tooth: one multiplication per entry */
+    for (a = 1; a < 1 << BIGINT_COMB_TEETH; ++a)
+    {
+        for (i = 0; a >> (i + 1); ++i)
+            ;
+        bigint_mont_mul_limbs(T->table[a], T->table[a ^ 1 << i], tooth[i], C);
+    }
+}
+
+void bigint_comb_exp_ct(
+    bigint_p DST, bigint_p E, bigint_comb_p T, bigint_mont_p C
+)
+{
+    uint32_t x[BIGINT_MONT_LIMBS];
+    uint32_t y[BIGINT_MONT_LIMBS];
+    uint32_t index;
+    int      bit;
+    int      i;
+    int      j;
+
+    DST->overflow = E->overflow;
+    if (DST->overflow)
+        return;
+
+    /* Column j of E picks the entry with the teeth i whose bit i * d + j is
+     * set; the squarings shift what was gathered so far by one column */
+    memcpy(x, T->table[0], sizeof(uint32_t) * (size_t)C->n);
+
+    for (j = T->d - 1; j >= 0; --j)
+    {
+        bigint_mont_mul_limbs(x, x, x, C);
+
+        index = 0;
+        for (i = 0; i < BIGINT_COMB_TEETH; ++i)
+        {
+            bit = i * T->d + j;
+            index |= (uint32_t)(E->num[bit / 8] >> (bit % 8) & 1) << i;
+        }
+
+        bigint_ct_lookup(y, T->table, 1 << BIGINT_COMB_TEETH, index, C->n);
+        bigint_mont_mul_limbs(x, x, y, C);
+    }
+
+    memset(y, 0, sizeof(y));
+    y[0] = 1;
+    bigint_mont_mul_limbs(x, x, y, C);
+    bigint_from_limbs(DST, x, C->n);
+}
+
 /* --- SBIGING IMPL */
 void sbigint_init(sbigint_p N)
 {
@@ -546,18 +1189,14 @@ void sbigint_copy(sbigint_p N, sbigint_p M)
 
 int bigint_import(bigint_p N, char* dumped)
 {
-    int  iBuf;
-    int  iDump;
-    int  iNum;
-    int  dumpLen;
-    char buf[BIGINT_DUMP_SIZE];
-    int  tmp;
-    byte lh;
-    byte uh;
+    int dumpLen;
+    int iDump;
+    int iNum;
+    int lh;
+    int uh;
 
     bigint_init(N);
 
-    /* Init Buf */
     dumpLen = (int)strlen(dumped);
 
     /* Invalid format: an odd dumpLen is not allowed as each byte must be
@@ -569,38 +1208,85 @@ int bigint_import(bigint_p N, char* dumped)
     if (dumpLen > 2 * BIGINT_MAX)
         return 0;
 
-    iDump = dumpLen - 1;
-    iBuf  = 0;
-
-    while (iDump >= 0)
+    /* From the end of the string, that is from the least significant byte:
+     * no need to reverse it first */
+    for (iDump = dumpLen - 2, iNum = 0; iDump >= 0; iDump -= 2, ++iNum)
     {
-        buf[iBuf] = dumped[iDump];
+        uh = CACHE_HEX_VALUE[(byte)dumped[iDump]];
+        lh = CACHE_HEX_VALUE[(byte)dumped[iDump + 1]];
+
+        if (uh < 0 || lh < 0)
+            return 0;
 
-        ++iBuf;
-        --iDump;
+        N->num[iNum] = (byte)(uh << 4 | lh);
     }
 
-    /* Import */
-    iNum = 0;
-    iBuf = 0;
+    bigint_set_internal(N);
+
+    return 1;
+}
 
-    while (iBuf < dumpLen)
+int bigint_import_dec(bigint_p N, const char* str)
+{
+    uint32_t L[BIGINT_LIMBS];
+    uint64_t acc;
+    uint64_t carry;
+    uint32_t scale;
+    int      n = 0; /* Limbs in use */
+    int      len;
+    int      digits;
+    int      i = 0;
+    int      j;
+
+    bigint_init(N);
+
+    len = (int)strlen(str);
+    if (len == 0)
+        return 0;
+
+    /* Horner, one chunk at a time: the first chunk takes the digits in excess,
+     * so that all the others are BIGINT_DEC_CHUNK digits long */
+    digits = len % BIGINT_DEC_CHUNK;
+    if (digits == 0)
+        digits = BIGINT_DEC_CHUNK;
+
+    while (i < len)
     {
-        tmp = hex2int(buf[iBuf]);
-        if (tmp < 0)
-            return 0;
-        lh  = (byte)tmp;
+        carry = 0;
+        scale = 1;
+        for (j = 0; j < digits; ++j, ++i)
+        {
+            if (str[i] < '0' || str[i] > '9')
+                return 0;
 
-        tmp = hex2int(buf[iBuf + 1]);
-        if (tmp < 0)
-            return 0;
-        uh = (byte)tmp;
+            carry = carry * 10 + (uint64_t)(str[i] - '0');
+            scale *= 10;
+        }
+        digits = BIGINT_DEC_CHUNK;
+
+        /* L <- L * scale + chunk, where the chunk is the initial carry */
+        for (j = 0; j < n; ++j)
+        {
+            acc   = (uint64_t)L[j] * scale + carry;
+            L[j]  = (uint32_t)acc;
+            carry = acc >> 32;
+        }
+
+        if (carry)
+        {
+            if (n == BIGINT_LIMBS)
+                return 0;
 
-        /* Join uh and lh */
-        N->num[iNum] = (byte)(lh | (uh << 4));
+            L[n++] = (uint32_t)carry;
+        }
+    }
 
-        iNum += 1;
-        iBuf += 2;
+    for (i = 0; i < n; ++i)
+    {
+        N->num[4 * i]     = (byte)(L[i] & 0xff);
+        N->num[4 * i + 1] = (byte)(L[i] >> 8 & 0xff);
+        N->num[4 * i + 2] = (byte)(L[i] >> 16 & 0xff);
+        N->num[4 * i + 3] = (byte)(L[i] >> 24 & 0xff);
     }
 
     bigint_set_internal(N);
@@ -613,7 +1299,7 @@ void bigint_tostring(char* dst, bigint_p N, int base)
     int iNum = BIGINT_MAX - 1;
     int iDst = 0;
 
-    if (base != 16)
+    if (base != 16 && base != 10)
     {
         strcpy(dst, "!!! unsupported base");
         return;
@@ -625,10 +1311,17 @@ void bigint_tostring(char* dst, bigint_p N, int base)
         return;
     }
 
+    if (base == 10)
+    {
+        bigint_tostring_dec(dst, N);
+        return;
+    }
+
     /* Exceeding BIGINT_MAX is overflow in the user context */
     while (iNum >= 0)
     {
-        sprintf(dst + iDst, "%02x", N->num[iNum]);
+        dst[iDst]     = HEX_DIGITS[N->num[iNum] >> 4];
+        dst[iDst + 1] = HEX_DIGITS[N->num[iNum] & 0xf];
         iNum -= 1;
         iDst += 2;
     }
@@ -636,6 +1329,88 @@ void bigint_tostring(char* dst, bigint_p N, int base)
     dst[iDst] = '\0';
 }
 
+static void bigint_tostring_dec(char* dst, bigint_p N)
+{
+    char     buf[BIGINT_DUMP10_SIZE];
+    uint32_t L[BIGINT_LIMBS];
+    uint64_t cur;
+    uint32_t rem;
+    int      n;
+    int      pos = BIGINT_DUMP10_SIZE - 1;
+    int      i;
+
+    n = BIGINT_LIMBS;
+    for (i = 0; i < n; ++i)
+        L[i] = (uint32_t)N->num[4 * i] | (uint32_t)N->num[4 * i + 1] << 8 |
+               (uint32_t)N->num[4 * i + 2] << 16 |
+               (uint32_t)N->num[4 * i + 3] << 24;
+
+    while (n > 0 && L[n - 1] == 0)
+        --n;
+
+    buf[pos] = '\0';
+
+    /* Schoolbook division by 10^9, from the most significant limb: each pass
+     * yields the next 9 digits, from the least significant ones */
+    while (n > 0)
+    {
+        rem = 0;
+        for (i = n - 1; i >= 0; --i)
+        {
+            cur  = (uint64_t)rem << 32 | L[i];
+            L[i] = (uint32_t)(cur / BIGINT_DEC_BASE);
+            rem  = (uint32_t)(cur % BIGINT_DEC_BASE);
+        }
+
+        while (n > 0 && L[n - 1] == 0)
+            --n;
+
+        /* The most significant chunk has no leading zeros */
+        for (i = 0; i < BIGINT_DEC_CHUNK && (n > 0 || rem > 0); ++i)
+        {
+            buf[--pos] = (char)('0' + rem % 10);
+            rem /= 10;
+        }
+    }
+
+    if (buf[pos] == '\0')
+        buf[--pos] = '0';
+
+    strcpy(dst, &buf[pos]);
+}
+
+int bigint_export_bytes(byte* dst, bigint_p N)
+{
+    int i;
+    int len;
+
+    if (bigint_iszero(N))
+        return 0;
+
+    len = N->max_exp + 1;
+    for (i = 0; i < len; ++i)
+        dst[i] = N->num[len - 1 - i];
+
+    return len;
+}
+
+int bigint_import_bytes(bigint_p N, const byte* src, int len)
+{
+    int i;
+
+    bigint_init(N);
+
+    if (len < 0 || len > BIGINT_MAX)
+        return 0;
+
+    for (i = 0; i < len; ++i)
+        N->num[i] = src[len - 1 - i];
+
+    bigint_set_internal(N);
+
+    return 1;
+}
+
 void sbigint_sum(sbigint_p DST, sbigint_p N, sbigint_p M)
 {
     M->sign *= -1;
@@ -645,11 +1420,9 @@ void sbigint_sum(sbigint_p DST, sbigint_p N, sbigint_p M)
 
 void sbigint_sub(sbigint_p DST, sbigint_p N, sbigint_p M)
 {
-    int flagNgtM;
-    int flagSignN;   /* true: >0, false: <0, U.B. ==0 */
-    int flagSignM;   /* true: >0, false: <0, U.B. ==0 */
-    int flagSignOUT; /* true: >0, false: <0, U.B. ==0 */
-    int noOp = 0;
+    int flagNgeM;  /* |N| >= |M| */
+    int flagSignN; /* true: >0, false: <0 */
+    int flagSignM; /* true: >0, false: <0 */
 
     if (M->sign == 0)
     {
@@ -666,76 +1439,39 @@ void sbigint_sub(sbigint_p DST, sbigint_p N, sbigint_p M)
 
     /* Now surely N and M are not 0 */
 
-    /*
-     * |N| > |M|   signN   signM   signOUT   Calc.        E.G.      = OUT     #
-     * true        + (8)   + (3)   +         |N| - |M|    8 -   3  = +(8-3)   1
-     * true        + (8)   - (3)   +         |N| + |M|    8 - (-3) = +(8+3)   2
-     * true        - (8)   + (3)   -         |N| - |M|   -8 +   3  = -(8-3)   1
-     * true        - (8)   - (3)   -         |N| + |M|   -8 - (-3) = -(8+3)   2
-     * false       + (3)   + (8)   -         |M| - |N|    3 -   8  = -(8-3)   3
-     * false       + (3)   - (8)   +         |N| + |M|    3 - (-8) = +(8+3)   2
-     * false       - (3)   + (8)   -         |M| - |N|   -3 -   8  = -(8-3)   3
-     * false       - (3)   - (8)   +         |M| - |N|   -3 - (-8) = +(8-3)   3
-     */
-
     /* State */
-    flagNgtM  = bigint_cmp(&N->N, &M->N) > 0;
+    flagNgeM  = bigint_cmp(&N->N, &M->N) >= 0;
     flagSignN = N->sign > 0;
     flagSignM = M->sign > 0;
 
-    /* Out */
-
-    /* flagSignOUT = flagNgtM  &&  flagSignN && flagSignM  +   << Fact 1
-     *               flagNgtM  &&  flagSignN && !flagSignM +   << Fact 1
-     *               !flagNgtM &&  flagSignN && !flagSignM +   << Fact 2
-     *               !flagNgtM && !flagSignN && !flagSignM     << Fact 2
-     *
-     *             =  flagNgtM && flagSignN +                  << Fact 1
-     *               !flagNgtM && !flagSignM                   << Fact 2
-     *
-     *             = flagNgtM && flagSignN + !(flagNgtM + flagSignM)
-     */
-    flagSignOUT = (flagNgtM && flagSignN) || !(flagNgtM || flagSignM);
-
-    /* #1: flagNgtM &&  flagSignN && flagSignM +
-     *     flagNgtM && !flagSignN && flagSignM
-     *
-     *   : flagNgtM && flagSignM
-     */
-    if (flagNgtM && flagSignM)
-        noOp = 1;
-
     /*
-     * #2:  flagNgtM &&  flagSignN && !flagSignM +   << Fact 1
-     *      flagNgtM && !flagSignN && !flagSignM +   << Fact 2
-     *     !flagNgtM &&  flagSignN && !flagSignM
+     * signN != signM: |N| + |M|, with the sign of N:
+     *      8 - (-3) = +(8+3)
+     *     -8 -   3  = -(8+3)
      *
-     *   :   flagNgtM && !flagSignM +
-     *      !flagNgtM &&  flagSignN && !flagSignM
+     * signN == signM: difference of the magnitudes, with the sign of N if
+     * |N| >= |M|, with the opposite one otherwise:
+     *      8 -   3  = +(8-3)      3 -   8  = -(8-3)
+     *     -8 - (-3) = -(8-3)     -3 - (-8) = +(8-3)
      */
-    if ((flagNgtM && !flagSignM) || (!flagNgtM && flagSignN && !flagSignM))
-        noOp = 2;
-
-    if (!noOp)
-        noOp = 3;
-
-    /* Computing */
-    DST->sign = flagSignOUT ? 1 : -1;
-
-    switch (noOp)
+    if (flagSignN != flagSignM)
     {
-    case 1:
-        bigint_sub(&DST->N, &N->N, &M->N);
-        break;
-    case 2:
         bigint_sum(&DST->N, &N->N, &M->N);
-        break;
-    case 3:
+        DST->sign = flagSignN ? 1 : -1;
+    }
+    else if (flagNgeM)
+    {
+        bigint_sub(&DST->N, &N->N, &M->N);
+        DST->sign = flagSignN ? 1 : -1;
+    }
+    else
+    {
         bigint_sub(&DST->N, &M->N, &N->N);
-        break;
-    default:
-        EXIT(FATAL_LOGIC, "sbigint_sub", "noOp undefined");
+        DST->sign = flagSignN ? -1 : 1;
     }
+
+    if (bigint_iszero(&DST->N))
+        DST->sign = 0;
 }
 
 void sbigint_mul(sbigint_p DST, sbigint_p N, sbigint_p M)
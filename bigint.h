@@ -1,6 +1,8 @@
 #ifndef CMC_CRYPTO_BIGINT_H_INCLUDED
 #define CMC_CRYPTO_BIGINT_H_INCLUDED
 
+#include <stdint.h>
+
 #include "types.h"
 
 #ifndef BIGINT_MAX
@@ -12,6 +14,9 @@
  */
 #define BIGINT_DUMP_SIZE (2 * BIGINT_MAX + 1)
 
+/* Decimal form: log10(256) < 2.5 digits for each byte, +1 -> NUL-terminator */
+#define BIGINT_DUMP10_SIZE (BIGINT_MAX * 5 / 2 + 1)
+
 typedef struct bigint_t
 {
     byte num[2 * BIGINT_MAX]; /* Big integer represented in base 256 */
@@ -20,6 +25,24 @@ typedef struct bigint_t
     int  max_digit2; /* Most significant non-zero bit [0,8*2*BIGINT_MAX) */
 }* bigint_p;
 
+/* Montgomery contexts work on 32-bit limbs; the modulus can be up to
+ * BIGINT_MAX bytes long */
+#define BIGINT_MONT_LIMBS (BIGINT_MAX / 4)
+
+/* Montgomery arithmetic modulo an odd M: values are represented as x * R mod M,
+ * with R = 2^(32 * n), so that products are reduced without divisions.
+ *
+ * A context is built once per modulus by bigint_mont_init and is only read
+ * afterwards: it can be shared among threads. */
+typedef struct bigint_mont_t
+{
+    struct bigint_t M;
+    uint32_t        m[BIGINT_MONT_LIMBS];  /* M, least significant limb first */
+    uint32_t        rr[BIGINT_MONT_LIMBS]; /* R^2 mod M */
+    uint32_t        minv;                  /* -M^-1 mod 2^32 */
+    int             n;                     /* Limbs of M */
+}* bigint_mont_p;
+
 typedef struct sbigint_t
 {
     struct bigint_t N;
@@ -51,12 +74,43 @@ extern void bigint_copy(bigint_p N, bigint_p M);
  */
 extern int bigint_import(bigint_p N, char* dumped);
 
-/* `dst` is assumed to have a minimum size of BIGINT_DUMP_SIZE */
+/* Same as bigint_import, for a decimal string (digits only, any length)
+ *
+ * RETURN
+ * true  -> import went fine
+ * false -> import failed: not a decimal number, or exceeding BIGINT_MAX bytes
+ */
+extern int bigint_import_dec(bigint_p N, const char* str);
+
+/* base 16 -> all the BIGINT_MAX bytes of N, as 2 * BIGINT_MAX hex digits;
+ *            `dst` is assumed to have a minimum size of BIGINT_DUMP_SIZE.
+ * base 10 -> decimal, without leading zeros; `dst` is assumed to have a
+ *            minimum size of BIGINT_DUMP10_SIZE.
+ */
 extern void bigint_tostring(char* dst, bigint_p N, int base);
 
+/* Big-endian binary form of N, without leading zeros (zero has no bytes at
+ * all). `dst` is assumed to have a minimum size of BIGINT_MAX.
+ *
+ * RETURN
+ * Number of bytes written
+ */
+extern int bigint_export_bytes(byte* dst, bigint_p N);
+
+/* Inverse of bigint_export_bytes; leading zeros are allowed.
+ *
+ * RETURN
+ * true  -> import went fine
+ * false -> import failed: len is negative or greater than BIGINT_MAX
+ */
+extern int bigint_import_bytes(bigint_p N, const byte* src, int len);
+
 extern int  bigint_iszero(bigint_p N);
 extern int  bigint_eq_byte(bigint_p N, byte n);
 extern int  bigint_iseven(bigint_p N);
+
+/* Remainder of N divided by m, where m must be in (0, 2^23) (no check) */
+extern int bigint_mod_int(bigint_p N, int m);
 extern void bigint_or(bigint_p DST, bigint_p N, bigint_p M);
 extern void bigint_sum(bigint_p DST, bigint_p N, bigint_p M);
 
@@ -105,9 +159,99 @@ extern void bigint_quotient(bigint_p DST, bigint_p N, bigint_p M);
  * */
 extern void bigint_eec(bigint_p DST, bigint_p T, bigint_p N, bigint_p M);
 
+/* Left-to-right square and multiply; its cost is proportional to the bit
+ * length of E, not to BIGINT_MAX. DST can overlap with N and E, not with M.
+ *
+ * If M is odd (as RSA moduli and primes are), a Montgomery context is built
+ * and bigint_mont_exp is used instead: callers doing many exponentiations with
+ * the same modulus should build the context once and call it directly. */
 extern void bigint_exp_mod(bigint_p DST, bigint_p N, bigint_p E, bigint_p M);
 extern void bigint_exp(bigint_p DST, bigint_p N, bigint_p E);
 
+/* MONTGOMERY INTERFACE */
+
+/* RETURN
+ * true  -> C is ready;
+ * false -> M is even, or longer than BIGINT_MAX bytes.
+ */
+extern int bigint_mont_init(bigint_mont_p C, bigint_p M);
+
+/* Same as bigint_exp_mod, with modulus C->M. It uses a fixed 4-bit window.
+ * DST can overlap with N and E. */
+extern void
+bigint_mont_exp(bigint_p DST, bigint_p N, bigint_p E, bigint_mont_p C);
+
+/* Same as bigint_mont_exp, in constant time for private exponents: E is read
+ * as a number of `bits` bits (e.g. the bit length of C->M), and the sequence
+ * of operations and memory accesses depends on `bits` only, not on the values
+ * of E and N (with N less than C->M, otherwise it is reduced first).
+ * - bigint_mont_exp_ct: fixed 4-bit window, with a multiplication for zero
+ *   nibbles as well; every table entry is read at each lookup, and the one
+ *   needed is selected with masks;
+ * - bigint_mont_ladder_ct: Montgomery ladder, a multiplication and a squaring
+ *   per bit, and no table; about 70% slower.
+ *
+ * DST can overlap with N and E.
+ */
+extern void bigint_mont_exp_ct(
+    bigint_p DST, bigint_p N, bigint_p E, int bits, bigint_mont_p C
+);
+extern void bigint_mont_ladder_ct(
+    bigint_p DST, bigint_p N, bigint_p E, int bits, bigint_mont_p C
+);
+
+/* DST <- N mod C->M, much faster than bigint_mod for N < R^2, where
+ * R = 2^(32 * C->n) (e.g. for N < C->M^2); bigint_mod is used otherwise. */
+extern void bigint_mont_mod(bigint_p DST, bigint_p N, bigint_mont_p C);
+
+/* Conversions to and from the Montgomery representation: DST <- N * R mod M
+ * and DST <- N * R^-1 mod M. N must be less than C->M. */
+extern void bigint_mont_to(bigint_p DST, bigint_p N, bigint_mont_p C);
+extern void bigint_mont_from(bigint_p DST, bigint_p N, bigint_mont_p C);
+
+/* DST <- N * M * R^-1 mod C->M, that is the Montgomery representation of the
+ * product if N and M are in Montgomery representation. N and M must be less
+ * than C->M; DST can overlap with both. */
+extern void
+bigint_mont_mul(bigint_p DST, bigint_p N, bigint_p M, bigint_mont_p C);
+
+/* FIXED-BASE COMB INTERFACE */
+
+/* Teeth of a comb: its table has 2^BIGINT_COMB_TEETH entries */
+#ifndef BIGINT_COMB_TEETH
+#define BIGINT_COMB_TEETH 6
+#endif
+
+/* Fixed-base comb (Lim-Lee) for G^E mod C->M, when G never changes (e.g. the
+ * generator of a Diffie-Hellman group). E, of up to `bits` bits, is read as
+ * BIGINT_COMB_TEETH rows of d bits, d = bits / BIGINT_COMB_TEETH rounded up:
+ * the entry of the table for the combination of teeth a is the product of
+ * G^(2^(i * d)) over the bits i set in a, in Montgomery representation. One
+ * column of E at a time, an exponentiation takes d squarings and d
+ * multiplications, instead of `bits` squarings and bits / 4 multiplications.
+ *
+ * A comb is built once per base by bigint_comb_init and is only read
+ * afterwards: it can be shared among threads. It is large (the table has room
+ * for BIGINT_MAX bytes per entry), better not on the stack. */
+typedef struct bigint_comb_t
+{
+    uint32_t table[1 << BIGINT_COMB_TEETH][BIGINT_MONT_LIMBS];
+    int      bits; /* Exponents up to `bits` bits */
+    int      d;    /* Distance between two teeth, in bits */
+}* bigint_comb_p;
+
+/* T <- comb of G for exponents up to `bits` bits, modulo C->M */
+extern void
+bigint_comb_init(bigint_comb_p T, bigint_p G, int bits, bigint_mont_p C);
+
+/* DST <- G^E mod C->M, where G is the base of T and E has up to T->bits bits
+ * at most. In constant time, as bigint_mont_exp_ct: d
+ * squarings and d multiplications whatever E is, and every table entry is
+ * read at each lookup. DST can overlap with E. */
+extern void bigint_comb_exp_ct(
+    bigint_p DST, bigint_p E, bigint_comb_p T, bigint_mont_p C
+);
+
 /* SBIGINT INTERFACE */
 extern void sbigint_init(sbigint_p N);
 extern void sbigint_init_by_int(sbigint_p N, int n);
@@ -0,0 +1,78 @@
+#ifndef CMC_CRYPTO_DH_INCLUDED
+#define CMC_CRYPTO_DH_INCLUDED
+
+#include "bigint.h"
+
+/* Finite-field Diffie-Hellman groups, all with generator 2 and a safe prime
+ * p = 2q + 1; p is at most BIGINT_MAX bytes long, hence the larger groups of
+ * RFC 3526 and RFC 7919 (6144 and 8192 bits) are not available. */
+enum
+{
+    DH_MODP1536 = 0, /* RFC 3526, group 5 */
+    DH_MODP2048,     /* RFC 3526, group 14 */
+    DH_MODP3072,     /* RFC 3526, group 15 */
+    DH_MODP4096,     /* RFC 3526, group 16 */
+    DH_FFDHE2048,    /* RFC 7919 */
+    DH_FFDHE3072,    /* RFC 7919 */
+    DH_FFDHE4096,    /* RFC 7919 */
+
+    __dh_group_sentinel
+};
+
+/* A group is built once, on first use, and is only read afterwards: it can be
+ * shared among threads. Besides the Montgomery context of p, it holds the comb
+ * of the generator (see bigint_comb_init) for exponents of exp_bits bits, so
+ * that public keys take a few multiplications per bit of the exponent. */
+typedef struct dh_group_t
+{
+    struct bigint_mont_t C;        /* Modulo p */
+    struct bigint_t      p1;       /* p - 1 */
+    bigint_comb_p        G;        /* Comb of the generator */
+    const char*          name;     /* e.g. "ffdhe2048" */
+    int                  bits;     /* Bit length of p */
+    int                  size;     /* Bytes of p, public keys and secrets */
+    int                  exp_bits; /* Bit length of private exponents */
+}* dh_group_p;
+
+typedef struct dh_key_t
+{
+    struct bigint_t x; /* Private exponent */
+    struct bigint_t y; /* Public key: 2^x mod p */
+    dh_group_p      G;
+}* dh_key_p;
+
+/* RETURN
+ * Group `id` (DH_MODP1536, ...), built if needed; NULL if id is out of range.
+ */
+extern dh_group_p dh_group_get(int id);
+
+/* Same as dh_group_get, by name: "modp1536", ..., "ffdhe2048", ...
+ *
+ * RETURN
+ * NULL if there is no such group
+ */
+extern dh_group_p dh_group_by_name(const char* name);
+
+/* K <- new key pair of group G: x is random, of exactly G->exp_bits bits, and
+ * y = 2^x mod p is computed with the comb of the generator, in constant time.
+ *
+ * Private exponents are short, as both RFCs allow: about twice the strength of
+ * the group, that is the upper bound given by RFC 3526 for the MODP groups and
+ * the length given by RFC 7919 for the others (e.g. 320 and 225 bits for p of
+ * 2048 bits). */
+extern void dh_keypair(dh_key_p K, dh_group_p G);
+
+/* dst <- y, as G->size big-endian bytes (leading zeros included) */
+extern void dh_export_public(byte* dst, dh_key_p K);
+
+/* dst <- shared secret, peer^x mod p, as G->size big-endian bytes (leading
+ * zeros included, as TLS 1.3 does). The exponentiation is constant-time.
+ *
+ * RETURN
+ * 0 -> dst is the secret;
+ * 1 -> the peer public key is not in [2, p - 2] (RFC 7919, section 5.1), dst
+ *      is left untouched.
+ */
+extern int dh_shared_secret(byte* dst, dh_key_p K, bigint_p peer);
+
+#endif /* CMC_CRYPTO_DH_INCLUDED */
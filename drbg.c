@@ -0,0 +1,132 @@
+#include <string.h>
+
+#include "aes.h"
+#include "drbg.h"
+#include "error.h"
+
+/* CTR_DRBG_Update (SP 800-90A, 10.2.1.2): (key, V) <- keystream of the
+ * counter blocks V + 1, V + 2, V + 3 under key, XOR data (none if NULL) */
+static void drbg_update(drbg_p D, const byte* data);
+
+/* (key, V) <- (0, 0), then drbg_update with entropy ^ extra; 1 -> counter */
+static void drbg_seed(drbg_p D, const byte* entropy, const byte* extra);
+
+/* --- IMPL */
+
+void drbg_instantiate(drbg_p D, const byte* entropy, const byte* personal)
+{
+    memset(D->key, 0, DRBG_KEY_SIZE);
+    memset(D->V, 0, DRBG_BLOCK_SIZE);
+    drbg_seed(D, entropy, personal);
+}
+
+void drbg_reseed(drbg_p D, const byte* entropy, const byte* additional)
+{
+    drbg_seed(D, entropy, additional);
+}
+
+int drbg_generate(drbg_p D, byte* dst, size_t len, const byte* additional)
+{
+    byte      tmp[DRBG_SEED_SIZE];
+    byte      iv[DRBG_BLOCK_SIZE];
+    aes_ctr_p ctr;
+    int       i;
+
+    if (len > DRBG_MAX_REQUEST)
+        EXIT(FATAL_LOGIC, "drbg_generate", "len > DRBG_MAX_REQUEST");
+
+    if (D->reseed_counter > DRBG_RESEED_INTERVAL)
+        return 1;
+
+    if (additional != NULL)
+        drbg_update(D, additional);
+
+    /* The output is the keystream from V + 1 on, and the update that follows
+     * goes on from the first counter block not used: one stream serves
+     * both */
+    memcpy(iv, D->V, DRBG_BLOCK_SIZE);
+    for (i = DRBG_BLOCK_SIZE - 1; i >= 0; --i)
+        if (++iv[i] != 0)
+            break;
+
+    ctr = aes_ctr_new(D->key, DRBG_KEY_SIZE, (char*)iv);
+    if (ctr == NULL)
+        EXIT(FATAL_LOGIC, "drbg_generate", "aes_ctr_new");
+
+    memset(dst, 0, len);
+    aes_ctr_update(ctr, (char*)dst, (char*)dst, (int)len);
+
+    /* Rest of the last output block, discarded */
+    memset(tmp, 0, DRBG_SEED_SIZE);
+    if (len % DRBG_BLOCK_SIZE != 0)
+        aes_ctr_update(
+            ctr,
+            (char*)tmp,
+            (char*)tmp,
+            (int)(DRBG_BLOCK_SIZE - len % DRBG_BLOCK_SIZE)
+        );
+
+    if (additional != NULL)
+        memcpy(tmp, additional, DRBG_SEED_SIZE);
+    else
+        memset(tmp, 0, DRBG_SEED_SIZE);
+
+    aes_ctr_update(ctr, (char*)tmp, (char*)tmp, DRBG_SEED_SIZE);
+    aes_ctr_free(ctr);
+
+    memcpy(D->key, tmp, DRBG_KEY_SIZE);
+    memcpy(D->V, &tmp[DRBG_KEY_SIZE], DRBG_BLOCK_SIZE);
+    ++D->reseed_counter;
+
+    memset(tmp, 0, DRBG_SEED_SIZE);
+    memset(iv, 0, DRBG_BLOCK_SIZE);
+
+    return 0;
+}
+
+void drbg_wipe(drbg_p D) { memset(D, 0, sizeof(struct drbg_t)); }
+
+static void drbg_update(drbg_p D, const byte* data)
+{
+    byte      tmp[DRBG_SEED_SIZE];
+    byte      iv[DRBG_BLOCK_SIZE];
+    aes_ctr_p ctr;
+    int       i;
+
+    memcpy(iv, D->V, DRBG_BLOCK_SIZE);
+    for (i = DRBG_BLOCK_SIZE - 1; i >= 0; --i)
+        if (++iv[i] != 0)
+            break;
+
+    if (data != NULL)
+        memcpy(tmp, data, DRBG_SEED_SIZE);
+    else
+        memset(tmp, 0, DRBG_SEED_SIZE);
+
+    ctr = aes_ctr_new(D->key, DRBG_KEY_SIZE, (char*)iv);
+    if (ctr == NULL)
+        EXIT(FATAL_LOGIC, "drbg_update", "aes_ctr_new");
+
+    aes_ctr_update(ctr, (char*)tmp, (char*)tmp, DRBG_SEED_SIZE);
+    aes_ctr_free(ctr);
+
+    memcpy(D->key, tmp, DRBG_KEY_SIZE);
+    memcpy(D->V, &tmp[DRBG_KEY_SIZE], DRBG_BLOCK_SIZE);
+
+    memset(tmp, 0, DRBG_SEED_SIZE);
+    memset(iv, 0, DRBG_BLOCK_SIZE);
+}
+
+static void drbg_seed(drbg_p D, const byte* entropy, const byte* extra)
+{
+    byte seed[DRBG_SEED_SIZE];
+    int  i;
+
+    for (i = 0; i < DRBG_SEED_SIZE; ++i)
+        seed[i] = extra != NULL ? (byte)(entropy[i] ^ extra[i]) : entropy[i];
+
+    drbg_update(D, seed);
+    D->reseed_counter = 1;
+
+    memset(seed, 0, DRBG_SEED_SIZE);
+}
@@ -0,0 +1,55 @@
+#ifndef CMC_CRYPTO_DRBG_INCLUDED
+#define CMC_CRYPTO_DRBG_INCLUDED
+
+#include <stddef.h>
+
+#include "types.h"
+
+#define DRBG_KEY_SIZE 32   /* AES-256 */
+#define DRBG_BLOCK_SIZE 16 /* V */
+#define DRBG_SEED_SIZE 48  /* seedlen: key and V */
+
+/* Most bytes of a single drbg_generate call: 2^19 bits (SP 800-90A, table 3) */
+#define DRBG_MAX_REQUEST 65536
+
+/* drbg_generate calls allowed before a reseed is required; SP 800-90A allows
+ * up to 2^48 */
+#ifndef DRBG_RESEED_INTERVAL
+#define DRBG_RESEED_INTERVAL 0x1000000UL
+#endif
+
+typedef struct drbg_t
+{
+    byte          key[DRBG_KEY_SIZE];
+    byte          V[DRBG_BLOCK_SIZE];
+    unsigned long reseed_counter; /* drbg_generate calls since the seeding */
+}* drbg_p;
+
+/* CTR_DRBG (NIST SP 800-90A, section 10.2) with AES-256 and no derivation
+ * function: the entropy input must be DRBG_SEED_SIZE bytes of full entropy,
+ * e.g. from getrandom(2). The output is the AES-CTR keystream of the
+ * internal state (key, V), whose key and V are replaced after each request,
+ * so that a later compromise of the state does not reveal earlier outputs.
+ *
+ * AES comes from aes.h, with its fastest backend (AES-NI, if the CPU has it).
+ *
+ * personal and additional: NULL, or DRBG_SEED_SIZE bytes XORed into the seed
+ * material (personalization string, additional input). */
+extern void
+drbg_instantiate(drbg_p D, const byte* entropy, const byte* personal);
+extern void drbg_reseed(drbg_p D, const byte* entropy, const byte* additional);
+
+/* dst[0...len) <- next len bytes of output, len <= DRBG_MAX_REQUEST.
+ *
+ * RETURN
+ * 0 -> dst is filled;
+ * 1 -> reseed required (DRBG_RESEED_INTERVAL calls since the last seeding):
+ *      nothing is written.
+ */
+extern int
+drbg_generate(drbg_p D, byte* dst, size_t len, const byte* additional);
+
+/* State wiped */
+extern void drbg_wipe(drbg_p D);
+
+#endif /* CMC_CRYPTO_DRBG_INCLUDED */
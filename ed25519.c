@@ -0,0 +1,879 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bigint.h"
+#include "ed25519.h"
+#include "error.h"
+#include "fe25519.h"
+#include "random.h"
+#include "sha2.h"
+
+/* Sliding windows of the variable-time multiplications: odd multiples up to
+ * (2^(w - 1) - 1) P, that is 2^(w - 2) of them; the base point, whose table is
+ * built once, has a wider window */
+#define ED25519_WINDOW 5
+#define ED25519_BASE_WINDOW 8
+#define ED25519_ODD (1 << (ED25519_WINDOW - 2))
+#define ED25519_BASE_ODD (1 << (ED25519_BASE_WINDOW - 2))
+
+/* Bytes of scalars; multiplier of the random linear combinations */
+#define ED25519_SCALAR_SIZE 32
+#define ED25519_Z_SIZE 16
+
+/* Curve constant d = -121665 / 121666, 2d and sqrt(-1), little-endian */
+static const byte ED25519_D[] = {
+    0xa3, 0x78, 0x59, 0x13, 0xca, 0x4d, 0xeb, 0x75, 0xab, 0xd8, 0x41, 0x41,
+    0x4d, 0x0a, 0x70, 0x00, 0x98, 0xe8, 0x79, 0x77, 0x79, 0x40, 0xc7, 0x8c,
+    0x73, 0xfe, 0x6f, 0x2b, 0xee, 0x6c, 0x03, 0x52
+};
+static const byte ED25519_D2[] = {
+    0x59, 0xf1, 0xb2, 0x26, 0x94, 0x9b, 0xd6, 0xeb, 0x56, 0xb1, 0x83, 0x82,
+    0x9a, 0x14, 0xe0, 0x00, 0x30, 0xd1, 0xf3, 0xee, 0xf2, 0x80, 0x8e, 0x19,
+    0xe7, 0xfc, 0xdf, 0x56, 0xdc, 0xd9, 0x06, 0x24
+};
+static const byte ED25519_SQRTM1[] = {
+    0xb0, 0xa0, 0x0e, 0x4a, 0x27, 0x1b, 0xee, 0xc4, 0x78, 0xe4, 0x2f, 0xad,
+    0x06, 0x18, 0x43, 0x2f, 0xa7, 0xd7, 0xfb, 0x3d, 0x99, 0x00, 0x4d, 0x2b,
+    0x0b, 0xdf, 0xc1, 0x4f, 0x80, 0x24, 0x83, 0x2b
+};
+
+/* Order of the base point, 2^252 + 27742317777372353535851937790883648493,
+ * little-endian */
+static const byte ED25519_L[] = {
+    0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58, 0xd6, 0x9c, 0xf7, 0xa2,
+    0xde, 0xf9, 0xde, 0x14, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10
+};
+
+/* Encoding of the base point: y = 4/5, x even */
+static const byte ED25519_B[] = {
+    0x58, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+    0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+    0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66
+};
+
+/* Extended coordinates: x = X / Z, y = Y / Z, xy = T / Z */
+typedef struct ge_p3_t
+{
+    fe25519_t X;
+    fe25519_t Y;
+    fe25519_t Z;
+    fe25519_t T;
+}* ge_p3_p;
+
+/* Completed coordinates, the result of additions and doublings: x = X / Z,
+ * y = Y / T */
+typedef struct ge_p1p1_t
+{
+    fe25519_t X;
+    fe25519_t Y;
+    fe25519_t Z;
+    fe25519_t T;
+}* ge_p1p1_p;
+
+/* Second operand of additions: (Y + X, Y - X, Z, 2dT) */
+typedef struct ge_cached_t
+{
+    fe25519_t YplusX;
+    fe25519_t YminusX;
+    fe25519_t Z;
+    fe25519_t T2d;
+}* ge_cached_p;
+
+/* Same as ge_cached_t, in affine coordinates (Z = 1): (y + x, y - x, 2dxy) */
+typedef struct ge_precomp_t
+{
+    fe25519_t yplusx;
+    fe25519_t yminusx;
+    fe25519_t xy2d;
+}* ge_precomp_p;
+
+/* Built once by ed25519_init, read-only afterwards */
+static struct ed25519_tables_t
+{
+    fe25519_t            d;
+    fe25519_t            d2;
+    fe25519_t            sqrtm1;
+    struct ge_p3_t       B;
+    struct ge_precomp_t  base[32][8];           /* (k + 1) * 256^i * B */
+    struct ge_cached_t   odd[ED25519_BASE_ODD]; /* (2k + 1) * B */
+    struct bigint_mont_t L;
+} ED25519;
+
+static pthread_once_t ed25519_once = PTHREAD_ONCE_INIT;
+
+static void ed25519_init(void);
+
+/* h <- neutral element */
+static void ge_p3_0(ge_p3_p h);
+
+/* r <- p + q, p - q, p + q (q affine), 2p */
+static void ge_add(ge_p1p1_p r, ge_p3_p p, ge_cached_p q);
+static void ge_sub(ge_p1p1_p r, ge_p3_p p, ge_cached_p q);
+static void ge_madd(ge_p1p1_p r, ge_p3_p p, ge_precomp_p q);
+static void ge_dbl(ge_p1p1_p r, ge_p3_p p);
+
+/* Conversions */
+static void ge_p1p1_to_p3(ge_p3_p r, ge_p1p1_p p);
+static void ge_p3_to_cached(ge_cached_p r, ge_p3_p p);
+static void ge_p3_to_precomp(ge_precomp_p r, ge_p3_p p);
+
+/* h <- -h */
+static void ge_p3_neg(ge_p3_p h);
+
+/* Encoding: y, and the sign of x in the top bit */
+static void ge_tobytes(byte* dst, ge_p3_p h);
+
+/* RETURN
+ * 0 -> h is the point encoded by src;
+ * 1 -> src is not a canonical encoding of a point.
+ */
+static int ge_frombytes(ge_p3_p h, const byte* src);
+
+/* RETURN
+ * 1 if [8]h is the neutral element, 0 otherwise */
+static int ge_is_small(ge_p3_p h);
+
+/* h <- a * B, in constant time; a has 32 bytes, a[31] <= 127 */
+static void ge_base_mul(ge_p3_p h, const byte* a);
+
+/* t <- b * base[pos], -8 <= b <= 8, in constant time */
+static void ge_base_select(ge_precomp_p t, int pos, int b);
+
+/* r <- b * B + sum s[i] * P[i] for 0 <= i < n, in variable time: s holds n
+ * scalars of 32 bytes, less than 2^253 as b */
+static void
+ge_msm_vartime(ge_p3_p r, const byte* b, const byte* s, ge_p3_p P, int n);
+
+/* naf[0...256) <- sliding window form of s (32 bytes, less than 2^255): odd
+ * digits in (-2^(w - 1), 2^(w - 1)), each followed by w - 1 zeros at least */
+static void ge_slide(signed char* naf, const byte* s, int w);
+
+/* Scalars modulo L, 32 bytes little-endian:
+ * - sc_reduce: dst <- src mod L, src having len bytes, 64 at most;
+ * - sc_muladd: dst <- a * b + c mod L, a, b and c less than 2^256;
+ * - sc_iscanonical: 1 if s < L, 0 otherwise.
+ */
+static void sc_reduce(byte* dst, const byte* src, int len);
+static void sc_muladd(byte* dst, const byte* a, const byte* b, const byte* c);
+static int  sc_iscanonical(const byte* s);
+
+/* N <- src, len bytes little-endian */
+static void sc_import(bigint_p N, const byte* src, int len);
+
+/* k <- SHA-512(R || A || msg) mod L */
+static void ed25519_challenge(
+    byte* k, const byte* R, const byte* A, const byte* msg, size_t len
+);
+
+/* --- IMPL */
+
+void ed25519_public(byte* pub, const byte* seed)
+{
+    struct ge_p3_t A;
+    byte           h[SHA512_DIGEST_SIZE];
+
+    pthread_once(&ed25519_once, ed25519_init);
+
+    sha512(h, seed, ED25519_SEED_SIZE);
+    h[0] &= 248;
+    h[31] &= 127;
+    h[31] |= 64;
+
+    ge_base_mul(&A, h);
+    ge_tobytes(pub, &A);
+
+    memset(h, 0, sizeof(h));
+}
+
+void ed25519_keypair(byte* pub, byte* seed)
+{
+    random_get_buffer((char*)seed, ED25519_SEED_SIZE);
+    ed25519_public(pub, seed);
+}
+
+void ed25519_sign(
+    byte* sig, const byte* msg, size_t len, const byte* seed, const byte* pub
+)
+{
+    struct sha512_t S;
+    struct ge_p3_t  R;
+    byte            h[SHA512_DIGEST_SIZE]; /* Scalar a || prefix */
+    byte            r[SHA512_DIGEST_SIZE];
+    byte            k[ED25519_SCALAR_SIZE];
+
+    pthread_once(&ed25519_once, ed25519_init);
+
+    sha512(h, seed, ED25519_SEED_SIZE);
+    h[0] &= 248;
+    h[31] &= 127;
+    h[31] |= 64;
+
+    /* r = SHA-512(prefix || msg) mod L, R = r * B */
+    sha512_init(&S);
+    sha512_update(&S, &h[32], 32);
+    sha512_update(&S, msg, len);
+    sha512_final(&S, r);
+    sc_reduce(r, r, SHA512_DIGEST_SIZE);
+
+    ge_base_mul(&R, r);
+    ge_tobytes(sig, &R);
+
+    /* S = r + k * a mod L */
+    ed25519_challenge(k, sig, pub, msg, len);
+    sc_muladd(&sig[32], k, h, r);
+
+    memset(h, 0, sizeof(h));
+    memset(r, 0, sizeof(r));
+}
+
+int ed25519_verify(
+    const byte* sig, const byte* msg, size_t len, const byte* pub
+)
+{
+    struct ge_p3_t     A;
+    struct ge_p3_t     R;
+    struct ge_p3_t     P;
+    struct ge_cached_t Rc;
+    struct ge_p1p1_t   t;
+    byte               k[ED25519_SCALAR_SIZE];
+
+    pthread_once(&ed25519_once, ed25519_init);
+
+    if (!sc_iscanonical(&sig[32]) || ge_frombytes(&A, pub) ||
+        ge_frombytes(&R, sig))
+        return 1;
+
+    /* [8]([S]B - [k]A - R) must be the neutral element */
+    ed25519_challenge(k, sig, pub, msg, len);
+    ge_p3_neg(&A);
+    ge_msm_vartime(&P, &sig[32], k, &A, 1);
+
+    ge_p3_to_cached(&Rc, &R);
+    ge_sub(&t, &P, &Rc);
+    ge_p1p1_to_p3(&P, &t);
+
+    return !ge_is_small(&P);
+}
+
+int ed25519_verify_batch(
+    const byte**  sig,
+    const byte**  msg,
+    const size_t* len,
+    const byte**  pub,
+    int           count,
+    int*          valid
+)
+{
+    struct ge_p3_t* P;     /* R_j and A_j, interleaved */
+    byte*           s;     /* z_j and z_j * k_j, interleaved */
+    int*            index; /* Signature of R_j and A_j */
+    struct ge_p3_t  Q;
+    byte            z[ED25519_SCALAR_SIZE];
+    byte            k[ED25519_SCALAR_SIZE];
+    byte            b[ED25519_SCALAR_SIZE]; /* sum z_j * S_j */
+    byte            zero[ED25519_SCALAR_SIZE];
+    int             invalid = 0;
+    int             start;
+    int             n;
+    int             i;
+    int             j;
+
+    pthread_once(&ed25519_once, ed25519_init);
+
+    P     = malloc(sizeof(struct ge_p3_t) * 2 * ED25519_BATCH_CHUNK);
+    s     = malloc(ED25519_SCALAR_SIZE * 2 * ED25519_BATCH_CHUNK);
+    index = malloc(sizeof(int) * ED25519_BATCH_CHUNK);
+    EXIT_EALLOC(P);
+    EXIT_EALLOC(s);
+    EXIT_EALLOC(index);
+
+    memset(zero, 0, sizeof(zero));
+
+    for (start = 0; start < count; start += ED25519_BATCH_CHUNK)
+    {
+        /* Malformed signatures and keys are out before the combination */
+        n = 0;
+        memset(b, 0, sizeof(b));
+        for (i = start; i < count && i < start + ED25519_BATCH_CHUNK; ++i)
+        {
+            valid[i] = 0;
+            if (!sc_iscanonical(&sig[i][32]) ||
+                ge_frombytes(&P[2 * n], sig[i]) ||
+                ge_frombytes(&P[2 * n + 1], pub[i]))
+            {
+                ++invalid;
+                continue;
+            }
+
+            memset(z, 0, sizeof(z));
+            random_get_buffer((char*)z, ED25519_Z_SIZE);
+            ed25519_challenge(k, sig[i], pub[i], msg[i], len[i]);
+
+            memcpy(&s[ED25519_SCALAR_SIZE * 2 * n], z, ED25519_SCALAR_SIZE);
+            sc_muladd(&s[ED25519_SCALAR_SIZE * (2 * n + 1)], z, k, zero);
+            sc_muladd(b, z, &sig[i][32], b);
+
+            index[n++] = i;
+        }
+
+        if (n == 0)
+            continue;
+
+        /* (sum z_j S_j) B - sum z_j R_j - sum (z_j k_j) A_j: the points are
+         * negated instead of the scalars */
+        for (j = 0; j < 2 * n; ++j)
+            ge_p3_neg(&P[j]);
+
+        ge_msm_vartime(&Q, b, s, P, 2 * n);
+
+        if (ge_is_small(&Q))
+        {
+            for (j = 0; j < n; ++j)
+                valid[index[j]] = 1;
+            continue;
+        }
+
+        for (j = 0; j < n; ++j)
+        {
+            i        = index[j];
+            valid[i] = !ed25519_verify(sig[i], msg[i], len[i], pub[i]);
+            invalid += !valid[i];
+        }
+    }
+
+    free(P);
+    free(s);
+    free(index);
+
+    return invalid;
+}
+
+static void ed25519_init(void)
+{
+    struct ge_p3_t     P;
+    struct ge_p3_t     Q;
+    struct ge_p1p1_t   t;
+    struct ge_cached_t c;
+    struct bigint_t    L;
+    int                i;
+    int                k;
+
+    fe25519_frombytes(ED25519.d, ED25519_D);
+    fe25519_frombytes(ED25519.d2, ED25519_D2);
+    fe25519_frombytes(ED25519.sqrtm1, ED25519_SQRTM1);
+
+    if (ge_frombytes(&ED25519.B, ED25519_B))
+        EXIT(FATAL_LOGIC, "ed25519_init", "invalid base point");
+
+    sc_import(&L, ED25519_L, sizeof(ED25519_L));
+    if (!bigint_mont_init(&ED25519.L, &L))
+        EXIT(FATAL_LOGIC, "ed25519_init", "invalid group order");
+
+    /* base[i][k] = (k + 1) * 256^i * B: P runs through 256^i * B */
+    P = ED25519.B;
+    for (i = 0; i < 32; ++i)
+    {
+        ge_p3_to_cached(&c, &P);
+        Q = P;
+        for (k = 0; k < 8; ++k)
+        {
+            ge_p3_to_precomp(&ED25519.base[i][k], &Q);
+            ge_add(&t, &Q, &c);
+            ge_p1p1_to_p3(&Q, &t);
+        }
+
+        for (k = 0; k < 8; ++k)
+        {
+            ge_dbl(&t, &P);
+            ge_p1p1_to_p3(&P, &t);
+        }
+    }
+
+    /* odd[k] = (2k + 1) * B */
+    ge_dbl(&t, &ED25519.B);
+    ge_p1p1_to_p3(&Q, &t);
+    ge_p3_to_cached(&c, &Q);
+    P = ED25519.B;
+    for (k = 0; k < ED25519_BASE_ODD; ++k)
+    {
+        ge_p3_to_cached(&ED25519.odd[k], &P);
+        ge_add(&t, &P, &c);
+        ge_p1p1_to_p3(&P, &t);
+    }
+}
+
+static void ge_p3_0(ge_p3_p h)
+{
+    fe25519_zero(h->X);
+    fe25519_one(h->Y);
+    fe25519_one(h->Z);
+    fe25519_zero(h->T);
+}
+
+static void ge_add(ge_p1p1_p r, ge_p3_p p, ge_cached_p q)
+{
+    fe25519_t t0;
+
+    fe25519_add(r->X, p->Y, p->X);
+    fe25519_sub(r->Y, p->Y, p->X);
+    fe25519_mul(r->Z, r->X, q->YplusX);
+    fe25519_mul(r->Y, r->Y, q->YminusX);
+    fe25519_mul(r->T, q->T2d, p->T);
+    fe25519_mul(r->X, p->Z, q->Z);
+    fe25519_add(t0, r->X, r->X);
+    fe25519_sub(r->X, r->Z, r->Y);
+    fe25519_add(r->Y, r->Z, r->Y);
+    fe25519_add(r->Z, t0, r->T);
+    fe25519_sub(r->T, t0, r->T);
+}
+
+static void ge_sub(ge_p1p1_p r, ge_p3_p p, ge_cached_p q)
+{
+    fe25519_t t0;
+
+    /* -q = (Y - X, Y + X, Z, -2dT) */
+    fe25519_add(r->X, p->Y, p->X);
+    fe25519_sub(r->Y, p->Y, p->X);
+    fe25519_mul(r->Z, r->X, q->YminusX);
+    fe25519_mul(r->Y, r->Y, q->YplusX);
+    fe25519_mul(r->T, q->T2d, p->T);
+    fe25519_mul(r->X, p->Z, q->Z);
+    fe25519_add(t0, r->X, r->X);
+    fe25519_sub(r->X, r->Z, r->Y);
+    fe25519_add(r->Y, r->Z, r->Y);
+    fe25519_sub(r->Z, t0, r->T);
+    fe25519_add(r->T, t0, r->T);
+}
+
+static void ge_madd(ge_p1p1_p r, ge_p3_p p, ge_precomp_p q)
+{
+    fe25519_t t0;
+
+    fe25519_add(r->X, p->Y, p->X);
+    fe25519_sub(r->Y, p->Y, p->X);
+    fe25519_mul(r->Z, r->X, q->yplusx);
+    fe25519_mul(r->Y, r->Y, q->yminusx);
+    fe25519_mul(r->T, q->xy2d, p->T);
+    fe25519_add(t0, p->Z, p->Z);
+    fe25519_sub(r->X, r->Z, r->Y);
+    fe25519_add(r->Y, r->Z, r->Y);
+    fe25519_add(r->Z, t0, r->T);
+    fe25519_sub(r->T, t0, r->T);
+}
+
+static void ge_dbl(ge_p1p1_p r, ge_p3_p p)
+{
+    fe25519_t t0;
+
+    fe25519_sqr(r->X, p->X);
+    fe25519_sqr(r->Z, p->Y);
+    fe25519_sqr(r->T, p->Z);
+    fe25519_add(r->T, r->T, r->T);
+    fe25519_add(r->Y, p->X, p->Y);
+    fe25519_sqr(t0, r->Y);
+    fe25519_add(r->Y, r->Z, r->X);
+    fe25519_sub(r->Z, r->Z, r->X);
+    fe25519_sub(r->X, t0, r->Y);
+    fe25519_sub(r->T, r->T, r->Z);
+}
+
+static void ge_p1p1_to_p3(ge_p3_p r, ge_p1p1_p p)
+{
+    fe25519_mul(r->X, p->X, p->T);
+    fe25519_mul(r->Y, p->Y, p->Z);
+    fe25519_mul(r->Z, p->Z, p->T);
+    fe25519_mul(r->T, p->X, p->Y);
+}
+
+static void ge_p3_to_cached(ge_cached_p r, ge_p3_p p)
+{
+    fe25519_add(r->YplusX, p->Y, p->X);
+    fe25519_sub(r->YminusX, p->Y, p->X);
+    fe25519_copy(r->Z, p->Z);
+    fe25519_mul(r->T2d, p->T, ED25519.d2);
+}
+
+static void ge_p3_to_precomp(ge_precomp_p r, ge_p3_p p)
+{
+    fe25519_t recip;
+    fe25519_t x;
+    fe25519_t y;
+
+    fe25519_invert(recip, p->Z);
+    fe25519_mul(x, p->X, recip);
+    fe25519_mul(y, p->Y, recip);
+
+    fe25519_add(r->yplusx, y, x);
+    fe25519_sub(r->yminusx, y, x);
+    fe25519_mul(r->xy2d, x, y);
+    fe25519_mul(r->xy2d, r->xy2d, ED25519.d2);
+}
+
+static void ge_p3_neg(ge_p3_p h)
+{
+    fe25519_neg(h->X, h->X);
+    fe25519_neg(h->T, h->T);
+}
+
+static void ge_tobytes(byte* dst, ge_p3_p h)
+{
+    fe25519_t recip;
+    fe25519_t x;
+    fe25519_t y;
+
+    fe25519_invert(recip, h->Z);
+    fe25519_mul(x, h->X, recip);
+    fe25519_mul(y, h->Y, recip);
+
+    fe25519_tobytes(dst, y);
+    dst[31] ^= (byte)(fe25519_isnegative(x) << 7);
+}
+
+static int ge_frombytes(ge_p3_p h, const byte* src)
+{
+    byte      check[FE25519_SIZE];
+    fe25519_t u;
+    fe25519_t v;
+    fe25519_t v3;
+    fe25519_t vxx;
+    fe25519_t t;
+    int       sign = src[31] >> 7;
+
+    /* y must be less than p */
+    fe25519_frombytes(h->Y, src);
+    fe25519_tobytes(check, h->Y);
+    check[31] |= (byte)(sign << 7);
+    if (memcmp(check, src, FE25519_SIZE) != 0)
+        return 1;
+
+    /* x^2 = u / v, u = y^2 - 1, v = dy^2 + 1: x = u v^3 (u v^7)^((p - 5) / 8)
+     * is a root if v x^2 = u, x * sqrt(-1) is if v x^2 = -u */
+    fe25519_one(h->Z);
+    fe25519_sqr(u, h->Y);
+    fe25519_mul(v, u, ED25519.d);
+    fe25519_sub(u, u, h->Z);
+    fe25519_add(v, v, h->Z);
+
+    fe25519_sqr(v3, v);
+    fe25519_mul(v3, v3, v);
+    fe25519_sqr(h->X, v3);
+    fe25519_mul(h->X, h->X, v);
+    fe25519_mul(h->X, h->X, u);
+    fe25519_pow22523(h->X, h->X);
+    fe25519_mul(h->X, h->X, v3);
+    fe25519_mul(h->X, h->X, u);
+
+    fe25519_sqr(vxx, h->X);
+    fe25519_mul(vxx, vxx, v);
+    fe25519_sub(t, vxx, u);
+    if (!fe25519_iszero(t))
+    {
+        fe25519_add(t, vxx, u);
+        if (!fe25519_iszero(t))
+            return 1;
+        fe25519_mul(h->X, h->X, ED25519.sqrtm1);
+    }
+
+    /* x = 0 has no negative */
+    if (fe25519_iszero(h->X) && sign)
+        return 1;
+    if (fe25519_isnegative(h->X) != sign)
+        fe25519_neg(h->X, h->X);
+
+    fe25519_mul(h->T, h->X, h->Y);
+
+    return 0;
+}
+
+static int ge_is_small(ge_p3_p h)
+{
+    struct ge_p3_t   P = *h;
+    struct ge_p1p1_t t;
+    fe25519_t        d;
+    int              i;
+
+    for (i = 0; i < 3; ++i)
+    {
+        ge_dbl(&t, &P);
+        ge_p1p1_to_p3(&P, &t);
+    }
+
+    /* Neutral element: x = 0, y = 1 */
+    fe25519_sub(d, P.Y, P.Z);
+
+    return fe25519_iszero(P.X) && fe25519_iszero(d);
+}
+
+static void ge_base_mul(ge_p3_p h, const byte* a)
+{
+    struct ge_precomp_t t;
+    struct ge_p1p1_t    r;
+    signed char         e[64];
+    int                 carry = 0;
+    int                 i;
+
+    /* a = sum e[i] * 16^i, with -8 <= e[i] < 8 (e[63] <= 8) */
+    for (i = 0; i < 32; ++i)
+    {
+        e[2 * i]     = (signed char)(a[i] & 15);
+        e[2 * i + 1] = (signed char)(a[i] >> 4 & 15);
+    }
+    for (i = 0; i < 63; ++i)
+    {
+        e[i]  = (signed char)(e[i] + carry);
+        carry = (e[i] + 8) >> 4;
+        e[i]  = (signed char)(e[i] - carry * 16);
+    }
+    e[63] = (signed char)(e[63] + carry);
+
+    /* Odd digits first, then multiplied by 16, then the even ones: 256^i is
+     * all the table holds */
+    ge_p3_0(h);
+    for (i = 1; i < 64; i += 2)
+    {
+        ge_base_select(&t, i / 2, e[i]);
+        ge_madd(&r, h, &t);
+        ge_p1p1_to_p3(h, &r);
+    }
+
+    for (i = 0; i < 4; ++i)
+    {
+        ge_dbl(&r, h);
+        ge_p1p1_to_p3(h, &r);
+    }
+
+    for (i = 0; i < 64; i += 2)
+    {
+        ge_base_select(&t, i / 2, e[i]);
+        ge_madd(&r, h, &t);
+        ge_p1p1_to_p3(h, &r);
+    }
+
+    memset(e, 0, sizeof(e));
+}
+
+static void ge_base_select(ge_precomp_p t, int pos, int b)
+{
+    struct ge_precomp_t minus;
+    ge_precomp_p        e;
+    uint64_t            negative = (uint64_t)((unsigned int)b >> 31 & 1);
+    uint64_t            mask;
+    uint32_t            babs;
+    uint32_t            x;
+    int                 k;
+
+    /* |b|, without branches: b - 2b if b is negative */
+    babs = (uint32_t)b - (((uint32_t)(0 - negative) & (uint32_t)b) << 1);
+
+    fe25519_one(t->yplusx);
+    fe25519_one(t->yminusx);
+    fe25519_zero(t->xy2d);
+
+    for (k = 1; k <= 8; ++k)
+    {
+        /* x - 1 borrows only if babs is k */
+        x    = (babs ^ (uint32_t)k) - 1;
+        mask = 0 - (uint64_t)(x >> 31);
+        e    = &ED25519.base[pos][k - 1];
+        fe25519_cmov(t->yplusx, e->yplusx, mask);
+        fe25519_cmov(t->yminusx, e->yminusx, mask);
+        fe25519_cmov(t->xy2d, e->xy2d, mask);
+    }
+
+    /* -(x, y) = (-x, y): y + x and y - x swap, 2dxy changes sign */
+    fe25519_copy(minus.yplusx, t->yminusx);
+    fe25519_copy(minus.yminusx, t->yplusx);
+    fe25519_neg(minus.xy2d, t->xy2d);
+
+    fe25519_cmov(t->yplusx, minus.yplusx, 0 - negative);
+    fe25519_cmov(t->yminusx, minus.yminusx, 0 - negative);
+    fe25519_cmov(t->xy2d, minus.xy2d, 0 - negative);
+}
+
+static void
+ge_msm_vartime(ge_p3_p r, const byte* b, const byte* s, ge_p3_p P, int n)
+{
+    struct ge_cached_t* odd; /* (2k + 1) * P[i], ED25519_ODD per point */
+    signed char*        naf; /* 256 digits per scalar, b's last */
+    struct ge_p1p1_t    t;
+    struct ge_p3_t      Q;
+    struct ge_cached_t  c;
+    int                 top;
+    int                 i;
+    int                 j;
+    int                 k;
+
+    odd = malloc(sizeof(struct ge_cached_t) * ED25519_ODD * (size_t)n);
+    naf = malloc((size_t)(256 * (n + 1)));
+    EXIT_EALLOC(odd);
+    EXIT_EALLOC(naf);
+
+    for (j = 0; j < n; ++j)
+    {
+        ge_slide(&naf[256 * j], &s[ED25519_SCALAR_SIZE * j], ED25519_WINDOW);
+
+        ge_dbl(&t, &P[j]);
+        ge_p1p1_to_p3(&Q, &t);
+        ge_p3_to_cached(&c, &Q);
+
+        Q = P[j];
+        ge_p3_to_cached(&odd[ED25519_ODD * j], &Q);
+        for (k = 1; k < ED25519_ODD; ++k)
+        {
+            ge_add(&t, &Q, &c);
+            ge_p1p1_to_p3(&Q, &t);
+            ge_p3_to_cached(&odd[ED25519_ODD * j + k], &Q);
+        }
+    }
+    ge_slide(&naf[256 * n], b, ED25519_BASE_WINDOW);
+
+    /* Doublings start from the highest non-zero digit of any scalar */
+    for (top = 255; top >= 0; --top)
+    {
+        for (j = 0; j <= n && naf[256 * j + top] == 0; ++j)
+            ;
+        if (j <= n)
+            break;
+    }
+
+    ge_p3_0(r);
+    for (i = top; i >= 0; --i)
+    {
+        ge_dbl(&t, r);
+        ge_p1p1_to_p3(r, &t);
+
+        for (j = 0; j < n; ++j)
+        {
+            k = naf[256 * j + i];
+            if (k > 0)
+                ge_add(&t, r, &odd[ED25519_ODD * j + k / 2]);
+            else if (k < 0)
+                ge_sub(&t, r, &odd[ED25519_ODD * j + -k / 2]);
+            else
+                continue;
+            ge_p1p1_to_p3(r, &t);
+        }
+
+        k = naf[256 * n + i];
+        if (k > 0)
+            ge_add(&t, r, &ED25519.odd[k / 2]);
+        else if (k < 0)
+            ge_sub(&t, r, &ED25519.odd[-k / 2]);
+        if (k != 0)
+            ge_p1p1_to_p3(r, &t);
+    }
+
+    free(odd);
+    free(naf);
+}
+
+static void ge_slide(signed char* naf, const byte* s, int w)
+{
+    int max = (1 << (w - 1)) - 1;
+    int i;
+    int b;
+    int k;
+
+    for (i = 0; i < 256; ++i)
+        naf[i] = (signed char)(s[i / 8] >> (i % 8) & 1);
+
+    /* Each set bit absorbs the next w - 1 bits, while the digit stays in
+     * (-2^(w - 1), 2^(w - 1)); a negative digit carries one upwards */
+    for (i = 0; i < 256; ++i)
+    {
+        if (!naf[i])
+            continue;
+
+        for (b = 1; b < w && i + b < 256; ++b)
+        {
+            if (!naf[i + b])
+                continue;
+
+            if (naf[i] + (naf[i + b] << b) <= max)
+            {
+                naf[i]     = (signed char)(naf[i] + (naf[i + b] << b));
+                naf[i + b] = 0;
+            }
+            else if (naf[i] - (naf[i + b] << b) >= -max)
+            {
+                naf[i] = (signed char)(naf[i] - (naf[i + b] << b));
+                for (k = i + b; k < 256; ++k)
+                {
+                    if (!naf[k])
+                    {
+                        naf[k] = 1;
+                        break;
+                    }
+                    naf[k] = 0;
+                }
+            }
+            else
+                break;
+        }
+    }
+}
+
+static void sc_reduce(byte* dst, const byte* src, int len)
+{
+    struct bigint_t N;
+
+    sc_import(&N, src, len);
+    bigint_mont_mod(&N, &N, &ED25519.L);
+    memcpy(dst, N.num, ED25519_SCALAR_SIZE);
+
+    memset(&N, 0, sizeof(N));
+}
+
+static void sc_muladd(byte* dst, const byte* a, const byte* b, const byte* c)
+{
+    struct bigint_t A;
+    struct bigint_t B;
+    struct bigint_t C;
+
+    sc_import(&A, a, ED25519_SCALAR_SIZE);
+    sc_import(&B, b, ED25519_SCALAR_SIZE);
+    sc_import(&C, c, ED25519_SCALAR_SIZE);
+
+    /* Less than 2^512 = R^2 */
+    bigint_mul(&B, &A, &B);
+    bigint_sum(&B, &B, &C);
+    bigint_mont_mod(&B, &B, &ED25519.L);
+    memcpy(dst, B.num, ED25519_SCALAR_SIZE);
+
+    memset(&A, 0, sizeof(A));
+    memset(&B, 0, sizeof(B));
+}
+
+static int sc_iscanonical(const byte* s)
+{
+    struct bigint_t S;
+
+    sc_import(&S, s, ED25519_SCALAR_SIZE);
+
+    return bigint_cmp(&S, &ED25519.L.M) < 0;
+}
+
+static void sc_import(bigint_p N, const byte* src, int len)
+{
+    bigint_init(N);
+    memcpy(N->num, src, (size_t)len);
+    bigint_set_internal(N);
+}
+
+static void ed25519_challenge(
+    byte* k, const byte* R, const byte* A, const byte* msg, size_t len
+)
+{
+    struct sha512_t S;
+    byte            h[SHA512_DIGEST_SIZE];
+
+    sha512_init(&S);
+    sha512_update(&S, R, 32);
+    sha512_update(&S, A, ED25519_PUBLIC_SIZE);
+    sha512_update(&S, msg, len);
+    sha512_final(&S, h);
+
+    sc_reduce(k, h, SHA512_DIGEST_SIZE);
+}
@@ -0,0 +1,75 @@
+#ifndef CMC_CRYPTO_ED25519_INCLUDED
+#define CMC_CRYPTO_ED25519_INCLUDED
+
+#include <stddef.h>
+
+#include "types.h"
+
+/* Signatures checked by a single multi-scalar multiplication, see
+ * ed25519_verify_batch */
+#ifndef ED25519_BATCH_CHUNK
+#define ED25519_BATCH_CHUNK 64
+#endif
+
+#define ED25519_SEED_SIZE 32 /* Private key */
+#define ED25519_PUBLIC_SIZE 32
+#define ED25519_SIGNATURE_SIZE 64
+
+/* Ed25519 (RFC 8032), on the twisted Edwards form of Curve25519, with points
+ * in extended coordinates (X : Y : Z : T), x = X / Z, y = Y / Z, xy = T / Z,
+ * that add without inversions; field elements are those of fe25519.h.
+ *
+ * - Signing multiplies the base point by secret scalars: in constant time,
+ *   with a table of the multiples k * 256^i * B (1 <= k <= 8, 0 <= i < 32)
+ *   built on first use, one addition per 4 bits of the scalar and no
+ *   doublings but 4, and entries selected with masks.
+ * - Verification only deals with public data: variable time, with sliding
+ *   windows (odd multiples of the points, the base point's precomputed).
+ *
+ * Verification is cofactored: [8][S]B = [8]R + [8][k]A, as RFC 8032 allows,
+ * so that single and batch verification accept exactly the same signatures.
+ * Non-canonical S and encodings of points are rejected. */
+
+/* pub <- public key of the private key seed */
+extern void ed25519_public(byte* pub, const byte* seed);
+
+/* New key pair: seed is random, pub = ed25519_public(seed) */
+extern void ed25519_keypair(byte* pub, byte* seed);
+
+/* sig <- signature of msg[0...len) with the private key seed, whose public key
+ * is pub (not checked: a wrong pub gives an invalid signature) */
+extern void ed25519_sign(
+    byte* sig, const byte* msg, size_t len, const byte* seed, const byte* pub
+);
+
+/* RETURN
+ * 0 -> sig is a valid signature of msg[0...len) with the public key pub;
+ * 1 -> it is not, or pub is not a valid public key.
+ */
+extern int
+ed25519_verify(const byte* sig, const byte* msg, size_t len, const byte* pub);
+
+/* valid[i] <- 1 if sig[i] is a valid signature of msg[i][0...len[i]) with the
+ * public key pub[i], 0 otherwise; for 0 <= i < count.
+ *
+ * Signatures are checked ED25519_BATCH_CHUNK at a time with a random linear
+ * combination: for random 128-bit z_i, the chunk is valid if
+ * [8](-(sum z_i S_i) B + sum z_i R_i + sum (z_i k_i) A_i) is the identity,
+ * one multi-scalar multiplication whose doublings are shared by all the
+ * points (Straus). A forged signature passes with probability 2^-128 at most.
+ * Only if a chunk fails are its signatures verified one by one, to tell which
+ * ones are invalid: batches are for inputs expected to be valid, e.g. logs.
+ *
+ * RETURN
+ * Number of invalid signatures
+ */
+extern int ed25519_verify_batch(
+    const byte**  sig,
+    const byte**  msg,
+    const size_t* len,
+    const byte**  pub,
+    int           count,
+    int*          valid
+);
+
+#endif /* CMC_CRYPTO_ED25519_INCLUDED */
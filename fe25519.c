@@ -0,0 +1,441 @@
+#include <string.h>
+
+#include "fe25519.h"
+
+#define FE25519_MASK51 (((uint64_t)1 << 51) - 1)
+
+#if FE25519_INT128
+__extension__ typedef unsigned __int128 u128_t;
+#else
+typedef struct u128_t
+{
+    uint64_t lo;
+    uint64_t hi;
+} u128_t;
+#endif
+
+/* 128-bit accumulators:
+ * - u128_mac: acc <- acc + a * b;
+ * - u128_add: acc <- acc + a;
+ * - u128_shift: acc <- acc >> 51, returning the 51 bits shifted out;
+ * - u128_low: low 64 bits of acc.
+ */
+static void     u128_mac(u128_t* acc, uint64_t a, uint64_t b);
+static void     u128_add(u128_t* acc, uint64_t a);
+static uint64_t u128_shift(u128_t* acc);
+static uint64_t u128_low(u128_t* acc);
+
+/* Carries of the 128-bit limbs r into h, 19 * 2^255 wrapping around as 19 */
+static void fe25519_carry(fe25519_t h, u128_t* r);
+
+/* One carry pass: limbs of 51 bits, h[0] a few bits more */
+static void fe25519_reduce(fe25519_t h);
+
+/* h <- f^(2^250 - 1), and f^11 into z11: the common prefix of the chains of
+ * fe25519_invert and fe25519_pow22523 */
+static void fe25519_pow2250(fe25519_t h, fe25519_t z11, fe25519_t f);
+
+/* --- IMPL */
+
+#if FE25519_INT128
+
+static void u128_mac(u128_t* acc, uint64_t a, uint64_t b)
+{
+    *acc += (u128_t)a * b;
+}
+
+static void u128_add(u128_t* acc, uint64_t a) { *acc += a; }
+
+static uint64_t u128_shift(u128_t* acc)
+{
+    uint64_t low = (uint64_t)*acc & FE25519_MASK51;
+
+    *acc >>= 51;
+
+    return low;
+}
+
+static uint64_t u128_low(u128_t* acc) { return (uint64_t)*acc; }
+
+#else
+
+static void u128_mac(u128_t* acc, uint64_t a, uint64_t b)
+{
+    uint64_t a0 = a & 0xffffffff;
+    uint64_t a1 = a >> 32;
+    uint64_t b0 = b & 0xffffffff;
+    uint64_t b1 = b >> 32;
+    uint64_t m0 = a1 * b0;
+    uint64_t m1 = a0 * b1;
+    uint64_t lo = a0 * b0;
+    uint64_t mid;
+    uint64_t hi;
+
+    /* Schoolbook on 32-bit halves; mid, the sum of three 32-bit numbers,
+     * cannot overflow */
+    mid = (lo >> 32) + (m0 & 0xffffffff) + (m1 & 0xffffffff);
+    hi  = a1 * b1 + (m0 >> 32) + (m1 >> 32) + (mid >> 32);
+    lo  = (lo & 0xffffffff) | mid << 32;
+
+    acc->lo += lo;
+    acc->hi += hi + (acc->lo < lo);
+}
+
+static void u128_add(u128_t* acc, uint64_t a)
+{
+    acc->lo += a;
+    acc->hi += acc->lo < a;
+}
+
+static uint64_t u128_shift(u128_t* acc)
+{
+    uint64_t low = acc->lo & FE25519_MASK51;
+
+    acc->lo = acc->lo >> 51 | acc->hi << 13;
+    acc->hi >>= 51;
+
+    return low;
+}
+
+static uint64_t u128_low(u128_t* acc) { return acc->lo; }
+
+#endif
+
+void fe25519_frombytes(fe25519_t h, const byte* src)
+{
+    uint64_t w[4];
+    int      i;
+    int      j;
+
+    for (i = 0; i < 4; ++i)
+    {
+        w[i] = 0;
+        for (j = 7; j >= 0; --j)
+            w[i] = w[i] << 8 | src[8 * i + j];
+    }
+
+    /* Bit 255 is dropped by the last mask */
+    h[0] = w[0] & FE25519_MASK51;
+    h[1] = (w[0] >> 51 | w[1] << 13) & FE25519_MASK51;
+    h[2] = (w[1] >> 38 | w[2] << 26) & FE25519_MASK51;
+    h[3] = (w[2] >> 25 | w[3] << 39) & FE25519_MASK51;
+    h[4] = w[3] >> 12 & FE25519_MASK51;
+}
+
+void fe25519_tobytes(byte* dst, fe25519_t h)
+{
+    uint64_t t[5];
+    uint64_t w[4];
+    uint64_t q;
+    int      pass;
+    int      i;
+    int      j;
+
+    fe25519_copy(t, h);
+
+    /* Two passes leave limbs of 51 bits and t < 2^255 */
+    for (pass = 0; pass < 2; ++pass)
+    {
+        for (i = 0; i < 4; ++i)
+        {
+            t[i + 1] += t[i] >> 51;
+            t[i] &= FE25519_MASK51;
+        }
+        t[0] += 19 * (t[4] >> 51);
+        t[4] &= FE25519_MASK51;
+    }
+
+    /* q = 1 if t >= p, that is if t + 19 reaches 2^255; then t - p is
+     * t + 19 - 2^255: 19 is added, and the carry out of bit 255 dropped */
+    q = (t[0] + 19) >> 51;
+    for (i = 1; i < 5; ++i)
+        q = (t[i] + q) >> 51;
+
+    t[0] += 19 * q;
+    for (i = 0; i < 4; ++i)
+    {
+        t[i + 1] += t[i] >> 51;
+        t[i] &= FE25519_MASK51;
+    }
+    t[4] &= FE25519_MASK51;
+
+    w[0] = t[0] | t[1] << 51;
+    w[1] = t[1] >> 13 | t[2] << 38;
+    w[2] = t[2] >> 26 | t[3] << 25;
+    w[3] = t[3] >> 39 | t[4] << 12;
+
+    for (i = 0; i < 4; ++i)
+        for (j = 0; j < 8; ++j)
+            dst[8 * i + j] = (byte)(w[i] >> (8 * j) & 0xff);
+}
+
+void fe25519_zero(fe25519_t h) { memset(h, 0, sizeof(fe25519_t)); }
+
+void fe25519_one(fe25519_t h)
+{
+    fe25519_zero(h);
+    h[0] = 1;
+}
+
+void fe25519_copy(fe25519_t h, fe25519_t f)
+{
+    memcpy(h, f, sizeof(fe25519_t));
+}
+
+void fe25519_add(fe25519_t h, fe25519_t f, fe25519_t g)
+{
+    int i;
+
+    for (i = 0; i < 5; ++i)
+        h[i] = f[i] + g[i];
+
+    fe25519_reduce(h);
+}
+
+void fe25519_sub(fe25519_t h, fe25519_t f, fe25519_t g)
+{
+    int i;
+
+    /* Plus 4p = 4 * (2^255 - 19), to stay positive: 2^53 - 76, then 2^53 - 4
+     * for the other limbs, more than any limb of g */
+    h[0] = f[0] + (((uint64_t)1 << 53) - 76) - g[0];
+    for (i = 1; i < 5; ++i)
+        h[i] = f[i] + (((uint64_t)1 << 53) - 4) - g[i];
+
+    fe25519_reduce(h);
+}
+
+void fe25519_neg(fe25519_t h, fe25519_t f)
+{
+    fe25519_t zero;
+
+    fe25519_zero(zero);
+    fe25519_sub(h, zero, f);
+}
+
+void fe25519_mul(fe25519_t h, fe25519_t f, fe25519_t g)
+{
+    u128_t   r[5];
+    uint64_t g19[5];
+    int      i;
+    int      j;
+
+    memset(r, 0, sizeof(r));
+
+    /* f[i] * g[j] * 2^(51 * (i + j)): past 2^255, 2^255 = 19 mod p */
+    for (j = 0; j < 5; ++j)
+        g19[j] = 19 * g[j];
+
+    for (i = 0; i < 5; ++i)
+        for (j = 0; j < 5; ++j)
+            u128_mac(&r[(i + j) % 5], f[i], i + j < 5 ? g[j] : g19[j]);
+
+    fe25519_carry(h, r);
+}
+
+void fe25519_sqr(fe25519_t h, fe25519_t f)
+{
+    u128_t   r[5];
+    uint64_t d0  = 2 * f[0];
+    uint64_t d1  = 2 * f[1];
+    uint64_t d2  = 2 * f[2];
+    uint64_t d3  = 2 * f[3];
+    uint64_t t3  = 19 * f[3];
+    uint64_t t4  = 19 * f[4];
+
+    memset(r, 0, sizeof(r));
+
+    /* Same as fe25519_mul, each cross product f[i] * f[j] taken once and
+     * doubled */
+    u128_mac(&r[0], f[0], f[0]);
+    u128_mac(&r[0], d1, t4);
+    u128_mac(&r[0], d2, t3);
+
+    u128_mac(&r[1], d0, f[1]);
+    u128_mac(&r[1], d2, t4);
+    u128_mac(&r[1], f[3], t3);
+
+    u128_mac(&r[2], d0, f[2]);
+    u128_mac(&r[2], f[1], f[1]);
+    u128_mac(&r[2], d3, t4);
+
+    u128_mac(&r[3], d0, f[3]);
+    u128_mac(&r[3], d1, f[2]);
+    u128_mac(&r[3], f[4], t4);
+
+    u128_mac(&r[4], d0, f[4]);
+    u128_mac(&r[4], d1, f[3]);
+    u128_mac(&r[4], f[2], f[2]);
+
+    fe25519_carry(h, r);
+}
+
+void fe25519_mul_small(fe25519_t h, fe25519_t f, uint32_t n)
+{
+    u128_t r[5];
+    int    i;
+
+    memset(r, 0, sizeof(r));
+
+    for (i = 0; i < 5; ++i)
+        u128_mac(&r[i], f[i], n);
+
+    fe25519_carry(h, r);
+}
+
+static void fe25519_carry(fe25519_t h, u128_t* r)
+{
+    u128_t top;
+    int    i;
+
+    for (i = 0; i < 4; ++i)
+    {
+        h[i] = u128_shift(&r[i]);
+        u128_add(&r[i + 1], u128_low(&r[i]));
+    }
+    h[4] = u128_shift(&r[4]);
+
+    /* What is left of r[4] can be 64 bits long: times 19 on 128 bits */
+    memset(&top, 0, sizeof(top));
+    u128_mac(&top, u128_low(&r[4]), 19);
+    u128_add(&top, h[0]);
+    h[0] = u128_shift(&top);
+    h[1] += u128_low(&top);
+}
+
+void fe25519_invert(fe25519_t h, fe25519_t f)
+{
+    fe25519_t z11;
+    fe25519_t t;
+    int       i;
+
+    /* p - 2 = 2^255 - 21 = (2^250 - 1) * 2^5 + 11 */
+    fe25519_pow2250(t, z11, f);
+    for (i = 0; i < 5; ++i)
+        fe25519_sqr(t, t);
+    fe25519_mul(h, t, z11);
+}
+
+void fe25519_pow22523(fe25519_t h, fe25519_t f)
+{
+    fe25519_t z11;
+    fe25519_t t;
+
+    /* (p - 5) / 8 = 2^252 - 3 = (2^250 - 1) * 2^2 + 1 */
+    fe25519_pow2250(t, z11, f);
+    fe25519_sqr(t, t);
+    fe25519_sqr(t, t);
+    fe25519_mul(h, t, f);
+}
+
+static void fe25519_pow2250(fe25519_t h, fe25519_t z11, fe25519_t f)
+{
+    fe25519_t z2;
+    fe25519_t z9;
+    fe25519_t z2_5;   /* f^(2^5 - 1) */
+    fe25519_t z2_10;  /* f^(2^10 - 1) */
+    fe25519_t z2_20;  /* f^(2^20 - 1) */
+    fe25519_t z2_50;  /* f^(2^50 - 1) */
+    fe25519_t z2_100; /* f^(2^100 - 1) */
+    fe25519_t t;
+    int       i;
+
+    /* The usual chain: 249 squarings and 11 multiplications */
+    fe25519_sqr(z2, f);
+    fe25519_sqr(t, z2);
+    fe25519_sqr(t, t);
+    fe25519_mul(z9, t, f);
+    fe25519_mul(z11, z9, z2);
+    fe25519_sqr(t, z11);
+    fe25519_mul(z2_5, t, z9);
+
+    fe25519_sqr(t, z2_5);
+    for (i = 1; i < 5; ++i)
+        fe25519_sqr(t, t);
+    fe25519_mul(z2_10, t, z2_5);
+
+    fe25519_sqr(t, z2_10);
+    for (i = 1; i < 10; ++i)
+        fe25519_sqr(t, t);
+    fe25519_mul(z2_20, t, z2_10);
+
+    fe25519_sqr(t, z2_20);
+    for (i = 1; i < 20; ++i)
+        fe25519_sqr(t, t);
+    fe25519_mul(t, t, z2_20);
+
+    for (i = 0; i < 10; ++i)
+        fe25519_sqr(t, t);
+    fe25519_mul(z2_50, t, z2_10);
+
+    fe25519_sqr(t, z2_50);
+    for (i = 1; i < 50; ++i)
+        fe25519_sqr(t, t);
+    fe25519_mul(z2_100, t, z2_50);
+
+    fe25519_sqr(t, z2_100);
+    for (i = 1; i < 100; ++i)
+        fe25519_sqr(t, t);
+    fe25519_mul(t, t, z2_100);
+
+    for (i = 0; i < 50; ++i)
+        fe25519_sqr(t, t);
+    fe25519_mul(h, t, z2_50);
+}
+
+void fe25519_cswap(fe25519_t f, fe25519_t g, uint64_t mask)
+{
+    uint64_t x;
+    int      i;
+
+    for (i = 0; i < 5; ++i)
+    {
+        x = (f[i] ^ g[i]) & mask;
+        f[i] ^= x;
+        g[i] ^= x;
+    }
+}
+
+void fe25519_cmov(fe25519_t f, fe25519_t g, uint64_t mask)
+{
+    int i;
+
+    for (i = 0; i < 5; ++i)
+        f[i] ^= (f[i] ^ g[i]) & mask;
+}
+
+int fe25519_isnegative(fe25519_t f)
+{
+    byte s[FE25519_SIZE];
+
+    fe25519_tobytes(s, f);
+
+    return s[0] & 1;
+}
+
+int fe25519_iszero(fe25519_t f)
+{
+    byte s[FE25519_SIZE];
+    byte acc = 0;
+    int  i;
+
+    fe25519_tobytes(s, f);
+    for (i = 0; i < FE25519_SIZE; ++i)
+        acc |= s[i];
+
+    /* acc - 1 borrows only if acc is zero */
+    return (int)(((unsigned int)acc - 1) >> 8 & 1);
+}
+
+static void fe25519_reduce(fe25519_t h)
+{
+    int i;
+
+    for (i = 0; i < 4; ++i)
+    {
+        h[i + 1] += h[i] >> 51;
+        h[i] &= FE25519_MASK51;
+    }
+    h[0] += 19 * (h[4] >> 51);
+    h[4] &= FE25519_MASK51;
+}
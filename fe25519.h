@@ -0,0 +1,70 @@
+#ifndef CMC_CRYPTO_FE25519_INCLUDED
+#define CMC_CRYPTO_FE25519_INCLUDED
+
+#include <stdint.h>
+
+#include "types.h"
+
+/* Field products are accumulated on 128 bits: 1 -> with the compiler's
+ * unsigned __int128; 0 -> with pairs of 64-bit words (portable, slower) */
+#ifndef FE25519_INT128
+#if defined(__SIZEOF_INT128__)
+#define FE25519_INT128 1
+#else
+#define FE25519_INT128 0
+#endif
+#endif
+
+/* Bytes of an encoded field element */
+#define FE25519_SIZE 32
+
+/* Element of GF(2^255 - 19), the field of Curve25519 and Ed25519, in radix
+ * 2^51: h[0] + h[1] * 2^51 + ... + h[4] * 2^204.
+ *
+ * Limbs are not kept below 2^51, only below 2^52, and the representation is
+ * not unique: any output of these functions is a valid input of any of them,
+ * fe25519_tobytes gives the canonical form. Outputs can overlap with inputs.
+ * All of them run in constant time. */
+typedef uint64_t fe25519_t[5];
+
+/* Little-endian bytes, the top bit ignored (values up to 2^255 - 1, not
+ * necessarily reduced), and back (fully reduced) */
+extern void fe25519_frombytes(fe25519_t h, const byte* src);
+extern void fe25519_tobytes(byte* dst, fe25519_t h);
+
+extern void fe25519_zero(fe25519_t h);
+extern void fe25519_one(fe25519_t h);
+extern void fe25519_copy(fe25519_t h, fe25519_t f);
+
+/* h <- f + g, f - g, -f */
+extern void fe25519_add(fe25519_t h, fe25519_t f, fe25519_t g);
+extern void fe25519_sub(fe25519_t h, fe25519_t f, fe25519_t g);
+extern void fe25519_neg(fe25519_t h, fe25519_t f);
+
+/* h <- f * g, f^2, f * n (n less than 2^32) */
+extern void fe25519_mul(fe25519_t h, fe25519_t f, fe25519_t g);
+extern void fe25519_sqr(fe25519_t h, fe25519_t f);
+extern void fe25519_mul_small(fe25519_t h, fe25519_t f, uint32_t n);
+
+/* h <- f^(p - 2), the inverse of f (0 if f is 0) */
+extern void fe25519_invert(fe25519_t h, fe25519_t f);
+
+/* h <- f^((p - 5) / 8), for square roots (see RFC 8032, section 5.1.3) */
+extern void fe25519_pow22523(fe25519_t h, fe25519_t f);
+
+/* Without branches, mask being all ones or zero:
+ * - fe25519_cswap: f <-> g if mask;
+ * - fe25519_cmov: f <- g if mask.
+ */
+extern void fe25519_cswap(fe25519_t f, fe25519_t g, uint64_t mask);
+extern void fe25519_cmov(fe25519_t f, fe25519_t g, uint64_t mask);
+
+/* RETURN
+ * fe25519_isnegative: lowest bit of the canonical form (the "sign" of x in
+ *                     the encodings of Ed25519);
+ * fe25519_iszero: 1 if f is 0 mod p, 0 otherwise.
+ */
+extern int fe25519_isnegative(fe25519_t f);
+extern int fe25519_iszero(fe25519_t f);
+
+#endif /* CMC_CRYPTO_FE25519_INCLUDED */
@@ -0,0 +1,218 @@
+#include <string.h>
+
+#include "hmac.h"
+
+#define HMAC_IPAD 0x36
+#define HMAC_OPAD 0x5c
+
+void hmac_sha256_key(hmac_sha256_key_p K, const byte* key, size_t len)
+{
+    byte   block[SHA256_BLOCK_SIZE];
+    size_t i;
+
+    memset(block, 0, sizeof(block));
+    if (len > SHA256_BLOCK_SIZE)
+        sha256(block, key, len);
+    else if (len > 0)
+        memcpy(block, key, len);
+
+    for (i = 0; i < SHA256_BLOCK_SIZE; ++i)
+        block[i] ^= HMAC_IPAD;
+    sha256_init(&K->inner);
+    sha256_update(&K->inner, block, SHA256_BLOCK_SIZE);
+
+    for (i = 0; i < SHA256_BLOCK_SIZE; ++i)
+        block[i] ^= HMAC_IPAD ^ HMAC_OPAD;
+    sha256_init(&K->outer);
+    sha256_update(&K->outer, block, SHA256_BLOCK_SIZE);
+
+    memset(block, 0, sizeof(block));
+}
+
+void hmac_sha512_key(hmac_sha512_key_p K, const byte* key, size_t len)
+{
+    byte   block[SHA512_BLOCK_SIZE];
+    size_t i;
+
+    memset(block, 0, sizeof(block));
+    if (len > SHA512_BLOCK_SIZE)
+        sha512(block, key, len);
+    else if (len > 0)
+        memcpy(block, key, len);
+
+    for (i = 0; i < SHA512_BLOCK_SIZE; ++i)
+        block[i] ^= HMAC_IPAD;
+    sha512_init(&K->inner);
+    sha512_update(&K->inner, block, SHA512_BLOCK_SIZE);
+
+    for (i = 0; i < SHA512_BLOCK_SIZE; ++i)
+        block[i] ^= HMAC_IPAD ^ HMAC_OPAD;
+    sha512_init(&K->outer);
+    sha512_update(&K->outer, block, SHA512_BLOCK_SIZE);
+
+    memset(block, 0, sizeof(block));
+}
+
+void hmac_sha256_init(hmac_sha256_p M, hmac_sha256_key_p K) { *M = *K; }
+
+void hmac_sha256_update(hmac_sha256_p M, const byte* src, size_t len)
+{
+    sha256_update(&M->inner, src, len);
+}
+
+void hmac_sha256_final(hmac_sha256_p M, byte* dst)
+{
+    byte T[SHA256_DIGEST_SIZE];
+
+    sha256_final(&M->inner, T);
+    sha256_update(&M->outer, T, SHA256_DIGEST_SIZE);
+    sha256_final(&M->outer, dst);
+}
+
+void hmac_sha512_init(hmac_sha512_p M, hmac_sha512_key_p K) { *M = *K; }
+
+void hmac_sha512_update(hmac_sha512_p M, const byte* src, size_t len)
+{
+    sha512_update(&M->inner, src, len);
+}
+
+void hmac_sha512_final(hmac_sha512_p M, byte* dst)
+{
+    byte T[SHA512_DIGEST_SIZE];
+
+    sha512_final(&M->inner, T);
+    sha512_update(&M->outer, T, SHA512_DIGEST_SIZE);
+    sha512_final(&M->outer, dst);
+}
+
+void hmac_sha256(byte* dst, hmac_sha256_key_p K, const byte* src, size_t len)
+{
+    struct hmac_sha256_key_t M;
+
+    hmac_sha256_init(&M, K);
+    hmac_sha256_update(&M, src, len);
+    hmac_sha256_final(&M, dst);
+}
+
+void hmac_sha512(byte* dst, hmac_sha512_key_p K, const byte* src, size_t len)
+{
+    struct hmac_sha512_key_t M;
+
+    hmac_sha512_init(&M, K);
+    hmac_sha512_update(&M, src, len);
+    hmac_sha512_final(&M, dst);
+}
+
+int hmac_equal(const byte* a, const byte* b, size_t len)
+{
+    unsigned int diff = 0;
+    size_t       i;
+
+    for (i = 0; i < len; ++i)
+        diff |= (unsigned int)(a[i] ^ b[i]);
+
+    /* diff - 1 borrows (top bit set) only if diff is zero */
+    return (int)(((diff - 1u) >> (sizeof(unsigned int) * 8 - 1)) & 1u);
+}
+
+void hkdf_sha256_extract(
+    byte*       prk,
+    const byte* salt,
+    size_t      salt_len,
+    const byte* ikm,
+    size_t      ikm_len
+)
+{
+    struct hmac_sha256_key_t K;
+
+    /* No salt is HashLen zeros, the same key once padded to a block */
+    hmac_sha256_key(&K, salt, salt_len);
+    hmac_sha256(prk, &K, ikm, ikm_len);
+}
+
+int hkdf_sha256_expand(
+    byte*       okm,
+    size_t      len,
+    const byte* prk,
+    size_t      prk_len,
+    const byte* info,
+    size_t      info_len
+)
+{
+    struct hmac_sha256_key_t K;
+    struct hmac_sha256_key_t M;
+    byte                     T[SHA256_DIGEST_SIZE];
+    byte                     counter;
+    size_t                   take;
+
+    if (len > 255 * SHA256_DIGEST_SIZE)
+        return 1;
+
+    hmac_sha256_key(&K, prk, prk_len);
+
+    /* T(i) = HMAC(prk, T(i - 1) || info || i), T(0) being empty */
+    for (counter = 1; len > 0; ++counter, okm += take, len -= take)
+    {
+        hmac_sha256_init(&M, &K);
+        if (counter > 1)
+            hmac_sha256_update(&M, T, SHA256_DIGEST_SIZE);
+        hmac_sha256_update(&M, info, info_len);
+        hmac_sha256_update(&M, &counter, 1);
+        hmac_sha256_final(&M, T);
+
+        take = len < SHA256_DIGEST_SIZE ? len : SHA256_DIGEST_SIZE;
+        memcpy(okm, T, take);
+    }
+
+    return 0;
+}
+
+void hkdf_sha512_extract(
+    byte*       prk,
+    const byte* salt,
+    size_t      salt_len,
+    const byte* ikm,
+    size_t      ikm_len
+)
+{
+    struct hmac_sha512_key_t K;
+
+    hmac_sha512_key(&K, salt, salt_len);
+    hmac_sha512(prk, &K, ikm, ikm_len);
+}
+
+int hkdf_sha512_expand(
+    byte*       okm,
+    size_t      len,
+    const byte* prk,
+    size_t      prk_len,
+    const byte* info,
+    size_t      info_len
+)
+{
+    struct hmac_sha512_key_t K;
+    struct hmac_sha512_key_t M;
+    byte                     T[SHA512_DIGEST_SIZE];
+    byte                     counter;
+    size_t                   take;
+
+    if (len > 255 * SHA512_DIGEST_SIZE)
+        return 1;
+
+    hmac_sha512_key(&K, prk, prk_len);
+
+    for (counter = 1; len > 0; ++counter, okm += take, len -= take)
+    {
+        hmac_sha512_init(&M, &K);
+        if (counter > 1)
+            hmac_sha512_update(&M, T, SHA512_DIGEST_SIZE);
+        hmac_sha512_update(&M, info, info_len);
+        hmac_sha512_update(&M, &counter, 1);
+        hmac_sha512_final(&M, T);
+
+        take = len < SHA512_DIGEST_SIZE ? len : SHA512_DIGEST_SIZE;
+        memcpy(okm, T, take);
+    }
+
+    return 0;
+}
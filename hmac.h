@@ -0,0 +1,95 @@
+#ifndef CMC_CRYPTO_HMAC_INCLUDED
+#define CMC_CRYPTO_HMAC_INCLUDED
+
+#include <stddef.h>
+
+#include "sha2.h"
+#include "types.h"
+
+/* HMAC key: the hash states after the first block, that is key ^ ipad and
+ * key ^ opad, computed once by hmac_sha256_key (hmac_sha512_key) and then
+ * copied at each message. An HMAC costs, on top of hashing the message, just
+ * two compressions: the outer hash of the inner digest and the final padding
+ * block; the two key blocks, that dominate short messages, are not hashed
+ * again. */
+typedef struct hmac_sha256_key_t
+{
+    struct sha256_t inner;
+    struct sha256_t outer;
+}* hmac_sha256_key_p;
+
+typedef struct hmac_sha512_key_t
+{
+    struct sha512_t inner;
+    struct sha512_t outer;
+}* hmac_sha512_key_p;
+
+/* Message in progress, see hmac_sha256_init */
+typedef struct hmac_sha256_key_t* hmac_sha256_p;
+typedef struct hmac_sha512_key_t* hmac_sha512_p;
+
+/* HMAC (RFC 2104) key of any length: longer than a block, it is hashed */
+extern void hmac_sha256_key(hmac_sha256_key_p K, const byte* key, size_t len);
+extern void hmac_sha512_key(hmac_sha512_key_p K, const byte* key, size_t len);
+
+/* Incremental HMAC with a precomputed key: hmac_sha256_init, then
+ * hmac_sha256_update any number of times, then hmac_sha256_final, that writes
+ * the SHA256_DIGEST_SIZE bytes of the tag into dst. K is not modified, hence
+ * it can be shared by any number of messages (and threads). */
+extern void hmac_sha256_init(hmac_sha256_p M, hmac_sha256_key_p K);
+extern void hmac_sha256_update(hmac_sha256_p M, const byte* src, size_t len);
+extern void hmac_sha256_final(hmac_sha256_p M, byte* dst);
+extern void hmac_sha512_init(hmac_sha512_p M, hmac_sha512_key_p K);
+extern void hmac_sha512_update(hmac_sha512_p M, const byte* src, size_t len);
+extern void hmac_sha512_final(hmac_sha512_p M, byte* dst);
+
+/* One-shot HMAC of src with a precomputed key */
+extern void
+hmac_sha256(byte* dst, hmac_sha256_key_p K, const byte* src, size_t len);
+extern void
+hmac_sha512(byte* dst, hmac_sha512_key_p K, const byte* src, size_t len);
+
+/* Tag comparison in constant time: 1 if a and b are equal, 0 otherwise */
+extern int hmac_equal(const byte* a, const byte* b, size_t len);
+
+/* HKDF (RFC 5869) with HMAC-SHA256 (HMAC-SHA512):
+ * - hkdf_sha256_extract -> prk (SHA256_DIGEST_SIZE bytes) from the input
+ *   keying material and a salt (none if salt_len is 0);
+ * - hkdf_sha256_expand -> len bytes of output keying material from prk and
+ *   info, at most 255 * SHA256_DIGEST_SIZE.
+ *
+ * RETURN
+ * hkdf_*_expand: 0 on success, 1 if len is too long (nothing is written)
+ */
+extern void hkdf_sha256_extract(
+    byte*       prk,
+    const byte* salt,
+    size_t      salt_len,
+    const byte* ikm,
+    size_t      ikm_len
+);
+extern int hkdf_sha256_expand(
+    byte*       okm,
+    size_t      len,
+    const byte* prk,
+    size_t      prk_len,
+    const byte* info,
+    size_t      info_len
+);
+extern void hkdf_sha512_extract(
+    byte*       prk,
+    const byte* salt,
+    size_t      salt_len,
+    const byte* ikm,
+    size_t      ikm_len
+);
+extern int hkdf_sha512_expand(
+    byte*       okm,
+    size_t      len,
+    const byte* prk,
+    size_t      prk_len,
+    const byte* info,
+    size_t      info_len
+);
+
+#endif /* CMC_CRYPTO_HMAC_INCLUDED */
@@ -1,4 +1,5 @@
 #include <errno.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -154,3 +155,85 @@ void io_buffer_free(io_buffer_p B)
     B->buf = NULL;
     B->N   = 0;
 }
+
+int io_read_file(io_buffer_p B, const char* path)
+{
+    FILE* fp;
+    long  size;
+    int   errno_hold;
+
+    B->buf = NULL;
+    B->N   = 0;
+
+    fp = fopen(path, "rb");
+    if (fp == NULL)
+        return errno;
+
+    if (fseek(fp, 0, SEEK_END) == -1 || (size = ftell(fp)) == -1 ||
+        fseek(fp, 0, SEEK_SET) == -1)
+    {
+        errno_hold = errno;
+        fclose(fp);
+        return errno_hold;
+    }
+
+    if (size > INT_MAX)
+    {
+        fclose(fp);
+        return EFBIG;
+    }
+
+    if (size > 0)
+    {
+        B->buf = malloc((size_t)size);
+        if (B->buf == NULL)
+        {
+            fclose(fp);
+            return ENOMEM;
+        }
+
+        if (fread(B->buf, 1, (size_t)size, fp) != (size_t)size)
+        {
+            errno_hold = ferror(fp) ? errno : EIO;
+            free(B->buf);
+            B->buf = NULL;
+            fclose(fp);
+            return errno_hold;
+        }
+    }
+
+    B->N = (int)size;
+    fclose(fp);
+
+    return 0;
+}
+
+int io_write_file(io_buffer_p B, const char* path, int pad_mode)
+{
+    FILE*  fp;
+    size_t to_print = (size_t)B->N;
+    size_t wb;
+
+    if (to_print == 0)
+        return 0;
+
+    if (pad_mode == PAD_PKCS7)
+    {
+        if ((unsigned char)B->buf[to_print - 1] > to_print)
+            return EINVAL;
+
+        to_print -= (unsigned char)B->buf[to_print - 1];
+    }
+
+    fp = fopen(path, "wb");
+    if (fp == NULL)
+        return errno;
+
+    errno = 0;
+    wb    = fwrite(B->buf, 1, to_print, fp);
+
+    if (fclose(fp) != 0 || wb != to_print)
+        return errno != 0 ? errno : EIO;
+
+    return 0;
+}
@@ -13,6 +13,16 @@ void io_read_all_content(io_buffer_p B, const char* path);
 /* Write a buffer to a file, panic in case of failure. */
 void io_write_all_content(io_buffer_p B, const char* path, int pad_mode);
 
+/* As io_read_all_content and io_write_all_content, but a failure is returned
+ * instead of ending the process, e.g. when many files are processed.
+ *
+ * RETURN
+ * 0 on success (io_read_file: B holds the content, NULL if empty);
+ * errno of the failure otherwise (io_read_file: B holds nothing to free).
+ */
+int io_read_file(io_buffer_p B, const char* path);
+int io_write_file(io_buffer_p B, const char* path, int pad_mode);
+
 void io_buffer_alloc(io_buffer_p B, int N);
 void io_buffer_free(io_buffer_p B);
 
@@ -1,11 +1,23 @@
+#define _POSIX_C_SOURCE 199309L
+
 #include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "aes.h"
+#include "ed25519.h"
 #include "error.h"
+#include "hmac.h"
 #include "io.h"
+#include "p256.h"
+#include "random.h"
+#include "rsa.h"
+#include "sha2.h"
+#include "x25519.h"
 
 enum
 {
@@ -17,18 +29,279 @@ enum
     CLI_PATH_IV  = 6
 };
 
+/* Options of the RSA modes (RSA-OAEP+AES-CTR and RSA-PSS), that have no IV:
+ * [6] is the key file format and [7] the public key file of a private key */
+enum
+{
+    CLI_RSA_KEY_FMT  = 6,
+    CLI_RSA_PATH_PUB = 7
+};
+
+/* Bytes read and written at a time by the streaming ciphers */
+#ifndef CLI_STREAM_CHUNK
+#define CLI_STREAM_CHUNK (1 << 16)
+#endif
+
+/* RSA-OAEP+AES-CTR file layout:
+ * - HYBRID_MAGIC;
+ * - k, the byte length of n, 4 bytes big-endian;
+ * - k bytes: the AES-256 key and the first counter block (HYBRID_SECRET_SIZE
+ *   bytes in all), encrypted with RSA-OAEP;
+ * - the input, encrypted with AES-256-CTR (same length);
+ * - the HMAC-SHA256 of the first counter block and of the encrypted input,
+ *   keyed with HKDF-SHA256 of the AES key and counter block, HYBRID_INFO
+ *   being the info string. */
+#define HYBRID_MAGIC "CMCH"
+#define HYBRID_SECRET_SIZE (32 + 16)
+#define HYBRID_INFO "cmc-crypto RSA-OAEP+AES-CTR"
+#define HYBRID_TAG_SIZE SHA256_DIGEST_SIZE
+
+/* AES-CBC+HMAC file layout: IV (16 bytes), the input encrypted with
+ * AES-256-CBC and PKCS#7 padding, then the HMAC-SHA256 of both. The AES and
+ * HMAC keys are derived from the key file with HKDF-SHA256, ETM_INFO being the
+ * info string. */
+#define ETM_INFO "cmc-crypto AES-CBC+HMAC"
+#define ETM_TAG_SIZE SHA256_DIGEST_SIZE
+
+/* Longest line of a file list, see sign_router */
+#define CLI_PATH_MAX 4096
+
+/* Batch mode, see batch_router: lines of the manifest read ahead of the
+ * workers, and workers if [5] is "-" */
+#ifndef CLI_BATCH_QUEUE
+#define CLI_BATCH_QUEUE 64
+#endif
+
+#ifndef CLI_BATCH_WORKERS
+#define CLI_BATCH_WORKERS 4
+#endif
+
+#define CLI_BATCH_WORKERS_MAX 256
+
+/* A line of the manifest, split by the worker that takes it */
+typedef struct batch_job_t
+{
+    char          line[CLI_PATH_MAX];
+    unsigned long number; /* Line number, for the messages */
+}* batch_job_p;
+
+/* A slot of the IVs used by a batch, see batch_iv_claim */
+typedef struct batch_iv_t
+{
+    byte iv[16];
+    int  set;
+}* batch_iv_p;
+
+/* State shared by the reader of the manifest and the workers: a ring of
+ * CLI_BATCH_QUEUE jobs, the expanded key, and the totals */
+typedef struct batch_t
+{
+    pthread_mutex_t     lock;
+    pthread_cond_t      not_empty;
+    pthread_cond_t      not_full;
+    struct batch_job_t* queue;
+    int                 head;  /* Next job to take */
+    int                 count; /* Jobs queued */
+    int                 eof;   /* No job will be queued anymore */
+
+    aes_key_p KEY;
+    int       op;
+    int       block_mode;
+    int       pad_mode;
+    int       need_iv;
+
+    unsigned long files;
+    unsigned long failed;
+    double        bytes; /* Input bytes of the files processed */
+
+    /* IVs used so far, when encrypting with a stream mode (see
+     * batch_iv_claim): open addressing, at most half full */
+    struct batch_iv_t* ivs;
+    size_t             ivs_size; /* Slots, a power of 2 */
+    size_t             ivs_used;
+}* batch_p;
+
 void exit_usage(void);
 
 void aes_router(int argc, char** argv);
 
+/* AES on many files in one process: [4] is @<manifest>, or @- for the
+ * standard input, with a line per file: input path, output path and, for the
+ * modes that need it, IV path, separated by blanks. [5] is the number of
+ * workers ("-": CLI_BATCH_WORKERS).
+ *
+ * The key is read and expanded once (aes_key_new). The manifest is read by
+ * the calling thread into a queue of CLI_BATCH_QUEUE lines, from which the
+ * workers take the files to read, encrypt (decrypt) and write. A file that
+ * fails is reported and skipped; the aggregate throughput is printed at the
+ * end.
+ *
+ * When encrypting with AES-CTR or AES-OFB, a file whose IV was already used in
+ * the batch fails (see batch_iv_claim). Distinct IVs are not enough for CTR
+ * either: counter ranges must not overlap, so IVs should be random.
+ */
+void batch_router(
+    int argc, char** argv, int block_mode, int pad_mode, int need_iv
+);
+
+/* Frees the key, the queue and the IVs of B, and workers and started (any of
+ * them may be NULL) */
+void batch_free(batch_p B, pthread_t* workers, int* started);
+
+/* Thread routine: arg is a batch_p. Runs the jobs of the queue until it is
+ * empty and eof is set. */
+void* batch_worker(void* arg);
+
+/* Process the file of J with the key and mode of B.
+ *
+ * RETURN
+ * Bytes read on success, -1 otherwise (the reason is printed)
+ */
+long batch_file(batch_p B, batch_job_p J);
+
+/* CTR and OFB turn the IV into a keystream: two files encrypted with the
+ * same key and IV would share it, and the XOR of the ciphertexts would be the
+ * XOR of the plaintexts. Record iv as used, unless it already is.
+ *
+ * RETURN
+ * 0 -> iv was not used yet in this batch; 1 -> it was.
+ */
+int batch_iv_claim(batch_p B, const byte* iv);
+
+/* FNV-1a of the 16 bytes of iv */
+size_t batch_iv_hash(const byte* iv);
+
+/* Next blank-separated field of *cursor, NUL-terminated in place, *cursor
+ * moved past it.
+ *
+ * RETURN
+ * The field, NULL if none is left
+ */
+char* batch_field(char** cursor);
+
+/* Seconds elapsed from an arbitrary origin (CLOCK_MONOTONIC) */
+double cli_now(void);
+
+/* RSA-OAEP+AES-CTR: a random AES key is encrypted with the RSA public key (or
+ * decrypted with the private one) and the input is streamed through AES-CTR,
+ * CLI_STREAM_CHUNK bytes at a time, so that files of any size are encrypted
+ * at AES speed and in constant memory. The output is authenticated
+ * (encrypt-then-MAC, see HYBRID_MAGIC): when decrypting, the tag is checked
+ * in a first pass over the input, and nothing is written if it does not
+ * match.
+ *
+ * [3] is a public key file when encrypting, a private key file when
+ * decrypting; [6] (optional) is its format: hex (default), bin or der. A hex
+ * or bin private key needs its public key file as well, [7] (see
+ * cli_key_import).
+ */
+void hybrid_router(int argc, char** argv);
+
+/* Stream in, from the current position, through M and, if ctr is not NULL,
+ * through AES-CTR into out. When encrypting the input is hashed once
+ * encrypted, and tag is not touched; when decrypting (decrypt set) it is
+ * hashed before, and its last HYBRID_TAG_SIZE bytes, copied into tag, are
+ * neither hashed nor decrypted. Exit on failure. */
+void hybrid_stream(
+    FILE*         in,
+    FILE*         out,
+    aes_ctr_p     ctr,
+    hmac_sha256_p M,
+    int           decrypt,
+    byte*         tag,
+    char**        argv
+);
+
+/* AES-CBC+HMAC: encrypt-then-MAC. The key file holds the input keying
+ * material (at least 16 bytes), the IV is random. When decrypting, the tag is
+ * checked before anything is decrypted, and nothing is written if it does not
+ * match. */
+void etm_router(int argc, char** argv);
+
+/* RSA-PSS: sign (s) or verify (v) [4] with the private or public key [3] in
+ * format [6] (optional: hex, the default, bin or der); [5] is the signature.
+ * A hex or bin private key needs its public key file as well, [7].
+ *
+ * If [4] is @<list>, <list> is a file with one path per line, and every file
+ * listed is signed (verified), its signature being the path followed by [5]
+ * (e.g. ".sig"). The key is imported, and its context built, only once.
+ */
+void sign_router(int argc, char** argv);
+
+/* Hash path (streaming it CLI_STREAM_CHUNK bytes at a time) and sign it into
+ * sig_path with C (op 's'), or verify sig_path with K (op 'v').
+ *
+ * RETURN
+ * 0 on success, 1 otherwise (the reason is printed)
+ */
+int sign_file(
+    rsa_key_p K, rsa_key_ctx_p C, int op, const char* path, const char* sig_path
+);
+
+/* X25519 key exchange, raw keys of X25519_SIZE bytes:
+ * - g: new key pair, the private key written into [3], the public one into
+ *   [5] ([4] is not read, e.g. "-");
+ * - x: shared secret of the private key [3] and the peer public key [4],
+ *   written into [5]. It is the raw X25519 output: use it through a KDF.
+ */
+void x25519_router(int argc, char** argv);
+
+/* Ed25519 signatures, raw keys: the private key is the ED25519_SEED_SIZE-byte
+ * seed, the public key ED25519_PUBLIC_SIZE bytes.
+ * - g: new key pair, the private key written into [3], the public one into
+ *   [5] ([4] is not read, e.g. "-");
+ * - s: sign [4] with the private key [3], the signature written into [5];
+ * - v: verify the signature [5] of [4] with the public key [3].
+ *
+ * As with RSA-PSS, [4] can be @<list>, [5] being the signature suffix. When
+ * verifying, the files listed are checked ED25519_BATCH_CHUNK at a time with
+ * ed25519_verify_batch. Files are read whole: Ed25519 hashes them twice.
+ */
+void ed25519_router(int argc, char** argv);
+
+/* Verify the signatures sig_path[i] of the n files path[i] with the public key
+ * pub, with a single batch (n <= ED25519_BATCH_CHUNK), and print the result
+ * of each.
+ *
+ * RETURN
+ * Number of invalid signatures
+ */
+int ed25519_verify_files(const byte* pub, char** path, char** sig_path, int n);
+
+/* NIST P-256, raw keys: the private key is P256_SIZE bytes big-endian, the
+ * public key P256_PUBLIC_SIZE bytes (uncompressed point).
+ * - g: new key pair, the private key written into [3], the public one into
+ *   [5] ([4] is not read, e.g. "-");
+ * - x: ECDH secret of the private key [3] and the peer public key [4],
+ *   written into [5] (raw x-coordinate: use it through a KDF);
+ * - s: ECDSA signature (r || s) of the SHA-256 hash of [4] with the private
+ *   key [3], written into [5];
+ * - v: verify the signature [5] of [4] with the public key [3].
+ */
+void p256_router(int argc, char** argv);
+
+/* Import the RSA key of [3], formatted as [6] (hex if missing): the private
+ * key if priv, the public one otherwise. Exit on failure.
+ *
+ * Hex and bin private key files hold n and d only, and private key operations
+ * are blinded with e (see rsa_key_ctx_init): the public key file [7] is
+ * imported along with them. DER private keys carry e already. */
+void cli_key_import(rsa_key_p K, int argc, char** argv, int priv);
+
 /*
  * - [0]
- * - [1] operation (encrypt, decrypt)
+ * - [1] operation (encrypt, decrypt, sign, verify, generate, exchange)
  * - [2] algo-variant-padding. E.g.:
  *   - AES-ECB
  *   - AES-CBC
  *   - AES-ECB-PKCS#7
  *   - AES-OFB
+ *   - AES-CBC+HMAC
+ *   - RSA-OAEP+AES-CTR
+ *   - RSA-PSS (sign and verify only)
+ *   - X25519 (generate and exchange only)
+ *   - Ed25519 (generate, sign and verify)
+ *   - P-256 (generate, exchange, sign and verify)
  *   [3] key file;
  * - [4] path in;
  * - [5] path out;
@@ -45,19 +318,67 @@ int main(int argc, char** argv)
     {
     case 'e':
     case 'd':
+    case 's':
+    case 'v':
+    case 'g':
+    case 'x':
         break;
     case '\0':
         printf("no operation provided!\n\n");
         exit_usage();
         break;
-    case 's':
-        printf("signing is not supported, yet\n\n");
-        exit_usage();
-        break;
     default:
         exit_usage();
     }
 
+    if (strcmp("X25519", argv[CLI_CIPHER]) == 0)
+    {
+        x25519_router(argc, argv);
+        return 0;
+    }
+
+    if (strcmp("Ed25519", argv[CLI_CIPHER]) == 0)
+    {
+        ed25519_router(argc, argv);
+        return 0;
+    }
+
+    if (strcmp("P-256", argv[CLI_CIPHER]) == 0)
+    {
+        p256_router(argc, argv);
+        return 0;
+    }
+
+    if (argv[CLI_OP][0] == 'g' || argv[CLI_OP][0] == 'x')
+    {
+        printf("cipher %s can not exchange keys\n\n", argv[CLI_CIPHER]);
+        exit_usage();
+    }
+
+    if (strcmp("AES-CBC+HMAC", argv[CLI_CIPHER]) == 0)
+    {
+        etm_router(argc, argv);
+        return 0;
+    }
+
+    if (strcmp("RSA-PSS", argv[CLI_CIPHER]) == 0)
+    {
+        sign_router(argc, argv);
+        return 0;
+    }
+
+    if (argv[CLI_OP][0] == 's' || argv[CLI_OP][0] == 'v')
+    {
+        printf("cipher %s can not sign\n\n", argv[CLI_CIPHER]);
+        exit_usage();
+    }
+
+    if (strcmp("RSA-OAEP+AES-CTR", argv[CLI_CIPHER]) == 0)
+    {
+        hybrid_router(argc, argv);
+        return 0;
+    }
+
     if (strncmp("AES", argv[CLI_CIPHER], 3) != 0)
     {
         printf("cipher %s is not supported (, yet?)\n\n", argv[CLI_CIPHER]);
@@ -77,18 +398,54 @@ void exit_usage(void)
     printf("\nOperations: (the program only checks the first char)\n");
     printf("\te, encrypt\n");
     printf("\td, decrypt\n");
+    printf("\ts, sign\n");
+    printf("\tv, verify (output path is the signature)\n");
+    printf("\tg, generate (key path is the private key, output path the "
+           "public one)\n");
+    printf("\tx, exchange (input path is the peer public key, output path "
+           "the secret)\n");
 
     printf("\nAvailable ciphers, and specific options:\n");
 
     printf("\tAES-ECB[-PKCS#7]\n");
     printf("\tAES-CBC[-PKCS#7] <iv path>\n");
     printf("\tAES-OFB          <iv path>\n");
+    printf("\tAES-CTR          <iv path>\n");
+    printf("\t                 @<manifest> (@- for stdin) as input path: one\n"
+           "\t                 \"<input> <output> [<iv>]\" line per file, key\n"
+           "\t                 expanded once, output path being the number\n"
+           "\t                 of workers (- for the default); CTR and OFB\n"
+           "\t                 reject an IV used twice (same keystream):\n"
+           "\t                 use a random IV per file\n");
+    printf("\tAES-CBC+HMAC     (encrypt-then-MAC, random IV)\n");
+    printf("\tRSA-OAEP+AES-CTR [hex|bin|der] (RSA key file format)\n");
+    printf("\tRSA-PSS          [hex|bin|der] (sign and verify only)\n");
+    printf("\t                 hex and bin private keys: [hex|bin] <public "
+           "key path>\n");
+    printf("\t                 @<list> as input path signs every file listed,\n"
+           "\t                 output path being the signature suffix\n");
+    printf("\tX25519           (generate and exchange only)\n");
+    printf("\tEd25519          (generate, sign and verify; @<list> as "
+           "RSA-PSS,\n"
+           "\t                 verified in batches)\n");
+    printf("\tP-256            (ECDH and ECDSA with SHA-256)\n");
 
     printf("\nExamples:\n");
 
     printf("\tcmc-crypto encrypt AES-ECB key.bin foo.txt bar.bin\n");
     printf("\tcmc-crypto e AES-ECB-PKCS#7 key.bin foo.txt bar.bin\n");
     printf("\tcmc-crypto d AES-OFB key.bin bar.bin foo.txt iv.bin\n");
+    printf("\tcmc-crypto e AES-CTR key.bin @manifest.txt 8\n");
+    printf("\tcmc-crypto e AES-CBC+HMAC key.bin foo.txt bar.bin\n");
+    printf("\tcmc-crypto e RSA-OAEP+AES-CTR pub.der foo.txt bar.bin der\n");
+    printf("\tcmc-crypto s RSA-PSS priv.der foo.txt foo.sig der\n");
+    printf("\tcmc-crypto v RSA-PSS pub.der foo.txt foo.sig der\n");
+    printf("\tcmc-crypto sign RSA-PSS priv.hex @files.txt .sig hex pub.hex\n");
+    printf("\tcmc-crypto g X25519 priv.bin - pub.bin\n");
+    printf("\tcmc-crypto x X25519 priv.bin peer.bin secret.bin\n");
+    printf("\tcmc-crypto g Ed25519 priv.bin - pub.bin\n");
+    printf("\tcmc-crypto v Ed25519 pub.bin @logs.txt .sig\n");
+    printf("\tcmc-crypto x P-256 priv.bin peer.bin secret.bin\n");
 
     exit(FATAL_GENERIC);
 }
@@ -118,38 +475,25 @@ void aes_router(int argc, char** argv)
     }
     else if (strcmp(argv[CLI_CIPHER], "AES-CBC") == 0)
     {
-        if (argc < 7)
-        {
-            printf("no IV provided\n");
-            exit_usage();
-        }
-
         iv.N       = 1;
         block_mode = MODE_CBC;
     }
     else if (strcmp(argv[CLI_CIPHER], "AES-CBC-PKCS#7") == 0)
     {
-        if (argc < 7)
-        {
-            printf("no IV provided\n");
-            exit_usage();
-        }
-
         iv.N       = 1;
         block_mode = MODE_CBC;
         pad_mode   = PAD_PKCS7;
     }
     else if (strcmp(argv[CLI_CIPHER], "AES-OFB") == 0)
     {
-        if (argc < 7)
-        {
-            printf("no IV provided\n");
-            exit_usage();
-        }
-
         iv.N       = 1;
         block_mode = MODE_OFB;
     }
+    else if (strcmp(argv[CLI_CIPHER], "AES-CTR") == 0)
+    {
+        iv.N       = 1;
+        block_mode = MODE_CTR;
+    }
 
     if (block_mode == __aes_mode_invalid)
     {
@@ -157,6 +501,18 @@ void aes_router(int argc, char** argv)
         exit_usage();
     }
 
+    if (argv[CLI_PATH_IN][0] == '@')
+    {
+        batch_router(argc, argv, block_mode, pad_mode, iv.N);
+        return;
+    }
+
+    if (iv.N && argc < 7)
+    {
+        printf("no IV provided\n");
+        exit_usage();
+    }
+
     if (iv.N)
     {
         io_read_all_content(&iv, argv[CLI_PATH_IV]);
@@ -231,3 +587,1281 @@ void aes_router(int argc, char** argv)
     io_buffer_free(&key);
     io_buffer_free(&iv);
 }
+
+void batch_router(
+    int argc, char** argv, int block_mode, int pad_mode, int need_iv
+)
+{
+    struct batch_t     B;
+    struct io_buffer_t key;
+    FILE*              manifest;
+    pthread_t*         workers;
+    int*               started;
+    const char*        name    = &argv[CLI_PATH_IN][1];
+    const char*        error   = NULL;
+    int                threads = CLI_BATCH_WORKERS;
+    int                running = 0;
+    int                i;
+    char               line[CLI_PATH_MAX];
+    unsigned long      number = 0;
+    size_t             len;
+    double             start;
+    double             elapsed;
+    char*              end;
+    long               n;
+
+    (void)argc;
+
+    if (strcmp(argv[CLI_PATH_OUT], "-") != 0)
+    {
+        n = strtol(argv[CLI_PATH_OUT], &end, 10);
+        if (*end != '\0' || n < 1 || n > CLI_BATCH_WORKERS_MAX)
+            EXIT(FATAL_GENERIC, argv[CLI_PATH_OUT], "invalid worker count");
+        threads = (int)n;
+    }
+
+    io_read_all_content(&key, argv[CLI_PATH_KEY]);
+    B.KEY = aes_key_new((unsigned char*)key.buf, key.N);
+    if (key.N > 0)
+        memset(key.buf, 0, (size_t)key.N);
+    io_buffer_free(&key);
+
+    if (B.KEY == NULL)
+        EXIT(
+            FATAL_GENERIC, argv[CLI_PATH_KEY], "key must be 16, 24 or 32 bytes"
+        );
+
+    /* Buffers first and the manifest last: an exit on the way leaks nothing */
+    B.ivs   = NULL;
+    B.queue = malloc(sizeof(struct batch_job_t) * CLI_BATCH_QUEUE);
+    workers = malloc(sizeof(pthread_t) * (size_t)threads);
+    started = calloc((size_t)threads, sizeof(int));
+    if (B.queue == NULL || workers == NULL || started == NULL)
+    {
+        batch_free(&B, workers, started);
+        EXIT(FATAL_GENERIC, "batch", strerror(errno));
+    }
+
+    manifest = strcmp(name, "-") == 0 ? stdin : fopen(name, "r");
+    if (manifest == NULL)
+    {
+        batch_free(&B, workers, started);
+        EXIT(FATAL_GENERIC, name, strerror(errno));
+    }
+
+    pthread_mutex_init(&B.lock, NULL);
+    pthread_cond_init(&B.not_empty, NULL);
+    pthread_cond_init(&B.not_full, NULL);
+    B.head       = 0;
+    B.count      = 0;
+    B.eof        = 0;
+    B.op         = argv[CLI_OP][0];
+    B.block_mode = block_mode;
+    B.pad_mode   = pad_mode;
+    B.need_iv    = need_iv;
+    B.files      = 0;
+    B.failed     = 0;
+    B.bytes      = 0;
+    B.ivs_size   = 0;
+    B.ivs_used   = 0;
+
+    start = cli_now();
+
+    for (i = 0; i < threads; ++i)
+    {
+        started[i] = pthread_create(&workers[i], NULL, batch_worker, &B) == 0;
+        running += started[i];
+    }
+
+    if (running == 0)
+    {
+        if (manifest != stdin)
+            fclose(manifest);
+        pthread_cond_destroy(&B.not_full);
+        pthread_cond_destroy(&B.not_empty);
+        pthread_mutex_destroy(&B.lock);
+        batch_free(&B, workers, started);
+        EXIT(FATAL_GENERIC, "batch", "no worker could be started");
+    }
+
+    while (fgets(line, CLI_PATH_MAX, manifest) != NULL)
+    {
+        ++number;
+
+        len = strcspn(line, "\r\n");
+        if (line[len] == '\0' && !feof(manifest))
+        {
+            error = "line too long";
+            break;
+        }
+
+        line[len] = '\0';
+        if (strspn(line, " \t") == len)
+            continue;
+
+        /* Wait for a free slot: the manifest is read as fast as the workers
+         * go, not faster */
+        pthread_mutex_lock(&B.lock);
+        while (B.count == CLI_BATCH_QUEUE)
+            pthread_cond_wait(&B.not_full, &B.lock);
+
+        i = (B.head + B.count) % CLI_BATCH_QUEUE;
+        memcpy(B.queue[i].line, line, len + 1);
+        B.queue[i].number = number;
+        ++B.count;
+
+        pthread_cond_signal(&B.not_empty);
+        pthread_mutex_unlock(&B.lock);
+    }
+
+    if (error == NULL && ferror(manifest))
+        error = strerror(errno);
+    if (manifest != stdin)
+        fclose(manifest);
+
+    pthread_mutex_lock(&B.lock);
+    B.eof = 1;
+    pthread_cond_broadcast(&B.not_empty);
+    pthread_mutex_unlock(&B.lock);
+
+    for (i = 0; i < threads; ++i)
+        if (started[i])
+            pthread_join(workers[i], NULL);
+
+    /* An empty manifest can take no measurable time */
+    elapsed = cli_now() - start;
+    if (elapsed <= 0)
+        elapsed = 1e-9;
+
+    printf(
+        "%lu files, %lu failed, %.1f MB in %.3f s: %.1f MB/s, %.1f files/s "
+        "(%d workers)\n",
+        B.files,
+        B.failed,
+        B.bytes / 1e6,
+        elapsed,
+        B.bytes / 1e6 / elapsed,
+        (double)B.files / elapsed,
+        running
+    );
+
+    pthread_cond_destroy(&B.not_full);
+    pthread_cond_destroy(&B.not_empty);
+    pthread_mutex_destroy(&B.lock);
+    batch_free(&B, workers, started);
+
+    /* The files queued before a bad manifest line are done all the same */
+    if (error != NULL)
+        EXIT(FATAL_GENERIC, name, error);
+    if (B.failed)
+        exit(FATAL_GENERIC);
+}
+
+void batch_free(batch_p B, pthread_t* workers, int* started)
+{
+    aes_key_free(B->KEY);
+    free(started);
+    free(workers);
+    free(B->queue);
+    free(B->ivs);
+}
+
+void* batch_worker(void* arg)
+{
+    batch_p            B = (batch_p)arg;
+    struct batch_job_t J;
+    long               n;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&B->lock);
+        while (B->count == 0 && !B->eof)
+            pthread_cond_wait(&B->not_empty, &B->lock);
+
+        if (B->count == 0)
+        {
+            pthread_mutex_unlock(&B->lock);
+            break;
+        }
+
+        strcpy(J.line, B->queue[B->head].line);
+        J.number = B->queue[B->head].number;
+        B->head  = (B->head + 1) % CLI_BATCH_QUEUE;
+        --B->count;
+
+        pthread_cond_signal(&B->not_full);
+        pthread_mutex_unlock(&B->lock);
+
+        n = batch_file(B, &J);
+
+        pthread_mutex_lock(&B->lock);
+        if (n < 0)
+        {
+            ++B->failed;
+        }
+        else
+        {
+            ++B->files;
+            B->bytes += (double)n;
+        }
+        pthread_mutex_unlock(&B->lock);
+    }
+
+    return NULL;
+}
+
+long batch_file(batch_p B, batch_job_p J)
+{
+    struct io_buffer_t in;
+    struct io_buffer_t out;
+    struct io_buffer_t iv;
+    char*              cursor = J->line;
+    char*              in_path;
+    char*              out_path;
+    char*              iv_path;
+    int                res;
+    long               n = -1;
+
+    in_path  = batch_field(&cursor);
+    out_path = batch_field(&cursor);
+    iv_path  = batch_field(&cursor);
+
+    if (out_path == NULL || (iv_path != NULL) != (B->need_iv != 0) ||
+        batch_field(&cursor) != NULL)
+    {
+        fprintf(
+            stderr,
+            "line %lu: expected <input> <output>%s\n",
+            J->number,
+            B->need_iv ? " <iv>" : ""
+        );
+        return -1;
+    }
+
+    io_buffer_alloc(&iv, 0);
+
+    if (iv_path != NULL)
+    {
+        res = io_read_file(&iv, iv_path);
+        if (res != 0)
+        {
+            fprintf(stderr, "%s: %s\n", iv_path, strerror(res));
+            return -1;
+        }
+
+        if (iv.N != 16)
+        {
+            fprintf(
+                stderr, "%s: IV size must be 16 (found %d)\n", iv_path, iv.N
+            );
+            io_buffer_free(&iv);
+            return -1;
+        }
+
+        if (B->op == 'e' &&
+            (B->block_mode == MODE_CTR || B->block_mode == MODE_OFB) &&
+            batch_iv_claim(B, (byte*)iv.buf))
+        {
+            fprintf(
+                stderr,
+                "%s: IV already used in this batch, the keystream would "
+                "repeat\n",
+                iv_path
+            );
+            io_buffer_free(&iv);
+            return -1;
+        }
+    }
+
+    res = io_read_file(&in, in_path);
+    if (res != 0)
+    {
+        fprintf(stderr, "%s: %s\n", in_path, strerror(res));
+        io_buffer_free(&iv);
+        return -1;
+    }
+
+    /* Sizes that AES rejects are checked here: its custom error message
+     * (aes_err) is a buffer shared by every thread */
+    if ((B->block_mode == MODE_ECB || B->block_mode == MODE_CBC) &&
+        (B->op == 'd' || B->pad_mode == PAD_NONE) &&
+        (in.N % 16 != 0 || (B->op == 'd' && in.N == 0)))
+    {
+        fprintf(
+            stderr, "%s: size %d is not a multiple of 16\n", in_path, in.N
+        );
+        io_buffer_free(&in);
+        io_buffer_free(&iv);
+        return -1;
+    }
+
+    if (B->op == 'e' && B->pad_mode != PAD_NONE)
+        io_buffer_alloc(&out, in.N + 16 - in.N % 16);
+    else
+        io_buffer_alloc(&out, in.N);
+
+    if (B->op == 'e')
+        res = aes_encrypt_key(
+            in.buf,
+            out.buf,
+            B->KEY,
+            in.N,
+            out.N,
+            iv.buf,
+            B->pad_mode,
+            B->block_mode
+        );
+    else
+        res = aes_decrypt_key(
+            out.buf,
+            in.buf,
+            B->KEY,
+            out.N,
+            in.N,
+            iv.buf,
+            B->pad_mode,
+            B->block_mode
+        );
+
+    if (res != 0)
+    {
+        fprintf(stderr, "%s: %s\n", in_path, aes_err(res));
+    }
+    else
+    {
+        res = io_write_file(
+            &out, out_path, B->op == 'e' ? PAD_NONE : B->pad_mode
+        );
+        if (res != 0)
+            fprintf(stderr, "%s: %s\n", out_path, strerror(res));
+        else
+            n = in.N;
+    }
+
+    io_buffer_free(&in);
+    io_buffer_free(&out);
+    io_buffer_free(&iv);
+
+    return n;
+}
+
+int batch_iv_claim(batch_p B, const byte* iv)
+{
+    struct batch_iv_t* old;
+    size_t             old_size;
+    size_t             h;
+    size_t             i;
+    int                used = 0;
+
+    pthread_mutex_lock(&B->lock);
+
+    if (2 * (B->ivs_used + 1) > B->ivs_size)
+    {
+        old      = B->ivs;
+        old_size = B->ivs_size;
+
+        B->ivs_size = old_size == 0 ? 1024 : 2 * old_size;
+        B->ivs      = calloc(B->ivs_size, sizeof(struct batch_iv_t));
+        EXIT_EALLOC(B->ivs);
+
+        for (i = 0; i < old_size; ++i)
+        {
+            if (!old[i].set)
+                continue;
+
+            h = batch_iv_hash(old[i].iv) & (B->ivs_size - 1);
+            while (B->ivs[h].set)
+                h = (h + 1) & (B->ivs_size - 1);
+            B->ivs[h] = old[i];
+        }
+
+        free(old);
+    }
+
+    h = batch_iv_hash(iv) & (B->ivs_size - 1);
+    for (; B->ivs[h].set; h = (h + 1) & (B->ivs_size - 1))
+    {
+        if (memcmp(B->ivs[h].iv, iv, 16) == 0)
+        {
+            used = 1;
+            break;
+        }
+    }
+
+    if (!used)
+    {
+        memcpy(B->ivs[h].iv, iv, 16);
+        B->ivs[h].set = 1;
+        ++B->ivs_used;
+    }
+
+    pthread_mutex_unlock(&B->lock);
+
+    return used;
+}
+
+size_t batch_iv_hash(const byte* iv)
+{
+    size_t h = 2166136261u;
+    int    i;
+
+    for (i = 0; i < 16; ++i)
+        h = (h ^ iv[i]) * 16777619u;
+
+    return h;
+}
+
+char* batch_field(char** cursor)
+{
+    char* field;
+
+    *cursor += strspn(*cursor, " \t");
+    if (**cursor == '\0')
+        return NULL;
+
+    field = *cursor;
+    *cursor += strcspn(*cursor, " \t");
+
+    if (**cursor != '\0')
+    {
+        **cursor = '\0';
+        ++*cursor;
+    }
+
+    return field;
+}
+
+double cli_now(void)
+{
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0)
+        EXIT(FATAL_GENERIC, "cli_now", "clock_gettime failed");
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+void etm_router(int argc, char** argv)
+{
+    struct io_buffer_t       key;
+    struct io_buffer_t       input_text;
+    struct io_buffer_t       output_text;
+    struct hmac_sha256_key_t K;
+    byte                     prk[SHA256_DIGEST_SIZE];
+    byte                     keys[32 + 32]; /* AES-256 key || HMAC key */
+    byte                     tag[ETM_TAG_SIZE];
+    byte*                    in;
+    int                      body;
+    int                      res;
+
+    (void)argc;
+
+    io_read_all_content(&key, argv[CLI_PATH_KEY]);
+    if (key.N < 16)
+        EXIT(
+            FATAL_GENERIC, argv[CLI_PATH_KEY], "key must be 16 bytes at least"
+        );
+
+    hkdf_sha256_extract(prk, NULL, 0, (byte*)key.buf, (size_t)key.N);
+    hkdf_sha256_expand(
+        keys, sizeof(keys), prk, sizeof(prk), (byte*)ETM_INFO, strlen(ETM_INFO)
+    );
+    hmac_sha256_key(&K, &keys[32], 32);
+
+    io_read_all_content(&input_text, argv[CLI_PATH_IN]);
+    in = (byte*)input_text.buf;
+
+    if (argv[CLI_OP][0] == 'e')
+    {
+        body = input_text.N + 16 - input_text.N % 16;
+        io_buffer_alloc(&output_text, 16 + body + ETM_TAG_SIZE);
+
+        random_get_buffer(output_text.buf, 16);
+        res = aes_encrypt(
+            input_text.buf,
+            &output_text.buf[16],
+            keys,
+            input_text.N,
+            body,
+            32,
+            output_text.buf,
+            PAD_PKCS7,
+            MODE_CBC
+        );
+        if (res != 0)
+            EXIT(FATAL_GENERIC, "AES failed", aes_err(res));
+
+        hmac_sha256(
+            (byte*)&output_text.buf[16 + body],
+            &K,
+            (byte*)output_text.buf,
+            (size_t)(16 + body)
+        );
+
+        io_write_all_content(&output_text, argv[CLI_PATH_OUT], PAD_NONE);
+    }
+    else
+    {
+        body = input_text.N - 16 - ETM_TAG_SIZE;
+        if (body < 16 || body % 16 != 0)
+            EXIT(FATAL_GENERIC, argv[CLI_PATH_IN], "not an AES-CBC+HMAC file");
+
+        hmac_sha256(tag, &K, in, (size_t)(16 + body));
+        if (!hmac_equal(tag, &in[16 + body], ETM_TAG_SIZE))
+            EXIT(FATAL_GENERIC, argv[CLI_PATH_IN], "authentication failed");
+
+        io_buffer_alloc(&output_text, body);
+        res = aes_decrypt(
+            output_text.buf,
+            &input_text.buf[16],
+            keys,
+            body,
+            body,
+            32,
+            input_text.buf,
+            PAD_PKCS7,
+            MODE_CBC
+        );
+        if (res != 0)
+            EXIT(FATAL_GENERIC, "AES failed", aes_err(res));
+
+        io_write_all_content(&output_text, argv[CLI_PATH_OUT], PAD_PKCS7);
+    }
+
+    memset(keys, 0, sizeof(keys));
+    memset(key.buf, 0, (size_t)key.N);
+
+    io_buffer_free(&key);
+    io_buffer_free(&input_text);
+    io_buffer_free(&output_text);
+}
+
+void hybrid_router(int argc, char** argv)
+{
+    struct rsa_key_t         K;
+    struct hmac_sha256_key_t MK;
+    struct hmac_sha256_key_t M;
+    FILE*                    in;
+    FILE*                    out;
+    aes_ctr_p                ctr;
+    byte                     secret[BIGINT_MAX]; /* AES key || counter */
+    byte                     wrapped[BIGINT_MAX];
+    byte                     prk[SHA256_DIGEST_SIZE];
+    byte                     mac_key[SHA256_DIGEST_SIZE];
+    byte                     tag[HYBRID_TAG_SIZE];
+    byte                     expected[HYBRID_TAG_SIZE];
+    byte                     header[8];
+    uint32_t                 size;
+    int                      decrypt = argv[CLI_OP][0] == 'd';
+    int                      k;
+    int                      len;
+    int                      res;
+
+    cli_key_import(&K, argc, argv, decrypt);
+    k = rsa_key_size(&K);
+
+    /* The input is streamed, not read whole: writing over it would truncate
+     * it before it is read */
+    if (strcmp(argv[CLI_PATH_IN], argv[CLI_PATH_OUT]) == 0)
+        EXIT(FATAL_GENERIC, argv[CLI_PATH_OUT], "same as the input path");
+
+    in = fopen(argv[CLI_PATH_IN], "rb");
+    if (in == NULL)
+        EXIT(FATAL_GENERIC, argv[CLI_PATH_IN], strerror(errno));
+
+    if (!decrypt)
+    {
+        random_get_buffer((char*)secret, HYBRID_SECRET_SIZE);
+
+        res = rsa_encrypt_oaep(
+            wrapped, secret, HYBRID_SECRET_SIZE, NULL, 0, &K
+        );
+        if (res != RSA_OK)
+            EXIT(FATAL_GENERIC, "RSA-OAEP", rsa_err(res));
+
+        memcpy(header, HYBRID_MAGIC, 4);
+        header[4] = (byte)(k >> 24);
+        header[5] = (byte)(k >> 16);
+        header[6] = (byte)(k >> 8);
+        header[7] = (byte)k;
+    }
+    else
+    {
+        if (fread(header, 1, 8, in) != 8 ||
+            memcmp(header, HYBRID_MAGIC, 4) != 0)
+            EXIT(
+                FATAL_GENERIC, argv[CLI_PATH_IN], "not a RSA-OAEP+AES-CTR file"
+            );
+
+        size = (uint32_t)header[4] << 24 | (uint32_t)header[5] << 16 |
+               (uint32_t)header[6] << 8 | (uint32_t)header[7];
+        if (size != (uint32_t)k ||
+            fread(wrapped, 1, (size_t)k, in) != (size_t)k)
+            EXIT(FATAL_GENERIC, argv[CLI_PATH_IN], "key size mismatch");
+
+        res = rsa_decrypt_oaep(secret, &len, wrapped, NULL, 0, &K);
+        if (res != RSA_OK || len != HYBRID_SECRET_SIZE)
+            EXIT(FATAL_GENERIC, "RSA-OAEP", rsa_err(RSA_ERR_DECRYPTION));
+    }
+
+    hkdf_sha256_extract(prk, NULL, 0, secret, HYBRID_SECRET_SIZE);
+    hkdf_sha256_expand(
+        mac_key,
+        sizeof(mac_key),
+        prk,
+        sizeof(prk),
+        (byte*)HYBRID_INFO,
+        strlen(HYBRID_INFO)
+    );
+    hmac_sha256_key(&MK, mac_key, sizeof(mac_key));
+    memset(prk, 0, sizeof(prk));
+    memset(mac_key, 0, sizeof(mac_key));
+
+    /* First pass: nothing is decrypted, nor written, unless the tag matches */
+    if (decrypt)
+    {
+        hmac_sha256_init(&M, &MK);
+        hmac_sha256_update(&M, &secret[32], 16);
+        hybrid_stream(in, NULL, NULL, &M, 1, tag, argv);
+        hmac_sha256_final(&M, expected);
+
+        if (!hmac_equal(tag, expected, HYBRID_TAG_SIZE) ||
+            fseek(in, 8 + (long)k, SEEK_SET) != 0)
+            EXIT(FATAL_GENERIC, argv[CLI_PATH_IN], "authentication failed");
+    }
+
+    /* Opened only now: nothing is written if the key can not be unwrapped */
+    out = fopen(argv[CLI_PATH_OUT], "wb");
+    if (out == NULL)
+        EXIT(FATAL_GENERIC, argv[CLI_PATH_OUT], strerror(errno));
+
+    if (!decrypt && (fwrite(header, 1, 8, out) != 8 ||
+                     fwrite(wrapped, 1, (size_t)k, out) != (size_t)k))
+        EXIT(FATAL_GENERIC, argv[CLI_PATH_OUT], strerror(errno));
+
+    ctr = aes_ctr_new(secret, 32, (char*)&secret[32]);
+
+    hmac_sha256_init(&M, &MK);
+    hmac_sha256_update(&M, &secret[32], 16);
+    memset(secret, 0, sizeof(secret));
+
+    hybrid_stream(in, out, ctr, &M, decrypt, tag, argv);
+    hmac_sha256_final(&M, expected);
+
+    /* The key schedule is wiped by aes_ctr_free */
+    aes_ctr_free(ctr);
+    memset(&MK, 0, sizeof(MK));
+    memset(&M, 0, sizeof(M));
+    fclose(in);
+
+    if (!decrypt &&
+        fwrite(expected, 1, HYBRID_TAG_SIZE, out) != HYBRID_TAG_SIZE)
+        EXIT(FATAL_GENERIC, argv[CLI_PATH_OUT], strerror(errno));
+
+    if (fclose(out) != 0)
+        EXIT(FATAL_GENERIC, argv[CLI_PATH_OUT], strerror(errno));
+
+    /* The input changed between the two passes */
+    if (decrypt && !hmac_equal(tag, expected, HYBRID_TAG_SIZE))
+    {
+        remove(argv[CLI_PATH_OUT]);
+        EXIT(FATAL_GENERIC, argv[CLI_PATH_IN], "authentication failed");
+    }
+}
+
+void hybrid_stream(
+    FILE*         in,
+    FILE*         out,
+    aes_ctr_p     ctr,
+    hmac_sha256_p M,
+    int           decrypt,
+    byte*         tag,
+    char**        argv
+)
+{
+    char*  chunk;
+    size_t have = 0; /* Bytes held back in chunk: the tag, maybe */
+    size_t body;
+    size_t n;
+
+    /* Room for a tag held back from the previous read */
+    chunk = malloc(CLI_STREAM_CHUNK + HYBRID_TAG_SIZE);
+    EXIT_EALLOC(chunk);
+
+    while ((n = fread(&chunk[have], 1, CLI_STREAM_CHUNK, in)) > 0)
+    {
+        have += n;
+        body = have;
+        if (decrypt)
+            body = have > HYBRID_TAG_SIZE ? have - HYBRID_TAG_SIZE : 0;
+
+        if (decrypt)
+            hmac_sha256_update(M, (byte*)chunk, body);
+        if (ctr != NULL)
+            aes_ctr_update(ctr, chunk, chunk, (int)body);
+        if (!decrypt)
+            hmac_sha256_update(M, (byte*)chunk, body);
+
+        if (out != NULL && fwrite(chunk, 1, body, out) != body)
+            EXIT(FATAL_GENERIC, argv[CLI_PATH_OUT], strerror(errno));
+
+        have -= body;
+        memmove(chunk, &chunk[body], have);
+    }
+
+    if (ferror(in))
+        EXIT(FATAL_GENERIC, argv[CLI_PATH_IN], strerror(errno));
+    if (decrypt && have != HYBRID_TAG_SIZE)
+        EXIT(FATAL_GENERIC, argv[CLI_PATH_IN], "not a RSA-OAEP+AES-CTR file");
+
+    if (decrypt)
+        memcpy(tag, chunk, HYBRID_TAG_SIZE);
+
+    /* Plaintext, either way */
+    memset(chunk, 0, CLI_STREAM_CHUNK + HYBRID_TAG_SIZE);
+    free(chunk);
+}
+
+void sign_router(int argc, char** argv)
+{
+    struct rsa_key_t     K;
+    struct rsa_key_ctx_t C;
+    FILE*                list;
+    char                 path[CLI_PATH_MAX];
+    char                 sig_path[2 * CLI_PATH_MAX];
+    int                  op     = argv[CLI_OP][0];
+    int                  failed = 0;
+    int                  res;
+    size_t               len;
+
+    cli_key_import(&K, argc, argv, op == 's');
+
+    if (op == 's')
+    {
+        res = rsa_key_ctx_get(&C, &K);
+        if (res != RSA_OK)
+            EXIT(FATAL_GENERIC, "key context", rsa_err(res));
+    }
+
+    if (argv[CLI_PATH_IN][0] != '@')
+    {
+        if (sign_file(&K, &C, op, argv[CLI_PATH_IN], argv[CLI_PATH_OUT]))
+            exit(FATAL_GENERIC);
+        return;
+    }
+
+    list = fopen(&argv[CLI_PATH_IN][1], "r");
+    if (list == NULL)
+        EXIT(FATAL_GENERIC, &argv[CLI_PATH_IN][1], strerror(errno));
+
+    while (fgets(path, CLI_PATH_MAX, list) != NULL)
+    {
+        len = strcspn(path, "\r\n");
+        if (path[len] == '\0' && !feof(list))
+            EXIT(FATAL_GENERIC, &argv[CLI_PATH_IN][1], "path too long");
+
+        path[len] = '\0';
+        if (len == 0)
+            continue;
+
+        if (len + strlen(argv[CLI_PATH_OUT]) >= sizeof(sig_path))
+            EXIT(FATAL_GENERIC, path, "signature path too long");
+
+        strcpy(sig_path, path);
+        strcat(sig_path, argv[CLI_PATH_OUT]);
+
+        failed |= sign_file(&K, &C, op, path, sig_path);
+    }
+
+    if (ferror(list))
+        EXIT(FATAL_GENERIC, &argv[CLI_PATH_IN][1], strerror(errno));
+    fclose(list);
+
+    if (failed)
+        exit(FATAL_GENERIC);
+}
+
+int sign_file(
+    rsa_key_p K, rsa_key_ctx_p C, int op, const char* path, const char* sig_path
+)
+{
+    struct sha256_t S;
+    FILE*           fp;
+    char*           chunk;
+    byte            hash[SHA256_DIGEST_SIZE];
+    byte            sig[BIGINT_MAX];
+    size_t          k = (size_t)rsa_key_size(K);
+    size_t          n;
+    int             res;
+
+    fp = fopen(path, "rb");
+    if (fp == NULL)
+    {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    chunk = malloc(CLI_STREAM_CHUNK);
+    EXIT_EALLOC(chunk);
+
+    sha256_init(&S);
+    while ((n = fread(chunk, 1, CLI_STREAM_CHUNK, fp)) > 0)
+        sha256_update(&S, (byte*)chunk, n);
+    sha256_final(&S, hash);
+
+    free(chunk);
+    res = ferror(fp);
+    fclose(fp);
+
+    if (res)
+    {
+        fprintf(stderr, "%s: read error\n", path);
+        return 1;
+    }
+
+    if (op == 's')
+    {
+        res = rsa_ctx_sign_pss(sig, hash, C);
+        if (res != RSA_OK)
+        {
+            fprintf(stderr, "%s: %s\n", path, rsa_err(res));
+            return 1;
+        }
+
+        fp = fopen(sig_path, "wb");
+        if (fp == NULL)
+        {
+            fprintf(stderr, "%s: %s\n", sig_path, strerror(errno));
+            return 1;
+        }
+
+        n = fwrite(sig, 1, k, fp);
+        if (fclose(fp) != 0 || n != k)
+        {
+            fprintf(stderr, "%s: write error\n", sig_path);
+            return 1;
+        }
+
+        return 0;
+    }
+
+    fp = fopen(sig_path, "rb");
+    if (fp == NULL)
+    {
+        fprintf(stderr, "%s: %s\n", sig_path, strerror(errno));
+        return 1;
+    }
+
+    /* A signature is exactly k bytes long */
+    n = fread(sig, 1, k, fp);
+    if (n == k && fgetc(fp) != EOF)
+        n = 0;
+    fclose(fp);
+
+    res = n == k ? rsa_verify_pss(sig, hash, K) : RSA_ERR_SIGNATURE;
+    printf("%s: %s\n", path, res == RSA_OK ? "OK" : rsa_err(res));
+
+    return res != RSA_OK;
+}
+
+void cli_key_import(rsa_key_p K, int argc, char** argv, int priv)
+{
+    FILE* fp;
+    FILE* pub;
+    int   fmt = RSA_FMT_HEX;
+    int   res;
+
+    if (argc > CLI_RSA_KEY_FMT)
+    {
+        if (strcmp(argv[CLI_RSA_KEY_FMT], "bin") == 0)
+            fmt = RSA_FMT_BIN;
+        else if (strcmp(argv[CLI_RSA_KEY_FMT], "der") == 0)
+            fmt = RSA_FMT_DER;
+        else if (strcmp(argv[CLI_RSA_KEY_FMT], "hex") != 0)
+        {
+            printf("invalid key format: %s\n", argv[CLI_RSA_KEY_FMT]);
+            exit_usage();
+        }
+    }
+
+    if (priv && fmt != RSA_FMT_DER && argc <= CLI_RSA_PATH_PUB)
+    {
+        printf("a hex or bin private key needs its public key file too\n\n");
+        exit_usage();
+    }
+
+    fp = fopen(argv[CLI_PATH_KEY], "rb");
+    if (fp == NULL)
+        EXIT(FATAL_GENERIC, argv[CLI_PATH_KEY], strerror(errno));
+
+    pub = NULL;
+    if (priv && fmt != RSA_FMT_DER)
+    {
+        pub = fopen(argv[CLI_RSA_PATH_PUB], "rb");
+        if (pub == NULL)
+        {
+            fclose(fp);
+            EXIT(FATAL_GENERIC, argv[CLI_RSA_PATH_PUB], strerror(errno));
+        }
+    }
+
+    if (priv)
+        res = rsa_key_import_fmt(K, pub, fp, fmt);
+    else
+        res = rsa_key_import_fmt(K, fp, NULL, fmt);
+    fclose(fp);
+    if (pub != NULL)
+        fclose(pub);
+
+    if (res != RSA_OK)
+        EXIT(FATAL_GENERIC, "key import", rsa_err(res));
+}
+
+void x25519_router(int argc, char** argv)
+{
+    struct io_buffer_t priv;
+    struct io_buffer_t peer;
+    struct io_buffer_t out;
+
+    (void)argc;
+
+    if (argv[CLI_OP][0] == 'g')
+    {
+        io_buffer_alloc(&priv, X25519_SIZE);
+        io_buffer_alloc(&out, X25519_SIZE);
+
+        x25519_keypair((byte*)out.buf, (byte*)priv.buf);
+
+        io_write_all_content(&priv, argv[CLI_PATH_KEY], PAD_NONE);
+        io_write_all_content(&out, argv[CLI_PATH_OUT], PAD_NONE);
+    }
+    else if (argv[CLI_OP][0] == 'x')
+    {
+        io_read_all_content(&priv, argv[CLI_PATH_KEY]);
+        if (priv.N != X25519_SIZE)
+            EXIT(FATAL_GENERIC, argv[CLI_PATH_KEY], "not an X25519 key");
+
+        io_read_all_content(&peer, argv[CLI_PATH_IN]);
+        if (peer.N != X25519_SIZE)
+            EXIT(FATAL_GENERIC, argv[CLI_PATH_IN], "not an X25519 key");
+
+        io_buffer_alloc(&out, X25519_SIZE);
+        if (x25519((byte*)out.buf, (byte*)priv.buf, (byte*)peer.buf) != 0)
+            EXIT(FATAL_GENERIC, argv[CLI_PATH_IN], "public key of small order");
+
+        io_write_all_content(&out, argv[CLI_PATH_OUT], PAD_NONE);
+        io_buffer_free(&peer);
+    }
+    else
+    {
+        printf("cipher X25519 can only generate and exchange keys\n\n");
+        exit_usage();
+    }
+
+    memset(priv.buf, 0, (size_t)priv.N);
+    memset(out.buf, 0, (size_t)out.N);
+
+    io_buffer_free(&priv);
+    io_buffer_free(&out);
+}
+
+void ed25519_router(int argc, char** argv)
+{
+    struct io_buffer_t key;
+    struct io_buffer_t msg;
+    struct io_buffer_t out;
+    FILE*              list;
+    char*              path[ED25519_BATCH_CHUNK];
+    char*              sig_path[ED25519_BATCH_CHUNK];
+    char               line[CLI_PATH_MAX];
+    byte               pub[ED25519_PUBLIC_SIZE];
+    int                op      = argv[CLI_OP][0];
+    int                invalid = 0;
+    int                n       = 0;
+    int                i;
+    size_t             len;
+
+    (void)argc;
+
+    if (op == 'g')
+    {
+        io_buffer_alloc(&key, ED25519_SEED_SIZE);
+        io_buffer_alloc(&out, ED25519_PUBLIC_SIZE);
+
+        ed25519_keypair((byte*)out.buf, (byte*)key.buf);
+
+        io_write_all_content(&key, argv[CLI_PATH_KEY], PAD_NONE);
+        io_write_all_content(&out, argv[CLI_PATH_OUT], PAD_NONE);
+
+        memset(key.buf, 0, (size_t)key.N);
+        io_buffer_free(&key);
+        io_buffer_free(&out);
+        return;
+    }
+
+    if (op != 's' && op != 'v')
+    {
+        printf("cipher Ed25519 can only generate keys, sign and verify\n\n");
+        exit_usage();
+    }
+
+    io_read_all_content(&key, argv[CLI_PATH_KEY]);
+    if (key.N != (op == 's' ? ED25519_SEED_SIZE : ED25519_PUBLIC_SIZE))
+        EXIT(FATAL_GENERIC, argv[CLI_PATH_KEY], "not an Ed25519 key");
+
+    if (op == 's')
+        ed25519_public(pub, (byte*)key.buf);
+    else
+        memcpy(pub, key.buf, ED25519_PUBLIC_SIZE);
+
+    if (argv[CLI_PATH_IN][0] != '@')
+    {
+        if (op == 'v')
+        {
+            path[0]     = argv[CLI_PATH_IN];
+            sig_path[0] = argv[CLI_PATH_OUT];
+            if (ed25519_verify_files(pub, path, sig_path, 1))
+                exit(FATAL_GENERIC);
+        }
+        else
+        {
+            io_read_all_content(&msg, argv[CLI_PATH_IN]);
+            io_buffer_alloc(&out, ED25519_SIGNATURE_SIZE);
+
+            ed25519_sign(
+                (byte*)out.buf,
+                (byte*)msg.buf,
+                (size_t)msg.N,
+                (byte*)key.buf,
+                pub
+            );
+            io_write_all_content(&out, argv[CLI_PATH_OUT], PAD_NONE);
+
+            io_buffer_free(&msg);
+            io_buffer_free(&out);
+        }
+
+        memset(key.buf, 0, (size_t)key.N);
+        io_buffer_free(&key);
+        return;
+    }
+
+    list = fopen(&argv[CLI_PATH_IN][1], "r");
+    if (list == NULL)
+        EXIT(FATAL_GENERIC, &argv[CLI_PATH_IN][1], strerror(errno));
+
+    /* Paths are collected up to a batch; signatures are written as they come */
+    io_buffer_alloc(&out, ED25519_SIGNATURE_SIZE);
+    while (fgets(line, CLI_PATH_MAX, list) != NULL)
+    {
+        len = strcspn(line, "\r\n");
+        if (line[len] == '\0' && !feof(list))
+            EXIT(FATAL_GENERIC, &argv[CLI_PATH_IN][1], "path too long");
+
+        line[len] = '\0';
+        if (len == 0)
+            continue;
+
+        path[n]     = malloc(len + 1);
+        sig_path[n] = malloc(len + strlen(argv[CLI_PATH_OUT]) + 1);
+        EXIT_EALLOC(path[n]);
+        EXIT_EALLOC(sig_path[n]);
+        strcpy(path[n], line);
+        strcpy(sig_path[n], line);
+        strcat(sig_path[n], argv[CLI_PATH_OUT]);
+
+        if (op == 's')
+        {
+            io_read_all_content(&msg, path[n]);
+            ed25519_sign(
+                (byte*)out.buf,
+                (byte*)msg.buf,
+                (size_t)msg.N,
+                (byte*)key.buf,
+                pub
+            );
+            io_write_all_content(&out, sig_path[n], PAD_NONE);
+
+            io_buffer_free(&msg);
+            free(path[n]);
+            free(sig_path[n]);
+            continue;
+        }
+
+        if (++n < ED25519_BATCH_CHUNK)
+            continue;
+
+        invalid += ed25519_verify_files(pub, path, sig_path, n);
+        for (i = 0; i < n; ++i)
+        {
+            free(path[i]);
+            free(sig_path[i]);
+        }
+        n = 0;
+    }
+
+    if (ferror(list))
+        EXIT(FATAL_GENERIC, &argv[CLI_PATH_IN][1], strerror(errno));
+    fclose(list);
+
+    if (n > 0)
+        invalid += ed25519_verify_files(pub, path, sig_path, n);
+    for (i = 0; i < n; ++i)
+    {
+        free(path[i]);
+        free(sig_path[i]);
+    }
+
+    memset(key.buf, 0, (size_t)key.N);
+    io_buffer_free(&key);
+    io_buffer_free(&out);
+
+    if (invalid)
+        exit(FATAL_GENERIC);
+}
+
+int ed25519_verify_files(const byte* pub, char** path, char** sig_path, int n)
+{
+    struct io_buffer_t msg[ED25519_BATCH_CHUNK];
+    byte               sig[ED25519_BATCH_CHUNK][ED25519_SIGNATURE_SIZE];
+    const byte*        sig_p[ED25519_BATCH_CHUNK];
+    const byte*        msg_p[ED25519_BATCH_CHUNK];
+    const byte*        pub_p[ED25519_BATCH_CHUNK];
+    size_t             len[ED25519_BATCH_CHUNK];
+    int                valid[ED25519_BATCH_CHUNK];
+    FILE*              fp;
+    int                invalid = 0;
+    int                res;
+    int                i;
+
+    memset(len, 0, sizeof(len));
+    for (i = 0; i < n; ++i)
+    {
+        /* A missing or malformed signature fails the check: S = 2^256 - 1 is
+         * never canonical. So does an unreadable file, checked as empty. */
+        memset(sig[i], 0xff, ED25519_SIGNATURE_SIZE);
+
+        res = io_read_file(&msg[i], path[i]);
+        if (res != 0)
+            fprintf(stderr, "%s: %s\n", path[i], strerror(res));
+
+        msg_p[i] = (byte*)msg[i].buf;
+        len[i]   = (size_t)msg[i].N;
+        sig_p[i] = sig[i];
+        pub_p[i] = pub;
+
+        if (res != 0)
+            continue;
+
+        fp = fopen(sig_path[i], "rb");
+        if (fp == NULL)
+        {
+            fprintf(stderr, "%s: %s\n", sig_path[i], strerror(errno));
+            continue;
+        }
+
+        if (fread(sig[i], 1, ED25519_SIGNATURE_SIZE, fp) !=
+                ED25519_SIGNATURE_SIZE ||
+            fgetc(fp) != EOF)
+            memset(sig[i], 0xff, ED25519_SIGNATURE_SIZE);
+        fclose(fp);
+    }
+
+    ed25519_verify_batch(sig_p, msg_p, len, pub_p, n, valid);
+
+    for (i = 0; i < n; ++i)
+    {
+        printf("%s: %s\n", path[i], valid[i] ? "OK" : "invalid signature");
+        io_buffer_free(&msg[i]);
+        invalid += !valid[i];
+    }
+
+    return invalid;
+}
+
+void p256_router(int argc, char** argv)
+{
+    struct io_buffer_t key;
+    struct io_buffer_t in;
+    struct io_buffer_t out;
+    byte               hash[SHA256_DIGEST_SIZE];
+    int                op = argv[CLI_OP][0];
+    int                res;
+
+    (void)argc;
+
+    if (op == 'g')
+    {
+        io_buffer_alloc(&key, P256_SIZE);
+        io_buffer_alloc(&out, P256_PUBLIC_SIZE);
+
+        p256_keypair((byte*)out.buf, (byte*)key.buf);
+
+        io_write_all_content(&key, argv[CLI_PATH_KEY], PAD_NONE);
+        io_write_all_content(&out, argv[CLI_PATH_OUT], PAD_NONE);
+
+        memset(key.buf, 0, (size_t)key.N);
+        io_buffer_free(&key);
+        io_buffer_free(&out);
+        return;
+    }
+
+    if (op != 'x' && op != 's' && op != 'v')
+    {
+        printf("cipher P-256 can not encrypt\n\n");
+        exit_usage();
+    }
+
+    io_read_all_content(&key, argv[CLI_PATH_KEY]);
+    if (key.N != (op == 'v' ? P256_PUBLIC_SIZE : P256_SIZE))
+        EXIT(FATAL_GENERIC, argv[CLI_PATH_KEY], "not a P-256 key");
+
+    io_read_all_content(&in, argv[CLI_PATH_IN]);
+
+    if (op == 'x')
+    {
+        if (in.N != P256_PUBLIC_SIZE)
+            EXIT(FATAL_GENERIC, argv[CLI_PATH_IN], "not a P-256 key");
+
+        io_buffer_alloc(&out, P256_SIZE);
+        if (p256_ecdh((byte*)out.buf, (byte*)key.buf, (byte*)in.buf) != 0)
+            EXIT(FATAL_GENERIC, "ECDH", "invalid private or public key");
+
+        io_write_all_content(&out, argv[CLI_PATH_OUT], PAD_NONE);
+        memset(out.buf, 0, (size_t)out.N);
+        io_buffer_free(&out);
+    }
+    else if (op == 's')
+    {
+        sha256(hash, (byte*)in.buf, (size_t)in.N);
+
+        io_buffer_alloc(&out, P256_SIGNATURE_SIZE);
+        res = p256_ecdsa_sign(
+            (byte*)out.buf, hash, sizeof(hash), (byte*)key.buf
+        );
+        if (res != 0)
+            EXIT(FATAL_GENERIC, argv[CLI_PATH_KEY], "invalid private key");
+
+        io_write_all_content(&out, argv[CLI_PATH_OUT], PAD_NONE);
+        io_buffer_free(&out);
+    }
+    else
+    {
+        sha256(hash, (byte*)in.buf, (size_t)in.N);
+
+        io_read_all_content(&out, argv[CLI_PATH_OUT]);
+        res = out.N != P256_SIGNATURE_SIZE ||
+              p256_ecdsa_verify(
+                  (byte*)out.buf, hash, sizeof(hash), (byte*)key.buf
+              );
+        printf("%s: %s\n", argv[CLI_PATH_IN], res ? "invalid signature" : "OK");
+        io_buffer_free(&out);
+
+        if (res)
+            exit(FATAL_GENERIC);
+    }
+
+    memset(key.buf, 0, (size_t)key.N);
+    io_buffer_free(&key);
+    io_buffer_free(&in);
+}
@@ -0,0 +1,1156 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bigint.h"
+#include "error.h"
+#include "hmac.h"
+#include "p256.h"
+#include "random.h"
+
+#define P256_LIMBS 8
+
+/* wNAF windows of verification: odd multiples up to (2^(w - 1) - 1) P, that
+ * is 2^(w - 2) of them; those of the generator are built once */
+#define P256_WINDOW 5
+#define P256_BASE_WINDOW 7
+#define P256_ODD (1 << (P256_WINDOW - 2))
+#define P256_BASE_ODD (1 << (P256_BASE_WINDOW - 2))
+
+/* Signed 4-bit digits of a scalar (less than 2^256): 64, plus a carry */
+#define P256_DIGITS 65
+
+/* Element of GF(p): 32-bit words, least significant first, always fully
+ * reduced (less than p) */
+typedef uint32_t fp_t[P256_LIMBS];
+
+static const fp_t P256_P = {
+    0xffffffff, 0xffffffff, 0xffffffff, 0x00000000,
+    0x00000000, 0x00000000, 0x00000001, 0xffffffff
+};
+
+/* p - 2, the exponent of inversions */
+static const fp_t P256_P2 = {
+    0xfffffffd, 0xffffffff, 0xffffffff, 0x00000000,
+    0x00000000, 0x00000000, 0x00000001, 0xffffffff
+};
+
+static const fp_t P256_B = {
+    0x27d2604b, 0x3bce3c3e, 0xcc53b0f6, 0x651d06b0,
+    0x769886bc, 0xb3ebbd55, 0xaa3a93e7, 0x5ac635d8
+};
+
+static const fp_t P256_GX = {
+    0xd898c296, 0xf4a13945, 0x2deb33a0, 0x77037d81,
+    0x63a440f2, 0xf8bce6e5, 0xe12c4247, 0x6b17d1f2
+};
+
+static const fp_t P256_GY = {
+    0x37bf51f5, 0xcbb64068, 0x6b315ece, 0x2bce3357,
+    0x7c0f9e16, 0x8ee7eb4a, 0xfe1a7f9b, 0x4fe342e2
+};
+
+/* Order of the generator, big-endian */
+static const byte P256_N[] = {
+    0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xbc, 0xe6, 0xfa, 0xad, 0xa7, 0x17, 0x9e, 0x84,
+    0xf3, 0xb9, 0xca, 0xc2, 0xfc, 0x63, 0x25, 0x51
+};
+
+/* Jacobian coordinates; Z = 0 is the point at infinity */
+typedef struct p256_jac_t
+{
+    fp_t X;
+    fp_t Y;
+    fp_t Z;
+}* p256_jac_p;
+
+typedef struct p256_aff_t
+{
+    fp_t x;
+    fp_t y;
+}* p256_aff_p;
+
+/* Built once by p256_init, read-only afterwards */
+static struct p256_tables_t
+{
+    struct p256_aff_t    base[P256_DIGITS / 2 + 1][8]; /* k * 256^i * G */
+    struct p256_aff_t    odd[P256_BASE_ODD];           /* (2k + 1) * G */
+    struct bigint_mont_t n;
+    struct bigint_t      n2; /* n - 2, the exponent of inversions */
+} P256;
+
+static pthread_once_t p256_once = PTHREAD_ONCE_INIT;
+
+static void p256_init(void);
+
+/* Field arithmetic, outputs fully reduced; they can overlap with inputs */
+static void fp_add(fp_t h, const fp_t f, const fp_t g);
+static void fp_sub(fp_t h, const fp_t f, const fp_t g);
+static void fp_mul(fp_t h, const fp_t f, const fp_t g);
+static void fp_sqr(fp_t h, const fp_t f);
+static void fp_inv(fp_t h, const fp_t f);
+static void fp_neg(fp_t h, const fp_t f);
+
+/* h <- t mod p, t having 16 words (a product), with the special form of p */
+static void fp_reduce(fp_t h, const uint32_t* t);
+
+/* h <- t + carry * 2^256 - p if not negative, t + carry * 2^256 otherwise;
+ * t + carry * 2^256 must be less than 2p */
+static void fp_reduce_once(fp_t h, const uint32_t* t, uint32_t carry);
+
+/* f <- g if mask (all ones or zero), without branches */
+static void fp_cmov(fp_t f, const fp_t g, uint32_t mask);
+
+/* RETURN
+ * 1 if f is 0, 0 otherwise */
+static int fp_iszero(const fp_t f);
+
+/* Big-endian bytes.
+ *
+ * RETURN (fp_frombytes)
+ * 0 -> h is the number in src;
+ * 1 -> it is not less than p.
+ */
+static int  fp_frombytes(fp_t h, const byte* src);
+static void fp_tobytes(byte* dst, const fp_t h);
+
+/* r <- 2p, p + q, p + q (q affine); r can be the same as p or q. Doubling the
+ * point at infinity, or adding it, gives the right result in constant time;
+ * p = q, only possible for public inputs or with negligible probability,
+ * branches to a doubling. */
+static void jac_dbl(p256_jac_p r, p256_jac_p p);
+static void jac_add(p256_jac_p r, p256_jac_p p, p256_jac_p q);
+static void jac_madd(p256_jac_p r, p256_jac_p p, p256_aff_p q);
+
+static void jac_to_aff(p256_aff_p r, p256_jac_p p);
+static void jac_from_aff(p256_jac_p r, p256_aff_p p);
+static void jac_infinity(p256_jac_p r);
+
+/* RETURN
+ * 1 if p is on the curve, 0 otherwise */
+static int aff_on_curve(p256_aff_p p);
+
+/* RETURN
+ * 0 -> p is the point encoded by src (uncompressed, on the curve);
+ * 1 -> src is not a valid public key.
+ */
+static int aff_frombytes(p256_aff_p p, const byte* src);
+static void aff_tobytes(byte* dst, p256_aff_p p);
+
+/* e[0...P256_DIGITS) <- signed 4-bit digits of the big-endian 32-byte k:
+ * k = sum e[i] * 16^i, -8 <= e[i] <= 8 */
+static void p256_recode(signed char* e, const byte* k);
+
+/* r <- k * G, in constant time (k big-endian, 32 bytes) */
+static void p256_base_mul(p256_jac_p r, const byte* k);
+
+/* r <- r + b * 256^pos * G, -8 <= b <= 8, in constant time */
+static void p256_base_madd(p256_jac_p r, int pos, int b);
+
+/* r <- k * p, in constant time */
+static void p256_mul(p256_jac_p r, const byte* k, p256_aff_p p);
+
+/* r <- u1 * G + u2 * q, in variable time */
+static void p256_mul2_vartime(
+    p256_jac_p r, const byte* u1, const byte* u2, p256_aff_p q
+);
+
+/* naf[0...257) <- width-w NAF of the big-endian 32-byte k */
+static void p256_wnaf(signed char* naf, const byte* k, int w);
+
+/* Scalars modulo n:
+ * - sc_import: N <- k, 32 bytes big-endian;
+ * - sc_export: dst <- N, 32 bytes big-endian (N < 2^256);
+ * - sc_hash: N <- leftmost 256 bits of hash[0...len), mod n;
+ * - sc_valid: 1 if 1 <= N < n, 0 otherwise;
+ * - sc_sign: s <- k^-1 (e + r d) mod n, all four less than n. It is computed
+ *   as (k b)^-1 (b e + b r d) for a random b: the products with the secrets
+ *   are Montgomery multiplications and the inversion is the constant-time
+ *   exponentiation, and the only variable-time step, the sum, sees blinded
+ *   values. The result does not depend on b.
+ */
+static void sc_import(bigint_p N, const byte* k);
+static void sc_export(byte* dst, bigint_p N);
+static void sc_hash(bigint_p N, const byte* hash, size_t len);
+static int  sc_valid(bigint_p N);
+static void sc_sign(bigint_p s, bigint_p r, bigint_p k, bigint_p d, bigint_p e);
+
+/* --- IMPL */
+
+int p256_public(byte* pub, const byte* priv)
+{
+    struct p256_jac_t R;
+    struct p256_aff_t A;
+    struct bigint_t   D;
+
+    pthread_once(&p256_once, p256_init);
+
+    sc_import(&D, priv);
+    if (!sc_valid(&D))
+        return 1;
+
+    p256_base_mul(&R, priv);
+    jac_to_aff(&A, &R);
+    aff_tobytes(pub, &A);
+
+    memset(&D, 0, sizeof(D));
+
+    return 0;
+}
+
+void p256_keypair(byte* pub, byte* priv)
+{
+    do
+        random_get_buffer((char*)priv, P256_SIZE);
+    while (p256_public(pub, priv) != 0);
+}
+
+int p256_check_public(const byte* pub)
+{
+    struct p256_aff_t A;
+
+    pthread_once(&p256_once, p256_init);
+
+    return aff_frombytes(&A, pub);
+}
+
+int p256_ecdh(byte* dst, const byte* priv, const byte* peer)
+{
+    struct p256_jac_t R;
+    struct p256_aff_t A;
+    struct bigint_t   D;
+
+    pthread_once(&p256_once, p256_init);
+
+    sc_import(&D, priv);
+    if (!sc_valid(&D) || aff_frombytes(&A, peer))
+        return 1;
+
+    /* n is prime: the product of a point of the curve is never at infinity */
+    p256_mul(&R, priv, &A);
+    jac_to_aff(&A, &R);
+    fp_tobytes(dst, A.x);
+
+    memset(&D, 0, sizeof(D));
+
+    return 0;
+}
+
+int p256_ecdsa_sign(byte* sig, const byte* hash, size_t len, const byte* priv)
+{
+    struct hmac_sha256_key_t K;
+    struct hmac_sha256_key_t M; /* Message in progress */
+    struct p256_jac_t        R;
+    struct p256_aff_t        A;
+    struct bigint_t          D;
+    struct bigint_t          E;
+    struct bigint_t          k;
+    struct bigint_t          r;
+    struct bigint_t          s;
+    byte                     key[SHA256_DIGEST_SIZE];
+    byte                     V[SHA256_DIGEST_SIZE];
+    byte                     x[P256_SIZE];
+    byte                     h[P256_SIZE];
+    byte                     b;
+    int                      i;
+
+    pthread_once(&p256_once, p256_init);
+
+    sc_import(&D, priv);
+    if (!sc_valid(&D))
+        return 1;
+
+    sc_hash(&E, hash, len);
+    sc_export(h, &E);
+
+    /* RFC 6979, section 3.2: K and V seeded with the key and the hash */
+    memset(key, 0x00, sizeof(key));
+    memset(V, 0x01, sizeof(V));
+    for (i = 0; i < 2; ++i)
+    {
+        b = (byte)i;
+        hmac_sha256_key(&K, key, sizeof(key));
+        hmac_sha256_init(&M, &K);
+        hmac_sha256_update(&M, V, sizeof(V));
+        hmac_sha256_update(&M, &b, 1);
+        hmac_sha256_update(&M, priv, P256_SIZE);
+        hmac_sha256_update(&M, h, P256_SIZE);
+        hmac_sha256_final(&M, key);
+
+        hmac_sha256_key(&K, key, sizeof(key));
+        hmac_sha256(V, &K, V, sizeof(V));
+    }
+
+    for (;;)
+    {
+        hmac_sha256(V, &K, V, sizeof(V));
+        sc_import(&k, V);
+
+        if (sc_valid(&k))
+        {
+            /* r = x(k * G) mod n, s = k^-1 (e + r d) mod n */
+            p256_base_mul(&R, V);
+            jac_to_aff(&A, &R);
+            fp_tobytes(x, A.x);
+            sc_import(&r, x);
+            bigint_mont_mod(&r, &r, &P256.n);
+
+            sc_sign(&s, &r, &k, &D, &E);
+
+            if (!bigint_iszero(&r) && !bigint_iszero(&s))
+                break;
+        }
+
+        /* Next candidate: K = HMAC_K(V || 0x00), V = HMAC_K(V) */
+        b = 0;
+        hmac_sha256_init(&M, &K);
+        hmac_sha256_update(&M, V, sizeof(V));
+        hmac_sha256_update(&M, &b, 1);
+        hmac_sha256_final(&M, key);
+
+        hmac_sha256_key(&K, key, sizeof(key));
+        hmac_sha256(V, &K, V, sizeof(V));
+    }
+
+    sc_export(sig, &r);
+    sc_export(&sig[P256_SIZE], &s);
+
+    memset(&K, 0, sizeof(K));
+    memset(&M, 0, sizeof(M));
+    memset(&D, 0, sizeof(D));
+    memset(&k, 0, sizeof(k));
+    memset(key, 0, sizeof(key));
+    memset(V, 0, sizeof(V));
+
+    return 0;
+}
+
+int p256_ecdsa_verify(
+    const byte* sig, const byte* hash, size_t len, const byte* pub
+)
+{
+    struct p256_jac_t R;
+    struct p256_aff_t Q;
+    struct bigint_t   E;
+    struct bigint_t   r;
+    struct bigint_t   s;
+    struct bigint_t   x;
+    byte              u1[P256_SIZE];
+    byte              u2[P256_SIZE];
+    byte              b[P256_SIZE];
+
+    pthread_once(&p256_once, p256_init);
+
+    sc_import(&r, sig);
+    sc_import(&s, &sig[P256_SIZE]);
+    if (!sc_valid(&r) || !sc_valid(&s) || aff_frombytes(&Q, pub))
+        return 1;
+
+    /* u1 = e / s, u2 = r / s mod n; s is public, no need of constant time */
+    sc_hash(&E, hash, len);
+    bigint_mont_exp(&s, &s, &P256.n2, &P256.n);
+
+    bigint_mul(&x, &E, &s);
+    bigint_mont_mod(&x, &x, &P256.n);
+    sc_export(u1, &x);
+
+    bigint_mul(&x, &r, &s);
+    bigint_mont_mod(&x, &x, &P256.n);
+    sc_export(u2, &x);
+
+    p256_mul2_vartime(&R, u1, u2, &Q);
+    if (fp_iszero(R.Z))
+        return 1;
+
+    /* x(R) mod n must be r */
+    jac_to_aff(&Q, &R);
+    fp_tobytes(b, Q.x);
+    sc_import(&x, b);
+    bigint_mont_mod(&x, &x, &P256.n);
+
+    return bigint_cmp(&x, &r) != 0;
+}
+
+static void p256_init(void)
+{
+    struct p256_jac_t P;
+    struct p256_jac_t Q;
+    struct p256_jac_t G2;
+    struct p256_aff_t G;
+    struct bigint_t   N;
+    int               i;
+    int               k;
+
+    bigint_import_bytes(&N, P256_N, (int)sizeof(P256_N));
+    if (!bigint_mont_init(&P256.n, &N))
+        EXIT(FATAL_LOGIC, "p256_init", "invalid group order");
+    bigint_sub_int(&P256.n2, &N, 2);
+
+    memcpy(G.x, P256_GX, sizeof(fp_t));
+    memcpy(G.y, P256_GY, sizeof(fp_t));
+    if (!aff_on_curve(&G))
+        EXIT(FATAL_LOGIC, "p256_init", "invalid generator");
+
+    /* base[i][k] = (k + 1) * 256^i * G: P runs through 256^i * G */
+    jac_from_aff(&P, &G);
+    for (i = 0; i < P256_DIGITS / 2 + 1; ++i)
+    {
+        Q = P;
+        for (k = 0; k < 8; ++k)
+        {
+            jac_to_aff(&P256.base[i][k], &Q);
+            jac_add(&Q, &Q, &P);
+        }
+
+        for (k = 0; k < 8; ++k)
+            jac_dbl(&P, &P);
+    }
+
+    /* odd[k] = (2k + 1) * G */
+    jac_from_aff(&P, &G);
+    jac_dbl(&G2, &P);
+    for (k = 0; k < P256_BASE_ODD; ++k)
+    {
+        jac_to_aff(&P256.odd[k], &P);
+        jac_add(&P, &P, &G2);
+    }
+}
+
+static void fp_add(fp_t h, const fp_t f, const fp_t g)
+{
+    uint32_t t[P256_LIMBS];
+    uint64_t c = 0;
+    int      i;
+
+    for (i = 0; i < P256_LIMBS; ++i)
+    {
+        c += (uint64_t)f[i] + g[i];
+        t[i] = (uint32_t)c;
+        c >>= 32;
+    }
+
+    fp_reduce_once(h, t, (uint32_t)c);
+}
+
+static void fp_sub(fp_t h, const fp_t f, const fp_t g)
+{
+    uint32_t t[P256_LIMBS];
+    uint32_t mask;
+    uint64_t c = 0;
+    int      i;
+
+    /* f - g, then + p if it borrowed */
+    for (i = 0; i < P256_LIMBS; ++i)
+    {
+        c    = (uint64_t)f[i] - g[i] - c;
+        t[i] = (uint32_t)c;
+        c    = c >> 63;
+    }
+
+    mask = 0 - (uint32_t)c;
+    c    = 0;
+    for (i = 0; i < P256_LIMBS; ++i)
+    {
+        c += (uint64_t)t[i] + (P256_P[i] & mask);
+        h[i] = (uint32_t)c;
+        c >>= 32;
+    }
+}
+
+static void fp_mul(fp_t h, const fp_t f, const fp_t g)
+{
+    uint32_t t[2 * P256_LIMBS];
+    uint64_t c;
+    int      i;
+    int      j;
+
+    memset(t, 0, sizeof(t));
+    for (i = 0; i < P256_LIMBS; ++i)
+    {
+        c = 0;
+        for (j = 0; j < P256_LIMBS; ++j)
+        {
+            c += (uint64_t)f[i] * g[j] + t[i + j];
+            t[i + j] = (uint32_t)c;
+            c >>= 32;
+        }
+        t[i + P256_LIMBS] = (uint32_t)c;
+    }
+
+    fp_reduce(h, t);
+}
+
+static void fp_sqr(fp_t h, const fp_t f)
+{
+    fp_mul(h, f, f);
+}
+
+static void fp_inv(fp_t h, const fp_t f)
+{
+    fp_t r;
+    int  i;
+
+    /* f^(p - 2), left to right: the exponent is public */
+    memcpy(r, f, sizeof(fp_t));
+    for (i = 254; i >= 0; --i)
+    {
+        fp_sqr(r, r);
+        if (P256_P2[i / 32] >> (i % 32) & 1)
+            fp_mul(r, r, f);
+    }
+
+    memcpy(h, r, sizeof(fp_t));
+}
+
+static void fp_neg(fp_t h, const fp_t f)
+{
+    fp_t zero;
+
+    memset(zero, 0, sizeof(fp_t));
+    fp_sub(h, zero, f);
+}
+
+static void fp_reduce(fp_t h, const uint32_t* t)
+{
+    int64_t  w[P256_LIMBS];
+    int64_t  carry;
+    uint32_t r[P256_LIMBS];
+    int      k;
+    int      i;
+
+    /* FIPS 186-4, D.2.3: t = s1 + 2 s2 + 2 s3 + s4 + s5 - s6 - s7 - s8 - s9
+     * mod p, the s being words of t; word by word: */
+    w[0] = (int64_t)t[0] + t[8] + t[9] - t[11] - t[12] - t[13] - t[14];
+    w[1] = (int64_t)t[1] + t[9] + t[10] - t[12] - t[13] - t[14] - t[15];
+    w[2] = (int64_t)t[2] + t[10] + t[11] - t[13] - t[14] - t[15];
+    w[3] = (int64_t)t[3] + 2 * (int64_t)t[11] + 2 * (int64_t)t[12] + t[13] -
+           t[15] - t[8] - t[9];
+    w[4] = (int64_t)t[4] + 2 * (int64_t)t[12] + 2 * (int64_t)t[13] + t[14] -
+           t[9] - t[10];
+    w[5] = (int64_t)t[5] + 2 * (int64_t)t[13] + 2 * (int64_t)t[14] + t[15] -
+           t[10] - t[11];
+    w[6] = (int64_t)t[6] + 3 * (int64_t)t[14] + 2 * (int64_t)t[15] + t[13] -
+           t[8] - t[9];
+    w[7] = (int64_t)t[7] + 3 * (int64_t)t[15] + t[8] - t[10] - t[11] - t[12] -
+           t[13];
+
+    /* The carry out of 2^256 is folded back twice, 2^256 being
+     * 2^224 - 2^192 - 2^96 + 1 mod p: the first fold leaves a carry of -1, 0
+     * or 1, the second none */
+    for (k = 0; k < 2; ++k)
+    {
+        carry = 0;
+        for (i = 0; i < P256_LIMBS; ++i)
+        {
+            w[i] += carry;
+            r[i]  = (uint32_t)w[i];
+            carry = w[i] >> 32;
+        }
+
+        for (i = 0; i < P256_LIMBS; ++i)
+            w[i] = r[i];
+        w[0] += carry;
+        w[3] -= carry;
+        w[6] -= carry;
+        w[7] += carry;
+    }
+
+    for (i = 0; i < P256_LIMBS; ++i)
+        r[i] = (uint32_t)w[i];
+
+    fp_reduce_once(h, r, 0);
+}
+
+static void fp_reduce_once(fp_t h, const uint32_t* t, uint32_t carry)
+{
+    uint32_t u[P256_LIMBS];
+    uint32_t mask;
+    uint64_t c = 0;
+    int      i;
+
+    for (i = 0; i < P256_LIMBS; ++i)
+    {
+        c    = (uint64_t)t[i] - P256_P[i] - c;
+        u[i] = (uint32_t)c;
+        c    = c >> 63;
+    }
+
+    /* t - p is kept if there was a carry, or if it did not borrow */
+    mask = 0 - (carry | ((uint32_t)c ^ 1));
+    for (i = 0; i < P256_LIMBS; ++i)
+        h[i] = (u[i] & mask) | (t[i] & ~mask);
+}
+
+static void fp_cmov(fp_t f, const fp_t g, uint32_t mask)
+{
+    int i;
+
+    for (i = 0; i < P256_LIMBS; ++i)
+        f[i] ^= mask & (f[i] ^ g[i]);
+}
+
+static int fp_iszero(const fp_t f)
+{
+    uint32_t acc = 0;
+    int      i;
+
+    for (i = 0; i < P256_LIMBS; ++i)
+        acc |= f[i];
+
+    return acc == 0;
+}
+
+static int fp_frombytes(fp_t h, const byte* src)
+{
+    uint64_t c = 0;
+    int      i;
+
+    for (i = 0; i < P256_LIMBS; ++i)
+    {
+        h[i] = (uint32_t)src[31 - 4 * i] |
+               (uint32_t)src[30 - 4 * i] << 8 |
+               (uint32_t)src[29 - 4 * i] << 16 |
+               (uint32_t)src[28 - 4 * i] << 24;
+    }
+
+    /* h - p must borrow */
+    for (i = 0; i < P256_LIMBS; ++i)
+        c = ((uint64_t)h[i] - P256_P[i] - c) >> 63;
+
+    return c == 0;
+}
+
+static void fp_tobytes(byte* dst, const fp_t h)
+{
+    int i;
+
+    for (i = 0; i < P256_LIMBS; ++i)
+    {
+        dst[31 - 4 * i] = (byte)h[i];
+        dst[30 - 4 * i] = (byte)(h[i] >> 8);
+        dst[29 - 4 * i] = (byte)(h[i] >> 16);
+        dst[28 - 4 * i] = (byte)(h[i] >> 24);
+    }
+}
+
+static void jac_dbl(p256_jac_p r, p256_jac_p p)
+{
+    fp_t delta;
+    fp_t gamma;
+    fp_t beta;
+    fp_t alpha;
+    fp_t t;
+
+    /* dbl-2001-b, for a = -3 */
+    fp_sqr(delta, p->Z);
+    fp_sqr(gamma, p->Y);
+    fp_mul(beta, p->X, gamma);
+
+    /* alpha = 3 (X - delta) (X + delta) */
+    fp_sub(t, p->X, delta);
+    fp_add(alpha, p->X, delta);
+    fp_mul(alpha, alpha, t);
+    fp_add(t, alpha, alpha);
+    fp_add(alpha, alpha, t);
+
+    /* Z3 = (Y + Z)^2 - gamma - delta */
+    fp_add(t, p->Y, p->Z);
+    fp_sqr(t, t);
+    fp_sub(t, t, gamma);
+    fp_sub(r->Z, t, delta);
+
+    /* X3 = alpha^2 - 8 beta */
+    fp_add(beta, beta, beta);
+    fp_add(beta, beta, beta); /* 4 beta */
+    fp_add(t, beta, beta);
+    fp_sqr(r->X, alpha);
+    fp_sub(r->X, r->X, t);
+
+    /* Y3 = alpha (4 beta - X3) - 8 gamma^2 */
+    fp_sqr(gamma, gamma);
+    fp_add(gamma, gamma, gamma);
+    fp_add(gamma, gamma, gamma);
+    fp_add(gamma, gamma, gamma);
+    fp_sub(t, beta, r->X);
+    fp_mul(t, alpha, t);
+    fp_sub(r->Y, t, gamma);
+}
+
+static void jac_add(p256_jac_p r, p256_jac_p p, p256_jac_p q)
+{
+    struct p256_jac_t s;
+    fp_t              z1z1;
+    fp_t              z2z2;
+    fp_t              u1;
+    fp_t              s1;
+    fp_t              h;
+    fp_t              i;
+    fp_t              j;
+    fp_t              rr;
+    fp_t              v;
+    uint32_t          p_inf = 0 - (uint32_t)fp_iszero(p->Z);
+    uint32_t          q_inf = 0 - (uint32_t)fp_iszero(q->Z);
+
+    /* add-2007-bl */
+    fp_sqr(z1z1, p->Z);
+    fp_sqr(z2z2, q->Z);
+    fp_mul(u1, p->X, z2z2);
+    fp_mul(h, q->X, z1z1);
+    fp_sub(h, h, u1); /* U2 - U1 */
+
+    fp_mul(s1, p->Y, q->Z);
+    fp_mul(s1, s1, z2z2);
+    fp_mul(rr, q->Y, p->Z);
+    fp_mul(rr, rr, z1z1);
+    fp_sub(rr, rr, s1);
+    fp_add(rr, rr, rr); /* 2 (S2 - S1) */
+
+    if (fp_iszero(h) && fp_iszero(rr) && !p_inf && !q_inf)
+    {
+        jac_dbl(r, p);
+        return;
+    }
+
+    fp_add(i, h, h);
+    fp_sqr(i, i);
+    fp_mul(j, h, i);
+    fp_mul(v, u1, i);
+
+    /* X3 = rr^2 - J - 2V */
+    fp_sqr(s.X, rr);
+    fp_sub(s.X, s.X, j);
+    fp_sub(s.X, s.X, v);
+    fp_sub(s.X, s.X, v);
+
+    /* Y3 = rr (V - X3) - 2 S1 J */
+    fp_sub(v, v, s.X);
+    fp_mul(v, rr, v);
+    fp_mul(s1, s1, j);
+    fp_add(s1, s1, s1);
+    fp_sub(s.Y, v, s1);
+
+    /* Z3 = ((Z1 + Z2)^2 - Z1Z1 - Z2Z2) H */
+    fp_add(s.Z, p->Z, q->Z);
+    fp_sqr(s.Z, s.Z);
+    fp_sub(s.Z, s.Z, z1z1);
+    fp_sub(s.Z, s.Z, z2z2);
+    fp_mul(s.Z, s.Z, h);
+
+    fp_cmov(s.X, q->X, p_inf);
+    fp_cmov(s.Y, q->Y, p_inf);
+    fp_cmov(s.Z, q->Z, p_inf);
+    fp_cmov(s.X, p->X, q_inf);
+    fp_cmov(s.Y, p->Y, q_inf);
+    fp_cmov(s.Z, p->Z, q_inf);
+
+    *r = s;
+}
+
+static void jac_madd(p256_jac_p r, p256_jac_p p, p256_aff_p q)
+{
+    struct p256_jac_t s;
+    fp_t              z1z1;
+    fp_t              h;
+    fp_t              hh;
+    fp_t              i;
+    fp_t              j;
+    fp_t              rr;
+    fp_t              v;
+    uint32_t          p_inf = 0 - (uint32_t)fp_iszero(p->Z);
+
+    /* madd-2007-bl */
+    fp_sqr(z1z1, p->Z);
+    fp_mul(h, q->x, z1z1);
+    fp_sub(h, h, p->X); /* U2 - X1 */
+
+    fp_mul(rr, q->y, p->Z);
+    fp_mul(rr, rr, z1z1);
+    fp_sub(rr, rr, p->Y);
+    fp_add(rr, rr, rr); /* 2 (S2 - Y1) */
+
+    if (fp_iszero(h) && fp_iszero(rr) && !p_inf)
+    {
+        jac_dbl(r, p);
+        return;
+    }
+
+    fp_sqr(hh, h);
+    fp_add(i, hh, hh);
+    fp_add(i, i, i);
+    fp_mul(j, h, i);
+    fp_mul(v, p->X, i);
+
+    /* X3 = rr^2 - J - 2V */
+    fp_sqr(s.X, rr);
+    fp_sub(s.X, s.X, j);
+    fp_sub(s.X, s.X, v);
+    fp_sub(s.X, s.X, v);
+
+    /* Y3 = rr (V - X3) - 2 Y1 J */
+    fp_sub(v, v, s.X);
+    fp_mul(v, rr, v);
+    fp_mul(j, p->Y, j);
+    fp_add(j, j, j);
+    fp_sub(s.Y, v, j);
+
+    /* Z3 = (Z1 + H)^2 - Z1Z1 - HH */
+    fp_add(s.Z, p->Z, h);
+    fp_sqr(s.Z, s.Z);
+    fp_sub(s.Z, s.Z, z1z1);
+    fp_sub(s.Z, s.Z, hh);
+
+    /* Infinity + q = q */
+    jac_from_aff(r, q);
+    fp_cmov(r->X, s.X, ~p_inf);
+    fp_cmov(r->Y, s.Y, ~p_inf);
+    fp_cmov(r->Z, s.Z, ~p_inf);
+}
+
+static void jac_to_aff(p256_aff_p r, p256_jac_p p)
+{
+    fp_t zi;
+    fp_t zi2;
+
+    fp_inv(zi, p->Z);
+    fp_sqr(zi2, zi);
+    fp_mul(r->x, p->X, zi2);
+    fp_mul(zi2, zi2, zi);
+    fp_mul(r->y, p->Y, zi2);
+}
+
+static void jac_from_aff(p256_jac_p r, p256_aff_p p)
+{
+    memcpy(r->X, p->x, sizeof(fp_t));
+    memcpy(r->Y, p->y, sizeof(fp_t));
+    memset(r->Z, 0, sizeof(fp_t));
+    r->Z[0] = 1;
+}
+
+static void jac_infinity(p256_jac_p r)
+{
+    memset(r, 0, sizeof(struct p256_jac_t));
+    r->X[0] = 1;
+    r->Y[0] = 1;
+}
+
+static int aff_on_curve(p256_aff_p p)
+{
+    fp_t l;
+    fp_t r;
+    fp_t t;
+
+    /* y^2 = x^3 - 3x + b */
+    fp_sqr(l, p->y);
+    fp_sqr(r, p->x);
+    fp_mul(r, r, p->x);
+    fp_add(t, p->x, p->x);
+    fp_add(t, t, p->x);
+    fp_sub(r, r, t);
+    fp_add(r, r, P256_B);
+
+    fp_sub(t, l, r);
+
+    return fp_iszero(t);
+}
+
+static int aff_frombytes(p256_aff_p p, const byte* src)
+{
+    if (src[0] != 0x04)
+        return 1;
+
+    if (fp_frombytes(p->x, &src[1]) || fp_frombytes(p->y, &src[1 + P256_SIZE]))
+        return 1;
+
+    return !aff_on_curve(p);
+}
+
+static void aff_tobytes(byte* dst, p256_aff_p p)
+{
+    dst[0] = 0x04;
+    fp_tobytes(&dst[1], p->x);
+    fp_tobytes(&dst[1 + P256_SIZE], p->y);
+}
+
+static void p256_recode(signed char* e, const byte* k)
+{
+    int carry = 0;
+    int i;
+
+    for (i = 0; i < 32; ++i)
+    {
+        e[2 * i]     = (signed char)(k[31 - i] & 15);
+        e[2 * i + 1] = (signed char)(k[31 - i] >> 4);
+    }
+
+    for (i = 0; i < P256_DIGITS - 1; ++i)
+    {
+        e[i]  = (signed char)(e[i] + carry);
+        carry = (e[i] + 8) >> 4;
+        e[i]  = (signed char)(e[i] - carry * 16);
+    }
+    e[P256_DIGITS - 1] = (signed char)carry;
+}
+
+static void p256_base_mul(p256_jac_p r, const byte* k)
+{
+    signed char e[P256_DIGITS];
+    int         i;
+
+    p256_recode(e, k);
+    jac_infinity(r);
+
+    /* Odd digits first, then multiplied by 16, then the even ones: 256^i is
+     * all the table holds */
+    for (i = 1; i < P256_DIGITS; i += 2)
+        p256_base_madd(r, i / 2, e[i]);
+
+    for (i = 0; i < 4; ++i)
+        jac_dbl(r, r);
+
+    for (i = 0; i < P256_DIGITS; i += 2)
+        p256_base_madd(r, i / 2, e[i]);
+
+    memset(e, 0, sizeof(e));
+}
+
+static void p256_base_madd(p256_jac_p r, int pos, int b)
+{
+    struct p256_aff_t t;
+    struct p256_jac_t s;
+    uint32_t          negative = (uint32_t)((unsigned int)b >> 31 & 1);
+    uint32_t          babs;
+    uint32_t          mask;
+    fp_t              minus;
+    int               k;
+
+    /* |b|, without branches: b - 2b if b is negative */
+    babs = (uint32_t)b - (((0 - negative) & (uint32_t)b) << 1);
+
+    t = P256.base[pos][0];
+    for (k = 2; k <= 8; ++k)
+    {
+        /* x - 1 borrows only if babs is k */
+        mask = 0 - (((babs ^ (uint32_t)k) - 1) >> 31);
+        fp_cmov(t.x, P256.base[pos][k - 1].x, mask);
+        fp_cmov(t.y, P256.base[pos][k - 1].y, mask);
+    }
+
+    /* -(x, y) = (x, -y) */
+    fp_neg(minus, t.y);
+    fp_cmov(t.y, minus, 0 - negative);
+
+    /* The sum is dropped if b is 0 */
+    jac_madd(&s, r, &t);
+    mask = 0 - ((babs - 1) >> 31);
+    fp_cmov(s.X, r->X, mask);
+    fp_cmov(s.Y, r->Y, mask);
+    fp_cmov(s.Z, r->Z, mask);
+    *r = s;
+}
+
+static void p256_mul(p256_jac_p r, const byte* k, p256_aff_p p)
+{
+    struct p256_jac_t T[8]; /* (j + 1) * p */
+    struct p256_jac_t t;
+    struct p256_jac_t s;
+    signed char       e[P256_DIGITS];
+    uint32_t          negative;
+    uint32_t          babs;
+    uint32_t          mask;
+    fp_t              minus;
+    int               b;
+    int               i;
+    int               j;
+
+    jac_from_aff(&T[0], p);
+    jac_dbl(&T[1], &T[0]);
+    for (j = 2; j < 8; ++j)
+        jac_add(&T[j], &T[j - 1], &T[0]);
+
+    p256_recode(e, k);
+    jac_infinity(r);
+
+    for (i = P256_DIGITS - 1; i >= 0; --i)
+    {
+        for (j = 0; j < 4; ++j)
+            jac_dbl(r, r);
+
+        b        = e[i];
+        negative = (uint32_t)((unsigned int)b >> 31 & 1);
+        babs     = (uint32_t)b - (((0 - negative) & (uint32_t)b) << 1);
+
+        t = T[0];
+        for (j = 2; j <= 8; ++j)
+        {
+            mask = 0 - (((babs ^ (uint32_t)j) - 1) >> 31);
+            fp_cmov(t.X, T[j - 1].X, mask);
+            fp_cmov(t.Y, T[j - 1].Y, mask);
+            fp_cmov(t.Z, T[j - 1].Z, mask);
+        }
+
+        fp_neg(minus, t.Y);
+        fp_cmov(t.Y, minus, 0 - negative);
+
+        jac_add(&s, r, &t);
+        mask = 0 - ((babs - 1) >> 31); /* babs == 0 */
+        fp_cmov(s.X, r->X, mask);
+        fp_cmov(s.Y, r->Y, mask);
+        fp_cmov(s.Z, r->Z, mask);
+        *r = s;
+    }
+
+    memset(e, 0, sizeof(e));
+}
+
+static void p256_mul2_vartime(
+    p256_jac_p r, const byte* u1, const byte* u2, p256_aff_p q
+)
+{
+    struct p256_jac_t odd[P256_ODD]; /* (2k + 1) * q */
+    struct p256_jac_t q2;
+    struct p256_jac_t t;
+    struct p256_aff_t a;
+    signed char       naf1[257];
+    signed char       naf2[257];
+    int               i;
+
+    p256_wnaf(naf1, u1, P256_BASE_WINDOW);
+    p256_wnaf(naf2, u2, P256_WINDOW);
+
+    jac_from_aff(&odd[0], q);
+    jac_dbl(&q2, &odd[0]);
+    for (i = 1; i < P256_ODD; ++i)
+        jac_add(&odd[i], &odd[i - 1], &q2);
+
+    for (i = 256; i >= 0 && naf1[i] == 0 && naf2[i] == 0; --i)
+        ;
+
+    jac_infinity(r);
+    for (; i >= 0; --i)
+    {
+        jac_dbl(r, r);
+
+        if (naf1[i] > 0)
+            jac_madd(r, r, &P256.odd[naf1[i] / 2]);
+        else if (naf1[i] < 0)
+        {
+            a = P256.odd[-naf1[i] / 2];
+            fp_neg(a.y, a.y);
+            jac_madd(r, r, &a);
+        }
+
+        if (naf2[i] > 0)
+            jac_add(r, r, &odd[naf2[i] / 2]);
+        else if (naf2[i] < 0)
+        {
+            t = odd[-naf2[i] / 2];
+            fp_neg(t.Y, t.Y);
+            jac_add(r, r, &t);
+        }
+    }
+}
+
+static void p256_wnaf(signed char* naf, const byte* k, int w)
+{
+    uint32_t n[P256_LIMBS + 1];
+    uint32_t c;
+    int      d;
+    int      i;
+    int      j;
+
+    memset(n, 0, sizeof(n));
+    for (i = 0; i < 32; ++i)
+        n[i / 4] |= (uint32_t)k[31 - i] << (8 * (i % 4));
+
+    /* Odd n: digit n mod 2^w, in (-2^(w - 1), 2^(w - 1)), subtracted so that
+     * the next w - 1 digits are zeros */
+    for (i = 0; i < 257; ++i)
+    {
+        d = 0;
+        if (n[0] & 1)
+        {
+            d = (int)(n[0] & ((1u << w) - 1));
+            if (d >= 1 << (w - 1))
+                d -= 1 << w;
+
+            if (d > 0)
+            {
+                n[0] -= (uint32_t)d;
+            }
+            else
+            {
+                /* n + |d|, carry propagated */
+                c = (uint32_t)-d;
+                for (j = 0; j <= P256_LIMBS && c; ++j)
+                {
+                    n[j] += c;
+                    c = n[j] < c;
+                }
+            }
+        }
+        naf[i] = (signed char)d;
+
+        for (j = 0; j < P256_LIMBS; ++j)
+            n[j] = n[j] >> 1 | n[j + 1] << 31;
+        n[P256_LIMBS] >>= 1;
+    }
+}
+
+static void sc_import(bigint_p N, const byte* k)
+{
+    bigint_import_bytes(N, k, P256_SIZE);
+}
+
+static void sc_export(byte* dst, bigint_p N)
+{
+    int i;
+
+    for (i = 0; i < P256_SIZE; ++i)
+        dst[P256_SIZE - 1 - i] = N->num[i];
+}
+
+static void sc_hash(bigint_p N, const byte* hash, size_t len)
+{
+    /* Leftmost bits, less than 2^256 < 2n */
+    bigint_import_bytes(N, hash, len < P256_SIZE ? (int)len : P256_SIZE);
+    bigint_mont_mod(N, N, &P256.n);
+}
+
+static int sc_valid(bigint_p N)
+{
+    return !bigint_iszero(N) && bigint_cmp(N, &P256.n.M) < 0;
+}
+
+static void sc_sign(bigint_p s, bigint_p r, bigint_p k, bigint_p d, bigint_p e)
+{
+    struct bigint_t b; /* Blinding factor, then b * R */
+    struct bigint_t t;
+    struct bigint_t u;
+
+    /* 1 <= b < 2^248 < n */
+    do
+        bigint_init_rand(&b, P256_SIZE - 1);
+    while (bigint_iszero(&b));
+    bigint_mont_to(&b, &b, &P256.n);
+
+    /* t <- b e + b r d */
+    bigint_mont_mul(&t, d, &b, &P256.n);
+    bigint_mont_to(&u, r, &P256.n);
+    bigint_mont_mul(&t, &t, &u, &P256.n);
+    bigint_mont_mul(&u, e, &b, &P256.n);
+    bigint_sum(&t, &t, &u);
+    bigint_mont_mod(&t, &t, &P256.n);
+
+    /* u <- (k b)^-1 = (k b)^(n - 2) */
+    bigint_mont_mul(&u, k, &b, &P256.n);
+    bigint_mont_exp_ct(&u, &u, &P256.n2, 256, &P256.n);
+
+    /* s <- t (k b)^-1 */
+    bigint_mont_to(&u, &u, &P256.n);
+    bigint_mont_mul(s, &t, &u, &P256.n);
+
+    memset(&b, 0, sizeof(b));
+    memset(&t, 0, sizeof(t));
+    memset(&u, 0, sizeof(u));
+}
@@ -0,0 +1,80 @@
+#ifndef CMC_CRYPTO_P256_INCLUDED
+#define CMC_CRYPTO_P256_INCLUDED
+
+#include <stddef.h>
+
+#include "types.h"
+
+#define P256_SIZE 32            /* Private keys, coordinates, ECDH secrets */
+#define P256_PUBLIC_SIZE 65     /* 0x04 || x || y (SEC 1, uncompressed) */
+#define P256_SIGNATURE_SIZE 64  /* r || s */
+
+/* NIST P-256 (FIPS 186-4, secp256r1): y^2 = x^3 - 3x + b over GF(p),
+ * p = 2^256 - 2^224 + 2^192 + 2^96 - 1. All numbers are big-endian, as SEC 1
+ * and the X9.62 signatures are.
+ *
+ * Field elements are 8 words of 32 bits, and products are reduced with the
+ * special form of p (FIPS 186-4, D.2.3: a few additions and subtractions of
+ * the high words), not with bigint_mod. Points are in Jacobian coordinates
+ * (X : Y : Z), x = X / Z^2, y = Y / Z^3, with the a = -3 doubling.
+ *
+ * - Secret scalars (key pairs, signatures, ECDH) are multiplied in constant
+ *   time with signed 4-bit digits: the generator with a table of
+ *   k * 256^i * G (1 <= k <= 8) built on first use, no doublings but 4; any
+ *   other point with a table of its first 8 multiples, 4 doublings per digit.
+ *   Table entries are selected with masks.
+ * - Verification (public data only) uses wNAF, interleaving u1 * G, whose
+ *   odd multiples are precomputed, and u2 * Q.
+ *
+ * Scalars modulo the group order n go through the Montgomery interface of
+ * bigint.h; those of signatures, which involve the key and the nonce, are
+ * blinded by a random factor and multiplied and inverted in constant time. */
+
+/* pub <- public key of the private key priv (1 <= priv < n).
+ *
+ * RETURN
+ * 0 -> pub is the public key;
+ * 1 -> priv is out of range.
+ */
+extern int p256_public(byte* pub, const byte* priv);
+
+/* New key pair: priv is random in [1, n), pub = p256_public(priv) */
+extern void p256_keypair(byte* pub, byte* priv);
+
+/* RETURN
+ * 0 -> pub is a point of the curve (coordinates less than p);
+ * 1 -> it is not, or it is not an uncompressed encoding.
+ */
+extern int p256_check_public(const byte* pub);
+
+/* ECDH: dst <- x-coordinate of priv * peer (SEC 1, section 3.3.1), the peer
+ * public key being validated first. Like any raw Diffie-Hellman output, dst
+ * should go through a KDF before use.
+ *
+ * RETURN
+ * 0 -> dst is the shared secret;
+ * 1 -> priv is out of range, or peer is not a valid public key.
+ */
+extern int p256_ecdh(byte* dst, const byte* priv, const byte* peer);
+
+/* ECDSA: sig <- signature (r || s) of the hash hash[0...len) with the private
+ * key priv. The nonce is deterministic (RFC 6979, HMAC-SHA256): no random
+ * number is involved, and the same hash and key give the same signature.
+ * Hashes longer than 32 bytes are truncated to their leftmost 256 bits.
+ *
+ * RETURN
+ * 0 -> sig is the signature;
+ * 1 -> priv is out of range.
+ */
+extern int
+p256_ecdsa_sign(byte* sig, const byte* hash, size_t len, const byte* priv);
+
+/* RETURN
+ * 0 -> sig is a valid signature of hash[0...len) with the public key pub;
+ * 1 -> it is not, or pub is not a valid public key.
+ */
+extern int p256_ecdsa_verify(
+    const byte* sig, const byte* hash, size_t len, const byte* pub
+);
+
+#endif /* CMC_CRYPTO_P256_INCLUDED */
@@ -2,77 +2,295 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
+#include "drbg.h"
+
+/* getrandom(2) is in glibc since 2.25 (and in Linux since 3.17, hence the
+ * fallback to /dev/urandom at run time as well) */
+#ifndef RANDOM_GETRANDOM
+#if defined(__GLIBC__) &&                                                      \
+    (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 25))
+#define RANDOM_GETRANDOM 1
+#else
+#define RANDOM_GETRANDOM 0
+#endif
+#endif
+
+#if RANDOM_GETRANDOM
+#include <sys/random.h>
+#endif
+
 /**
- * THREAD UNSAFE
+ * Bytes come from getrandom(2) or, if the kernel does not have it, from a
+ * descriptor of /dev/urandom shared by all threads (random_fd, -1 when
+ * getrandom is used). Neither needs a lock.
+ *
+ * Each thread draws small requests from its own buffer, refilled
+ * independently: callers never wait for each other. Bytes are wiped from the
+ * buffer as they are handed out. Requests of RANDOM_DIRECT_MIN bytes or more
+ * are read straight into the caller's buffer, without copies.
+ *
+ * With RANDOM_SOURCE_CTR_DRBG, buffers and large requests are filled by the
+ * thread's CTR_DRBG instead, seeded with DRBG_SEED_SIZE bytes of the kernel
+ * on first use.
+ *
+ * A fork copies the buffer of the forking thread into the child, that would
+ * hand out the same bytes as the parent: each fork bumps random_generation in
+ * the child, and a buffer loaded in an older generation is discarded.
  */
 
-int  fd = -1;
-int  cur;
-char random_buffer[RANDOM_BUFFER_SIZE];
+typedef struct random_state_t
+{
+    char          buffer[RANDOM_BUFFER_SIZE];
+    int           cur;        /* Next byte to hand out */
+    unsigned long generation; /* random_generation when buffer was loaded */
+    struct drbg_t drbg;
+    int           seeded; /* drbg instantiated */
+}* random_state_p;
+
+static int            random_fd     = -1;
+static int            random_source = RANDOM_SOURCE_DEFAULT;
+static unsigned long  random_generation;
+static pthread_key_t  random_key;
+static pthread_once_t random_once = PTHREAD_ONCE_INIT;
 
+/* Pick the source (opening /dev/urandom if getrandom is missing), create the
+ * key of the per-thread states and register random_fork_child: once per
+ * process */
 static void random_open(void);
-static void random_load(void);
+
+/* Child side of fork(): buffers inherited from the parent are now stale */
+static void random_fork_child(void);
+
+/* Thread exit: state is wiped and released */
+static void random_state_free(void* state);
+
+/* RETURN
+ * State of the calling thread, allocated on first use */
+static random_state_p random_state(void);
+
+/* buf[0...size) <- bytes of the source; partial reads and interrupted calls
+ * are retried */
+static void random_fill(char* buf, size_t size);
+
+/* buf[0...size) <- bytes of random_source, drawn by the thread of S */
+static void random_generate(random_state_p S, char* buf, size_t size);
+
+static void random_load(random_state_p S);
 
 void random_get_buffer(char* buf, size_t size)
 {
-    size_t i;
+    random_state_p S;
+    size_t         i;
+    size_t         n;
 
     if (buf == NULL)
         return;
 
-    if (fd == -1)
-        random_open();
+    pthread_once(&random_once, random_open);
+
+    if (random_source == RANDOM_SOURCE_KERNEL && size >= RANDOM_DIRECT_MIN)
+    {
+        random_fill(buf, size);
+        return;
+    }
+
+    S = random_state();
+
+    if (S->generation != random_generation)
+    {
+        memset(S->buffer, 0, RANDOM_BUFFER_SIZE);
+        drbg_wipe(&S->drbg);
+        S->seeded     = 0;
+        S->cur        = RANDOM_BUFFER_SIZE;
+        S->generation = random_generation;
+    }
+
+    if (size >= RANDOM_DIRECT_MIN)
+    {
+        random_generate(S, buf, size);
+        return;
+    }
 
     for (i = 0; i < size;)
     {
-        for (; cur < RANDOM_BUFFER_SIZE && i < size; ++i)
-        {
-            buf[i] = random_buffer[cur];
-            ++cur;
-        }
+        n = (size_t)(RANDOM_BUFFER_SIZE - S->cur);
+        if (n > size - i)
+            n = size - i;
+
+        memcpy(&buf[i], &S->buffer[S->cur], n);
+        memset(&S->buffer[S->cur], 0, n);
+        S->cur += (int)n;
+        i += n;
 
         if (i < size)
-            random_load();
+            random_load(S);
     }
 }
 
+int random_set_source(int source)
+{
+    if (source < 0 || source >= __random_source_sentinel)
+        return 1;
+
+    random_source = source;
+
+    return 0;
+}
+
 static void random_open(void)
 {
     int errno_hold;
 
-    if (fd != -1)
-        return;
+#if RANDOM_GETRANDOM
+    char probe;
 
-    fd = open("/dev/urandom", O_RDONLY, 0444);
-    if (fd == -1)
+    if (getrandom(&probe, 0, 0) == 0 || errno != ENOSYS)
+        random_fd = -1;
+    else
+#endif
+    {
+        random_fd = open("/dev/urandom", O_RDONLY, 0444);
+        if (random_fd == -1)
+        {
+            errno_hold = errno;
+            fprintf(
+                stderr,
+                "random_open: %d - %s",
+                errno_hold,
+                strerror(errno_hold)
+            );
+            exit(errno_hold);
+        }
+    }
+
+    errno_hold = pthread_key_create(&random_key, random_state_free);
+    if (errno_hold == 0)
+        errno_hold = pthread_atfork(NULL, NULL, random_fork_child);
+    if (errno_hold != 0)
     {
-        errno_hold = errno;
         fprintf(
             stderr, "random_open: %d - %s", errno_hold, strerror(errno_hold)
         );
         exit(errno_hold);
     }
+}
 
-    cur = RANDOM_BUFFER_SIZE;
+static void random_fork_child(void)
+{
+    ++random_generation;
 }
 
-static void random_load(void)
+static void random_state_free(void* state)
 {
-    int errno_hold;
+    memset(state, 0, sizeof(struct random_state_t));
+    free(state);
+}
+
+static random_state_p random_state(void)
+{
+    random_state_p S;
+    int            errno_hold;
 
-    if (read(fd, random_buffer, RANDOM_BUFFER_SIZE) != RANDOM_BUFFER_SIZE)
+    S = pthread_getspecific(random_key);
+    if (S != NULL)
+        return S;
+
+    S = malloc(sizeof(struct random_state_t));
+    if (S == NULL)
     {
         errno_hold = errno;
         fprintf(
-            stderr, "random_load: %d - %s", errno_hold, strerror(errno_hold)
+            stderr, "random_state: %d - %s", errno_hold, strerror(errno_hold)
+        );
+        exit(errno_hold);
+    }
+
+    S->cur        = RANDOM_BUFFER_SIZE;
+    S->generation = random_generation;
+    S->seeded     = 0;
+
+    errno_hold = pthread_setspecific(random_key, S);
+    if (errno_hold != 0)
+    {
+        fprintf(
+            stderr, "random_state: %d - %s", errno_hold, strerror(errno_hold)
         );
         exit(errno_hold);
     }
 
-    cur = 0;
+    return S;
+}
+
+static void random_fill(char* buf, size_t size)
+{
+    ssize_t n;
+    int     errno_hold;
+
+    while (size > 0)
+    {
+#if RANDOM_GETRANDOM
+        if (random_fd == -1)
+            n = getrandom(buf, size, 0);
+        else
+#endif
+            n = read(random_fd, buf, size);
+
+        if (n > 0)
+        {
+            buf += n;
+            size -= (size_t)n;
+        }
+        else if (n == 0 || errno != EINTR)
+        {
+            errno_hold = n == 0 ? EIO : errno;
+            fprintf(
+                stderr, "random_fill: %d - %s", errno_hold, strerror(errno_hold)
+            );
+            exit(errno_hold);
+        }
+    }
+}
+
+static void random_generate(random_state_p S, char* buf, size_t size)
+{
+    byte   seed[DRBG_SEED_SIZE];
+    size_t n;
+
+    if (random_source == RANDOM_SOURCE_KERNEL)
+    {
+        random_fill(buf, size);
+        return;
+    }
+
+    for (; size > 0; buf += n, size -= n)
+    {
+        n = size < DRBG_MAX_REQUEST ? size : DRBG_MAX_REQUEST;
+
+        if (!S->seeded || S->drbg.reseed_counter > RANDOM_DRBG_RESEED)
+        {
+            random_fill((char*)seed, DRBG_SEED_SIZE);
+            if (S->seeded)
+                drbg_reseed(&S->drbg, seed, NULL);
+            else
+                drbg_instantiate(&S->drbg, seed, NULL);
+            S->seeded = 1;
+
+            memset(seed, 0, DRBG_SEED_SIZE);
+        }
+
+        /* RANDOM_DRBG_RESEED is below DRBG_RESEED_INTERVAL: never 1 */
+        drbg_generate(&S->drbg, (byte*)buf, n, NULL);
+    }
+}
+
+static void random_load(random_state_p S)
+{
+    random_generate(S, S->buffer, RANDOM_BUFFER_SIZE);
+    S->cur = 0;
 }
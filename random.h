@@ -7,7 +7,52 @@
 #define RANDOM_BUFFER_SIZE 1024
 #endif
 
-/** Thread UNSAFE */
+/* Requests of at least this many bytes bypass the per-thread buffer */
+#ifndef RANDOM_DIRECT_MIN
+#define RANDOM_DIRECT_MIN RANDOM_BUFFER_SIZE
+#endif
+
+/* Sources of random_get_buffer, see random_set_source */
+enum
+{
+    RANDOM_SOURCE_KERNEL,   /* getrandom(2), or /dev/urandom */
+    RANDOM_SOURCE_CTR_DRBG, /* AES-256 CTR_DRBG (drbg.h) seeded by the kernel */
+
+    __random_source_sentinel
+};
+
+#ifndef RANDOM_SOURCE_DEFAULT
+#define RANDOM_SOURCE_DEFAULT RANDOM_SOURCE_KERNEL
+#endif
+
+/* Requests (of at most DRBG_MAX_REQUEST bytes) each thread's CTR_DRBG serves
+ * before it is reseeded from the kernel */
+#ifndef RANDOM_DRBG_RESEED
+#define RANDOM_DRBG_RESEED 1024
+#endif
+
+/** Bytes come from getrandom(2), or from /dev/urandom where it is not
+ * available. Thread safe: each thread has a buffer of RANDOM_BUFFER_SIZE bytes
+ * of its own, refilled independently, so that concurrent callers do not wait
+ * for each other; requests of RANDOM_DIRECT_MIN bytes or more are read
+ * directly into buf instead. Fork safe: a child process discards the buffers
+ * inherited from its parent. */
 extern void random_get_buffer(char* buf, size_t size);
 
+/* Source of the bytes of random_get_buffer, RANDOM_SOURCE_DEFAULT at first:
+ * - RANDOM_SOURCE_KERNEL: every byte comes from the kernel;
+ * - RANDOM_SOURCE_CTR_DRBG: each thread has a CTR_DRBG of its own, seeded
+ *   from the kernel and reseeded every RANDOM_DRBG_RESEED requests (and in a
+ *   child process after fork), that expands each seed with AES in counter
+ *   mode: many bytes, e.g. those of prime generation, for few system calls.
+ *   It is as fast as AES-CTR, that is fast with AES-NI only (see aes.h).
+ *
+ * Not thread safe: it must be set before random_get_buffer is in use.
+ *
+ * RETURN
+ * 0 -> source selected;
+ * 1 -> unknown source.
+ */
+extern int random_set_source(int source);
+
 #endif /* CMC_CRYPTO_RANDOM */
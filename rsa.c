@@ -1,8 +1,14 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <pthread.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "error.h"
 #include "random.h"
 #include "rsa.h"
+#include "sha2.h"
 
 typedef struct rsa_keygen_t
 {
@@ -12,6 +18,40 @@ typedef struct rsa_keygen_t
     struct rsa_key_t K;
 }* rsa_keygen_p;
 
+/* Shared state of a multi-threaded prime search: workers look for primes
+ * independently and the first two distinct ones found become p and q. */
+typedef struct rsa_prime_search_t
+{
+    pthread_mutex_t lock;
+    int             byte_length;
+    bigint_p        E;     /* Fixed public exponent, NULL if random */
+    int             found; /* Primes found so far; the search stops at 2 */
+    struct bigint_t primes[2];
+}* rsa_prime_search_p;
+
+/* Shared state of a batch of exponentiations, all with the same exponent and
+ * modulus: workers take chunks of inputs until none is left. */
+typedef struct rsa_batch_t
+{
+    pthread_mutex_t      lock;
+    int                  next; /* First input not yet taken by any worker */
+    int                  count;
+    bigint_p             DST;
+    bigint_p             B;
+    bigint_p             E;
+    struct bigint_mont_t C; /* Montgomery context of the modulus */
+}* rsa_batch_p;
+
+/* Process-wide cache of key contexts, see rsa_key_ctx_get */
+typedef struct rsa_key_cache_t
+{
+    int                          used;
+    unsigned long                clock; /* Ticks at each lookup */
+    unsigned long                last_use[RSA_KEY_CACHE_SIZE];
+    struct rsa_key_ctx_t         ctx[RSA_KEY_CACHE_SIZE];
+    struct rsa_key_cache_stats_t stats;
+}* rsa_key_cache_p;
+
 const char* RSA_ERR[] = {
     "rsa: unsupported key bit length",
     "rsa: key too long: bit length exceed BIGINT_MAX",
@@ -20,20 +60,255 @@ const char* RSA_ERR[] = {
     "rsa: could not import exponent, bigint_import failed",
     "rsa: pub-priv join failed: bit lengths not compatible",
     "rsa: pub-priv join failed: `n` not consistent",
+    "rsa: public exponent must be odd and greater than 1",
+    "rsa: modulus must be odd",
+    "rsa: unknown key file format",
+    "rsa: malformed key file",
+    "rsa: PKCS#1 private key needs p and q",
+    "rsa: blinding failed: private key not consistent",
+    "rsa: message too long for the key",
+    "rsa: decryption error",
+    "rsa: invalid signature",
+    "rsa: private key without e, can not be blinded: import the public key",
 };
 
 char RSA_ERR_MESSAGE[2048] = {0};
 
+/* First RSA_SIEVE_PRIMES odd primes, filled by rsa_sieve_init once (see
+ * rsa_sieve_once), then only read */
+static pthread_once_t rsa_sieve_once = PTHREAD_ONCE_INIT;
+static int            RSA_SIEVE[RSA_SIEVE_PRIMES];
+
+/* Candidates are start, start + 2, ..., start + RSA_SIEVE_SPAN - 2; if none of
+ * them is prime, a new start is drawn. The average gap between primes of 4096
+ * bits is less than 3000, so the span is rarely exhausted. */
+#define RSA_SIEVE_SPAN (1 << 16)
+
+/* Upper bound for a PKCS#1 RSAPrivateKey: nine INTEGERs of at most
+ * BIGINT_MAX + 1 bytes, each with a tag and up to 3 length bytes, plus the
+ * SEQUENCE header */
+#define RSA_DER_MAX (9 * (BIGINT_MAX + 5) + 4)
+
+/* Magic number of RSA_FMT_BIN key files */
+#define RSA_BIN_MAGIC "CMCK"
+
+static struct rsa_key_cache_t RSA_KEY_CACHE;
+static pthread_mutex_t        rsa_key_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Bound on |D| for the strong Lucas test parameters, see lucas_is_likely_prime
+ */
+#define RSA_LUCAS_MAX_D (1 << 16)
+
 static void rsa_key_init(rsa_key_p FK);
 
-/* Get a prime with maximum length of byte_length */
-static void rsa_get_prime(bigint_p N, int byte_length);
+/* Fill RSA_SIEVE: see rsa_sieve_once */
+static void rsa_sieve_init(void);
+
+/* RETURN
+ * true  -> start + delta is not divisible by any of the sieving primes;
+ * false -> otherwise.
+ *
+ * `residues` holds start mod RSA_SIEVE[i] */
+static int rsa_sieve_survives(int* residues, int delta);
+
+/* Get a prime of exactly byte_length bytes, with the two most significant bits
+ * set, so that the product of two of them has exactly 16 * byte_length bits.
+ *
+ * Candidates are generated by an incremental sieve: a random odd start is
+ * trial-divided once by the small primes in RSA_SIEVE, then candidates are
+ * obtained stepping by 2 and only those not divisible by any small prime are
+ * given to Miller-Rabin.
+ *
+ * S is NULL in single-threaded key generation; otherwise the search is
+ * abandoned as soon as S is done.
+ *
+ * RETURN
+ * true  -> N is a (likely) prime;
+ * false -> the search was cancelled, N is undefined.
+ */
+static int rsa_get_prime(bigint_p N, int byte_length, rsa_prime_search_p S);
+
+/* Get a prime as rsa_get_prime does, retrying until gcd(E, N - 1) == 1. If E
+ * is NULL, it is the same as rsa_get_prime.
+ *
+ * RETURN
+ * See rsa_get_prime
+ */
+static int rsa_get_prime_coprime(
+    bigint_p N, int byte_length, bigint_p E, rsa_prime_search_p S
+);
+
+/* RETURN
+ * true  -> S is not NULL and two primes have been found;
+ * false -> otherwise.
+ */
+static int rsa_prime_search_done(rsa_prime_search_p S);
+
+/* Thread routine: arg is a rsa_prime_search_p */
+static void* rsa_prime_search_worker(void* arg);
+
+/* Find p and q using `threads` threads, the calling one included */
+static void rsa_prime_search(rsa_keygen_p keygen, int byte_length, int threads);
 
 /* Select public and private exponents */
 static void rsa_select_exp(rsa_keygen_p keygen);
 
-/* Checl primality using an implementation of Miller-Rabin primality check */
-static int miller_rabin_is_likely_prime(bigint_p N, int u, bigint_p R);
+/* Compute the private exponent for an already chosen public exponent, that must
+ * be coprime with phi(n) */
+static void rsa_invert_exp(rsa_keygen_p keygen);
+
+/* Baillie-PSW (a base-2 strong probable prime test followed by a strong Lucas
+ * test), then rsa_mr_rounds random-base Miller-Rabin rounds.
+ *
+ * Almost every composite that gets past the sieve is rejected by the base-2
+ * round alone, which is cheaper than a random-base one: multiplying by 2 is a
+ * single shift in bigint_mul.
+ *
+ * The test gives up (returning false) if S is done. */
+static int rsa_is_likely_prime(bigint_p N, rsa_prime_search_p S);
+
+/* Random-base Miller-Rabin rounds needed for a candidate of bit_length bits.
+ *
+ * Following FIPS 186-5 (Appendix B), the count depends on the candidate size:
+ * for random candidates the probability that a composite survives t rounds
+ * falls much faster than 4^-t (Damgard, Landrock and Pomerance), and these
+ * counts keep it below 2^-100. Candidates shorter than 512 bits get
+ * PRIMALITY_S rounds. */
+static int rsa_mr_rounds(int bit_length);
+
+/* Single Miller-Rabin round, with base A, where N - 1 = 2^u * R, R odd, and C
+ * is the Montgomery context of N.
+ *
+ * RETURN
+ * true  -> N is a strong probable prime to base A;
+ * false -> N is composite.
+ */
+static int miller_rabin_round(
+    bigint_p N, int u, bigint_p R, bigint_p A, bigint_mont_p C
+);
+
+/* Checl primality using an implementation of Miller-Rabin primality check,
+ * with `rounds` random bases.
+ *
+ * The test gives up (returning false) if S is done. */
+static int miller_rabin_is_likely_prime(
+    bigint_p N, int u, bigint_p R, int rounds, bigint_mont_p C,
+    rsa_prime_search_p S
+);
+
+/* Strong Lucas probable prime test, with parameters chosen by Selfridge's
+ * method A: D is the first of 5, -7, 9, -11, ... such that the Jacobi symbol
+ * (D/N) is -1, P = 1 and Q = (1 - D) / 4. C is the Montgomery context of N.
+ *
+ * N must be odd and not divisible by any small prime. If N is a perfect square
+ * no such D exists: the search gives up, reporting N composite, once |D|
+ * reaches RSA_LUCAS_MAX_D.
+ *
+ * RETURN
+ * true  -> N is a strong Lucas probable prime;
+ * false -> N is composite.
+ */
+static int lucas_is_likely_prime(bigint_p N, bigint_mont_p C);
+
+/* Jacobi symbol (a/n), with a >= 0 and n odd, positive */
+static int rsa_jacobi(int a, int n);
+
+/* Modular arithmetic helpers for lucas_is_likely_prime: operands are in
+ * [0, M), DST can overlap with any of them. */
+static void rsa_addmod(bigint_p DST, bigint_p A, bigint_p B, bigint_p M);
+static void rsa_submod(bigint_p DST, bigint_p A, bigint_p B, bigint_p M);
+
+/* DST <- A / 2 mod M, M odd */
+static void rsa_halfmod(bigint_p DST, bigint_p A, bigint_p M);
+
+/* DST <- -A mod M */
+static void rsa_negmod(bigint_p DST, bigint_p A, bigint_p M);
+
+/* Thread routine: arg is a rsa_batch_p */
+static void* rsa_batch_worker(void* arg);
+
+/* DST[i] <- B[i]^E mod K->n, for 0 <= i < count, using `threads` threads (the
+ * calling one included).
+ *
+ * RETURN
+ * RSA ERROR ENUM
+ */
+static int rsa_batch_run(
+    bigint_p DST, bigint_p B, int count, bigint_p E, rsa_key_p K, int threads
+);
+
+/* Index of the context of K in RSA_KEY_CACHE, -1 if missing. The cache lock
+ * must be held. */
+static int rsa_key_cache_find(rsa_key_p K, uint32_t fingerprint);
+
+/* Copy C into RSA_KEY_CACHE, unless already there. The cache lock must be
+ * held. */
+static void rsa_key_cache_put(rsa_key_ctx_p C);
+
+/* Same keys: n, e, d and p match */
+static int rsa_key_eq(rsa_key_p A, rsa_key_p B);
+
+/* Monotonic wall-clock time, in seconds */
+static double rsa_now(void);
+
+/* Attempts to draw a blinding pair before giving up, see rsa_blinding_init */
+#define RSA_BLINDING_TRIES 8
+
+/* DST <- B^E mod C->M in constant time, E being read as a number of `bits`
+ * bits: bigint_mont_exp_ct, or bigint_mont_ladder_ct if RSA_CT_LADDER */
+static void
+rsa_exp_ct(bigint_p DST, bigint_p B, bigint_p E, int bits, bigint_mont_p C);
+
+/* DST <- B^d mod n, by the CRT when C->crt is set */
+static void rsa_ctx_private(bigint_p DST, bigint_p B, rsa_key_ctx_p C);
+
+/* DST <- X mod n, where X = B^EP mod p and X = B^EQ mod q (CRT). C->crt must
+ * be set. */
+static void rsa_ctx_crt_exp(
+    bigint_p DST, bigint_p B, bigint_p EP, bigint_p EQ, rsa_key_ctx_p C
+);
+
+/* Draw the blinding pair of C (see rsa_key_ctx_init).
+ *
+ * RETURN
+ * RSA ERROR ENUM
+ */
+static int rsa_blinding_init(rsa_key_ctx_p C);
+
+/* Square the blinding pair of C */
+static void rsa_blinding_update(rsa_key_ctx_p C);
+
+/* dst (k bytes) <- src^e mod n (public) or src^d mod n (private, through
+ * rsa_decrypt), where src is k bytes long.
+ *
+ * RETURN
+ * RSA ERROR ENUM: RSA_ERR_DECRYPTION if src is not less than n
+ */
+static int rsa_bytes_op(byte* dst, const byte* src, rsa_key_p K, int priv);
+
+/* dst (k bytes) <- B, left-padded with zeros */
+static void rsa_export_padded(byte* dst, bigint_p B, int k);
+
+/* EMSA-PSS encoding of hash into the k bytes of dst, k being rsa_key_size(K).
+ * The encoded message is emBits = (bit length of n) - 1 bits long, hence its
+ * leading bits (and, if emBits is a multiple of 8, the first byte) are zero:
+ * dst is less than n.
+ *
+ * RETURN
+ * RSA ERROR ENUM
+ */
+static int rsa_pss_encode(byte* dst, const byte* hash, rsa_key_p K);
+
+/* H <- SHA-256(0x00 * 8 || hash || salt) */
+static void rsa_pss_hash(byte* H, const byte* hash, const byte* salt);
+
+/* dst[0...len) ^= MGF1(seed), with SHA-256 */
+static void
+rsa_mgf1_xor(byte* dst, int len, const byte* seed, int seed_len);
+
+/* Constant-time comparisons: all ones if true, zero otherwise */
+static unsigned int rsa_ct_eq(unsigned int a, unsigned int b);
+static unsigned int rsa_ct_lt(unsigned int a, unsigned int b);
 
 /* Euler's Phi function on n = p * q.
  *
@@ -70,6 +345,58 @@ static int rsa_n_exp_import(FILE* fp, rsa_key_p K, bigint_p E);
  */
 static int rsa_key_import_join(rsa_key_p DST, rsa_key_p pub, rsa_key_p priv);
 
+/* Same as rsa_n_exp_dump and rsa_n_exp_import, in RSA_FMT_BIN format */
+static void
+rsa_n_exp_dump_bin(FILE* fp, bigint_p n, bigint_p e, int bit_length);
+static int rsa_n_exp_import_bin(FILE* fp, rsa_key_p K, bigint_p E);
+
+/* Write a 4-byte big-endian unsigned integer */
+static void rsa_put_u32(FILE* fp, uint32_t n);
+
+/* Read a 4-byte big-endian unsigned integer
+ *
+ * RETURN
+ * true  -> n is set;
+ * false -> the file is truncated.
+ */
+static int rsa_get_u32(FILE* fp, uint32_t* n);
+
+/* Dump K as a PKCS#1 RSAPublicKey (priv false) or RSAPrivateKey (priv true).
+ *
+ * RETURN
+ * RSA ERROR ENUM
+ */
+static int rsa_der_dump(FILE* fp, rsa_key_p K, int priv);
+
+/* Import a PKCS#1 RSAPublicKey (priv false) or RSAPrivateKey (priv true). The
+ * bit length of K is the one of `n`.
+ *
+ * RETURN
+ * RSA ERROR ENUM
+ */
+static int rsa_der_import(FILE* fp, rsa_key_p K, int priv);
+
+/* Append a DER length, or a DER INTEGER, to buf at *pos */
+static void rsa_der_put_len(byte* buf, int* pos, int len);
+static void rsa_der_put_int(byte* buf, int* pos, bigint_p N);
+
+/* Read the DER header (tag and length) at *pos, of `size` bytes buf, moving
+ * *pos to the content.
+ *
+ * RETURN
+ * Content length, or -1 if the tag is not `tag` or the content does not fit
+ * buf.
+ */
+static int rsa_der_get_header(byte* buf, int size, int* pos, int tag);
+
+/* Read the non-negative DER INTEGER at *pos, moving *pos past it.
+ *
+ * RETURN
+ * true  -> N is set;
+ * false -> malformed, negative, or longer than BIGINT_MAX.
+ */
+static int rsa_der_get_int(byte* buf, int size, int* pos, bigint_p N);
+
 /* IMPL */
 
 /* STATIC */
@@ -78,40 +405,184 @@ static void rsa_key_init(rsa_key_p FK)
     memset(FK, 0, sizeof(struct rsa_key_t));
 }
 
-static void rsa_get_prime(bigint_p N, int byte_length)
+static void rsa_sieve_init(void)
 {
-    int             u;
-    struct bigint_t twoU; /* 2^u */
-    struct bigint_t one;  /* one */
+    int n;
+    int i;
+    int found = 0;
+
+    /* Trial division by the primes already found is plenty for a table this
+     * small, as it is built only once */
+    for (n = 3; found < RSA_SIEVE_PRIMES; n += 2)
+    {
+        for (i = 0; i < found && RSA_SIEVE[i] * RSA_SIEVE[i] <= n; ++i)
+            if (n % RSA_SIEVE[i] == 0)
+                break;
+
+        if (i == found || RSA_SIEVE[i] * RSA_SIEVE[i] > n)
+            RSA_SIEVE[found++] = n;
+    }
+}
+
+static int rsa_sieve_survives(int* residues, int delta)
+{
+    int i;
+
+    for (i = 0; i < RSA_SIEVE_PRIMES; ++i)
+        if ((residues[i] + delta) % RSA_SIEVE[i] == 0)
+            return 0;
+
+    return 1;
+}
+
+static int rsa_get_prime(bigint_p N, int byte_length, rsa_prime_search_p S)
+{
+    int             i;
+    int             delta;
+    int             residues[RSA_SIEVE_PRIMES];
+    struct bigint_t start;
     struct bigint_t R;
 
-    if (byte_length <= 1)
+    if (byte_length <= 1 || byte_length > BIGINT_MAX)
     {
         N->overflow = 1;
-        return;
+        return 0;
     }
 
-    bigint_init_by_int(&one, 1);
+    pthread_once(&rsa_sieve_once, rsa_sieve_init);
+
+    while (!rsa_prime_search_done(S))
+    {
+        bigint_init_rand(&start, (size_t)byte_length);
+        start.num[byte_length - 1] |= 0xc0;
+        start.num[0] |= 0x01;
+        bigint_set_internal(&start);
+
+        for (i = 0; i < RSA_SIEVE_PRIMES; ++i)
+            residues[i] = bigint_mod_int(&start, RSA_SIEVE[i]);
+
+        for (delta = 0; delta < RSA_SIEVE_SPAN; delta += 2)
+        {
+            if (!rsa_sieve_survives(residues, delta))
+                continue;
+
+            bigint_init_by_int(&R, delta);
+            bigint_sum(N, &start, &R);
+
+            /* Carried out of byte_length: drawing a new start */
+            if (N->max_exp >= byte_length)
+                break;
+
+            if (rsa_is_likely_prime(N, S))
+                return 1;
+
+            if (rsa_prime_search_done(S))
+                return 0;
+        }
+    }
+
+    return 0;
+}
+
+static int rsa_get_prime_coprime(
+    bigint_p N, int byte_length, bigint_p E, rsa_prime_search_p S
+)
+{
+    struct bigint_t GCD;
+    struct bigint_t T;
+    struct bigint_t nm1; /* nm1 = N - 1 */
 
     do
     {
-        /* Choosing u in (0, byte_length / 2] */
-        random_get_buffer((char*)&u, sizeof(u));
-        u %= byte_length / 2;
-        if (u < 0)
-            u += byte_length / 2;
-        ++u;
+        if (!rsa_get_prime(N, byte_length, S))
+            return 0;
+
+        if (E == NULL)
+            return 1;
+
+        bigint_sub_int(&nm1, N, 1);
+        bigint_eec(&GCD, &T, E, &nm1);
+    } while (!bigint_eq_byte(&GCD, 1));
+
+    return 1;
+}
+
+static int rsa_prime_search_done(rsa_prime_search_p S)
+{
+    int done;
+
+    if (S == NULL)
+        return 0;
 
-        /* 2^u */
-        bigint_copy(&twoU, &one);
-        bigint_shiftl(&twoU, &twoU, u);
+    pthread_mutex_lock(&S->lock);
+    done = S->found >= 2;
+    pthread_mutex_unlock(&S->lock);
 
-        bigint_init_rand(&R, (size_t)byte_length);
-        bigint_or(&R, &R, &one);
+    return done;
+}
 
-        bigint_mul(N, &R, &twoU); /* N = 2^u * R */
-        bigint_sum(N, N, &one);   /* N = N + 1 */
-    } while (!miller_rabin_is_likely_prime(N, u, &R));
+static void* rsa_prime_search_worker(void* arg)
+{
+    rsa_prime_search_p S = (rsa_prime_search_p)arg;
+    struct bigint_t    P;
+
+    while (rsa_get_prime_coprime(&P, S->byte_length, S->E, S))
+    {
+        pthread_mutex_lock(&S->lock);
+
+        /* p == q would make n a square: such a prime is discarded */
+        if (S->found == 0 ||
+            (S->found == 1 && bigint_cmp(&S->primes[0], &P) != 0))
+        {
+            bigint_copy(&S->primes[S->found], &P);
+            S->found += 1;
+        }
+
+        pthread_mutex_unlock(&S->lock);
+    }
+
+    return NULL;
+}
+
+static void rsa_prime_search(rsa_keygen_p keygen, int byte_length, int threads)
+{
+    struct rsa_prime_search_t S;
+    pthread_t*                workers;
+    int*                      started;
+    int                       i;
+
+    workers = malloc(sizeof(pthread_t) * (size_t)threads);
+    EXIT_EALLOC(workers);
+    started = calloc((size_t)threads, sizeof(int));
+    EXIT_EALLOC(started);
+
+    pthread_mutex_init(&S.lock, NULL);
+    S.byte_length = byte_length;
+    S.E           = bigint_iszero(&keygen->K.e) ? NULL : &keygen->K.e;
+    S.found       = 0;
+
+    /* The sieve table is shared: ready before workers start */
+    pthread_once(&rsa_sieve_once, rsa_sieve_init);
+
+    /* If a thread cannot be started, the search goes on with fewer workers:
+     * the calling thread is a worker as well, hence there is always one. */
+    for (i = 1; i < threads; ++i)
+        started[i] =
+            pthread_create(&workers[i], NULL, rsa_prime_search_worker, &S) ==
+            0;
+
+    rsa_prime_search_worker(&S);
+
+    for (i = 1; i < threads; ++i)
+        if (started[i])
+            pthread_join(workers[i], NULL);
+
+    bigint_copy(&keygen->p, &S.primes[0]);
+    bigint_copy(&keygen->q, &S.primes[1]);
+
+    pthread_mutex_destroy(&S.lock);
+    free(started);
+    free(workers);
 }
 
 static void rsa_select_exp(rsa_keygen_p keygen)
@@ -131,47 +602,653 @@ static void rsa_select_exp(rsa_keygen_p keygen)
     }
 }
 
-static int miller_rabin_is_likely_prime(bigint_p N, int u, bigint_p R)
+static void rsa_invert_exp(rsa_keygen_p keygen)
+{
+    struct bigint_t GCD;
+
+    bigint_eec(&GCD, &keygen->K.d, &keygen->K.e, &keygen->phi_n);
+}
+
+static int rsa_is_likely_prime(bigint_p N, rsa_prime_search_p S)
+{
+    int                  u;
+    struct bigint_t      R;
+    struct bigint_t      A;
+    struct bigint_mont_t C; /* Shared by all the rounds */
+
+    /* N - 1 = 2^u * R, R odd */
+    bigint_sub_int(&R, N, 1);
+    for (u = 0; !bigint_getbit(&R, u); ++u)
+        ;
+    bigint_shiftr(&R, &R, u);
+
+    bigint_mont_init(&C, N);
+
+    bigint_init_by_int(&A, 2);
+    if (!miller_rabin_round(N, u, &R, &A, &C))
+        return 0;
+
+    if (rsa_prime_search_done(S) || !lucas_is_likely_prime(N, &C))
+        return 0;
+
+    return miller_rabin_is_likely_prime(
+        N, u, &R, rsa_mr_rounds(N->max_digit2 + 1), &C, S
+    );
+}
+
+static int rsa_mr_rounds(int bit_length)
+{
+    if (bit_length >= 1536)
+        return 3;
+    if (bit_length >= 1024)
+        return 4;
+    if (bit_length >= 512)
+        return 7;
+
+    return PRIMALITY_S;
+}
+
+static int miller_rabin_round(
+    bigint_p N, int u, bigint_p R, bigint_p A, bigint_mont_p C
+)
 {
-    int             s;
     int             i;
-    struct bigint_t A;
     struct bigint_t nm1; /* nm1 = N - 1 */
     struct bigint_t Z;
+    struct bigint_t one;
 
     bigint_sub_int(&nm1, N, 1);
 
-    for (s = 0; s < PRIMALITY_S; ++s)
+    bigint_mont_exp(&Z, A, R, C);
+
+    if (bigint_eq_byte(&Z, 1) || bigint_cmp(&Z, &nm1) == 0)
+        return 1; /* Likely prime, maybe a lie... */
+
+    /* Squarings are done in Montgomery representation, where 1 and N - 1
+     * become R mod N and N - (R mod N) */
+    bigint_init_by_int(&one, 1);
+    bigint_mont_to(&one, &one, C);
+    bigint_sub(&nm1, N, &one);
+    bigint_mont_to(&Z, &Z, C);
+
+    for (i = 1; i < u; ++i)
     {
+        bigint_mont_mul(&Z, &Z, &Z, C);
+
+        if (bigint_cmp(&Z, &one) == 0)
+            return 0;
+
+        if (bigint_cmp(&Z, &nm1) == 0)
+            return 1;
+    }
+
+    return 0;
+}
+
+static int miller_rabin_is_likely_prime(
+    bigint_p N, int u, bigint_p R, int rounds, bigint_mont_p C,
+    rsa_prime_search_p S
+)
+{
+    int             s;
+    struct bigint_t A;
+    struct bigint_t nm1; /* nm1 = N - 1 */
+
+    bigint_sub_int(&nm1, N, 1);
+
+    for (s = 0; s < rounds; ++s)
+    {
+        if (rsa_prime_search_done(S))
+            return 0;
+
         do
         {
             bigint_init_rand(&A, (size_t)nm1.max_exp);
         } while (bigint_cmp(&nm1, &A) <= 0 || bigint_eq_byte(&A, 0) ||
                  bigint_eq_byte(&A, 1));
 
-        bigint_exp_mod(&Z, &A, R, N);
+        if (!miller_rabin_round(N, u, R, &A, C))
+            return 0;
+    }
 
-        if (bigint_eq_byte(&Z, 1) || bigint_cmp(&Z, &nm1) == 0)
-            continue; /* Likely prime, maybe a lie... */
+    return 1;
+}
 
-        if (!bigint_eq_byte(&Z, 1))
-            for (i = 1; i < u; ++i)
-            {
-                bigint_square(&Z, &Z);
-                bigint_mod(&Z, &Z, N);
+static int lucas_is_likely_prime(bigint_p N, bigint_mont_p C)
+{
+    int             d; /* D = d, or D = -d if d_neg */
+    int             d_neg;
+    int             q; /* Q = q, or Q = -q if q_neg */
+    int             q_neg;
+    int             j;
+    int             s;
+    int             i;
+    struct bigint_t K;
+    struct bigint_t U;
+    struct bigint_t V;
+    struct bigint_t Qk; /* Q^k mod N */
+    struct bigint_t T;
+    struct bigint_t absD;
+    struct bigint_t absQ;
+    struct bigint_t one;
+
+    for (d = 5, d_neg = 0;; d += 2, d_neg = !d_neg)
+    {
+        if (d >= RSA_LUCAS_MAX_D)
+            return 0;
 
-                if (bigint_eq_byte(&Z, 1))
-                    return 0;
+        /* (D/N) = (N/d), by reciprocity, as d is odd and positive; the sign
+         * changes if both d and N are 3 mod 4, and once more if D < 0 and N is
+         * 3 mod 4, for (-1/N) = -1 in that case. */
+        j = rsa_jacobi(bigint_mod_int(N, d), d);
+        if ((N->num[0] & 3) == 3 && (d % 4 == 3) != d_neg)
+            j = -j;
 
-                if (bigint_cmp(&Z, &nm1) == 0)
-                    break;
-            }
+        if (j == -1)
+            break;
 
-        if (bigint_cmp(&Z, &nm1) != 0)
+        /* d divides N (and N > d, N being sieved) */
+        if (j == 0)
             return 0;
     }
 
-    return 1;
+    /* Q = (1 - D) / 4 */
+    q     = d_neg ? (1 + d) / 4 : (d - 1) / 4;
+    q_neg = !d_neg;
+
+    if (q > 1 && bigint_mod_int(N, q) == 0)
+        return 0;
+
+    /* N + 1 = 2^s * K, K odd */
+    bigint_init_by_int(&T, 1);
+    bigint_sum(&K, N, &T);
+    for (s = 0; !bigint_getbit(&K, s); ++s)
+        ;
+    bigint_shiftr(&K, &K, s);
+
+    /* Everything is kept in Montgomery representation: sums, differences and
+     * halving are the same as for plain residues, and zero is still zero */
+    bigint_init_by_int(&absD, d);
+    bigint_mont_to(&absD, &absD, C);
+    bigint_init_by_int(&absQ, q);
+    bigint_mont_to(&absQ, &absQ, C);
+    bigint_init_by_int(&one, 1);
+    bigint_mont_to(&one, &one, C);
+
+    /* k = 1: U_1 = 1, V_1 = P = 1 */
+    bigint_copy(&U, &one);
+    bigint_copy(&V, &one);
+    bigint_copy(&Qk, &absQ);
+    if (q_neg)
+        rsa_negmod(&Qk, &Qk, N);
+
+    /* Left-to-right over the bits of K:
+     * - U_2k = U_k * V_k, V_2k = V_k^2 - 2 * Q^k;
+     * - U_k+1 = (P * U_k + V_k) / 2, V_k+1 = (D * U_k + P * V_k) / 2. */
+    for (i = K.max_digit2 - 1; i >= 0; --i)
+    {
+        bigint_mont_mul(&U, &U, &V, C);
+        bigint_mont_mul(&V, &V, &V, C);
+        rsa_addmod(&T, &Qk, &Qk, N);
+        rsa_submod(&V, &V, &T, N);
+        bigint_mont_mul(&Qk, &Qk, &Qk, C);
+
+        if (!bigint_getbit(&K, i))
+            continue;
+
+        bigint_mont_mul(&T, &absD, &U, C);
+        if (d_neg)
+            rsa_negmod(&T, &T, N);
+        rsa_addmod(&T, &T, &V, N);
+
+        rsa_addmod(&U, &U, &V, N);
+        rsa_halfmod(&U, &U, N);
+        rsa_halfmod(&V, &T, N);
+
+        bigint_mont_mul(&Qk, &Qk, &absQ, C);
+        if (q_neg)
+            rsa_negmod(&Qk, &Qk, N);
+    }
+
+    if (bigint_iszero(&U) || bigint_iszero(&V))
+        return 1;
+
+    /* V_2^r*K, for 0 < r < s */
+    for (i = 1; i < s; ++i)
+    {
+        bigint_mont_mul(&V, &V, &V, C);
+        rsa_addmod(&T, &Qk, &Qk, N);
+        rsa_submod(&V, &V, &T, N);
+
+        if (bigint_iszero(&V))
+            return 1;
+
+        bigint_mont_mul(&Qk, &Qk, &Qk, C);
+    }
+
+    return 0;
+}
+
+static int rsa_jacobi(int a, int n)
+{
+    int j = 1;
+    int t;
+
+    a %= n;
+
+    while (a != 0)
+    {
+        while (a % 2 == 0)
+        {
+            a /= 2;
+            if (n % 8 == 3 || n % 8 == 5)
+                j = -j;
+        }
+
+        t = a;
+        a = n;
+        n = t;
+
+        if (a % 4 == 3 && n % 4 == 3)
+            j = -j;
+
+        a %= n;
+    }
+
+    return n == 1 ? j : 0;
+}
+
+static void rsa_addmod(bigint_p DST, bigint_p A, bigint_p B, bigint_p M)
+{
+    struct bigint_t S;
+
+    bigint_sum(&S, A, B);
+    if (bigint_cmp(&S, M) >= 0)
+        bigint_sub(&S, &S, M);
+
+    bigint_copy(DST, &S);
+}
+
+static void rsa_submod(bigint_p DST, bigint_p A, bigint_p B, bigint_p M)
+{
+    struct bigint_t S;
+
+    if (bigint_cmp(A, B) >= 0)
+        bigint_sub(&S, A, B);
+    else
+    {
+        bigint_sum(&S, A, M);
+        bigint_sub(&S, &S, B);
+    }
+
+    bigint_copy(DST, &S);
+}
+
+static void rsa_halfmod(bigint_p DST, bigint_p A, bigint_p M)
+{
+    struct bigint_t S;
+
+    if (bigint_iseven(A))
+        bigint_copy(&S, A);
+    else
+        bigint_sum(&S, A, M);
+
+    bigint_shiftr(DST, &S, 1);
+}
+
+static void rsa_negmod(bigint_p DST, bigint_p A, bigint_p M)
+{
+    if (bigint_iszero(A))
+        bigint_copy(DST, A);
+    else
+        bigint_sub(DST, M, A);
+}
+
+static void* rsa_batch_worker(void* arg)
+{
+    rsa_batch_p batch = (rsa_batch_p)arg;
+    int         first;
+    int         i;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&batch->lock);
+        first = batch->next;
+        batch->next += RSA_BATCH_CHUNK;
+        pthread_mutex_unlock(&batch->lock);
+
+        if (first >= batch->count)
+            break;
+
+        for (i = first; i < first + RSA_BATCH_CHUNK && i < batch->count; ++i)
+            bigint_mont_exp(&batch->DST[i], &batch->B[i], batch->E, &batch->C);
+    }
+
+    return NULL;
+}
+
+static int rsa_batch_run(
+    bigint_p DST, bigint_p B, int count, bigint_p E, rsa_key_p K, int threads
+)
+{
+    struct rsa_batch_t batch;
+    pthread_t*         workers;
+    int*               started;
+    int                i;
+
+    if (!bigint_mont_init(&batch.C, &K->n))
+        return RSA_ERR_INVALID_N;
+
+    /* No more threads than chunks */
+    if (threads > (count + RSA_BATCH_CHUNK - 1) / RSA_BATCH_CHUNK)
+        threads = (count + RSA_BATCH_CHUNK - 1) / RSA_BATCH_CHUNK;
+    if (threads < 1)
+        threads = 1;
+
+    workers = malloc(sizeof(pthread_t) * (size_t)threads);
+    EXIT_EALLOC(workers);
+    started = calloc((size_t)threads, sizeof(int));
+    EXIT_EALLOC(started);
+
+    pthread_mutex_init(&batch.lock, NULL);
+    batch.next  = 0;
+    batch.count = count;
+    batch.DST   = DST;
+    batch.B     = B;
+    batch.E     = E;
+
+    /* As in rsa_prime_search, the calling thread is a worker as well */
+    for (i = 1; i < threads; ++i)
+        started[i] =
+            pthread_create(&workers[i], NULL, rsa_batch_worker, &batch) == 0;
+
+    rsa_batch_worker(&batch);
+
+    for (i = 1; i < threads; ++i)
+        if (started[i])
+            pthread_join(workers[i], NULL);
+
+    pthread_mutex_destroy(&batch.lock);
+    free(started);
+    free(workers);
+
+    return RSA_OK;
+}
+
+static int rsa_key_cache_find(rsa_key_p K, uint32_t fingerprint)
+{
+    int i;
+
+    for (i = 0; i < RSA_KEY_CACHE.used; ++i)
+        if (RSA_KEY_CACHE.ctx[i].fingerprint == fingerprint &&
+            rsa_key_eq(&RSA_KEY_CACHE.ctx[i].K, K))
+            return i;
+
+    return -1;
+}
+
+static void rsa_key_cache_put(rsa_key_ctx_p C)
+{
+    int i;
+    int slot;
+
+    /* Another thread might have built the same context in the meantime */
+    if (rsa_key_cache_find(&C->K, C->fingerprint) >= 0)
+        return;
+
+    if (RSA_KEY_CACHE.used < RSA_KEY_CACHE_SIZE)
+        slot = RSA_KEY_CACHE.used++;
+    else
+    {
+        slot = 0;
+        for (i = 1; i < RSA_KEY_CACHE_SIZE; ++i)
+            if (RSA_KEY_CACHE.last_use[i] < RSA_KEY_CACHE.last_use[slot])
+                slot = i;
+
+        ++RSA_KEY_CACHE.stats.evictions;
+    }
+
+    memcpy(&RSA_KEY_CACHE.ctx[slot], C, sizeof(struct rsa_key_ctx_t));
+    RSA_KEY_CACHE.last_use[slot] = ++RSA_KEY_CACHE.clock;
+
+    /* C keeps the pair it was built with, the next lookup gets the next one */
+    if (rsa_key_ispriv(&C->K))
+        rsa_blinding_update(&RSA_KEY_CACHE.ctx[slot]);
+}
+
+static int rsa_key_eq(rsa_key_p A, rsa_key_p B)
+{
+    return bigint_cmp(&A->n, &B->n) == 0 && bigint_cmp(&A->e, &B->e) == 0 &&
+           bigint_cmp(&A->d, &B->d) == 0 && bigint_cmp(&A->p, &B->p) == 0;
+}
+
+static double rsa_now(void)
+{
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0)
+        return 0;
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void
+rsa_exp_ct(bigint_p DST, bigint_p B, bigint_p E, int bits, bigint_mont_p C)
+{
+    if (RSA_CT_LADDER)
+        bigint_mont_ladder_ct(DST, B, E, bits, C);
+    else
+        bigint_mont_exp_ct(DST, B, E, bits, C);
+}
+
+static void rsa_ctx_private(bigint_p DST, bigint_p B, rsa_key_ctx_p C)
+{
+    if (C->crt)
+        rsa_ctx_crt_exp(DST, B, &C->dp, &C->dq, C);
+    else
+        rsa_exp_ct(DST, B, &C->K.d, C->N.M.max_digit2 + 1, &C->N);
+}
+
+static void rsa_ctx_crt_exp(
+    bigint_p DST, bigint_p B, bigint_p EP, bigint_p EQ, rsa_key_ctx_p C
+)
+{
+    struct bigint_t m1;
+    struct bigint_t m2;
+    struct bigint_t T;
+
+    /* m1 = B^EP mod p, m2 = B^EQ mod q, EP < p and EQ < q */
+    rsa_exp_ct(&m1, B, EP, C->P.M.max_digit2 + 1, &C->P);
+    rsa_exp_ct(&m2, B, EQ, C->Q.M.max_digit2 + 1, &C->Q);
+
+    /* h = qinv * (m1 - m2) mod p */
+    bigint_mont_mod(&T, &m2, &C->P);
+    if (bigint_cmp(&m1, &T) < 0)
+        bigint_sum(&m1, &m1, &C->P.M);
+    bigint_sub(&m1, &m1, &T);
+    bigint_mul(&T, &C->qinv, &m1);
+    bigint_mont_mod(&T, &T, &C->P);
+
+    /* m = m2 + h * q */
+    bigint_mul(&T, &T, &C->Q.M);
+    bigint_sum(DST, &m2, &T);
+}
+
+static int rsa_blinding_init(rsa_key_ctx_p C)
+{
+    struct bigint_t r;
+    struct bigint_t rinv;
+    struct bigint_t EP;
+    struct bigint_t EQ;
+    struct bigint_t T;
+    int             i;
+
+    /* Without e (a key imported from a private key file alone) there is no
+     * r^e: the operation would not be blinded at all */
+    if (!rsa_key_ispub(&C->K))
+        return RSA_ERR_NO_PUBLIC_EXP;
+
+    if (C->crt)
+    {
+        bigint_sub_int(&EP, &C->K.p, 2);
+        bigint_sub_int(&EQ, &C->K.q, 2);
+    }
+    else
+    {
+        /* e * d = 1 mod lambda(n), hence r^(e * d - 2) = r^-1 */
+        bigint_mul(&EP, &C->K.e, &C->K.d);
+        bigint_sub_int(&EP, &EP, 2);
+    }
+
+    for (i = 0; i < RSA_BLINDING_TRIES; ++i)
+    {
+        /* One byte shorter than n, hence less than it */
+        bigint_init_rand(&r, (size_t)C->N.M.max_exp);
+        if (r.max_digit2 < 1)
+            continue;
+
+        if (C->crt)
+            rsa_ctx_crt_exp(&rinv, &r, &EP, &EQ, C);
+        else
+            rsa_exp_ct(&rinv, &r, &EP, EP.max_digit2 + 1, &C->N);
+
+        /* r * r^-1 must be 1: it is not if the key is broken (or, with
+         * negligible probability, if r is not coprime with n) */
+        bigint_mul(&T, &r, &rinv);
+        bigint_mont_mod(&T, &T, &C->N);
+        if (!bigint_eq_byte(&T, 1))
+            continue;
+
+        bigint_mont_exp(&T, &r, &C->K.e, &C->N);
+        bigint_mont_to(&C->blind, &T, &C->N);
+        bigint_mont_to(&C->unblind, &rinv, &C->N);
+
+        return RSA_OK;
+    }
+
+    return RSA_ERR_BLINDING;
+}
+
+static void rsa_blinding_update(rsa_key_ctx_p C)
+{
+    bigint_mont_mul(&C->blind, &C->blind, &C->blind, &C->N);
+    bigint_mont_mul(&C->unblind, &C->unblind, &C->unblind, &C->N);
+}
+
+static int rsa_bytes_op(byte* dst, const byte* src, rsa_key_p K, int priv)
+{
+    struct bigint_t B;
+    int             k = rsa_key_size(K);
+    int             res;
+
+    if (priv && !rsa_key_ispub(K))
+        return RSA_ERR_NO_PUBLIC_EXP;
+
+    bigint_import_bytes(&B, src, k);
+    if (bigint_cmp(&B, &K->n) >= 0)
+        return RSA_ERR_DECRYPTION;
+
+    if (priv)
+    {
+        res = rsa_decrypt(&B, &B, K);
+        if (res != RSA_OK)
+            return res;
+    }
+    else
+        rsa_encrypt(&B, &B, K);
+
+    rsa_export_padded(dst, &B, k);
+
+    return RSA_OK;
+}
+
+static void rsa_export_padded(byte* dst, bigint_p B, int k)
+{
+    byte T[BIGINT_MAX];
+    int  len = bigint_export_bytes(T, B);
+
+    memset(dst, 0, (size_t)(k - len));
+    memcpy(&dst[k - len], T, (size_t)len);
+}
+
+static int rsa_pss_encode(byte* dst, const byte* hash, rsa_key_p K)
+{
+    int   k      = rsa_key_size(K);
+    int   embits = K->n.max_digit2;
+    int   emlen  = (embits + 7) / 8;
+    int   hlen   = SHA256_DIGEST_SIZE;
+    int   dblen  = emlen - hlen - 1;
+    byte* EM     = &dst[k - emlen];
+    byte* salt   = &EM[dblen - RSA_PSS_SALT_SIZE];
+
+    if (emlen < hlen + RSA_PSS_SALT_SIZE + 2)
+        return RSA_ERR_UNSUPPORTED_SIZE;
+
+    /* DB = PS || 0x01 || salt, PS being zeros */
+    memset(dst, 0, (size_t)(k - RSA_PSS_SALT_SIZE - hlen - 2));
+    EM[dblen - RSA_PSS_SALT_SIZE - 1] = 0x01;
+    random_get_buffer((char*)salt, RSA_PSS_SALT_SIZE);
+
+    /* EM = DB ^ MGF(H) || H || 0xbc, leading emlen * 8 - embits bits zeroed */
+    rsa_pss_hash(&EM[dblen], hash, salt);
+    rsa_mgf1_xor(EM, dblen, &EM[dblen], hlen);
+    EM[0] &= (byte)(0xffu >> (8 * emlen - embits));
+    EM[emlen - 1] = 0xbc;
+
+    return RSA_OK;
+}
+
+static void rsa_pss_hash(byte* H, const byte* hash, const byte* salt)
+{
+    static const byte ZEROS[8] = {0};
+    struct sha256_t   S;
+
+    sha256_init(&S);
+    sha256_update(&S, ZEROS, 8);
+    sha256_update(&S, hash, SHA256_DIGEST_SIZE);
+    sha256_update(&S, salt, RSA_PSS_SALT_SIZE);
+    sha256_final(&S, H);
+}
+
+static void
+rsa_mgf1_xor(byte* dst, int len, const byte* seed, int seed_len)
+{
+    struct sha256_t S;
+    byte            T[SHA256_DIGEST_SIZE];
+    byte            C[4];
+    uint32_t        counter;
+    int             i;
+    int             j;
+
+    for (counter = 0, i = 0; i < len; ++counter)
+    {
+        C[0] = (byte)(counter >> 24);
+        C[1] = (byte)(counter >> 16);
+        C[2] = (byte)(counter >> 8);
+        C[3] = (byte)counter;
+
+        sha256_init(&S);
+        sha256_update(&S, seed, (size_t)seed_len);
+        sha256_update(&S, C, 4);
+        sha256_final(&S, T);
+
+        for (j = 0; j < SHA256_DIGEST_SIZE && i < len; ++j, ++i)
+            dst[i] ^= T[j];
+    }
+}
+
+static unsigned int rsa_ct_eq(unsigned int a, unsigned int b)
+{
+    unsigned int x = a ^ b;
+
+    /* x | -x has the top bit set unless x is zero */
+    return ((x | (0u - x)) >> (sizeof(unsigned int) * 8 - 1)) - 1u;
+}
+
+static unsigned int rsa_ct_lt(unsigned int a, unsigned int b)
+{
+    /* Borrow of a - b, for a and b less than 2^31 */
+    return 0u - ((a - b) >> (sizeof(unsigned int) * 8 - 1));
 }
 
 static void rsa_phi(bigint_p DST, bigint_p p, bigint_p q)
@@ -233,12 +1310,266 @@ static int rsa_key_import_join(rsa_key_p DST, rsa_key_p pub, rsa_key_p priv)
 
     bigint_copy(&DST->n, &pub->n);
     bigint_copy(&DST->e, &pub->e);
-    bigint_copy(&DST->d, &pub->d);
+    bigint_copy(&DST->d, &priv->d);
+    bigint_copy(&DST->p, &priv->p);
+    bigint_copy(&DST->q, &priv->q);
     DST->bit_length = pub->bit_length;
 
     return RSA_OK;
 }
 
+static void
+rsa_n_exp_dump_bin(FILE* fp, bigint_p n, bigint_p e, int bit_length)
+{
+    byte buf[BIGINT_MAX];
+    int  len;
+
+    fwrite(RSA_BIN_MAGIC, 1, 4, fp);
+    rsa_put_u32(fp, (uint32_t)bit_length);
+
+    len = bigint_export_bytes(buf, n);
+    rsa_put_u32(fp, (uint32_t)len);
+    fwrite(buf, 1, (size_t)len, fp);
+
+    len = bigint_export_bytes(buf, e);
+    rsa_put_u32(fp, (uint32_t)len);
+    fwrite(buf, 1, (size_t)len, fp);
+}
+
+static int rsa_n_exp_import_bin(FILE* fp, rsa_key_p K, bigint_p E)
+{
+    byte     buf[BIGINT_MAX];
+    uint32_t n;
+    int      res;
+
+    if (fread(buf, 1, 4, fp) != 4 || memcmp(buf, RSA_BIN_MAGIC, 4) != 0)
+        return RSA_ERR_MALFORMED_KEY;
+
+    if (!rsa_get_u32(fp, &n))
+        return RSA_ERR_MALFORMED_KEY;
+
+    K->bit_length = (int)n;
+    res           = rsa_key_bit_length_supported(K->bit_length);
+    if (res != RSA_OK)
+        return res;
+
+    if (!rsa_get_u32(fp, &n) || n > BIGINT_MAX)
+        return RSA_ERR_N_IMPORT_FAILED;
+    if (fread(buf, 1, n, fp) != n)
+        return RSA_ERR_MALFORMED_KEY;
+    bigint_import_bytes(&K->n, buf, (int)n);
+
+    if (!rsa_get_u32(fp, &n) || n > BIGINT_MAX)
+        return RSA_ERR_EXP_IMPORT_FAILED;
+    if (fread(buf, 1, n, fp) != n)
+        return RSA_ERR_MALFORMED_KEY;
+    bigint_import_bytes(E, buf, (int)n);
+
+    return RSA_OK;
+}
+
+static void rsa_put_u32(FILE* fp, uint32_t n)
+{
+    byte buf[4];
+
+    buf[0] = (byte)(n >> 24 & 0xff);
+    buf[1] = (byte)(n >> 16 & 0xff);
+    buf[2] = (byte)(n >> 8 & 0xff);
+    buf[3] = (byte)(n & 0xff);
+
+    fwrite(buf, 1, 4, fp);
+}
+
+static int rsa_get_u32(FILE* fp, uint32_t* n)
+{
+    byte buf[4];
+
+    if (fread(buf, 1, 4, fp) != 4)
+        return 0;
+
+    *n = (uint32_t)buf[0] << 24 | (uint32_t)buf[1] << 16 |
+         (uint32_t)buf[2] << 8 | (uint32_t)buf[3];
+
+    return 1;
+}
+
+static int rsa_der_dump(FILE* fp, rsa_key_p K, int priv)
+{
+    byte            body[RSA_DER_MAX];
+    byte            header[4];
+    int             body_len   = 0;
+    int             header_len = 1;
+    struct bigint_t T;
+    struct bigint_t M;
+    struct bigint_t GCD;
+
+    if (!priv)
+    {
+        /* RSAPublicKey ::= SEQUENCE { modulus, publicExponent } */
+        rsa_der_put_int(body, &body_len, &K->n);
+        rsa_der_put_int(body, &body_len, &K->e);
+    }
+    else
+    {
+        if (bigint_iszero(&K->p) || bigint_iszero(&K->q))
+            return RSA_ERR_DER_NO_PRIMES;
+
+        /* RSAPrivateKey ::= SEQUENCE { version (0), modulus, publicExponent,
+         * privateExponent, prime1, prime2, exponent1, exponent2, coefficient }
+         */
+        bigint_init(&T);
+        rsa_der_put_int(body, &body_len, &T);
+        rsa_der_put_int(body, &body_len, &K->n);
+        rsa_der_put_int(body, &body_len, &K->e);
+        rsa_der_put_int(body, &body_len, &K->d);
+        rsa_der_put_int(body, &body_len, &K->p);
+        rsa_der_put_int(body, &body_len, &K->q);
+
+        /* d mod (p - 1) */
+        bigint_sub_int(&M, &K->p, 1);
+        bigint_mod(&T, &K->d, &M);
+        rsa_der_put_int(body, &body_len, &T);
+
+        /* d mod (q - 1) */
+        bigint_sub_int(&M, &K->q, 1);
+        bigint_mod(&T, &K->d, &M);
+        rsa_der_put_int(body, &body_len, &T);
+
+        /* q^-1 mod p */
+        bigint_mod(&M, &K->q, &K->p);
+        bigint_eec(&GCD, &T, &M, &K->p);
+        rsa_der_put_int(body, &body_len, &T);
+    }
+
+    header[0] = 0x30; /* SEQUENCE */
+    rsa_der_put_len(header, &header_len, body_len);
+
+    fwrite(header, 1, (size_t)header_len, fp);
+    fwrite(body, 1, (size_t)body_len, fp);
+
+    return RSA_OK;
+}
+
+static int rsa_der_import(FILE* fp, rsa_key_p K, int priv)
+{
+    byte            buf[RSA_DER_MAX];
+    int             size;
+    int             pos = 0;
+    int             ok;
+    struct bigint_t version;
+
+    size = (int)fread(buf, 1, sizeof(buf), fp);
+
+    if (rsa_der_get_header(buf, size, &pos, 0x30) < 0)
+        return RSA_ERR_MALFORMED_KEY;
+
+    if (priv)
+    {
+        ok = rsa_der_get_int(buf, size, &pos, &version) &&
+             bigint_iszero(&version) &&
+             rsa_der_get_int(buf, size, &pos, &K->n) &&
+             rsa_der_get_int(buf, size, &pos, &K->e) &&
+             rsa_der_get_int(buf, size, &pos, &K->d) &&
+             rsa_der_get_int(buf, size, &pos, &K->p) &&
+             rsa_der_get_int(buf, size, &pos, &K->q);
+    }
+    else
+    {
+        ok = rsa_der_get_int(buf, size, &pos, &K->n) &&
+             rsa_der_get_int(buf, size, &pos, &K->e);
+    }
+
+    if (!ok)
+        return RSA_ERR_MALFORMED_KEY;
+
+    K->bit_length = K->n.max_digit2 + 1;
+
+    return rsa_key_bit_length_supported(K->bit_length);
+}
+
+static void rsa_der_put_len(byte* buf, int* pos, int len)
+{
+    /* Short form up to 127, long form otherwise */
+    if (len >= 256)
+    {
+        buf[(*pos)++] = 0x82;
+        buf[(*pos)++] = (byte)(len >> 8 & 0xff);
+    }
+    else if (len >= 128)
+    {
+        buf[(*pos)++] = 0x81;
+    }
+
+    buf[(*pos)++] = (byte)(len & 0xff);
+}
+
+static void rsa_der_put_int(byte* buf, int* pos, bigint_p N)
+{
+    byte content[BIGINT_MAX + 1];
+    int  start;
+    int  len;
+
+    /* A leading zero keeps the most significant bit clear, for INTEGERs are
+     * signed; zero itself is a single zero byte */
+    content[0] = 0;
+    len        = bigint_export_bytes(&content[1], N);
+    start      = len == 0 || content[1] & 0x80 ? 0 : 1;
+    len        = len + 1 - start;
+
+    buf[(*pos)++] = 0x02; /* INTEGER */
+    rsa_der_put_len(buf, pos, len);
+
+    memcpy(&buf[*pos], &content[start], (size_t)len);
+    *pos += len;
+}
+
+static int rsa_der_get_header(byte* buf, int size, int* pos, int tag)
+{
+    int len;
+    int n;
+
+    if (*pos + 2 > size || buf[*pos] != tag)
+        return -1;
+
+    len = buf[*pos + 1];
+    *pos += 2;
+
+    /* Long form: 0x80 | number of length bytes (at most 2 here) */
+    if (len & 0x80)
+    {
+        n = len & 0x7f;
+        if (n < 1 || n > 2 || *pos + n > size)
+            return -1;
+
+        for (len = 0; n > 0; --n)
+            len = len * 256 + buf[(*pos)++];
+    }
+
+    if (len > size - *pos)
+        return -1;
+
+    return len;
+}
+
+static int rsa_der_get_int(byte* buf, int size, int* pos, bigint_p N)
+{
+    int len;
+    int start;
+
+    len = rsa_der_get_header(buf, size, pos, 0x02);
+    if (len < 1 || buf[*pos] & 0x80)
+        return 0;
+
+    start = *pos;
+    *pos += len;
+
+    /* Leading zeros */
+    for (; len > 1 && buf[start] == 0; ++start, --len)
+        ;
+
+    return bigint_import_bytes(N, &buf[start], len);
+}
+
 /* EXTERN */
 int rsa_key_bit_length_supported(int bit_length)
 {
@@ -263,6 +1594,16 @@ int rsa_key_bit_length_supported(int bit_length)
 }
 
 int rsa_key_generate(rsa_key_p FK, int bit_length)
+{
+    return rsa_key_generate_exp(FK, bit_length, RSA_EXP_RANDOM);
+}
+
+int rsa_key_generate_exp(rsa_key_p FK, int bit_length, int exp)
+{
+    return rsa_key_generate_mt(FK, bit_length, exp, 1);
+}
+
+int rsa_key_generate_mt(rsa_key_p FK, int bit_length, int exp, int threads)
 {
     int                 err;
     struct rsa_keygen_t keygen;
@@ -270,65 +1611,155 @@ int rsa_key_generate(rsa_key_p FK, int bit_length)
     err = rsa_key_bit_length_supported(bit_length);
     RETERR(err);
 
-    rsa_get_prime(&keygen.p, (bit_length / 2) / 8);
-    rsa_get_prime(&keygen.q, (bit_length / 2) / 8);
+    if (exp != RSA_EXP_RANDOM && (exp < 3 || exp % 2 == 0))
+        return RSA_ERR_INVALID_EXP;
+
+    rsa_key_init(&keygen.K);
+
+    /* With a fixed exponent, p and q are retried rather than e */
+    if (exp != RSA_EXP_RANDOM)
+        bigint_init_by_int(&keygen.K.e, exp);
+
+    if (threads > 1)
+    {
+        rsa_prime_search(&keygen, (bit_length / 2) / 8, threads);
+    }
+    else if (exp == RSA_EXP_RANDOM)
+    {
+        rsa_get_prime(&keygen.p, (bit_length / 2) / 8, NULL);
+        rsa_get_prime(&keygen.q, (bit_length / 2) / 8, NULL);
+    }
+    else
+    {
+        rsa_get_prime_coprime(
+            &keygen.p, (bit_length / 2) / 8, &keygen.K.e, NULL
+        );
+        rsa_get_prime_coprime(
+            &keygen.q, (bit_length / 2) / 8, &keygen.K.e, NULL
+        );
+    }
 
     bigint_mul(&keygen.K.n, &keygen.p, &keygen.q);
     rsa_phi(&keygen.phi_n, &keygen.p, &keygen.q);
-    rsa_select_exp(&keygen);
 
+    if (exp == RSA_EXP_RANDOM)
+        rsa_select_exp(&keygen);
+    else
+        rsa_invert_exp(&keygen);
+
+    bigint_copy(&keygen.K.p, &keygen.p);
+    bigint_copy(&keygen.K.q, &keygen.q);
     keygen.K.bit_length = bit_length;
     rsa_key_copy(FK, &keygen.K);
 
     return RSA_OK;
 }
 
+int rsa_prime_generate(bigint_p N, int bit_length)
+{
+    if (bit_length > 8 * BIGINT_MAX)
+        return RSA_ERR_OVERFLOW_SIZE;
+
+    if (bit_length < 16 || bit_length % 8 != 0)
+        return RSA_ERR_UNSUPPORTED_SIZE;
+
+    rsa_get_prime(N, bit_length / 8, NULL);
+
+    return RSA_OK;
+}
+
 void rsa_key_copy(rsa_key_p DST, rsa_key_p SRC)
 {
     memcpy(DST, SRC, sizeof(struct rsa_key_t));
 }
 
 int rsa_key_import(rsa_key_p FK, FILE* pub, FILE* priv)
+{
+    return rsa_key_import_fmt(FK, pub, priv, RSA_FMT_HEX);
+}
+
+int rsa_key_import_fmt(rsa_key_p FK, FILE* pub, FILE* priv, int fmt)
 {
     struct rsa_key_t pubK;
     struct rsa_key_t privK;
     int              res = RSA_OK;
 
     rsa_key_init(FK);
+    rsa_key_init(&pubK);
+    rsa_key_init(&privK);
 
     if (pub != NULL)
     {
-        if (priv == NULL)
-            /* Full - public only */
-            res = rsa_n_exp_import(pub, FK, &FK->e);
-        else
-            /* Partial - public part here */
+        if (fmt == RSA_FMT_HEX)
             res = rsa_n_exp_import(pub, &pubK, &pubK.e);
+        else if (fmt == RSA_FMT_BIN)
+            res = rsa_n_exp_import_bin(pub, &pubK, &pubK.e);
+        else if (fmt == RSA_FMT_DER)
+            res = rsa_der_import(pub, &pubK, 0);
+        else
+            res = RSA_ERR_INVALID_FMT;
     }
 
     if (res == RSA_OK && priv != NULL)
     {
-        if (pub == NULL)
-            /* Full - private only */
-            res = rsa_n_exp_import(priv, FK, &FK->d);
-        else
-            /* Partial - private here */
+        if (fmt == RSA_FMT_HEX)
             res = rsa_n_exp_import(priv, &privK, &privK.d);
+        else if (fmt == RSA_FMT_BIN)
+            res = rsa_n_exp_import_bin(priv, &privK, &privK.d);
+        else if (fmt == RSA_FMT_DER)
+            res = rsa_der_import(priv, &privK, 1);
+        else
+            res = RSA_ERR_INVALID_FMT;
     }
 
+    RETERR(res);
+
     /* Join is done only if both the private and public keys are read */
-    if (res == RSA_OK && pub != NULL && priv != NULL)
-        res = rsa_key_import_join(FK, &pubK, &privK);
+    if (pub != NULL && priv != NULL)
+        return rsa_key_import_join(FK, &pubK, &privK);
 
-    return res;
+    if (pub != NULL)
+        rsa_key_copy(FK, &pubK);
+    else if (priv != NULL)
+        rsa_key_copy(FK, &privK);
+
+    return RSA_OK;
 }
 
 void rsa_key_dump(rsa_key_p FK, FILE* pub, FILE* priv)
 {
-    if (pub != NULL)
-        rsa_n_exp_dump(pub, &FK->n, &FK->e, FK->bit_length);
-    if (priv != NULL)
-        rsa_n_exp_dump(priv, &FK->n, &FK->d, FK->bit_length);
+    rsa_key_dump_fmt(FK, pub, priv, RSA_FMT_HEX);
+}
+
+int rsa_key_dump_fmt(rsa_key_p FK, FILE* pub, FILE* priv, int fmt)
+{
+    int res = RSA_OK;
+
+    switch (fmt)
+    {
+    case RSA_FMT_HEX:
+        if (pub != NULL)
+            rsa_n_exp_dump(pub, &FK->n, &FK->e, FK->bit_length);
+        if (priv != NULL)
+            rsa_n_exp_dump(priv, &FK->n, &FK->d, FK->bit_length);
+        break;
+    case RSA_FMT_BIN:
+        if (pub != NULL)
+            rsa_n_exp_dump_bin(pub, &FK->n, &FK->e, FK->bit_length);
+        if (priv != NULL)
+            rsa_n_exp_dump_bin(priv, &FK->n, &FK->d, FK->bit_length);
+        break;
+    case RSA_FMT_DER:
+        if (pub != NULL)
+            res = rsa_der_dump(pub, FK, 0);
+        if (res == RSA_OK && priv != NULL)
+            res = rsa_der_dump(priv, FK, 1);
+        break;
+    default:
+        res = RSA_ERR_INVALID_FMT;
+    }
+
+    return res;
 }
 
 int rsa_key_ispub(rsa_key_p K) { return !bigint_iszero(&K->e); }
@@ -357,17 +1788,396 @@ void rsa_encrypt(bigint_p DST, bigint_p B, rsa_key_p K)
     bigint_exp_mod(DST, B, &K->e, &K->n);
 }
 
-void rsa_decrypt(bigint_p DST, bigint_p B, rsa_key_p K)
+int rsa_decrypt(bigint_p DST, bigint_p B, rsa_key_p K)
 {
-    bigint_exp_mod(DST, B, &K->d, &K->n);
+    struct rsa_key_ctx_t C;
+    int                  res = rsa_key_ctx_get(&C, K);
+
+    /* No context (no e, n even, or key not consistent): no blinding either,
+     * the operation is refused rather than done in variable time */
+    if (res != RSA_OK)
+        return res;
+
+    rsa_ctx_decrypt(DST, B, &C);
+
+    return RSA_OK;
 }
 
-void rsa_sign(bigint_p DST, bigint_p B, rsa_key_p K)
+int rsa_sign(bigint_p DST, bigint_p B, rsa_key_p K)
 {
-    bigint_exp_mod(DST, B, &K->d, &K->n);
+    return rsa_decrypt(DST, B, K);
 }
 
 void rsa_decrypt_signed(bigint_p DST, bigint_p B, rsa_key_p K)
 {
     bigint_exp_mod(DST, B, &K->e, &K->n);
 }
+
+int rsa_encrypt_batch(
+    bigint_p DST, bigint_p B, int count, rsa_key_p K, int threads
+)
+{
+    return rsa_batch_run(DST, B, count, &K->e, K, threads);
+}
+
+int rsa_decrypt_signed_batch(
+    bigint_p DST, bigint_p B, int count, rsa_key_p K, int threads
+)
+{
+    return rsa_batch_run(DST, B, count, &K->e, K, threads);
+}
+
+uint32_t rsa_key_fingerprint(rsa_key_p K)
+{
+    bigint_p parts[4];
+    uint32_t h = 2166136261u;
+    int      i;
+    int      j;
+
+    parts[0] = &K->n;
+    parts[1] = &K->e;
+    parts[2] = &K->d;
+    parts[3] = &K->p;
+
+    for (i = 0; i < 4; ++i)
+        for (j = 0; j <= parts[i]->max_exp; ++j)
+        {
+            h ^= parts[i]->num[j];
+            h *= 16777619u;
+        }
+
+    return h;
+}
+
+int rsa_key_ctx_init(rsa_key_ctx_p C, rsa_key_p K)
+{
+    struct bigint_t pm1;
+    struct bigint_t qm1;
+
+    memset(C, 0, sizeof(struct rsa_key_ctx_t));
+    rsa_key_copy(&C->K, K);
+    C->fingerprint = rsa_key_fingerprint(K);
+
+    if (!bigint_mont_init(&C->N, &K->n))
+        return RSA_ERR_INVALID_N;
+
+    if (!rsa_key_ispriv(K))
+        return RSA_OK;
+
+    C->crt = !bigint_iszero(&K->p) && !bigint_iszero(&K->q) &&
+             bigint_mont_init(&C->P, &K->p) && bigint_mont_init(&C->Q, &K->q);
+    if (C->crt)
+    {
+        bigint_sub_int(&pm1, &K->p, 1);
+        bigint_sub_int(&qm1, &K->q, 1);
+        bigint_mod(&C->dp, &K->d, &pm1);
+        bigint_mod(&C->dq, &K->d, &qm1);
+
+        /* p is prime: q^-1 = q^(p - 2) mod p */
+        bigint_sub_int(&pm1, &K->p, 2);
+        rsa_exp_ct(&C->qinv, &K->q, &pm1, C->P.M.max_digit2 + 1, &C->P);
+    }
+
+    return rsa_blinding_init(C);
+}
+
+int rsa_key_ctx_get(rsa_key_ctx_p C, rsa_key_p K)
+{
+    uint32_t fingerprint = rsa_key_fingerprint(K);
+    int      i;
+    int      res;
+    double   start;
+
+    pthread_mutex_lock(&rsa_key_cache_lock);
+
+    i = rsa_key_cache_find(K, fingerprint);
+    if (i >= 0)
+    {
+        memcpy(C, &RSA_KEY_CACHE.ctx[i], sizeof(struct rsa_key_ctx_t));
+        if (rsa_key_ispriv(&C->K))
+            rsa_blinding_update(&RSA_KEY_CACHE.ctx[i]);
+        RSA_KEY_CACHE.last_use[i] = ++RSA_KEY_CACHE.clock;
+        ++RSA_KEY_CACHE.stats.hits;
+        pthread_mutex_unlock(&rsa_key_cache_lock);
+        return RSA_OK;
+    }
+
+    ++RSA_KEY_CACHE.stats.misses;
+    pthread_mutex_unlock(&rsa_key_cache_lock);
+
+    /* Built without holding the lock, lookups of other keys need not wait */
+    start = rsa_now();
+    res   = rsa_key_ctx_init(C, K);
+
+    pthread_mutex_lock(&rsa_key_cache_lock);
+    RSA_KEY_CACHE.stats.build_seconds += rsa_now() - start;
+    if (res == RSA_OK)
+        rsa_key_cache_put(C);
+    pthread_mutex_unlock(&rsa_key_cache_lock);
+
+    return res;
+}
+
+void rsa_key_cache_stats(rsa_key_cache_stats_p S)
+{
+    pthread_mutex_lock(&rsa_key_cache_lock);
+    memcpy(S, &RSA_KEY_CACHE.stats, sizeof(struct rsa_key_cache_stats_t));
+    pthread_mutex_unlock(&rsa_key_cache_lock);
+}
+
+void rsa_key_cache_clear(void)
+{
+    pthread_mutex_lock(&rsa_key_cache_lock);
+    memset(&RSA_KEY_CACHE, 0, sizeof(struct rsa_key_cache_t));
+    pthread_mutex_unlock(&rsa_key_cache_lock);
+}
+
+void rsa_ctx_encrypt(bigint_p DST, bigint_p B, rsa_key_ctx_p C)
+{
+    bigint_mont_exp(DST, B, &C->K.e, &C->N);
+}
+
+void rsa_ctx_decrypt(bigint_p DST, bigint_p B, rsa_key_ctx_p C)
+{
+    struct bigint_t T;
+
+    /* Plain B * r^e, as one of the two is in Montgomery representation */
+    bigint_mont_mod(&T, B, &C->N);
+    bigint_mont_mul(&T, &T, &C->blind, &C->N);
+
+    rsa_ctx_private(&T, &T, C);
+
+    bigint_mont_mul(DST, &T, &C->unblind, &C->N);
+    rsa_blinding_update(C);
+}
+
+void rsa_ctx_sign(bigint_p DST, bigint_p B, rsa_key_ctx_p C)
+{
+    rsa_ctx_decrypt(DST, B, C);
+}
+
+void rsa_ctx_decrypt_signed(bigint_p DST, bigint_p B, rsa_key_ctx_p C)
+{
+    rsa_ctx_encrypt(DST, B, C);
+}
+
+int rsa_key_size(rsa_key_p K) { return (K->n.max_digit2 + 8) / 8; }
+
+int rsa_encrypt_pkcs1(byte* dst, const byte* msg, int len, rsa_key_p K)
+{
+    int k = rsa_key_size(K);
+    int i;
+
+    if (len < 0 || len > k - 11)
+        return RSA_ERR_MSG_TOO_LONG;
+
+    /* EM = 0x00 || 0x02 || PS || 0x00 || M, PS being random non-zero bytes */
+    dst[0] = 0x00;
+    dst[1] = 0x02;
+
+    random_get_buffer((char*)&dst[2], (size_t)(k - len - 3));
+    for (i = 2; i < k - len - 1; ++i)
+        while (dst[i] == 0)
+            random_get_buffer((char*)&dst[i], 1);
+
+    dst[k - len - 1] = 0x00;
+    memcpy(&dst[k - len], msg, (size_t)len);
+
+    return rsa_bytes_op(dst, dst, K, 0);
+}
+
+int rsa_decrypt_pkcs1(byte* dst, int* len, const byte* src, rsa_key_p K)
+{
+    byte         EM[BIGINT_MAX];
+    int          k = rsa_key_size(K);
+    int          i;
+    unsigned int good;
+    unsigned int looking = ~0u; /* Separator not found yet */
+    unsigned int zero;
+    unsigned int index = 0;
+
+    if (!rsa_key_ispub(K))
+        return RSA_ERR_NO_PUBLIC_EXP;
+
+    if (k < 11 || rsa_bytes_op(EM, src, K, 1) != RSA_OK)
+        return RSA_ERR_DECRYPTION;
+
+    good = rsa_ct_eq(EM[0], 0x00) & rsa_ct_eq(EM[1], 0x02);
+
+    /* The first zero after 0x02 is the separator; the scan goes on anyway */
+    for (i = 2; i < k; ++i)
+    {
+        zero = rsa_ct_eq(EM[i], 0x00);
+        index |= (unsigned int)i & looking & zero;
+        looking &= ~zero;
+    }
+
+    /* At least 8 bytes of padding */
+    good &= ~looking & ~rsa_ct_lt(index, 10);
+
+    if (!good)
+        return RSA_ERR_DECRYPTION;
+
+    *len = k - (int)index - 1;
+    memcpy(dst, &EM[index + 1], (size_t)*len);
+
+    return RSA_OK;
+}
+
+int rsa_encrypt_oaep(
+    byte*       dst,
+    const byte* msg,
+    int         len,
+    const byte* label,
+    int         label_len,
+    rsa_key_p   K
+)
+{
+    int   k     = rsa_key_size(K);
+    int   hlen  = SHA256_DIGEST_SIZE;
+    byte* seed  = &dst[1];
+    byte* DB    = &dst[1 + hlen];
+    int   dblen = k - hlen - 1;
+
+    if (len < 0 || len > k - 2 * hlen - 2)
+        return RSA_ERR_MSG_TOO_LONG;
+
+    /* DB = lHash || PS || 0x01 || M, PS being zeros */
+    sha256(DB, label, (size_t)label_len);
+    memset(&DB[hlen], 0, (size_t)(dblen - len - 1 - hlen));
+    DB[dblen - len - 1] = 0x01;
+    memcpy(&DB[dblen - len], msg, (size_t)len);
+
+    /* EM = 0x00 || seed ^ MGF(DB ^ MGF(seed)) || DB ^ MGF(seed) */
+    random_get_buffer((char*)seed, (size_t)hlen);
+    rsa_mgf1_xor(DB, dblen, seed, hlen);
+    rsa_mgf1_xor(seed, hlen, DB, dblen);
+    dst[0] = 0x00;
+
+    return rsa_bytes_op(dst, dst, K, 0);
+}
+
+int rsa_decrypt_oaep(
+    byte*       dst,
+    int*        len,
+    const byte* src,
+    const byte* label,
+    int         label_len,
+    rsa_key_p   K
+)
+{
+    byte         EM[BIGINT_MAX];
+    byte         lhash[SHA256_DIGEST_SIZE];
+    int          k     = rsa_key_size(K);
+    int          hlen  = SHA256_DIGEST_SIZE;
+    byte*        seed  = &EM[1];
+    byte*        DB    = &EM[1 + hlen];
+    int          dblen = k - hlen - 1;
+    int          i;
+    unsigned int good;
+    unsigned int looking = ~0u; /* Separator not found yet */
+    unsigned int one;
+    unsigned int index = 0;
+
+    if (!rsa_key_ispub(K))
+        return RSA_ERR_NO_PUBLIC_EXP;
+
+    if (k < 2 * hlen + 2 || rsa_bytes_op(EM, src, K, 1) != RSA_OK)
+        return RSA_ERR_DECRYPTION;
+
+    rsa_mgf1_xor(seed, hlen, DB, dblen);
+    rsa_mgf1_xor(DB, dblen, seed, hlen);
+
+    sha256(lhash, label, (size_t)label_len);
+
+    good = rsa_ct_eq(EM[0], 0x00);
+    for (i = 0; i < hlen; ++i)
+        good &= rsa_ct_eq(DB[i], lhash[i]);
+
+    /* PS is zeros up to the first 0x01; anything else before it is an error.
+     * The scan goes on anyway */
+    for (i = hlen; i < dblen; ++i)
+    {
+        one = rsa_ct_eq(DB[i], 0x01);
+        index |= (unsigned int)i & looking & one;
+        good &= ~looking | one | rsa_ct_eq(DB[i], 0x00);
+        looking &= ~one;
+    }
+
+    good &= ~looking;
+
+    if (!good)
+        return RSA_ERR_DECRYPTION;
+
+    *len = dblen - (int)index - 1;
+    memcpy(dst, &DB[index + 1], (size_t)*len);
+
+    return RSA_OK;
+}
+
+int rsa_sign_pss(byte* dst, const byte* hash, rsa_key_p K)
+{
+    int res = rsa_pss_encode(dst, hash, K);
+
+    if (res != RSA_OK)
+        return res;
+
+    return rsa_bytes_op(dst, dst, K, 1);
+}
+
+int rsa_ctx_sign_pss(byte* dst, const byte* hash, rsa_key_ctx_p C)
+{
+    struct bigint_t B;
+    int             k   = rsa_key_size(&C->K);
+    int             res = rsa_pss_encode(dst, hash, &C->K);
+
+    if (res != RSA_OK)
+        return res;
+
+    bigint_import_bytes(&B, dst, k);
+    rsa_ctx_sign(&B, &B, C);
+    rsa_export_padded(dst, &B, k);
+
+    return RSA_OK;
+}
+
+int rsa_verify_pss(const byte* sig, const byte* hash, rsa_key_p K)
+{
+    byte  T[BIGINT_MAX];
+    byte  H[SHA256_DIGEST_SIZE];
+    int   k      = rsa_key_size(K);
+    int   embits = K->n.max_digit2;
+    int   emlen  = (embits + 7) / 8;
+    int   hlen   = SHA256_DIGEST_SIZE;
+    int   dblen  = emlen - hlen - 1;
+    byte* EM     = &T[k - emlen];
+    byte  mask   = (byte)(0xffu >> (8 * emlen - embits));
+    int   i;
+
+    /* Public data: no need for constant-time checks */
+    if (emlen < hlen + RSA_PSS_SALT_SIZE + 2 ||
+        rsa_bytes_op(T, sig, K, 0) != RSA_OK)
+        return RSA_ERR_SIGNATURE;
+
+    for (i = 0; i < k - emlen; ++i)
+        if (T[i] != 0)
+            return RSA_ERR_SIGNATURE;
+
+    if (EM[emlen - 1] != 0xbc || (EM[0] & ~mask) != 0)
+        return RSA_ERR_SIGNATURE;
+
+    rsa_mgf1_xor(EM, dblen, &EM[dblen], hlen);
+    EM[0] &= mask;
+
+    for (i = 0; i < dblen - RSA_PSS_SALT_SIZE - 1; ++i)
+        if (EM[i] != 0)
+            return RSA_ERR_SIGNATURE;
+
+    if (EM[dblen - RSA_PSS_SALT_SIZE - 1] != 0x01)
+        return RSA_ERR_SIGNATURE;
+
+    rsa_pss_hash(H, hash, &EM[dblen - RSA_PSS_SALT_SIZE]);
+
+    return memcmp(H, &EM[dblen], (size_t)hlen) == 0 ? RSA_OK
+                                                    : RSA_ERR_SIGNATURE;
+}
@@ -9,6 +9,44 @@
 #define PRIMALITY_S 10
 #endif
 
+/* How many small primes are used to sieve prime candidates */
+#ifndef RSA_SIEVE_PRIMES
+#define RSA_SIEVE_PRIMES 2048
+#endif
+
+/* Inputs taken at a time by each thread of a batch, see rsa_encrypt_batch */
+#ifndef RSA_BATCH_CHUNK
+#define RSA_BATCH_CHUNK 16
+#endif
+
+/* Exponentiations with secret exponents are constant-time (see
+ * bigint_mont_exp_ct): 0 -> fixed window, 1 -> Montgomery ladder */
+#ifndef RSA_CT_LADDER
+#define RSA_CT_LADDER 0
+#endif
+
+/* Key contexts kept by the process-wide cache, see rsa_key_ctx_get */
+#ifndef RSA_KEY_CACHE_SIZE
+#define RSA_KEY_CACHE_SIZE 16
+#endif
+
+/* Salt length of RSASSA-PSS signatures, see rsa_sign_pss */
+#ifndef RSA_PSS_SALT_SIZE
+#define RSA_PSS_SALT_SIZE 32
+#endif
+
+/* Public exponent selection, see rsa_key_generate_exp */
+#define RSA_EXP_RANDOM 0
+#define RSA_EXP_F4 65537
+
+/* Key file formats, see rsa_key_import_fmt */
+enum
+{
+    RSA_FMT_HEX = 0, /* Text: bit length, `n` and exponent in hex */
+    RSA_FMT_BIN,     /* Length-prefixed big-endian binary */
+    RSA_FMT_DER      /* PKCS#1 RSAPublicKey/RSAPrivateKey, DER encoded */
+};
+
 /* RSA ERROR ENUM */
 enum
 {
@@ -20,6 +58,16 @@ enum
     RSA_ERR_EXP_IMPORT_FAILED,
     RSA_ERR_IMPORT_JOIN_FAILED_BIT_LENGTH,
     RSA_ERR_IMPORT_JOIN_FAILED_N,
+    RSA_ERR_INVALID_EXP,
+    RSA_ERR_INVALID_N,
+    RSA_ERR_INVALID_FMT,
+    RSA_ERR_MALFORMED_KEY,
+    RSA_ERR_DER_NO_PRIMES,
+    RSA_ERR_BLINDING,
+    RSA_ERR_MSG_TOO_LONG,
+    RSA_ERR_DECRYPTION,
+    RSA_ERR_SIGNATURE,
+    RSA_ERR_NO_PUBLIC_EXP,
 
     __rsa_err_sentinel,
     RSA_ERR_CUSTOM
@@ -30,9 +78,42 @@ typedef struct rsa_key_t
     struct bigint_t n; /* p * q */
     struct bigint_t e; /* public exponent */
     struct bigint_t d; /* private exponent */
+    struct bigint_t p; /* prime factors of n, zero if unknown */
+    struct bigint_t q;
     int             bit_length;
 }* rsa_key_p;
 
+/* Everything derived from a key that its operations need, built once by
+ * rsa_key_ctx_init instead of at every operation. */
+typedef struct rsa_key_ctx_t
+{
+    struct rsa_key_t     K;
+    uint32_t             fingerprint; /* see rsa_key_fingerprint */
+    struct bigint_mont_t N;           /* Montgomery context of n */
+
+    /* CRT parameters of the private key, only if p and q are known */
+    int                  crt;
+    struct bigint_mont_t P;
+    struct bigint_mont_t Q;
+    struct bigint_t      dp;   /* d mod (p - 1) */
+    struct bigint_t      dq;   /* d mod (q - 1) */
+    struct bigint_t      qinv; /* q^-1 mod p */
+
+    /* Blinding pair of the private key operations, in Montgomery
+     * representation: r^e and r^-1 mod n */
+    struct bigint_t blind;
+    struct bigint_t unblind;
+}* rsa_key_ctx_p;
+
+/* Counters of the key context cache, see rsa_key_cache_stats */
+typedef struct rsa_key_cache_stats_t
+{
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long evictions;
+    double        build_seconds; /* Time spent building contexts on misses */
+}* rsa_key_cache_stats_p;
+
 /* Key generation is limited by the value of BIGINT_MAX and in any case to the
  * following bit lengths:
  * - 64 (if compiled with debug symbols);
@@ -48,6 +129,41 @@ typedef struct rsa_key_t
 extern int  rsa_key_generate(rsa_key_p FK, int bit_length);
 extern void rsa_key_copy(rsa_key_p DST, rsa_key_p SRC);
 
+/* Same as rsa_key_generate, but the public exponent is chosen by the caller:
+ * - RSA_EXP_RANDOM -> e is drawn at random, as rsa_key_generate does;
+ * - any odd exp >= 3 (typically RSA_EXP_F4) -> e = exp.
+ *
+ * With a fixed exponent, p and q are drawn again until gcd(e, p - 1) and
+ * gcd(e, q - 1) are 1, so that e is always invertible modulo phi(n). A small e
+ * makes rsa_encrypt and rsa_decrypt_signed much cheaper, for bigint_exp_mod
+ * cost is proportional to the bit length of the exponent.
+ *
+ * RETURN
+ * RSA ERROR ENUM
+ */
+extern int rsa_key_generate_exp(rsa_key_p FK, int bit_length, int exp);
+
+/* Same as rsa_key_generate_exp, but the prime search is spread over `threads`
+ * threads (the calling one included): each worker tests its own candidates,
+ * and p and q are the first two distinct primes found by any of them. Workers
+ * stop as soon as both are found.
+ *
+ * threads <= 1 -> same as rsa_key_generate_exp.
+ *
+ * RETURN
+ * RSA ERROR ENUM
+ */
+extern int
+rsa_key_generate_mt(rsa_key_p FK, int bit_length, int exp, int threads);
+
+/* Generate a random prime of exactly bit_length bits, as key generation does
+ * for p and q: bit_length must be a multiple of 8, in [16, 8 * BIGINT_MAX].
+ *
+ * RETURN
+ * RSA ERROR ENUM
+ */
+extern int rsa_prime_generate(bigint_p N, int bit_length);
+
 /* pub != NULL -> Public key is imported into it
  * priv != NULL -> Private key is imported into it
  *
@@ -67,6 +183,30 @@ extern int rsa_key_import(rsa_key_p FK, FILE* pub, FILE* priv);
  */
 extern void rsa_key_dump(rsa_key_p FK, FILE* pub, FILE* priv);
 
+/* Same as rsa_key_import, but files are in format fmt:
+ * - RSA_FMT_HEX -> same as rsa_key_import;
+ * - RSA_FMT_BIN -> for each of `n` and the exponent, a 4-byte big-endian length
+ *   followed by the big-endian number, after the "CMCK" magic and the 4-byte
+ *   big-endian key bit length;
+ * - RSA_FMT_DER -> PKCS#1 RSAPublicKey (pub) and RSAPrivateKey (priv). A
+ *   private key file also carries e, p and q, that are imported as well.
+ *
+ * Files are opened by the caller; binary formats need them in binary mode.
+ *
+ * RETURN
+ * RSA ERROR ENUM
+ */
+extern int rsa_key_import_fmt(rsa_key_p FK, FILE* pub, FILE* priv, int fmt);
+
+/* Same as rsa_key_dump, but files are written in format fmt (see
+ * rsa_key_import_fmt). A PKCS#1 private key needs p and q: keys generated by
+ * rsa_key_generate have them, keys imported from HEX or BIN files do not.
+ *
+ * RETURN
+ * RSA ERROR ENUM
+ */
+extern int rsa_key_dump_fmt(rsa_key_p FK, FILE* pub, FILE* priv, int fmt);
+
 extern int rsa_key_ispub(rsa_key_p K);
 extern int rsa_key_ispriv(rsa_key_p K);
 
@@ -78,15 +218,164 @@ extern int rsa_key_bit_length_supported(int size);
 /* Encript using public key */
 extern void rsa_encrypt(bigint_p DST, bigint_p B, rsa_key_p K);
 
-/* Decrypt using private key */
-extern void rsa_decrypt(bigint_p DST, bigint_p B, rsa_key_p K);
+/* Decrypt using private key. The operation runs on the context of K taken
+ * from the key context cache, see rsa_key_ctx_get and rsa_ctx_decrypt. If
+ * there is no context (e.g. K has no e, or is not consistent) the operation
+ * could not be blinded: it is refused and DST is left untouched.
+ *
+ * RETURN
+ * RSA ERROR ENUM, that of rsa_key_ctx_get
+ */
+extern int rsa_decrypt(bigint_p DST, bigint_p B, rsa_key_p K);
 
-/* Encrypt using private key */
-extern void rsa_sign(bigint_p DST, bigint_p B, rsa_key_p K);
+/* Encrypt using private key, same as rsa_decrypt */
+extern int rsa_sign(bigint_p DST, bigint_p B, rsa_key_p K);
 
 /* Decrypt using public key  */
 extern void rsa_decrypt_signed(bigint_p DST, bigint_p B, rsa_key_p K);
 
+/* Byte length of n, that is of ciphertexts and signatures */
+extern int rsa_key_size(rsa_key_p K);
+
+/* Encryption schemes of PKCS#1 (RFC 8017):
+ * - rsa_encrypt_pkcs1 -> RSAES-PKCS1-v1_5: msg is at most k - 11 bytes long,
+ *   where k is rsa_key_size(K);
+ * - rsa_encrypt_oaep -> RSAES-OAEP, with SHA-256 and MGF1 with SHA-256, and
+ *   the given label (NULL if label_len is 0): msg is at most k - 66 bytes
+ *   long. OAEP should be preferred for new uses.
+ *
+ * Both write k bytes into dst.
+ *
+ * RETURN
+ * RSA ERROR ENUM
+ */
+extern int rsa_encrypt_pkcs1(byte* dst, const byte* msg, int len, rsa_key_p K);
+extern int rsa_encrypt_oaep(
+    byte*       dst,
+    const byte* msg,
+    int         len,
+    const byte* label,
+    int         label_len,
+    rsa_key_p   K
+);
+
+/* Inverse of rsa_encrypt_pkcs1 and rsa_encrypt_oaep: src is k bytes long and
+ * the message is written into dst (k bytes at most), its length into len.
+ * Decryption is done by rsa_decrypt. Whatever the reason, a failure is
+ * always RSA_ERR_DECRYPTION, and padding checks do not branch on the data,
+ * so that failures tell an attacker as little as possible. The only
+ * exception is a key without e: RSA_ERR_NO_PUBLIC_EXP, nothing is decrypted.
+ *
+ * RETURN
+ * RSA ERROR ENUM
+ */
+extern int
+rsa_decrypt_pkcs1(byte* dst, int* len, const byte* src, rsa_key_p K);
+extern int rsa_decrypt_oaep(
+    byte*       dst,
+    int*        len,
+    const byte* src,
+    const byte* label,
+    int         label_len,
+    rsa_key_p   K
+);
+
+/* RSASSA-PSS (RFC 8017), with SHA-256, MGF1 with SHA-256 and a random salt
+ * RSA_PSS_SALT_SIZE bytes long. hash is the SHA-256 digest of the message
+ * rather than the message itself, so that a message of any size can be hashed
+ * a chunk at a time (see sha256_update) and signed with a single private key
+ * operation.
+ * - rsa_sign_pss -> writes the k-byte signature into dst, k being
+ *   rsa_key_size(K);
+ * - rsa_verify_pss -> checks the k-byte signature sig: RSA_OK if valid,
+ *   RSA_ERR_SIGNATURE otherwise.
+ *
+ * RETURN
+ * RSA ERROR ENUM
+ */
+extern int rsa_sign_pss(byte* dst, const byte* hash, rsa_key_p K);
+extern int rsa_verify_pss(const byte* sig, const byte* hash, rsa_key_p K);
+
+/* Batch versions of rsa_encrypt and rsa_decrypt_signed, that is of the public
+ * key operation (encryption, signature verification): DST[i] <- B[i]^e mod n,
+ * for 0 <= i < count. DST and B can be the same array.
+ *
+ * The Montgomery context of n is built once for the whole batch, instead of
+ * once per input, and the inputs are shared among `threads` threads (the
+ * calling one included), each taking RSA_BATCH_CHUNK inputs at a time.
+ *
+ * RETURN
+ * RSA ERROR ENUM
+ */
+extern int rsa_encrypt_batch(
+    bigint_p DST, bigint_p B, int count, rsa_key_p K, int threads
+);
+extern int rsa_decrypt_signed_batch(
+    bigint_p DST, bigint_p B, int count, rsa_key_p K, int threads
+);
+
+/* FNV-1a hash of n, e, d and p: keys with different fingerprints are
+ * different, the converse is only likely. */
+extern uint32_t rsa_key_fingerprint(rsa_key_p K);
+
+/* Build the context of K: Montgomery contexts of n and, if p and q are known,
+ * of p and q, along with the CRT exponents and coefficient. K is copied into
+ * C, hence it can be discarded afterwards.
+ *
+ * For a private key, the blinding pair is drawn as well: r is random and r^-1
+ * is r^(p - 2) mod p and r^(q - 2) mod q, joined by the CRT, or r^(ed - 2)
+ * mod n if p and q are unknown. Either costs about as much as a private key
+ * operation; RSA_ERR_BLINDING is returned if the result is not the inverse of
+ * r, as it happens with keys that are not consistent. A private key without
+ * e (e.g. imported from a HEX or BIN private key file alone) can not be
+ * blinded: RSA_ERR_NO_PUBLIC_EXP is returned, import the public key too.
+ *
+ * RETURN
+ * RSA ERROR ENUM
+ */
+extern int rsa_key_ctx_init(rsa_key_ctx_p C, rsa_key_p K);
+
+/* Same as rsa_key_ctx_init, but the context is looked up in a process-wide
+ * cache first (by fingerprint, then comparing the keys) and copied into C;
+ * on a miss it is built and added to the cache, evicting the least recently
+ * used context if the cache is full. The blinding pair of the cached context
+ * is squared at each lookup, so that no two copies start from the same one.
+ * Meant for services that import the same keys over and over (e.g. with
+ * rsa_key_import): only the first import of a key pays for its context.
+ * Thread safe.
+ *
+ * RETURN
+ * RSA ERROR ENUM
+ */
+extern int rsa_key_ctx_get(rsa_key_ctx_p C, rsa_key_p K);
+
+/* Cache counters since start (or since the last rsa_key_cache_clear) */
+extern void rsa_key_cache_stats(rsa_key_cache_stats_p S);
+
+/* Drop every cached context and reset the counters */
+extern void rsa_key_cache_clear(void);
+
+/* Same as rsa_encrypt, rsa_decrypt, rsa_sign and rsa_decrypt_signed, on a key
+ * context. Private key operations use the CRT when C->crt is set: two
+ * exponentiations with half-size exponents and moduli, about 3 times faster.
+ *
+ * Private key exponentiations are constant-time (see RSA_CT_LADDER), and
+ * blinded, so that the rest of the operation does not depend on the input:
+ * B^d = (B * r^e)^d * r^-1 mod n. The pair is then squared, that is (r^2)^e
+ * and (r^2)^-1, hence blinding costs four Montgomery multiplications per
+ * operation. As the pair changes, a context must not be used by more than a
+ * thread at a time.
+ */
+extern void rsa_ctx_encrypt(bigint_p DST, bigint_p B, rsa_key_ctx_p C);
+extern void rsa_ctx_decrypt(bigint_p DST, bigint_p B, rsa_key_ctx_p C);
+extern void rsa_ctx_sign(bigint_p DST, bigint_p B, rsa_key_ctx_p C);
+extern void rsa_ctx_decrypt_signed(bigint_p DST, bigint_p B, rsa_key_ctx_p C);
+
+/* Same as rsa_sign_pss, on a key context: signing many messages with the same
+ * key (see rsa_key_ctx_get) costs one private key operation per message, and
+ * nothing else. */
+extern int rsa_ctx_sign_pss(byte* dst, const byte* hash, rsa_key_ctx_p C);
+
 /* Do not free */
 extern const char* rsa_err(int code);
 
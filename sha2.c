@@ -0,0 +1,1092 @@
+#include <pthread.h>
+#include <string.h>
+
+#include "sha2.h"
+
+#if SHA2_X86
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+#define ROTR32(x, n) ((x) >> (n) | (x) << (32 - (n)))
+#define ROTR64(x, n) ((x) >> (n) | (x) << (64 - (n)))
+
+#define CH(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define MAJ(x, y, z) (((x) & (y)) | ((z) & ((x) | (y))))
+
+#define SHA256_S0(x) (ROTR32(x, 2) ^ ROTR32(x, 13) ^ ROTR32(x, 22))
+#define SHA256_S1(x) (ROTR32(x, 6) ^ ROTR32(x, 11) ^ ROTR32(x, 25))
+#define SHA256_s0(x) (ROTR32(x, 7) ^ ROTR32(x, 18) ^ (x) >> 3)
+#define SHA256_s1(x) (ROTR32(x, 17) ^ ROTR32(x, 19) ^ (x) >> 10)
+
+#define SHA512_S0(x) (ROTR64(x, 28) ^ ROTR64(x, 34) ^ ROTR64(x, 39))
+#define SHA512_S1(x) (ROTR64(x, 14) ^ ROTR64(x, 18) ^ ROTR64(x, 41))
+#define SHA512_s0(x) (ROTR64(x, 1) ^ ROTR64(x, 8) ^ (x) >> 7)
+#define SHA512_s1(x) (ROTR64(x, 19) ^ ROTR64(x, 61) ^ (x) >> 6)
+
+/* Round t + i: rather than shifting the working variables at each round, the
+ * caller names them in a different order (d and h are the ones updated) */
+#define SHA256_ROUND(a, b, c, d, e, f, g, h, i)                                \
+    T1 = (h) + SHA256_S1(e) + CH(e, f, g) + SHA256_K[t + (i)] + W[t + (i)];    \
+    (d) += T1;                                                                 \
+    (h) = T1 + SHA256_S0(a) + MAJ(a, b, c)
+
+#define SHA512_ROUND(a, b, c, d, e, f, g, h, i)                                \
+    T1 = (h) + SHA512_S1(e) + CH(e, f, g) + SHA512_K[t + (i)] + W[t + (i)];    \
+    (d) += T1;                                                                 \
+    (h) = T1 + SHA512_S0(a) + MAJ(a, b, c)
+
+/* 64-bit constant from its 32-bit halves: C89 has no 64-bit literals */
+#define SHA512_C(hi, lo) ((uint64_t)(hi) << 32 | (uint64_t)(lo))
+
+static const uint32_t SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static const uint32_t SHA256_H0[8] = {
+    0x6a09e667,
+    0xbb67ae85,
+    0x3c6ef372,
+    0xa54ff53a,
+    0x510e527f,
+    0x9b05688c,
+    0x1f83d9ab,
+    0x5be0cd19
+};
+
+static const uint64_t SHA512_K[80] = {
+    SHA512_C(0x428a2f98, 0xd728ae22),
+    SHA512_C(0x71374491, 0x23ef65cd),
+    SHA512_C(0xb5c0fbcf, 0xec4d3b2f),
+    SHA512_C(0xe9b5dba5, 0x8189dbbc),
+    SHA512_C(0x3956c25b, 0xf348b538),
+    SHA512_C(0x59f111f1, 0xb605d019),
+    SHA512_C(0x923f82a4, 0xaf194f9b),
+    SHA512_C(0xab1c5ed5, 0xda6d8118),
+    SHA512_C(0xd807aa98, 0xa3030242),
+    SHA512_C(0x12835b01, 0x45706fbe),
+    SHA512_C(0x243185be, 0x4ee4b28c),
+    SHA512_C(0x550c7dc3, 0xd5ffb4e2),
+    SHA512_C(0x72be5d74, 0xf27b896f),
+    SHA512_C(0x80deb1fe, 0x3b1696b1),
+    SHA512_C(0x9bdc06a7, 0x25c71235),
+    SHA512_C(0xc19bf174, 0xcf692694),
+    SHA512_C(0xe49b69c1, 0x9ef14ad2),
+    SHA512_C(0xefbe4786, 0x384f25e3),
+    SHA512_C(0x0fc19dc6, 0x8b8cd5b5),
+    SHA512_C(0x240ca1cc, 0x77ac9c65),
+    SHA512_C(0x2de92c6f, 0x592b0275),
+    SHA512_C(0x4a7484aa, 0x6ea6e483),
+    SHA512_C(0x5cb0a9dc, 0xbd41fbd4),
+    SHA512_C(0x76f988da, 0x831153b5),
+    SHA512_C(0x983e5152, 0xee66dfab),
+    SHA512_C(0xa831c66d, 0x2db43210),
+    SHA512_C(0xb00327c8, 0x98fb213f),
+    SHA512_C(0xbf597fc7, 0xbeef0ee4),
+    SHA512_C(0xc6e00bf3, 0x3da88fc2),
+    SHA512_C(0xd5a79147, 0x930aa725),
+    SHA512_C(0x06ca6351, 0xe003826f),
+    SHA512_C(0x14292967, 0x0a0e6e70),
+    SHA512_C(0x27b70a85, 0x46d22ffc),
+    SHA512_C(0x2e1b2138, 0x5c26c926),
+    SHA512_C(0x4d2c6dfc, 0x5ac42aed),
+    SHA512_C(0x53380d13, 0x9d95b3df),
+    SHA512_C(0x650a7354, 0x8baf63de),
+    SHA512_C(0x766a0abb, 0x3c77b2a8),
+    SHA512_C(0x81c2c92e, 0x47edaee6),
+    SHA512_C(0x92722c85, 0x1482353b),
+    SHA512_C(0xa2bfe8a1, 0x4cf10364),
+    SHA512_C(0xa81a664b, 0xbc423001),
+    SHA512_C(0xc24b8b70, 0xd0f89791),
+    SHA512_C(0xc76c51a3, 0x0654be30),
+    SHA512_C(0xd192e819, 0xd6ef5218),
+    SHA512_C(0xd6990624, 0x5565a910),
+    SHA512_C(0xf40e3585, 0x5771202a),
+    SHA512_C(0x106aa070, 0x32bbd1b8),
+    SHA512_C(0x19a4c116, 0xb8d2d0c8),
+    SHA512_C(0x1e376c08, 0x5141ab53),
+    SHA512_C(0x2748774c, 0xdf8eeb99),
+    SHA512_C(0x34b0bcb5, 0xe19b48a8),
+    SHA512_C(0x391c0cb3, 0xc5c95a63),
+    SHA512_C(0x4ed8aa4a, 0xe3418acb),
+    SHA512_C(0x5b9cca4f, 0x7763e373),
+    SHA512_C(0x682e6ff3, 0xd6b2b8a3),
+    SHA512_C(0x748f82ee, 0x5defb2fc),
+    SHA512_C(0x78a5636f, 0x43172f60),
+    SHA512_C(0x84c87814, 0xa1f0ab72),
+    SHA512_C(0x8cc70208, 0x1a6439ec),
+    SHA512_C(0x90befffa, 0x23631e28),
+    SHA512_C(0xa4506ceb, 0xde82bde9),
+    SHA512_C(0xbef9a3f7, 0xb2c67915),
+    SHA512_C(0xc67178f2, 0xe372532b),
+    SHA512_C(0xca273ece, 0xea26619c),
+    SHA512_C(0xd186b8c7, 0x21c0c207),
+    SHA512_C(0xeada7dd6, 0xcde0eb1e),
+    SHA512_C(0xf57d4f7f, 0xee6ed178),
+    SHA512_C(0x06f067aa, 0x72176fba),
+    SHA512_C(0x0a637dc5, 0xa2c898a6),
+    SHA512_C(0x113f9804, 0xbef90dae),
+    SHA512_C(0x1b710b35, 0x131c471b),
+    SHA512_C(0x28db77f5, 0x23047d84),
+    SHA512_C(0x32caab7b, 0x40c72493),
+    SHA512_C(0x3c9ebe0a, 0x15c9bebc),
+    SHA512_C(0x431d67c4, 0x9c100d4c),
+    SHA512_C(0x4cc5d4be, 0xcb3e42b6),
+    SHA512_C(0x597f299c, 0xfc657e2a),
+    SHA512_C(0x5fcb6fab, 0x3ad6faec),
+    SHA512_C(0x6c44198c, 0x4a475817)
+};
+
+static const uint64_t SHA512_H0[8] = {
+    SHA512_C(0x6a09e667, 0xf3bcc908),
+    SHA512_C(0xbb67ae85, 0x84caa73b),
+    SHA512_C(0x3c6ef372, 0xfe94f82b),
+    SHA512_C(0xa54ff53a, 0x5f1d36f1),
+    SHA512_C(0x510e527f, 0xade682d1),
+    SHA512_C(0x9b05688c, 0x2b3e6c1f),
+    SHA512_C(0x1f83d9ab, 0xfb41bd6b),
+    SHA512_C(0x5be0cd19, 0x137e2179)
+};
+
+static const uint64_t SHA384_H0[8] = {
+    SHA512_C(0xcbbb9d5d, 0xc1059ed8),
+    SHA512_C(0x629a292a, 0x367cd507),
+    SHA512_C(0x9159015a, 0x3070dd17),
+    SHA512_C(0x152fecd8, 0xf70e5939),
+    SHA512_C(0x67332667, 0xffc00b31),
+    SHA512_C(0x8eb44a87, 0x68581511),
+    SHA512_C(0xdb0c2e0d, 0x64f98fa7),
+    SHA512_C(0x47b5481d, 0xbefa4fa4)
+};
+
+/* Features of the CPU (sha2_cpu) and the ones in use (sha2_in_use), see
+ * sha2_features */
+static pthread_once_t sha2_once   = PTHREAD_ONCE_INIT;
+static int            sha2_cpu    = 0;
+static int            sha2_in_use = 0;
+
+/* Fill sha2_cpu and sha2_in_use, once: see sha2_once */
+static void sha2_detect(void);
+
+/* Big-endian loads */
+static uint32_t sha2_load32(const byte* src);
+static uint64_t sha2_load64(const byte* src);
+
+/* Compress `blocks` consecutive blocks of src into h: portable code */
+static void sha256_compress(uint32_t* h, const byte* src, size_t blocks);
+static void sha512_compress(uint64_t* h, const byte* src, size_t blocks);
+
+/* Same as sha256_compress, with the best backend in use */
+static void sha256_blocks(uint32_t* h, const byte* src, size_t blocks);
+
+#if SHA2_X86
+/* Last blocks of a message len bytes long, whose last len % block size bytes
+ * are at src: those bytes, 0x80, zeros, then the bit length (multi-buffer
+ * code only, the single-message functions pad in place).
+ *
+ * RETURN
+ * Blocks written into dst: 1 or 2
+ */
+static int sha256_pad(byte* dst, const byte* src, size_t len);
+static int sha512_pad(byte* dst, const byte* src, size_t len);
+
+/* Same as sha256_compress, with the SHA extensions */
+__attribute__((target("sha,sse4.1"))) static void
+sha256_compress_shani(uint32_t* h, const byte* src, size_t blocks);
+
+/* One block for each of 8 (4) messages at a time. S[i][j] is word i of the
+ * hash value of lane j, P[j] the block of lane j: lanes whose active[j] is
+ * zero are left untouched. */
+__attribute__((target("avx2"))) static void sha256_compress_x8(
+    uint32_t S[8][8], const byte* const* P, const uint32_t* active
+);
+__attribute__((target("avx2"))) static void sha512_compress_x4(
+    uint64_t S[8][4], const byte* const* P, const uint64_t* active
+);
+
+/* sha256_multi (sha512_multi) with sha256_compress_x8 (sha512_compress_x4) */
+static void
+sha256_multi_avx2(byte** dst, const byte** src, const size_t* len, int count);
+static void
+sha512_multi_avx2(byte** dst, const byte** src, const size_t* len, int count);
+#endif
+
+/* --- IMPL */
+
+static void sha2_detect(void)
+{
+#if SHA2_X86
+    unsigned int a;
+    unsigned int b;
+    unsigned int c;
+    unsigned int d;
+
+    /* SHA-NI code uses SSSE3 and SSE4.1 too */
+    if (__get_cpuid(1, &a, &b, &c, &d) && (c & 1u << 9) && (c & 1u << 19) &&
+        __get_cpuid_count(7, 0, &a, &b, &c, &d) && (b & 1u << 29))
+        sha2_cpu |= SHA2_SHANI;
+
+    /* Also checks that the OS saves the AVX registers */
+    if (__builtin_cpu_supports("avx2"))
+        sha2_cpu |= SHA2_AVX2;
+#endif
+
+    sha2_in_use = sha2_cpu;
+}
+
+static uint32_t sha2_load32(const byte* src)
+{
+    return (uint32_t)src[0] << 24 | (uint32_t)src[1] << 16 |
+           (uint32_t)src[2] << 8 | (uint32_t)src[3];
+}
+
+static uint64_t sha2_load64(const byte* src)
+{
+    return (uint64_t)sha2_load32(src) << 32 | sha2_load32(&src[4]);
+}
+
+static void sha256_compress(uint32_t* h, const byte* src, size_t blocks)
+{
+    uint32_t W[64];
+    uint32_t A;
+    uint32_t B;
+    uint32_t C;
+    uint32_t D;
+    uint32_t E;
+    uint32_t F;
+    uint32_t G;
+    uint32_t H;
+    uint32_t T1;
+    int      t;
+
+    for (; blocks > 0; --blocks, src += SHA256_BLOCK_SIZE)
+    {
+        for (t = 0; t < 16; ++t)
+            W[t] = sha2_load32(&src[4 * t]);
+
+        for (t = 16; t < 64; ++t)
+            W[t] = SHA256_s1(W[t - 2]) + W[t - 7] + SHA256_s0(W[t - 15]) +
+                   W[t - 16];
+
+        A = h[0];
+        B = h[1];
+        C = h[2];
+        D = h[3];
+        E = h[4];
+        F = h[5];
+        G = h[6];
+        H = h[7];
+
+        for (t = 0; t < 64; t += 8)
+        {
+            SHA256_ROUND(A, B, C, D, E, F, G, H, 0);
+            SHA256_ROUND(H, A, B, C, D, E, F, G, 1);
+            SHA256_ROUND(G, H, A, B, C, D, E, F, 2);
+            SHA256_ROUND(F, G, H, A, B, C, D, E, 3);
+            SHA256_ROUND(E, F, G, H, A, B, C, D, 4);
+            SHA256_ROUND(D, E, F, G, H, A, B, C, 5);
+            SHA256_ROUND(C, D, E, F, G, H, A, B, 6);
+            SHA256_ROUND(B, C, D, E, F, G, H, A, 7);
+        }
+
+        h[0] += A;
+        h[1] += B;
+        h[2] += C;
+        h[3] += D;
+        h[4] += E;
+        h[5] += F;
+        h[6] += G;
+        h[7] += H;
+    }
+}
+
+static void sha512_compress(uint64_t* h, const byte* src, size_t blocks)
+{
+    uint64_t W[80];
+    uint64_t A;
+    uint64_t B;
+    uint64_t C;
+    uint64_t D;
+    uint64_t E;
+    uint64_t F;
+    uint64_t G;
+    uint64_t H;
+    uint64_t T1;
+    int      t;
+
+    for (; blocks > 0; --blocks, src += SHA512_BLOCK_SIZE)
+    {
+        for (t = 0; t < 16; ++t)
+            W[t] = sha2_load64(&src[8 * t]);
+
+        for (t = 16; t < 80; ++t)
+            W[t] = SHA512_s1(W[t - 2]) + W[t - 7] + SHA512_s0(W[t - 15]) +
+                   W[t - 16];
+
+        A = h[0];
+        B = h[1];
+        C = h[2];
+        D = h[3];
+        E = h[4];
+        F = h[5];
+        G = h[6];
+        H = h[7];
+
+        for (t = 0; t < 80; t += 8)
+        {
+            SHA512_ROUND(A, B, C, D, E, F, G, H, 0);
+            SHA512_ROUND(H, A, B, C, D, E, F, G, 1);
+            SHA512_ROUND(G, H, A, B, C, D, E, F, 2);
+            SHA512_ROUND(F, G, H, A, B, C, D, E, 3);
+            SHA512_ROUND(E, F, G, H, A, B, C, D, 4);
+            SHA512_ROUND(D, E, F, G, H, A, B, C, 5);
+            SHA512_ROUND(C, D, E, F, G, H, A, B, 6);
+            SHA512_ROUND(B, C, D, E, F, G, H, A, 7);
+        }
+
+        h[0] += A;
+        h[1] += B;
+        h[2] += C;
+        h[3] += D;
+        h[4] += E;
+        h[5] += F;
+        h[6] += G;
+        h[7] += H;
+    }
+}
+
+static void sha256_blocks(uint32_t* h, const byte* src, size_t blocks)
+{
+#if SHA2_X86
+    if (sha2_in_use & SHA2_SHANI)
+    {
+        sha256_compress_shani(h, src, blocks);
+        return;
+    }
+#endif
+
+    sha256_compress(h, src, blocks);
+}
+
+#if SHA2_X86
+
+static int sha256_pad(byte* dst, const byte* src, size_t len)
+{
+    size_t rem    = len % SHA256_BLOCK_SIZE;
+    int    blocks = rem < SHA256_BLOCK_SIZE - 8 ? 1 : 2;
+    size_t end    = (size_t)blocks * SHA256_BLOCK_SIZE;
+    int    i;
+
+    memcpy(dst, src, rem);
+    dst[rem] = 0x80;
+    memset(&dst[rem + 1], 0, end - 8 - rem - 1);
+
+    /* Bit length: len * 8, 64 bits */
+    for (i = 0; i < 8; ++i)
+        dst[end - 1 - (size_t)i] = (byte)((uint64_t)len << 3 >> (8 * i));
+
+    return blocks;
+}
+
+static int sha512_pad(byte* dst, const byte* src, size_t len)
+{
+    size_t rem    = len % SHA512_BLOCK_SIZE;
+    int    blocks = rem < SHA512_BLOCK_SIZE - 16 ? 1 : 2;
+    size_t end    = (size_t)blocks * SHA512_BLOCK_SIZE;
+    int    i;
+
+    memcpy(dst, src, rem);
+    dst[rem] = 0x80;
+    memset(&dst[rem + 1], 0, end - 16 - rem - 1);
+
+    /* Bit length: len * 8, 128 bits */
+    for (i = 0; i < 8; ++i)
+    {
+        dst[end - 1 - (size_t)i] = (byte)((uint64_t)len << 3 >> (8 * i));
+        dst[end - 9 - (size_t)i] = (byte)((uint64_t)len >> 61 >> (8 * i));
+    }
+
+    return blocks;
+}
+
+/* Rounds 4g...4g + 3, two for each sha256rnds2 */
+#define SHA256_NI_ROUNDS(M, g)                                                 \
+    MSG = _mm_add_epi32(                                                       \
+        M, _mm_loadu_si128((const __m128i*)&SHA256_K[4 * (g)])                 \
+    );                                                                         \
+    STATE1 = _mm_sha256rnds2_epu32(STATE1, STATE0, MSG);                       \
+    MSG    = _mm_shuffle_epi32(MSG, 0x0E);                                     \
+    STATE0 = _mm_sha256rnds2_epu32(STATE0, STATE1, MSG)
+
+/* Schedule: N (the words 12 positions ahead of C, already through
+ * sha256msg1) is completed from C, the current words, and P, the previous */
+#define SHA256_NI_MSG2(N, C, P)                                                \
+    N = _mm_sha256msg2_epu32(_mm_add_epi32(N, _mm_alignr_epi8(C, P, 4)), C)
+
+#define SHA256_NI_MSG1(P, C) P = _mm_sha256msg1_epu32(P, C)
+
+__attribute__((target("sha,sse4.1"))) static void
+sha256_compress_shani(uint32_t* h, const byte* src, size_t blocks)
+{
+    __m128i STATE0;
+    __m128i STATE1;
+    __m128i ABEF;
+    __m128i CDGH;
+    __m128i MSG;
+    __m128i M0;
+    __m128i M1;
+    __m128i M2;
+    __m128i M3;
+    __m128i TMP;
+    __m128i BSWAP;
+    int     i;
+
+    BSWAP = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+
+    /* h[0...8) is ABCD EFGH, sha256rnds2 wants ABEF and CDGH */
+    TMP    = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&h[0]), 0xB1);
+    STATE1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&h[4]), 0x1B);
+    STATE0 = _mm_alignr_epi8(TMP, STATE1, 8);
+    STATE1 = _mm_blend_epi16(STATE1, TMP, 0xF0);
+
+    for (; blocks > 0; --blocks, src += SHA256_BLOCK_SIZE)
+    {
+        ABEF = STATE0;
+        CDGH = STATE1;
+
+        M0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&src[0]), BSWAP);
+        M1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&src[16]), BSWAP);
+        M2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&src[32]), BSWAP);
+        M3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&src[48]), BSWAP);
+
+        SHA256_NI_ROUNDS(M0, 0);
+        SHA256_NI_ROUNDS(M1, 1);
+        SHA256_NI_MSG1(M0, M1);
+        SHA256_NI_ROUNDS(M2, 2);
+        SHA256_NI_MSG1(M1, M2);
+        SHA256_NI_ROUNDS(M3, 3);
+        SHA256_NI_MSG2(M0, M3, M2);
+        SHA256_NI_MSG1(M2, M3);
+
+        for (i = 4; i < 12; i += 4)
+        {
+            SHA256_NI_ROUNDS(M0, i);
+            SHA256_NI_MSG2(M1, M0, M3);
+            SHA256_NI_MSG1(M3, M0);
+            SHA256_NI_ROUNDS(M1, i + 1);
+            SHA256_NI_MSG2(M2, M1, M0);
+            SHA256_NI_MSG1(M0, M1);
+            SHA256_NI_ROUNDS(M2, i + 2);
+            SHA256_NI_MSG2(M3, M2, M1);
+            SHA256_NI_MSG1(M1, M2);
+            SHA256_NI_ROUNDS(M3, i + 3);
+            SHA256_NI_MSG2(M0, M3, M2);
+            SHA256_NI_MSG1(M2, M3);
+        }
+
+        SHA256_NI_ROUNDS(M0, 12);
+        SHA256_NI_MSG2(M1, M0, M3);
+        SHA256_NI_MSG1(M3, M0);
+        SHA256_NI_ROUNDS(M1, 13);
+        SHA256_NI_MSG2(M2, M1, M0);
+        SHA256_NI_ROUNDS(M2, 14);
+        SHA256_NI_MSG2(M3, M2, M1);
+        SHA256_NI_ROUNDS(M3, 15);
+
+        STATE0 = _mm_add_epi32(STATE0, ABEF);
+        STATE1 = _mm_add_epi32(STATE1, CDGH);
+    }
+
+    /* Back to ABCD EFGH */
+    TMP    = _mm_shuffle_epi32(STATE0, 0x1B);
+    STATE1 = _mm_shuffle_epi32(STATE1, 0xB1);
+    STATE0 = _mm_blend_epi16(TMP, STATE1, 0xF0);
+    STATE1 = _mm_alignr_epi8(STATE1, TMP, 8);
+
+    _mm_storeu_si128((__m128i*)&h[0], STATE0);
+    _mm_storeu_si128((__m128i*)&h[4], STATE1);
+}
+
+/* SHA-2 functions on vectors of 32-bit (V32) and 64-bit (V64) lanes */
+#define V_XOR3(x, y, z) _mm256_xor_si256(_mm256_xor_si256(x, y), z)
+#define V_CH(x, y, z)                                                          \
+    _mm256_xor_si256(z, _mm256_and_si256(x, _mm256_xor_si256(y, z)))
+#define V_MAJ(x, y, z)                                                         \
+    _mm256_or_si256(                                                           \
+        _mm256_and_si256(x, y), _mm256_and_si256(z, _mm256_or_si256(x, y))     \
+    )
+
+#define V32_ROTR(x, n)                                                         \
+    _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - (n)))
+#define V32_S0(x) V_XOR3(V32_ROTR(x, 2), V32_ROTR(x, 13), V32_ROTR(x, 22))
+#define V32_S1(x) V_XOR3(V32_ROTR(x, 6), V32_ROTR(x, 11), V32_ROTR(x, 25))
+#define V32_s0(x)                                                              \
+    V_XOR3(V32_ROTR(x, 7), V32_ROTR(x, 18), _mm256_srli_epi32(x, 3))
+#define V32_s1(x)                                                              \
+    V_XOR3(V32_ROTR(x, 17), V32_ROTR(x, 19), _mm256_srli_epi32(x, 10))
+
+#define V64_ROTR(x, n)                                                         \
+    _mm256_or_si256(_mm256_srli_epi64(x, n), _mm256_slli_epi64(x, 64 - (n)))
+#define V64_S0(x) V_XOR3(V64_ROTR(x, 28), V64_ROTR(x, 34), V64_ROTR(x, 39))
+#define V64_S1(x) V_XOR3(V64_ROTR(x, 14), V64_ROTR(x, 18), V64_ROTR(x, 41))
+#define V64_s0(x)                                                              \
+    V_XOR3(V64_ROTR(x, 1), V64_ROTR(x, 8), _mm256_srli_epi64(x, 7))
+#define V64_s1(x)                                                              \
+    V_XOR3(V64_ROTR(x, 19), V64_ROTR(x, 61), _mm256_srli_epi64(x, 6))
+
+/* Same as SHA256_ROUND and SHA512_ROUND, on every lane */
+#define V32_ROUND(a, b, c, d, e, f, g, h, i)                                   \
+    T1 = _mm256_add_epi32(                                                     \
+        _mm256_add_epi32(h, V32_S1(e)),                                        \
+        _mm256_add_epi32(                                                      \
+            _mm256_add_epi32(V_CH(e, f, g), W[t + (i)]),                       \
+            _mm256_set1_epi32((int)SHA256_K[t + (i)])                          \
+        )                                                                      \
+    );                                                                         \
+    d = _mm256_add_epi32(d, T1);                                               \
+    h = _mm256_add_epi32(T1, _mm256_add_epi32(V32_S0(a), V_MAJ(a, b, c)))
+
+#define V64_ROUND(a, b, c, d, e, f, g, h, i)                                   \
+    T1 = _mm256_add_epi64(                                                     \
+        _mm256_add_epi64(h, V64_S1(e)),                                        \
+        _mm256_add_epi64(                                                      \
+            _mm256_add_epi64(V_CH(e, f, g), W[t + (i)]),                       \
+            _mm256_broadcastq_epi64(                                           \
+                _mm_loadl_epi64((const __m128i*)&SHA512_K[t + (i)])            \
+            )                                                                  \
+        )                                                                      \
+    );                                                                         \
+    d = _mm256_add_epi64(d, T1);                                               \
+    h = _mm256_add_epi64(T1, _mm256_add_epi64(V64_S0(a), V_MAJ(a, b, c)))
+
+/* S[j] += x on the active lanes */
+#define V32_ACCUMULATE(j, x)                                                   \
+    T1 = _mm256_loadu_si256((const __m256i*)S[j]);                             \
+    _mm256_storeu_si256(                                                       \
+        (__m256i*)S[j],                                                        \
+        _mm256_blendv_epi8(T1, _mm256_add_epi32(T1, x), mask)                  \
+    )
+
+#define V64_ACCUMULATE(j, x)                                                   \
+    T1 = _mm256_loadu_si256((const __m256i*)S[j]);                             \
+    _mm256_storeu_si256(                                                       \
+        (__m256i*)S[j],                                                        \
+        _mm256_blendv_epi8(T1, _mm256_add_epi64(T1, x), mask)                  \
+    )
+
+__attribute__((target("avx2"))) static void sha256_compress_x8(
+    uint32_t S[8][8], const byte* const* P, const uint32_t* active
+)
+{
+    __m256i  W[64];
+    __m256i  A;
+    __m256i  B;
+    __m256i  C;
+    __m256i  D;
+    __m256i  E;
+    __m256i  F;
+    __m256i  G;
+    __m256i  H;
+    __m256i  T1;
+    __m256i  mask;
+    uint32_t X[8];
+    int      t;
+    int      j;
+
+    /* W[t] holds word t of every lane */
+    for (t = 0; t < 16; ++t)
+    {
+        for (j = 0; j < 8; ++j)
+            X[j] = sha2_load32(&P[j][4 * t]);
+
+        W[t] = _mm256_loadu_si256((const __m256i*)X);
+    }
+
+    for (t = 16; t < 64; ++t)
+        W[t] = _mm256_add_epi32(
+            _mm256_add_epi32(V32_s1(W[t - 2]), W[t - 7]),
+            _mm256_add_epi32(V32_s0(W[t - 15]), W[t - 16])
+        );
+
+    A = _mm256_loadu_si256((const __m256i*)S[0]);
+    B = _mm256_loadu_si256((const __m256i*)S[1]);
+    C = _mm256_loadu_si256((const __m256i*)S[2]);
+    D = _mm256_loadu_si256((const __m256i*)S[3]);
+    E = _mm256_loadu_si256((const __m256i*)S[4]);
+    F = _mm256_loadu_si256((const __m256i*)S[5]);
+    G = _mm256_loadu_si256((const __m256i*)S[6]);
+    H = _mm256_loadu_si256((const __m256i*)S[7]);
+
+    for (t = 0; t < 64; t += 8)
+    {
+        V32_ROUND(A, B, C, D, E, F, G, H, 0);
+        V32_ROUND(H, A, B, C, D, E, F, G, 1);
+        V32_ROUND(G, H, A, B, C, D, E, F, 2);
+        V32_ROUND(F, G, H, A, B, C, D, E, 3);
+        V32_ROUND(E, F, G, H, A, B, C, D, 4);
+        V32_ROUND(D, E, F, G, H, A, B, C, 5);
+        V32_ROUND(C, D, E, F, G, H, A, B, 6);
+        V32_ROUND(B, C, D, E, F, G, H, A, 7);
+    }
+
+    mask = _mm256_loadu_si256((const __m256i*)active);
+
+    V32_ACCUMULATE(0, A);
+    V32_ACCUMULATE(1, B);
+    V32_ACCUMULATE(2, C);
+    V32_ACCUMULATE(3, D);
+    V32_ACCUMULATE(4, E);
+    V32_ACCUMULATE(5, F);
+    V32_ACCUMULATE(6, G);
+    V32_ACCUMULATE(7, H);
+}
+
+__attribute__((target("avx2"))) static void sha512_compress_x4(
+    uint64_t S[8][4], const byte* const* P, const uint64_t* active
+)
+{
+    __m256i  W[80];
+    __m256i  A;
+    __m256i  B;
+    __m256i  C;
+    __m256i  D;
+    __m256i  E;
+    __m256i  F;
+    __m256i  G;
+    __m256i  H;
+    __m256i  T1;
+    __m256i  mask;
+    uint64_t X[4];
+    int      t;
+    int      j;
+
+    for (t = 0; t < 16; ++t)
+    {
+        for (j = 0; j < 4; ++j)
+            X[j] = sha2_load64(&P[j][8 * t]);
+
+        W[t] = _mm256_loadu_si256((const __m256i*)X);
+    }
+
+    for (t = 16; t < 80; ++t)
+        W[t] = _mm256_add_epi64(
+            _mm256_add_epi64(V64_s1(W[t - 2]), W[t - 7]),
+            _mm256_add_epi64(V64_s0(W[t - 15]), W[t - 16])
+        );
+
+    A = _mm256_loadu_si256((const __m256i*)S[0]);
+    B = _mm256_loadu_si256((const __m256i*)S[1]);
+    C = _mm256_loadu_si256((const __m256i*)S[2]);
+    D = _mm256_loadu_si256((const __m256i*)S[3]);
+    E = _mm256_loadu_si256((const __m256i*)S[4]);
+    F = _mm256_loadu_si256((const __m256i*)S[5]);
+    G = _mm256_loadu_si256((const __m256i*)S[6]);
+    H = _mm256_loadu_si256((const __m256i*)S[7]);
+
+    for (t = 0; t < 80; t += 8)
+    {
+        V64_ROUND(A, B, C, D, E, F, G, H, 0);
+        V64_ROUND(H, A, B, C, D, E, F, G, 1);
+        V64_ROUND(G, H, A, B, C, D, E, F, 2);
+        V64_ROUND(F, G, H, A, B, C, D, E, 3);
+        V64_ROUND(E, F, G, H, A, B, C, D, 4);
+        V64_ROUND(D, E, F, G, H, A, B, C, 5);
+        V64_ROUND(C, D, E, F, G, H, A, B, 6);
+        V64_ROUND(B, C, D, E, F, G, H, A, 7);
+    }
+
+    mask = _mm256_loadu_si256((const __m256i*)active);
+
+    V64_ACCUMULATE(0, A);
+    V64_ACCUMULATE(1, B);
+    V64_ACCUMULATE(2, C);
+    V64_ACCUMULATE(3, D);
+    V64_ACCUMULATE(4, E);
+    V64_ACCUMULATE(5, F);
+    V64_ACCUMULATE(6, G);
+    V64_ACCUMULATE(7, H);
+}
+
+static void
+sha256_multi_avx2(byte** dst, const byte** src, const size_t* len, int count)
+{
+    uint32_t    S[8][8];
+    byte        tail[8][2 * SHA256_BLOCK_SIZE];
+    const byte* P[8];
+    uint32_t    active[8];
+    size_t      full[8];   /* Blocks taken straight from src */
+    size_t      blocks[8]; /* Blocks in all, padding included */
+    size_t      most;
+    size_t      b;
+    int         lanes;
+    int         i;
+    int         j;
+
+    for (; count > 0; count -= lanes, dst += lanes, src += lanes, len += lanes)
+    {
+        lanes = count < 8 ? count : 8;
+        most  = 0;
+
+        for (j = 0; j < 8; ++j)
+        {
+            full[j]   = 0;
+            blocks[j] = 0;
+
+            for (i = 0; i < 8; ++i)
+                S[i][j] = SHA256_H0[i];
+
+            if (j >= lanes)
+                continue;
+
+            full[j]   = len[j] / SHA256_BLOCK_SIZE;
+            blocks[j] = full[j] + (size_t)sha256_pad(
+                                      tail[j],
+                                      &src[j][full[j] * SHA256_BLOCK_SIZE],
+                                      len[j]
+                                  );
+
+            if (blocks[j] > most)
+                most = blocks[j];
+        }
+
+        for (b = 0; b < most; ++b)
+        {
+            /* Lanes done (or unused) hash tail[0] again, to no effect */
+            for (j = 0; j < 8; ++j)
+            {
+                active[j] = b < blocks[j] ? 0xffffffffu : 0;
+
+                if (b < full[j])
+                    P[j] = &src[j][b * SHA256_BLOCK_SIZE];
+                else if (b < blocks[j])
+                    P[j] = &tail[j][(b - full[j]) * SHA256_BLOCK_SIZE];
+                else
+                    P[j] = tail[0];
+            }
+
+            sha256_compress_x8(S, P, active);
+        }
+
+        for (j = 0; j < lanes; ++j)
+            for (i = 0; i < SHA256_DIGEST_SIZE; ++i)
+                dst[j][i] = (byte)(S[i / 4][j] >> (24 - 8 * (i % 4)));
+    }
+}
+
+static void
+sha512_multi_avx2(byte** dst, const byte** src, const size_t* len, int count)
+{
+    uint64_t    S[8][4];
+    byte        tail[4][2 * SHA512_BLOCK_SIZE];
+    const byte* P[4];
+    uint64_t    active[4];
+    size_t      full[4];
+    size_t      blocks[4];
+    size_t      most;
+    size_t      b;
+    int         lanes;
+    int         i;
+    int         j;
+
+    for (; count > 0; count -= lanes, dst += lanes, src += lanes, len += lanes)
+    {
+        lanes = count < 4 ? count : 4;
+        most  = 0;
+
+        for (j = 0; j < 4; ++j)
+        {
+            full[j]   = 0;
+            blocks[j] = 0;
+
+            for (i = 0; i < 8; ++i)
+                S[i][j] = SHA512_H0[i];
+
+            if (j >= lanes)
+                continue;
+
+            full[j]   = len[j] / SHA512_BLOCK_SIZE;
+            blocks[j] = full[j] + (size_t)sha512_pad(
+                                      tail[j],
+                                      &src[j][full[j] * SHA512_BLOCK_SIZE],
+                                      len[j]
+                                  );
+
+            if (blocks[j] > most)
+                most = blocks[j];
+        }
+
+        for (b = 0; b < most; ++b)
+        {
+            for (j = 0; j < 4; ++j)
+            {
+                active[j] = b < blocks[j] ? ~(uint64_t)0 : 0;
+
+                if (b < full[j])
+                    P[j] = &src[j][b * SHA512_BLOCK_SIZE];
+                else if (b < blocks[j])
+                    P[j] = &tail[j][(b - full[j]) * SHA512_BLOCK_SIZE];
+                else
+                    P[j] = tail[0];
+            }
+
+            sha512_compress_x4(S, P, active);
+        }
+
+        for (j = 0; j < lanes; ++j)
+            for (i = 0; i < SHA512_DIGEST_SIZE; ++i)
+                dst[j][i] = (byte)(S[i / 8][j] >> (56 - 8 * (i % 8)));
+    }
+}
+
+#endif /* SHA2_X86 */
+
+void sha256_init(sha256_p S)
+{
+    pthread_once(&sha2_once, sha2_detect);
+
+    memcpy(S->h, SHA256_H0, sizeof(SHA256_H0));
+    S->n      = 0;
+    S->len[0] = S->len[1] = 0;
+}
+
+void sha256_update(sha256_p S, const byte* src, size_t len)
+{
+    size_t take;
+
+    S->len[0] += (uint32_t)len;
+    if (S->len[0] < (uint32_t)len)
+        ++S->len[1];
+    S->len[1] += (uint32_t)(len >> 16 >> 16);
+
+    /* Fill the pending block first */
+    if (S->n > 0)
+    {
+        take = (size_t)(SHA256_BLOCK_SIZE - S->n);
+        if (take > len)
+            take = len;
+
+        memcpy(&S->buf[S->n], src, take);
+        S->n += (int)take;
+        src += take;
+        len -= take;
+
+        if (S->n < SHA256_BLOCK_SIZE)
+            return;
+
+        sha256_blocks(S->h, S->buf, 1);
+        S->n = 0;
+    }
+
+    /* Whole blocks straight from src */
+    if (len >= SHA256_BLOCK_SIZE)
+        sha256_blocks(S->h, src, len / SHA256_BLOCK_SIZE);
+    src += len - len % SHA256_BLOCK_SIZE;
+    len %= SHA256_BLOCK_SIZE;
+
+    memcpy(S->buf, src, len);
+    S->n = (int)len;
+}
+
+void sha256_final(sha256_p S, byte* dst)
+{
+    uint32_t hi = S->len[1] << 3 | S->len[0] >> 29;
+    uint32_t lo = S->len[0] << 3;
+    int      i;
+
+    /* 0x80, zeros up to 56 bytes (mod 64), then the bit length */
+    S->buf[S->n++] = 0x80;
+    if (S->n > SHA256_BLOCK_SIZE - 8)
+    {
+        memset(&S->buf[S->n], 0, (size_t)(SHA256_BLOCK_SIZE - S->n));
+        sha256_blocks(S->h, S->buf, 1);
+        S->n = 0;
+    }
+    memset(&S->buf[S->n], 0, (size_t)(SHA256_BLOCK_SIZE - 8 - S->n));
+
+    for (i = 0; i < 4; ++i)
+    {
+        S->buf[56 + i] = (byte)(hi >> (24 - 8 * i));
+        S->buf[60 + i] = (byte)(lo >> (24 - 8 * i));
+    }
+    sha256_blocks(S->h, S->buf, 1);
+
+    for (i = 0; i < SHA256_DIGEST_SIZE; ++i)
+        dst[i] = (byte)(S->h[i / 4] >> (24 - 8 * (i % 4)));
+}
+
+void sha384_init(sha384_p S)
+{
+    sha512_init(S);
+    memcpy(S->h, SHA384_H0, sizeof(SHA384_H0));
+}
+
+void sha384_update(sha384_p S, const byte* src, size_t len)
+{
+    sha512_update(S, src, len);
+}
+
+void sha384_final(sha384_p S, byte* dst)
+{
+    byte T[SHA512_DIGEST_SIZE];
+
+    sha512_final(S, T);
+    memcpy(dst, T, SHA384_DIGEST_SIZE);
+}
+
+void sha512_init(sha512_p S)
+{
+    memcpy(S->h, SHA512_H0, sizeof(SHA512_H0));
+    S->n      = 0;
+    S->len[0] = S->len[1] = 0;
+}
+
+void sha512_update(sha512_p S, const byte* src, size_t len)
+{
+    size_t take;
+
+    S->len[0] += (uint64_t)len;
+    if (S->len[0] < (uint64_t)len)
+        ++S->len[1];
+
+    if (S->n > 0)
+    {
+        take = (size_t)(SHA512_BLOCK_SIZE - S->n);
+        if (take > len)
+            take = len;
+
+        memcpy(&S->buf[S->n], src, take);
+        S->n += (int)take;
+        src += take;
+        len -= take;
+
+        if (S->n < SHA512_BLOCK_SIZE)
+            return;
+
+        sha512_compress(S->h, S->buf, 1);
+        S->n = 0;
+    }
+
+    sha512_compress(S->h, src, len / SHA512_BLOCK_SIZE);
+    src += len - len % SHA512_BLOCK_SIZE;
+    len %= SHA512_BLOCK_SIZE;
+
+    memcpy(S->buf, src, len);
+    S->n = (int)len;
+}
+
+void sha512_final(sha512_p S, byte* dst)
+{
+    uint64_t hi = S->len[1] << 3 | S->len[0] >> 61;
+    uint64_t lo = S->len[0] << 3;
+    int      i;
+
+    /* 0x80, zeros up to 112 bytes (mod 128), then the bit length */
+    S->buf[S->n++] = 0x80;
+    if (S->n > SHA512_BLOCK_SIZE - 16)
+    {
+        memset(&S->buf[S->n], 0, (size_t)(SHA512_BLOCK_SIZE - S->n));
+        sha512_compress(S->h, S->buf, 1);
+        S->n = 0;
+    }
+    memset(&S->buf[S->n], 0, (size_t)(SHA512_BLOCK_SIZE - 16 - S->n));
+
+    for (i = 0; i < 8; ++i)
+    {
+        S->buf[112 + i] = (byte)(hi >> (56 - 8 * i));
+        S->buf[120 + i] = (byte)(lo >> (56 - 8 * i));
+    }
+    sha512_compress(S->h, S->buf, 1);
+
+    for (i = 0; i < SHA512_DIGEST_SIZE; ++i)
+        dst[i] = (byte)(S->h[i / 8] >> (56 - 8 * (i % 8)));
+}
+
+void sha256(byte* dst, const byte* src, size_t len)
+{
+    struct sha256_t S;
+
+    sha256_init(&S);
+    sha256_update(&S, src, len);
+    sha256_final(&S, dst);
+}
+
+void sha384(byte* dst, const byte* src, size_t len)
+{
+    struct sha512_t S;
+
+    sha384_init(&S);
+    sha384_update(&S, src, len);
+    sha384_final(&S, dst);
+}
+
+void sha512(byte* dst, const byte* src, size_t len)
+{
+    struct sha512_t S;
+
+    sha512_init(&S);
+    sha512_update(&S, src, len);
+    sha512_final(&S, dst);
+}
+
+void sha256_multi(byte** dst, const byte** src, const size_t* len, int count)
+{
+    int i;
+
+    pthread_once(&sha2_once, sha2_detect);
+
+#if SHA2_X86
+    /* One lane of the SHA extensions outruns 8 lanes of AVX2 */
+    if ((sha2_in_use & (SHA2_SHANI | SHA2_AVX2)) == SHA2_AVX2)
+    {
+        sha256_multi_avx2(dst, src, len, count);
+        return;
+    }
+#endif
+
+    for (i = 0; i < count; ++i)
+        sha256(dst[i], src[i], len[i]);
+}
+
+void sha512_multi(byte** dst, const byte** src, const size_t* len, int count)
+{
+    int i;
+
+    pthread_once(&sha2_once, sha2_detect);
+
+#if SHA2_X86
+    if (sha2_in_use & SHA2_AVX2)
+    {
+        sha512_multi_avx2(dst, src, len, count);
+        return;
+    }
+#endif
+
+    for (i = 0; i < count; ++i)
+        sha512(dst[i], src[i], len[i]);
+}
+
+int sha2_features(void)
+{
+    pthread_once(&sha2_once, sha2_detect);
+
+    return sha2_in_use;
+}
+
+int sha2_features_set(int mask)
+{
+    pthread_once(&sha2_once, sha2_detect);
+
+    sha2_in_use = sha2_cpu & mask;
+
+    return sha2_in_use;
+}
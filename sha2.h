@@ -0,0 +1,97 @@
+#ifndef CMC_CRYPTO_SHA2_INCLUDED
+#define CMC_CRYPTO_SHA2_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "types.h"
+
+/* x86 backends (SHA-NI, AVX2), chosen at run time, see sha2_features:
+ * 1 -> built, if the compiler supports them; 0 -> portable code only */
+#ifndef SHA2_X86
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SHA2_X86 1
+#else
+#define SHA2_X86 0
+#endif
+#endif
+
+#define SHA256_BLOCK_SIZE 64
+#define SHA256_DIGEST_SIZE 32
+#define SHA384_DIGEST_SIZE 48
+#define SHA512_BLOCK_SIZE 128
+#define SHA512_DIGEST_SIZE 64
+
+/* CPU features used by SHA-2, see sha2_features */
+enum
+{
+    SHA2_SHANI = 1, /* SHA extensions: SHA-256 compression */
+    SHA2_AVX2  = 2  /* sha256_multi (8 lanes) and sha512_multi (4 lanes) */
+};
+
+typedef struct sha256_t
+{
+    uint32_t h[8];                   /* Intermediate hash value */
+    byte     buf[SHA256_BLOCK_SIZE]; /* Bytes not hashed yet */
+    int      n;                      /* Bytes in buf */
+    uint32_t len[2];                 /* Message length in bytes: low, high */
+}* sha256_p;
+
+typedef struct sha512_t
+{
+    uint64_t h[8];                   /* Intermediate hash value */
+    byte     buf[SHA512_BLOCK_SIZE]; /* Bytes not hashed yet */
+    int      n;                      /* Bytes in buf */
+    uint64_t len[2];                 /* Message length in bytes: low, high */
+}* sha512_p;
+
+/* SHA-384 is SHA-512 with another initial hash value, truncated */
+typedef struct sha512_t* sha384_p;
+
+/* SHA-256 (FIPS 180-4), incremental: sha256_init, then sha256_update any
+ * number of times with consecutive chunks of the message, then sha256_final,
+ * that writes the SHA256_DIGEST_SIZE bytes of the digest into dst.
+ *
+ * Blocks are compressed with the SHA extensions, if the CPU has them. */
+extern void sha256_init(sha256_p S);
+extern void sha256_update(sha256_p S, const byte* src, size_t len);
+extern void sha256_final(sha256_p S, byte* dst);
+
+/* Same as the SHA-256 functions, for SHA-384 and SHA-512 */
+extern void sha384_init(sha384_p S);
+extern void sha384_update(sha384_p S, const byte* src, size_t len);
+extern void sha384_final(sha384_p S, byte* dst);
+extern void sha512_init(sha512_p S);
+extern void sha512_update(sha512_p S, const byte* src, size_t len);
+extern void sha512_final(sha512_p S, byte* dst);
+
+/* One-shot SHA-256, SHA-384 and SHA-512 of src */
+extern void sha256(byte* dst, const byte* src, size_t len);
+extern void sha384(byte* dst, const byte* src, size_t len);
+extern void sha512(byte* dst, const byte* src, size_t len);
+
+/* dst[i] <- SHA-256 (SHA-512) of src[i][0...len[i]), for 0 <= i < count.
+ *
+ * Meant for many small messages: with AVX2 (and, for SHA-256, without the SHA
+ * extensions, that are faster still) messages are hashed 8 (4) at a time, one
+ * per vector lane, each lane padding its own message. Messages of similar
+ * length make the most of it, as a group takes as long as its longest
+ * message. */
+extern void
+sha256_multi(byte** dst, const byte** src, const size_t* len, int count);
+extern void
+sha512_multi(byte** dst, const byte** src, const size_t* len, int count);
+
+/* CPU features in use (SHA2_SHANI, SHA2_AVX2), detected on first use */
+extern int sha2_features(void);
+
+/* Use only the features in mask (0 -> portable code only) that the CPU has,
+ * e.g. to benchmark or to test the backends against each other. Not thread
+ * safe: no hashing must be in progress.
+ *
+ * RETURN
+ * Features in use
+ */
+extern int sha2_features_set(int mask);
+
+#endif /* CMC_CRYPTO_SHA2_INCLUDED */
@@ -49,4 +49,9 @@ for ((i = 1; i > 0; i++)); do
 	$TESTER "$DIR" "aes-128-ofb" "AES-OFB" "$DIR/key128.bin" 0 || exit $?
 	$TESTER "$DIR" "aes-192-ofb" "AES-OFB" "$DIR/key192.bin" 0 || exit $?
 	$TESTER "$DIR" "aes-256-ofb" "AES-OFB" "$DIR/key256.bin" 0 || exit $?
+
+	# AES-CTR (no padding needed)
+	$TESTER "$DIR" "aes-128-ctr" "AES-CTR" "$DIR/key128.bin" 0 || exit $?
+	$TESTER "$DIR" "aes-192-ctr" "AES-CTR" "$DIR/key192.bin" 0 || exit $?
+	$TESTER "$DIR" "aes-256-ctr" "AES-CTR" "$DIR/key256.bin" 0 || exit $?
 done
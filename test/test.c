@@ -0,0 +1,1478 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "aes.h"
+#include "bigint.h"
+#include "dh.h"
+#include "drbg.h"
+#include "ed25519.h"
+#include "hmac.h"
+#include "p256.h"
+#include "rsa.h"
+#include "sha2.h"
+#include "x25519.h"
+
+/* Default number of random cases of the differential and property tests */
+#ifndef TEST_CASES
+#define TEST_CASES 200
+#endif
+
+/* Longest message of the differential tests */
+#define TEST_MAX_LEN 600
+
+/* Messages of a multi-buffer SHA-2 case: more than the 8 lanes of
+ * sha256_multi, so that lanes are refilled */
+#define TEST_MULTI 12
+
+/* Signatures of an Ed25519 batch case, at most: more than a chunk */
+#define TEST_BATCH (ED25519_BATCH_CHUNK + 16)
+
+/* Largest operands of the property tests, in bytes: products must fit
+ * BIGINT_MAX */
+#define TEST_BIGINT_BYTES (BIGINT_MAX / 2)
+
+/* Known-answer test of an AES mode, a 64-byte message at most */
+typedef struct test_aes_kat_t
+{
+    const char* name;
+    int         mode;
+    const char* key;
+    const char* iv; /* NULL in ECB */
+    const char* plain;
+    const char* enc;
+}* test_aes_kat_p;
+
+/* NIST SP 800-38A, appendix F: the same 4 blocks in every mode */
+#define SP800_38A_PLAIN                                                        \
+    "6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e51"         \
+    "30c81c46a35ce411e5fbc1191a0a52eff69f2445df4f9b17ad2b417be66c3710"
+#define SP800_38A_KEY128 "2b7e151628aed2a6abf7158809cf4f3c"
+#define SP800_38A_KEY192 "8e73b0f7da0e6452c810f32b809079e562f8ead2522c6b7b"
+#define SP800_38A_KEY256                                                       \
+    "603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4"
+#define SP800_38A_IV "000102030405060708090a0b0c0d0e0f"
+#define SP800_38A_CTR "f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff"
+
+#define ZERO128 "00000000000000000000000000000000"
+#define ZERO192 "000000000000000000000000000000000000000000000000"
+#define ZERO256                                                                \
+    "0000000000000000000000000000000000000000000000000000000000000000"
+
+static const struct test_aes_kat_t test_aes_kats[] = {
+    /* FIPS-197, appendix C */
+    {"FIPS-197 C.1",
+     MODE_ECB,
+     "000102030405060708090a0b0c0d0e0f",
+     NULL,
+     "00112233445566778899aabbccddeeff",
+     "69c4e0d86a7b0430d8cdb78070b4c55a"},
+    {"FIPS-197 C.2",
+     MODE_ECB,
+     "000102030405060708090a0b0c0d0e0f1011121314151617",
+     NULL,
+     "00112233445566778899aabbccddeeff",
+     "dda97ca4864cdfe06eaf70a0ec0d7191"},
+    {"FIPS-197 C.3",
+     MODE_ECB,
+     "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f",
+     NULL,
+     "00112233445566778899aabbccddeeff",
+     "8ea2b7ca516745bfeafc49904b496089"},
+
+    /* AESAVS, GFSbox (zero key) */
+    {"AESAVS GFSbox-128 0",
+     MODE_ECB,
+     ZERO128,
+     NULL,
+     "f34481ec3cc627bacd5dc3fb08f273e6",
+     "0336763e966d92595a567cc9ce537f5e"},
+    {"AESAVS GFSbox-128 1",
+     MODE_ECB,
+     ZERO128,
+     NULL,
+     "9798c4640bad75c7c3227db910174e72",
+     "a9a1631bf4996954ebc093957b234589"},
+    {"AESAVS GFSbox-128 2",
+     MODE_ECB,
+     ZERO128,
+     NULL,
+     "96ab5c2ff612d9dfaae8c31f30c42168",
+     "ff4f8391a6a40ca5b25d23bedd44a597"},
+    {"AESAVS GFSbox-192 0",
+     MODE_ECB,
+     ZERO192,
+     NULL,
+     "1b077a6af4b7f98229de786d7516b639",
+     "275cfc0413d8ccb70513c3859b1d0f72"},
+    {"AESAVS GFSbox-256 0",
+     MODE_ECB,
+     ZERO256,
+     NULL,
+     "014730f80ac625fe84f026c60bfd547d",
+     "5c9d844ed46f9885085e5d6a4f94c7d7"},
+
+    /* SP 800-38A, F.1 to F.5 */
+    {"SP 800-38A F.1.1 ECB-AES128",
+     MODE_ECB,
+     SP800_38A_KEY128,
+     NULL,
+     SP800_38A_PLAIN,
+     "3ad77bb40d7a3660a89ecaf32466ef97f5d3d58503b9699de785895a96fdbaaf"
+     "43b1cd7f598ece23881b00e3ed0306887b0c785e27e8ad3f8223207104725dd4"},
+    {"SP 800-38A F.1.3 ECB-AES192",
+     MODE_ECB,
+     SP800_38A_KEY192,
+     NULL,
+     SP800_38A_PLAIN,
+     "bd334f1d6e45f25ff712a214571fa5cc974104846d0ad3ad7734ecb3ecee4eef"
+     "ef7afd2270e2e60adce0ba2face6444e9a4b41ba738d6c72fb16691603c18e0e"},
+    {"SP 800-38A F.1.5 ECB-AES256",
+     MODE_ECB,
+     SP800_38A_KEY256,
+     NULL,
+     SP800_38A_PLAIN,
+     "f3eed1bdb5d2a03c064b5a7e3db181f8591ccb10d410ed26dc5ba74a31362870"
+     "b6ed21b99ca6f4f9f153e7b1beafed1d23304b7a39f9f3ff067d8d8f9e24ecc7"},
+    {"SP 800-38A F.2.1 CBC-AES128",
+     MODE_CBC,
+     SP800_38A_KEY128,
+     SP800_38A_IV,
+     SP800_38A_PLAIN,
+     "7649abac8119b246cee98e9b12e9197d5086cb9b507219ee95db113a917678b2"
+     "73bed6b8e3c1743b7116e69e222295163ff1caa1681fac09120eca307586e1a7"},
+    {"SP 800-38A F.2.3 CBC-AES192",
+     MODE_CBC,
+     SP800_38A_KEY192,
+     SP800_38A_IV,
+     SP800_38A_PLAIN,
+     "4f021db243bc633d7178183a9fa071e8b4d9ada9ad7dedf4e5e738763f69145a"
+     "571b242012fb7ae07fa9baac3df102e008b0e27988598881d920a9e64f5615cd"},
+    {"SP 800-38A F.2.5 CBC-AES256",
+     MODE_CBC,
+     SP800_38A_KEY256,
+     SP800_38A_IV,
+     SP800_38A_PLAIN,
+     "f58c4c04d6e5f1ba779eabfb5f7bfbd69cfc4e967edb808d679f777bc6702c7d"
+     "39f23369a9d9bacfa530e26304231461b2eb05e2c39be9fcda6c19078c6a9d1b"},
+    {"SP 800-38A F.3.13 CFB128-AES128",
+     MODE_CFB,
+     SP800_38A_KEY128,
+     SP800_38A_IV,
+     SP800_38A_PLAIN,
+     "3b3fd92eb72dad20333449f8e83cfb4ac8a64537a0b3a93fcde3cdad9f1ce58b"
+     "26751f67a3cbb140b1808cf187a4f4dfc04b05357c5d1c0eeac4c66f9ff7f2e6"},
+    {"SP 800-38A F.3.15 CFB128-AES192",
+     MODE_CFB,
+     SP800_38A_KEY192,
+     SP800_38A_IV,
+     SP800_38A_PLAIN,
+     "cdc80d6fddf18cab34c25909c99a417467ce7f7f81173621961a2b70171d3d7a"
+     "2e1e8a1dd59b88b1c8e60fed1efac4c9c05f9f9ca9834fa042ae8fba584b09ff"},
+    {"SP 800-38A F.3.17 CFB128-AES256",
+     MODE_CFB,
+     SP800_38A_KEY256,
+     SP800_38A_IV,
+     SP800_38A_PLAIN,
+     "dc7e84bfda79164b7ecd8486985d386039ffed143b28b1c832113c6331e5407b"
+     "df10132415e54b92a13ed0a8267ae2f975a385741ab9cef82031623d55b1e471"},
+    {"SP 800-38A F.4.1 OFB-AES128",
+     MODE_OFB,
+     SP800_38A_KEY128,
+     SP800_38A_IV,
+     SP800_38A_PLAIN,
+     "3b3fd92eb72dad20333449f8e83cfb4a7789508d16918f03f53c52dac54ed825"
+     "9740051e9c5fecf64344f7a82260edcc304c6528f659c77866a510d9c1d6ae5e"},
+    {"SP 800-38A F.4.3 OFB-AES192",
+     MODE_OFB,
+     SP800_38A_KEY192,
+     SP800_38A_IV,
+     SP800_38A_PLAIN,
+     "cdc80d6fddf18cab34c25909c99a4174fcc28b8d4c63837c09e81700c1100401"
+     "8d9a9aeac0f6596f559c6d4daf59a5f26d9f200857ca6c3e9cac524bd9acc92a"},
+    {"SP 800-38A F.4.5 OFB-AES256",
+     MODE_OFB,
+     SP800_38A_KEY256,
+     SP800_38A_IV,
+     SP800_38A_PLAIN,
+     "dc7e84bfda79164b7ecd8486985d38604febdc6740d20b3ac88f6ad82a4fb08d"
+     "71ab47a086e86eedf39d1c5bba97c4080126141d67f37be8538f5a8be740e484"},
+    {"SP 800-38A F.5.1 CTR-AES128",
+     MODE_CTR,
+     SP800_38A_KEY128,
+     SP800_38A_CTR,
+     SP800_38A_PLAIN,
+     "874d6191b620e3261bef6864990db6ce9806f66b7970fdff8617187bb9fffdff"
+     "5ae4df3edbd5d35e5b4f09020db03eab1e031dda2fbe03d1792170a0f3009cee"},
+    {"SP 800-38A F.5.3 CTR-AES192",
+     MODE_CTR,
+     SP800_38A_KEY192,
+     SP800_38A_CTR,
+     SP800_38A_PLAIN,
+     "1abc932417521ca24f2b0459fe7e6e0b090339ec0aa6faefd5ccc2c6f4ce8e94"
+     "1e36b26bd1ebc670d1bd1d665620abf74f78a7f6d29809585a97daec58c6b050"},
+    {"SP 800-38A F.5.5 CTR-AES256",
+     MODE_CTR,
+     SP800_38A_KEY256,
+     SP800_38A_CTR,
+     SP800_38A_PLAIN,
+     "601ec313775789a5b7a7f504bbf3d228f443e3ca4d62b59aca84e990cacaf5c5"
+     "2b0930daa23de94ce87017ba2d84988ddfc9c58db67aada613c2dd08457941a6"}
+};
+
+/* Known-answer test of SHA-2 or HMAC: an ASCII message, a hex key (HMAC
+ * only) and the hex digest */
+typedef struct test_hash_kat_t
+{
+    const char* name;
+    int         bits; /* 256, 384 or 512 */
+    const char* key;  /* NULL for SHA-2 */
+    const char* msg;
+    const char* digest;
+}* test_hash_kat_p;
+
+/* RFC 4231, test case 6: a key longer than a block of either hash */
+#define RFC4231_KEY6                                                           \
+    "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"         \
+    "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"         \
+    "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"         \
+    "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"         \
+    "aaaaaa"
+#define RFC4231_MSG6 "Test Using Larger Than Block-Size Key - Hash Key First"
+
+static const struct test_hash_kat_t test_sha2_kats[] = {
+    /* FIPS 180-4 examples: one block and two blocks */
+    {"FIPS 180-4 SHA-256 abc",
+     256,
+     NULL,
+     "abc",
+     "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"},
+    {"FIPS 180-4 SHA-256 2 blocks",
+     256,
+     NULL,
+     "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+     "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"},
+    {"FIPS 180-4 SHA-384 abc",
+     384,
+     NULL,
+     "abc",
+     "cb00753f45a35e8bb5a03d699ac65007272c32ab0eded163"
+     "1a8b605a43ff5bed8086072ba1e7cc2358baeca134c825a7"},
+    {"FIPS 180-4 SHA-512 abc",
+     512,
+     NULL,
+     "abc",
+     "ddaf35a193617abacc417349ae20413112e6fa4e89a97ea20a9eeee64b55d39a"
+     "2192992a274fc1a836ba3c23a3feebbd454d4423643ce80e2a9ac94fa54ca49f"},
+    {"FIPS 180-4 SHA-512 2 blocks",
+     512,
+     NULL,
+     "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmn"
+     "hijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu",
+     "8e959b75dae313da8cf4f72814fc143f8f7779c6eb9f7fa17299aeadb6889018"
+     "501d289e4900f7e4331b99dec4b5433ac7d329eeb6dd26545e96e55b874be909"}
+};
+
+static const struct test_hash_kat_t test_hmac_kats[] = {
+    /* RFC 4231, test cases 2 and 6 */
+    {"RFC 4231 2 HMAC-SHA256",
+     256,
+     "4a656665",
+     "what do ya want for nothing?",
+     "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843"},
+    {"RFC 4231 2 HMAC-SHA512",
+     512,
+     "4a656665",
+     "what do ya want for nothing?",
+     "164b7a7bfcf819e2e395fbe73b56e0a387bd64222e831fd610270cd7ea250554"
+     "9758bf75c05a994a6d034f65f8f0e6fdcaeab1a34d4a6b4b636e070a38bce737"},
+    {"RFC 4231 6 HMAC-SHA256",
+     256,
+     RFC4231_KEY6,
+     RFC4231_MSG6,
+     "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54"},
+    {"RFC 4231 6 HMAC-SHA512",
+     512,
+     RFC4231_KEY6,
+     RFC4231_MSG6,
+     "80b24263c7c1a3ebb71493c1dd7be8b49b46d1f41b4aeec1121b013783f8f352"
+     "6b56d037e05f2598bd0fd2215d6a1e5295e64f73f63f0aec8b915a985d786598"}
+};
+
+/* RFC 5869, test case 1 (HKDF-SHA256) */
+#define RFC5869_IKM "0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b"
+#define RFC5869_SALT "000102030405060708090a0b0c"
+#define RFC5869_INFO "f0f1f2f3f4f5f6f7f8f9"
+#define RFC5869_PRK                                                            \
+    "077709362c2e32df0ddc3f0dc47bba6390b6c73bb50f9c3122ec844ad7c2b3e5"
+#define RFC5869_OKM                                                            \
+    "3cb25f25faacd57a90434f64d0362f2a2d2d0a90cf1a5a4c5db02d56ecc4c5bf"         \
+    "34007208d5b887185865"
+
+/* RFC 7748, section 5.2 (first vector) and section 6.1 (Alice and Bob) */
+#define RFC7748_SCALAR                                                         \
+    "a546e36bf0527c9d3b16154b82465edd62144c0ac1fc5a18506a2244ba449ac4"
+#define RFC7748_U                                                              \
+    "e6db6867583030db3594c1a424b15f7c726624ec26b3353b10a903a6d0ab1c4c"
+#define RFC7748_OUT                                                            \
+    "c3da55379de9c6908e94ea4df28d084f32eccf03491c71f754b4075577a28552"
+#define RFC7748_ALICE_PRIV                                                     \
+    "77076d0a7318a57d3c16c17251b26645df4c2f87ebc0992ab177fba51db92c2a"
+#define RFC7748_ALICE_PUB                                                      \
+    "8520f0098930a754748b7ddcb43ef75a0dbf3a0d26381af4eba4a98eaa9b4e6a"
+#define RFC7748_BOB_PRIV                                                       \
+    "5dab087e624a8a4b79e17f8b83800ee66f3bb1292618b6fd1c2f8b27ff88e0eb"
+#define RFC7748_BOB_PUB                                                        \
+    "de9edb7d7b7dc1b4d35b61c2ece435373f8343c85b78674dadfc7e146f882b4f"
+#define RFC7748_SHARED                                                         \
+    "4a5d9d5ba4ce2de1728e3bf480350f25e07e21c947d19e3376f09b3c1e161742"
+
+/* Known-answer test of Ed25519: hex seed, public key, message, signature */
+typedef struct test_ed25519_kat_t
+{
+    const char* name;
+    const char* seed;
+    const char* pub;
+    const char* msg;
+    const char* sig;
+}* test_ed25519_kat_p;
+
+static const struct test_ed25519_kat_t test_ed25519_kats[] = {
+    /* RFC 8032, section 7.1, tests 1 to 3 */
+    {"RFC 8032 test 1",
+     "9d61b19deffd5a60ba844af492ec2cc44449c5697b326919703bac031cae7f60",
+     "d75a980182b10ab7d54bfed3c964073a0ee172f3daa62325af021a68f707511a",
+     "",
+     "e5564300c360ac729086e2cc806e828a84877f1eb8e5d974d873e06522490155"
+     "5fb8821590a33bacc61e39701cf9b46bd25bf5f0595bbe24655141438e7a100b"},
+    {"RFC 8032 test 2",
+     "4ccd089b28ff96da9db6c346ec114e0f5b8a319f35aba624da8cf6ed4fb8a6fb",
+     "3d4017c3e843895a92b70aa74d1b7ebc9c982ccf2ec4968cc0cd55f12af4660c",
+     "72",
+     "92a009a9f0d4cab8720e820b5f642540a2b27b5416503f8fb3762223ebdb69da"
+     "085ac1e43e15996e458f3613d0f11d8c387b2eaeb4302aeeb00d291612bb0c00"},
+    {"RFC 8032 test 3",
+     "c5aa8df43f9f837bedb7442f31dcb7b166d38535076f094b85ce3a2e0b4458f7",
+     "fc51cd8e6218a1a38da47ed00230f0580816ed13ba3303ac5deb911548908025",
+     "af82",
+     "6291d657deec24024827e69c3abe01a30ce548a284743a445e3680d7db5ac3ac"
+     "18ff9b538d16f290ae67f760984dc6594a7c15e9716ed28dc027beceea1ec40a"}
+};
+
+/* RFC 6979, appendix A.2.5: P-256 key pair and the deterministic signatures
+ * of "sample" and "test" with SHA-256 */
+#define RFC6979_PRIV                                                           \
+    "c9afa9d845ba75166b5c215767b1d6934e50c3db36e89b127b8a622b120f6721"
+#define RFC6979_PUB                                                            \
+    "04"                                                                       \
+    "60fed4ba255a9d31c961eb74c6356d68c049b8923b61fa6ce669622e60f29fb6"         \
+    "7903fe1008b8bc99a41ae9e95628bc64f2f1b20c2d7e9f5177a3c294d4462299"
+#define RFC6979_SIG_SAMPLE                                                     \
+    "efd48b2aacb6a8fd1140dd9cd45e81d69d2c877b56aaf991c34d0ea84eaf3716"         \
+    "f7cb1c942d657c41d436c7a1b6e29f65f3e900dbb9aff4064dc4ab2f843acda8"
+#define RFC6979_SIG_TEST                                                       \
+    "f1abb023518351cd71d881567b1ea663ed3efcf6c5132b354f28d3b0b7d38367"         \
+    "019f4113742a2b14bd25926b49c649155f267e60d3814b4c0cc84250e46f0083"
+
+/* SP 800-90A CTR_DRBG, AES-256 without derivation function, as the CAVP tests
+ * run it: instantiate, generate 512 bits twice, check the second output. The
+ * entropy input is 00 01 ... 2f; the output is that of OpenSSL 3 (CTR-DRBG,
+ * AES-256-CTR, use_df 0, empty personalization string) */
+#define DRBG_KAT_ENTROPY                                                       \
+    "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"         \
+    "202122232425262728292a2b2c2d2e2f"
+#define DRBG_KAT_OUT                                                           \
+    "04562ad35e8ecafaafda16981cdaa147606beea62801342af13c8b5535f72f94"         \
+    "95b74317c762f0adab7abe710797612176b61b0e208398113cf9c170157bc75f"
+
+/* RSA key of 1024 bits, PKCS#1 RSAPrivateKey (DER), made by OpenSSL, in lines
+ * of at most 32 bytes */
+static const char* const test_rsa_der[] = {
+    "3082025c02010002818100c9556afd82b19db0797d79445acd2259c853309016",
+    "18ae2615ed08ca906e85b9504efb9580d85d86685e0452932c8687a20c397a81",
+    "34ec9685d06f5d7c87e41ce4742dc475017a27f4fb2d23d6837a93f5d57ebedd",
+    "863c358b2acc588a19d34df57ae7c94841d148a6209069da6e461523c5ee8c7c",
+    "8b74a45b5d0417a39c36d702030100010281804bc8e05e0ebd06eb6fbfc04eef",
+    "92f9d42be8cc85e01b682a23e4b683713c790f996031a943f7adb4b342788410",
+    "ac18f3a316d0e8010cc7e59cf729845a24d8c33029945d734a7053220c36f21f",
+    "cbc3f512106345472c984b5e5a1fa35670d5bf609126874b43a7fb5791f13c26",
+    "880c53c399511af7842af5db079220e7946159024100f1805068e8da50cb6adb",
+    "14edbf331a02e798ca0ba31dfd60130918cb289ef768e662eb03fbd86f5d8c34",
+    "55fa6f4dd88abeec2fa13f020ad6cb51c20a47dc9f03024100d56bc2782eaa06",
+    "47aaaf9fd9c96c2101bbb0c8b0c0f393f074442238f067f0634e9e5fa9a51647",
+    "1a6a9d4cc01842d73f28993b89c2506d125572e2934026e69d0240631f2a61d4",
+    "e8fe6e6f7e5a59b6b76fbeaf762bbf9904cf2166cebe096cb3ca9298b5130700",
+    "90762d2c45b2e0665cca3b305fdab0d11eb27a34db6acc33709f270240487fd5",
+    "cd2bd4f8532a2984fcdfceca9ba31dd7df2b7cd339b0d56066c54c19be327bdc",
+    "756dae56b3239a91f3038ad9420c5199871faa609304d205240e7be885024100",
+    "a7918a499a72165bcba633201de6bc228483682c69b867e4d119ce8c515dd930",
+    "b45408bf8ac362f1388d642a2249d04d508869a5c9d8c79659aba43f355c683d"
+};
+
+/* Made by OpenSSL with the key of test_rsa_der, for the message "abc":
+ * RSASSA-PSS (SHA-256, MGF1 with SHA-256, 32-byte salt), RSAES-OAEP (SHA-256,
+ * MGF1 with SHA-256, no label) and RSAES-PKCS1-v1_5 */
+#define RSA_KAT_PSS                                                            \
+    "92d1e728a49baa9e9104da95441d6b722ef84d77e5f0f6b28d421b9afa0de8d8"         \
+    "bba6b40571dad49036e560b6d93c9d94055745257cec3170796252ce964bba31"         \
+    "15e29a69853fc91cf13289a5e5cce4e1e04f024d22ae9132cf4fc1a8d7cc5a40"         \
+    "eb18d017a3d8854f971b5a6a79d54fd65591d5ca145bd62b590c9950dbb8ef49"
+#define RSA_KAT_OAEP                                                           \
+    "4f7287c38054811fb64a2ef9f0d7d5329463c7869334371464e380383c4500a0"         \
+    "ede5b90e80b21e2ee667697aa6bc1e3c1b13630d7312c0880afeb0ac08c1d7c2"         \
+    "fe09687f0d17b51df5b13fa9712098ece97eba0ad6043c271b89fdef56cba627"         \
+    "568c7dccc1815d7bf452ca285cb84ff30e23ca3aacea47f1b4d5bbfb3a25eaa8"
+#define RSA_KAT_PKCS1                                                          \
+    "2d17ec6ddfa35277619ce6fded0c1999bc5b165d8f72a9639fde4fdc092b50fa"         \
+    "9091b943505f0ca5837fee6ce84ef615ee30a25e6371f476924a452be19acd84"         \
+    "23aafe610c28716df0e25e0f8e479d7d3cf30b37f0c7b06de136c1516c3da912"         \
+    "cd460982dd45741188e42641c3f9c386ecc215d2a31b7b923e8f2f22bbafef27"
+
+static int test_checks   = 0;
+static int test_failures = 0;
+
+void exit_usage(void);
+
+/* Counts a check, and prints what failed if ok is 0 */
+static void test_check(int ok, const char* what);
+
+/* dst <- bytes of the hex string src
+ *
+ * RETURN
+ * Number of bytes
+ */
+static int test_hex(byte* dst, const char* src);
+
+/* RETURN
+ * 1 if got[0...) are the bytes of the hex string hex, 0 otherwise
+ */
+static int test_hex_equal(const byte* got, const char* hex);
+
+/* dst[0...len) <- bytes of rand(), reproducible from the seed */
+static void test_rand_bytes(byte* dst, size_t len);
+
+/* Random integer in [0, n) */
+static int test_rand_int(int n);
+
+/* Known answers: every vector of test_aes_kats, with each AES backend,
+ * encrypting and decrypting (CTR vectors through aes_ctr_update as well, a
+ * byte at a time); test_sha2_kats with each SHA-2 backend, and the published
+ * vectors of HMAC, HKDF, X25519, Ed25519 and P-256; CTR_DRBG and RSA against
+ * the output of OpenSSL */
+static void test_kat(void);
+static void test_kat_one(const struct test_aes_kat_t* V, int features);
+
+/* test_sha2_kats with the SHA-2 backend features, in one call and a byte at a
+ * time */
+static void test_kat_sha2(int features);
+
+/* test_hmac_kats, and RFC 5869 test case 1 */
+static void test_kat_hmac(void);
+
+/* RFC 7748: the scalar multiplication and the key exchange of Alice and Bob */
+static void test_kat_x25519(void);
+
+/* test_ed25519_kats: public key, signature and verification, also of a
+ * signature with a flipped bit */
+static void test_kat_ed25519(void);
+
+/* RFC 6979, A.2.5: public key and deterministic signatures, verified */
+static void test_kat_p256(void);
+
+/* DRBG_KAT_ENTROPY gives DRBG_KAT_OUT */
+static void test_kat_drbg(void);
+
+/* The key of test_rsa_der: DER import and export, the signature and
+ * ciphertexts of OpenSSL, round trips with the CRT, without it and without
+ * e (refused); then a new key pair */
+static void test_kat_rsa(void);
+
+/* Random cases: messages of random length, keys, modes and paddings, with
+ * the portable backend (the reference) against the fastest one, and the
+ * round trip of each; SHA-2 likewise. Then the multi-buffer and batch
+ * functions against the single-message ones, and DH agreements. */
+static void test_diff(int cases);
+
+/* Random cases: up to TEST_MULTI messages of random lengths through
+ * sha256_multi and sha512_multi with the SHA-2 features, against the
+ * portable sha256 and sha512 of each message */
+static void test_diff_multi(int cases, int features);
+
+/* Random cases: up to TEST_BATCH Ed25519 signatures, some of them forged,
+ * through ed25519_verify_batch against ed25519_verify of each */
+static void test_diff_batch(int cases);
+
+/* Random cases: two key pairs of ffdhe2048 agree on the secret; the public
+ * key is the secret with the generator as peer, and peers 1 and p - 1 are
+ * refused */
+static void test_diff_dh(int cases);
+
+/* Random cases: identities of bigint_mul, bigint_quotient, bigint_mod and
+ * the Montgomery exponentiation */
+static void test_bigint(int cases);
+
+/* N <- random number of 1 to bytes bytes, not zero */
+static void test_bigint_rand(bigint_p N, int bytes);
+
+/*
+ * - [0]
+ * - [1] test: kat, diff, bigint or all (optional, all by default)
+ * - [2] random cases (optional, TEST_CASES by default)
+ * - [3] seed of the random cases (optional, 1 by default).
+ */
+int main(int argc, char** argv)
+{
+    const char* which = "all";
+    int         cases = TEST_CASES;
+    unsigned    seed  = 1;
+
+    if (argc > 1)
+        which = argv[1];
+    if (argc > 2)
+        cases = atoi(argv[2]);
+    if (argc > 3)
+        seed = (unsigned)atoi(argv[3]);
+
+    if (cases < 1)
+        exit_usage();
+
+    srand(seed);
+
+    printf(
+        "cmc-test: aes features %d, sha2 features %d, seed %u\n",
+        aes_features(),
+        sha2_features(),
+        seed
+    );
+
+    if (strcmp(which, "kat") == 0)
+        test_kat();
+    else if (strcmp(which, "diff") == 0)
+        test_diff(cases);
+    else if (strcmp(which, "bigint") == 0)
+        test_bigint(cases);
+    else if (strcmp(which, "all") == 0)
+    {
+        test_kat();
+        test_diff(cases);
+        test_bigint(cases);
+    }
+    else
+        exit_usage();
+
+    printf("%d checks, %d failed\n", test_checks, test_failures);
+
+    return test_failures == 0 ? 0 : 1;
+}
+
+void exit_usage(void)
+{
+    printf("Usage: cmc-test [kat|diff|bigint|all] [cases] [seed]\n");
+    exit(2);
+}
+
+static void test_check(int ok, const char* what)
+{
+    ++test_checks;
+
+    if (!ok)
+    {
+        ++test_failures;
+        printf("FAIL %s\n", what);
+    }
+}
+
+static int test_hex(byte* dst, const char* src)
+{
+    unsigned int b;
+    int          n;
+
+    for (n = 0; src[2 * n] != '\0'; ++n)
+    {
+        if (sscanf(&src[2 * n], "%2x", &b) != 1)
+            return n;
+        dst[n] = (byte)b;
+    }
+
+    return n;
+}
+
+static int test_hex_equal(const byte* got, const char* hex)
+{
+    byte want[256];
+    int  n;
+
+    n = test_hex(want, hex);
+
+    return memcmp(got, want, (size_t)n) == 0;
+}
+
+static void test_rand_bytes(byte* dst, size_t len)
+{
+    size_t i;
+
+    for (i = 0; i < len; ++i)
+        dst[i] = (byte)(rand() & 0xFF);
+}
+
+static int test_rand_int(int n) { return rand() % n; }
+
+static void test_kat(void)
+{
+    size_t i;
+    int    cpu;
+
+    cpu = aes_features_set(~0);
+
+    for (i = 0; i < sizeof(test_aes_kats) / sizeof(test_aes_kats[0]); ++i)
+    {
+        test_kat_one(&test_aes_kats[i], 0);
+        if (cpu != 0)
+            test_kat_one(&test_aes_kats[i], cpu);
+    }
+
+    aes_features_set(cpu);
+
+    cpu = sha2_features_set(~0);
+    test_kat_sha2(0);
+    if (cpu != 0)
+        test_kat_sha2(cpu);
+    sha2_features_set(cpu);
+
+    test_kat_hmac();
+    test_kat_x25519();
+    test_kat_ed25519();
+    test_kat_p256();
+    test_kat_drbg();
+    test_kat_rsa();
+}
+
+static void test_kat_one(const struct test_aes_kat_t* V, int features)
+{
+    byte      key[32];
+    byte      iv[16];
+    byte      plain[64];
+    byte      enc[64];
+    byte      out[64];
+    char      what[128];
+    int       keyN;
+    int       n;
+    int       i;
+    aes_ctr_p ctr;
+
+    aes_features_set(features);
+
+    keyN = test_hex(key, V->key);
+    n    = test_hex(plain, V->plain);
+    test_hex(enc, V->enc);
+    if (V->iv != NULL)
+        test_hex(iv, V->iv);
+
+    memset(out, 0, sizeof(out));
+    sprintf(what, "kat %s encrypt (features %d)", V->name, features);
+    test_check(
+        aes_encrypt(
+            (char*)plain,
+            (char*)out,
+            key,
+            n,
+            n,
+            keyN,
+            V->iv != NULL ? (char*)iv : NULL,
+            PAD_NONE,
+            V->mode
+        ) == 0 &&
+            memcmp(out, enc, (size_t)n) == 0,
+        what
+    );
+
+    memset(out, 0, sizeof(out));
+    sprintf(what, "kat %s decrypt (features %d)", V->name, features);
+    test_check(
+        aes_decrypt(
+            (char*)out,
+            (char*)enc,
+            key,
+            n,
+            n,
+            keyN,
+            V->iv != NULL ? (char*)iv : NULL,
+            PAD_NONE,
+            V->mode
+        ) == 0 &&
+            memcmp(out, plain, (size_t)n) == 0,
+        what
+    );
+
+    if (V->mode != MODE_CTR)
+        return;
+
+    memset(out, 0, sizeof(out));
+    ctr = aes_ctr_new(key, keyN, (char*)iv);
+    for (i = 0; i < n; ++i)
+        aes_ctr_update(ctr, (char*)&out[i], (char*)&plain[i], 1);
+    aes_ctr_free(ctr);
+
+    sprintf(what, "kat %s streaming (features %d)", V->name, features);
+    test_check(memcmp(out, enc, (size_t)n) == 0, what);
+}
+
+static void test_kat_sha2(int features)
+{
+    const struct test_hash_kat_t* V;
+    struct sha256_t               S256;
+    struct sha512_t               S512;
+    byte                          out[SHA512_DIGEST_SIZE];
+    char                          what[128];
+    const byte*                   msg;
+    size_t                        len;
+    size_t                        i;
+    size_t                        j;
+
+    sha2_features_set(features);
+
+    for (i = 0; i < sizeof(test_sha2_kats) / sizeof(test_sha2_kats[0]); ++i)
+    {
+        V   = &test_sha2_kats[i];
+        msg = (const byte*)V->msg;
+        len = strlen(V->msg);
+
+        memset(out, 0, sizeof(out));
+        if (V->bits == 256)
+            sha256(out, msg, len);
+        else if (V->bits == 384)
+            sha384(out, msg, len);
+        else
+            sha512(out, msg, len);
+
+        sprintf(what, "kat %s (features %d)", V->name, features);
+        test_check(test_hex_equal(out, V->digest), what);
+
+        memset(out, 0, sizeof(out));
+        if (V->bits == 256)
+        {
+            sha256_init(&S256);
+            for (j = 0; j < len; ++j)
+                sha256_update(&S256, &msg[j], 1);
+            sha256_final(&S256, out);
+        }
+        else if (V->bits == 384)
+        {
+            sha384_init(&S512);
+            for (j = 0; j < len; ++j)
+                sha384_update(&S512, &msg[j], 1);
+            sha384_final(&S512, out);
+        }
+        else
+        {
+            sha512_init(&S512);
+            for (j = 0; j < len; ++j)
+                sha512_update(&S512, &msg[j], 1);
+            sha512_final(&S512, out);
+        }
+
+        sprintf(what, "kat %s streaming (features %d)", V->name, features);
+        test_check(test_hex_equal(out, V->digest), what);
+    }
+}
+
+static void test_kat_hmac(void)
+{
+    const struct test_hash_kat_t* V;
+    struct hmac_sha256_key_t      K256;
+    struct hmac_sha512_key_t      K512;
+    byte                          key[160];
+    byte                          out[SHA512_DIGEST_SIZE];
+    byte                          prk[SHA256_DIGEST_SIZE];
+    byte                          ikm[32];
+    byte                          salt[16];
+    byte                          info[16];
+    char                          what[128];
+    size_t                        i;
+    int                           keyN;
+    int                           saltN;
+    int                           infoN;
+
+    for (i = 0; i < sizeof(test_hmac_kats) / sizeof(test_hmac_kats[0]); ++i)
+    {
+        V    = &test_hmac_kats[i];
+        keyN = test_hex(key, V->key);
+
+        memset(out, 0, sizeof(out));
+        if (V->bits == 256)
+        {
+            hmac_sha256_key(&K256, key, (size_t)keyN);
+            hmac_sha256(out, &K256, (const byte*)V->msg, strlen(V->msg));
+        }
+        else
+        {
+            hmac_sha512_key(&K512, key, (size_t)keyN);
+            hmac_sha512(out, &K512, (const byte*)V->msg, strlen(V->msg));
+        }
+
+        sprintf(what, "kat %s", V->name);
+        test_check(test_hex_equal(out, V->digest), what);
+    }
+
+    keyN  = test_hex(ikm, RFC5869_IKM);
+    saltN = test_hex(salt, RFC5869_SALT);
+    infoN = test_hex(info, RFC5869_INFO);
+
+    hkdf_sha256_extract(prk, salt, (size_t)saltN, ikm, (size_t)keyN);
+    test_check(
+        test_hex_equal(prk, RFC5869_PRK), "kat RFC 5869 1 HKDF-SHA256 extract"
+    );
+
+    memset(out, 0, sizeof(out));
+    test_check(
+        hkdf_sha256_expand(out, 42, prk, sizeof(prk), info, (size_t)infoN) ==
+                0 &&
+            test_hex_equal(out, RFC5869_OKM),
+        "kat RFC 5869 1 HKDF-SHA256 expand"
+    );
+}
+
+static void test_kat_x25519(void)
+{
+    byte scalar[X25519_SIZE];
+    byte u[X25519_SIZE];
+    byte out[X25519_SIZE];
+    byte alice[X25519_SIZE];
+    byte bob[X25519_SIZE];
+
+    test_hex(scalar, RFC7748_SCALAR);
+    test_hex(u, RFC7748_U);
+    test_check(
+        x25519(out, scalar, u) == 0 && test_hex_equal(out, RFC7748_OUT),
+        "kat RFC 7748 5.2 x25519"
+    );
+
+    test_hex(alice, RFC7748_ALICE_PRIV);
+    test_hex(bob, RFC7748_BOB_PRIV);
+
+    x25519_base(u, alice);
+    test_check(test_hex_equal(u, RFC7748_ALICE_PUB), "kat RFC 7748 6.1 Alice");
+    test_check(
+        x25519(out, bob, u) == 0 && test_hex_equal(out, RFC7748_SHARED),
+        "kat RFC 7748 6.1 Bob's secret"
+    );
+
+    x25519_base(u, bob);
+    test_check(test_hex_equal(u, RFC7748_BOB_PUB), "kat RFC 7748 6.1 Bob");
+    test_check(
+        x25519(out, alice, u) == 0 && test_hex_equal(out, RFC7748_SHARED),
+        "kat RFC 7748 6.1 Alice's secret"
+    );
+}
+
+static void test_kat_ed25519(void)
+{
+    const struct test_ed25519_kat_t* V;
+    byte                             seed[ED25519_SEED_SIZE];
+    byte                             pub[ED25519_PUBLIC_SIZE];
+    byte                             sig[ED25519_SIGNATURE_SIZE];
+    byte                             msg[16];
+    char                             what[128];
+    size_t                           i;
+    size_t                           n;
+
+    for (i = 0; i < sizeof(test_ed25519_kats) / sizeof(test_ed25519_kats[0]);
+         ++i)
+    {
+        V = &test_ed25519_kats[i];
+        test_hex(seed, V->seed);
+        n = (size_t)test_hex(msg, V->msg);
+
+        ed25519_public(pub, seed);
+        sprintf(what, "kat %s public key", V->name);
+        test_check(test_hex_equal(pub, V->pub), what);
+
+        ed25519_sign(sig, msg, n, seed, pub);
+        sprintf(what, "kat %s sign", V->name);
+        test_check(test_hex_equal(sig, V->sig), what);
+
+        test_hex(sig, V->sig);
+        sprintf(what, "kat %s verify", V->name);
+        test_check(ed25519_verify(sig, msg, n, pub) == 0, what);
+
+        sig[i] ^= 1;
+        sprintf(what, "kat %s verify a forgery", V->name);
+        test_check(ed25519_verify(sig, msg, n, pub) == 1, what);
+    }
+}
+
+static void test_kat_p256(void)
+{
+    static const char* msgs[] = {"sample", "test"};
+    static const char* sigs[] = {RFC6979_SIG_SAMPLE, RFC6979_SIG_TEST};
+
+    byte   priv[P256_SIZE];
+    byte   pub[P256_PUBLIC_SIZE];
+    byte   sig[P256_SIGNATURE_SIZE];
+    byte   hash[SHA256_DIGEST_SIZE];
+    char   what[128];
+    size_t i;
+
+    test_hex(priv, RFC6979_PRIV);
+    test_check(
+        p256_public(pub, priv) == 0 && test_hex_equal(pub, RFC6979_PUB),
+        "kat RFC 6979 A.2.5 public key"
+    );
+
+    for (i = 0; i < sizeof(msgs) / sizeof(msgs[0]); ++i)
+    {
+        sha256(hash, (const byte*)msgs[i], strlen(msgs[i]));
+
+        sprintf(what, "kat RFC 6979 A.2.5 sign %s", msgs[i]);
+        test_check(
+            p256_ecdsa_sign(sig, hash, sizeof(hash), priv) == 0 &&
+                test_hex_equal(sig, sigs[i]),
+            what
+        );
+
+        sprintf(what, "kat RFC 6979 A.2.5 verify %s", msgs[i]);
+        test_check(p256_ecdsa_verify(sig, hash, sizeof(hash), pub) == 0, what);
+    }
+}
+
+static void test_kat_drbg(void)
+{
+    struct drbg_t D;
+    byte          entropy[DRBG_SEED_SIZE];
+    byte          out[64];
+
+    test_hex(entropy, DRBG_KAT_ENTROPY);
+    drbg_instantiate(&D, entropy, NULL);
+
+    test_check(
+        drbg_generate(&D, out, sizeof(out), NULL) == 0 &&
+            drbg_generate(&D, out, sizeof(out), NULL) == 0 &&
+            test_hex_equal(out, DRBG_KAT_OUT),
+        "kat SP 800-90A CTR_DRBG AES-256 no df"
+    );
+
+    drbg_wipe(&D);
+}
+
+static void test_kat_rsa(void)
+{
+    static const byte msg[] = {'a', 'b', 'c'};
+
+    struct rsa_key_t K;
+    struct rsa_key_t L;
+    struct bigint_t  B;
+    byte             der[1024];
+    byte             out[1024];
+    byte             hash[SHA256_DIGEST_SIZE];
+    byte             src[BIGINT_MAX];
+    byte             dst[BIGINT_MAX];
+    FILE*            fp;
+    size_t           i;
+    int              derN = 0;
+    int              len;
+    int              res;
+    long             n;
+
+    for (i = 0; i < sizeof(test_rsa_der) / sizeof(test_rsa_der[0]); ++i)
+        derN += test_hex(&der[derN], test_rsa_der[i]);
+
+    /* The key files of a test are temporary files, DER being binary */
+    res = RSA_ERR_MALFORMED_KEY;
+    fp  = tmpfile();
+    if (fp != NULL)
+    {
+        fwrite(der, 1, (size_t)derN, fp);
+        rewind(fp);
+        res = rsa_key_import_fmt(&K, NULL, fp, RSA_FMT_DER);
+        fclose(fp);
+    }
+    test_check(res == RSA_OK, "kat RSA DER import");
+    if (res != RSA_OK)
+        return;
+
+    n  = -1;
+    fp = tmpfile();
+    if (fp != NULL)
+    {
+        if (rsa_key_dump_fmt(&K, NULL, fp, RSA_FMT_DER) == RSA_OK)
+            n = ftell(fp);
+        rewind(fp);
+        if (n != derN || fread(out, 1, (size_t)n, fp) != (size_t)n)
+            n = -1;
+        fclose(fp);
+    }
+    test_check(
+        n == derN && memcmp(out, der, (size_t)derN) == 0, "kat RSA DER export"
+    );
+
+    sha256(hash, msg, sizeof(msg));
+
+    test_hex(src, RSA_KAT_PSS);
+    test_check(
+        rsa_verify_pss(src, hash, &K) == RSA_OK, "kat RSA-PSS verify OpenSSL"
+    );
+    src[10] ^= 1;
+    test_check(
+        rsa_verify_pss(src, hash, &K) == RSA_ERR_SIGNATURE,
+        "kat RSA-PSS verify a forgery"
+    );
+    test_check(
+        rsa_sign_pss(dst, hash, &K) == RSA_OK &&
+            rsa_verify_pss(dst, hash, &K) == RSA_OK,
+        "kat RSA-PSS sign and verify"
+    );
+
+    test_hex(src, RSA_KAT_OAEP);
+    test_check(
+        rsa_decrypt_oaep(dst, &len, src, NULL, 0, &K) == RSA_OK &&
+            len == (int)sizeof(msg) && memcmp(dst, msg, sizeof(msg)) == 0,
+        "kat RSA-OAEP decrypt OpenSSL"
+    );
+
+    test_hex(src, RSA_KAT_PKCS1);
+    test_check(
+        rsa_decrypt_pkcs1(dst, &len, src, &K) == RSA_OK &&
+            len == (int)sizeof(msg) && memcmp(dst, msg, sizeof(msg)) == 0,
+        "kat RSA-PKCS1 decrypt OpenSSL"
+    );
+
+    test_check(
+        rsa_encrypt_oaep(src, msg, (int)sizeof(msg), NULL, 0, &K) == RSA_OK &&
+            rsa_decrypt_oaep(dst, &len, src, NULL, 0, &K) == RSA_OK &&
+            len == (int)sizeof(msg) && memcmp(dst, msg, sizeof(msg)) == 0,
+        "kat RSA-OAEP round trip"
+    );
+
+    /* Without p and q: no CRT, blinded with r^(ed - 2) */
+    rsa_key_copy(&L, &K);
+    bigint_init(&L.p);
+    bigint_init(&L.q);
+    test_check(
+        rsa_decrypt_oaep(dst, &len, src, NULL, 0, &L) == RSA_OK &&
+            len == (int)sizeof(msg) && memcmp(dst, msg, sizeof(msg)) == 0,
+        "kat RSA-OAEP round trip without CRT"
+    );
+
+    /* Without e: it could not be blinded, and is refused */
+    bigint_init(&L.e);
+    bigint_import_bytes(&B, msg, (int)sizeof(msg));
+    test_check(
+        rsa_decrypt(&B, &B, &L) == RSA_ERR_NO_PUBLIC_EXP &&
+            rsa_decrypt_oaep(dst, &len, src, NULL, 0, &L) ==
+                RSA_ERR_NO_PUBLIC_EXP,
+        "kat RSA without e refused"
+    );
+
+    test_check(
+        rsa_key_generate_exp(&L, 1024, RSA_EXP_F4) == RSA_OK &&
+            rsa_encrypt_oaep(src, msg, (int)sizeof(msg), NULL, 0, &L) ==
+                RSA_OK &&
+            rsa_decrypt_oaep(dst, &len, src, NULL, 0, &L) == RSA_OK &&
+            len == (int)sizeof(msg) && memcmp(dst, msg, sizeof(msg)) == 0 &&
+            rsa_sign_pss(dst, hash, &L) == RSA_OK &&
+            rsa_verify_pss(dst, hash, &L) == RSA_OK,
+        "kat RSA new key pair round trips"
+    );
+}
+
+static void test_diff(int cases)
+{
+    static const int keys[] = {16, 24, 32};
+
+    byte      key[32];
+    byte      iv[16];
+    byte      plain[TEST_MAX_LEN];
+    byte      enc[2][TEST_MAX_LEN + 16];
+    byte      out[TEST_MAX_LEN + 16];
+    byte      digest[2][SHA512_DIGEST_SIZE];
+    char      what[128];
+    int       cpu[2];
+    int       c;
+    int       b;
+    int       len;
+    int       encN;
+    int       keyN;
+    int       mode;
+    int       pad;
+    int       i;
+    int       n;
+    aes_ctr_p ctr;
+
+    cpu[0] = aes_features_set(~0);
+    cpu[1] = sha2_features_set(~0);
+
+    for (c = 0; c < cases; ++c)
+    {
+        keyN = keys[test_rand_int(3)];
+        mode = MODE_ECB + test_rand_int(MODE_CTR - MODE_ECB + 1);
+        len  = 1 + test_rand_int(TEST_MAX_LEN);
+        test_rand_bytes(key, sizeof(key));
+        test_rand_bytes(iv, sizeof(iv));
+        test_rand_bytes(plain, (size_t)len);
+
+        /* ECB and CBC: PKCS#7 for partial blocks */
+        pad  = PAD_NONE;
+        encN = len;
+        if ((mode == MODE_ECB || mode == MODE_CBC) && len % 16 != 0)
+        {
+            pad  = PAD_PKCS7;
+            encN = len + 16 - len % 16;
+        }
+
+        for (b = 0; b < 2; ++b)
+        {
+            aes_features_set(b == 0 ? 0 : cpu[0]);
+            memset(enc[b], 0, sizeof(enc[b]));
+            aes_encrypt(
+                (char*)plain,
+                (char*)enc[b],
+                key,
+                len,
+                encN,
+                keyN,
+                (char*)iv,
+                pad,
+                mode
+            );
+
+            memset(out, 0, sizeof(out));
+            aes_decrypt(
+                (char*)out,
+                (char*)enc[b],
+                key,
+                encN,
+                encN,
+                keyN,
+                (char*)iv,
+                pad,
+                mode
+            );
+
+            sprintf(
+                what,
+                "diff case %d: aes-%d mode %d len %d round trip (features %d)",
+                c,
+                keyN * 8,
+                mode,
+                len,
+                b == 0 ? 0 : cpu[0]
+            );
+            test_check(memcmp(out, plain, (size_t)len) == 0, what);
+        }
+
+        sprintf(
+            what,
+            "diff case %d: aes-%d mode %d len %d, portable != features %d",
+            c,
+            keyN * 8,
+            mode,
+            len,
+            cpu[0]
+        );
+        test_check(memcmp(enc[0], enc[1], sizeof(enc[0])) == 0, what);
+
+        /* Streaming CTR in random chunks, against the portable one-shot */
+        if (mode == MODE_CTR)
+        {
+            ctr = aes_ctr_new(key, keyN, (char*)iv);
+            for (i = 0; i < len; i += n)
+            {
+                n = 1 + test_rand_int(64);
+                if (n > len - i)
+                    n = len - i;
+                aes_ctr_update(ctr, (char*)&out[i], (char*)&plain[i], n);
+            }
+            aes_ctr_free(ctr);
+
+            sprintf(what, "diff case %d: streaming ctr len %d", c, len);
+            test_check(memcmp(out, enc[0], (size_t)len) == 0, what);
+        }
+
+        /* SHA-2 */
+        for (b = 0; b < 2; ++b)
+        {
+            sha2_features_set(b == 0 ? 0 : cpu[1]);
+            sha256(digest[b], plain, (size_t)len);
+            sha512(&digest[b][SHA256_DIGEST_SIZE], plain, (size_t)len);
+        }
+
+        sprintf(
+            what,
+            "diff case %d: sha2 len %d, portable != features %d",
+            c,
+            len,
+            cpu[1]
+        );
+        test_check(memcmp(digest[0], digest[1], sizeof(digest[0])) == 0, what);
+    }
+
+    aes_features_set(cpu[0]);
+    sha2_features_set(cpu[1]);
+
+    test_diff_multi(cases, 0);
+    if (cpu[1] != 0)
+        test_diff_multi(cases, cpu[1]);
+    sha2_features_set(cpu[1]);
+
+    /* Slower: a case is a batch of signatures, or two DH key pairs */
+    test_diff_batch(1 + cases / 20);
+    test_diff_dh(1 + cases / 20);
+}
+
+static void test_diff_multi(int cases, int features)
+{
+    static byte msg[TEST_MULTI][TEST_MAX_LEN];
+    static byte digest[2][TEST_MULTI][SHA512_DIGEST_SIZE];
+
+    const byte* src[TEST_MULTI];
+    byte*       dst[TEST_MULTI];
+    size_t      len[TEST_MULTI];
+    byte        one[SHA512_DIGEST_SIZE];
+    char        what[128];
+    int         count;
+    int         c;
+    int         i;
+    int         ok;
+
+    for (c = 0; c < cases; ++c)
+    {
+        count = 1 + test_rand_int(TEST_MULTI);
+        for (i = 0; i < count; ++i)
+        {
+            len[i] = (size_t)test_rand_int(TEST_MAX_LEN + 1);
+            test_rand_bytes(msg[i], len[i]);
+            src[i] = msg[i];
+        }
+
+        sha2_features_set(features);
+        for (i = 0; i < count; ++i)
+            dst[i] = digest[0][i];
+        sha256_multi(dst, src, len, count);
+        for (i = 0; i < count; ++i)
+            dst[i] = digest[1][i];
+        sha512_multi(dst, src, len, count);
+
+        sha2_features_set(0);
+        ok = 1;
+        for (i = 0; i < count; ++i)
+        {
+            sha256(one, msg[i], len[i]);
+            ok &= memcmp(one, digest[0][i], SHA256_DIGEST_SIZE) == 0;
+            sha512(one, msg[i], len[i]);
+            ok &= memcmp(one, digest[1][i], SHA512_DIGEST_SIZE) == 0;
+        }
+
+        sprintf(
+            what,
+            "diff case %d: sha2 multi count %d, != portable (features %d)",
+            c,
+            count,
+            features
+        );
+        test_check(ok, what);
+    }
+}
+
+static void test_diff_batch(int cases)
+{
+    static byte msg[TEST_BATCH][64];
+    static byte sig[TEST_BATCH][ED25519_SIGNATURE_SIZE];
+
+    const byte* sig_p[TEST_BATCH];
+    const byte* msg_p[TEST_BATCH];
+    const byte* pub_p[TEST_BATCH];
+    size_t      len[TEST_BATCH];
+    int         valid[TEST_BATCH];
+    byte        seed[4][ED25519_SEED_SIZE];
+    byte        pub[4][ED25519_PUBLIC_SIZE];
+    char        what[128];
+    int         count;
+    int         invalid;
+    int         single;
+    int         c;
+    int         i;
+    int         j;
+    int         ok;
+
+    for (j = 0; j < 4; ++j)
+        ed25519_keypair(pub[j], seed[j]);
+
+    for (c = 0; c < cases; ++c)
+    {
+        count = 1 + test_rand_int(TEST_BATCH);
+
+        for (i = 0; i < count; ++i)
+        {
+            j      = test_rand_int(4);
+            len[i] = (size_t)test_rand_int(64 + 1);
+            test_rand_bytes(msg[i], len[i]);
+            ed25519_sign(sig[i], msg[i], len[i], seed[j], pub[j]);
+
+            /* Half of the cases have forgeries, about one in 16 */
+            if (c % 2 == 1 && test_rand_int(16) == 0)
+                sig[i][test_rand_int(ED25519_SIGNATURE_SIZE)] ^= 0x10;
+
+            sig_p[i] = sig[i];
+            msg_p[i] = msg[i];
+            pub_p[i] = pub[j];
+        }
+
+        ok = 1;
+        for (i = 0; i < count; ++i)
+            valid[i] = -1;
+        invalid = ed25519_verify_batch(sig_p, msg_p, len, pub_p, count, valid);
+        for (i = 0; i < count; ++i)
+        {
+            single = ed25519_verify(sig[i], msg[i], len[i], pub_p[i]) == 0;
+            ok &= valid[i] == single;
+            invalid -= !valid[i];
+        }
+
+        sprintf(
+            what, "diff case %d: ed25519 batch count %d, != single", c, count
+        );
+        test_check(ok && invalid == 0, what);
+    }
+}
+
+static void test_diff_dh(int cases)
+{
+    static const byte one = 1;
+    static const byte two = 2;
+
+    struct dh_key_t A;
+    struct dh_key_t B;
+    struct bigint_t Y;
+    byte            a[BIGINT_MAX];
+    byte            b[BIGINT_MAX];
+    byte            y[BIGINT_MAX];
+    char            what[128];
+    dh_group_p      G;
+    size_t          size;
+    int             c;
+
+    G    = dh_group_get(DH_FFDHE2048);
+    size = (size_t)G->size;
+
+    for (c = 0; c < cases; ++c)
+    {
+        dh_keypair(&A, G);
+        dh_keypair(&B, G);
+        sprintf(what, "diff case %d: dh ffdhe2048 agreement", c);
+        test_check(
+            dh_shared_secret(a, &A, &B.y) == 0 &&
+                dh_shared_secret(b, &B, &A.y) == 0 && memcmp(a, b, size) == 0,
+            what
+        );
+
+        bigint_import_bytes(&Y, &two, 1);
+        dh_export_public(y, &A);
+        sprintf(what, "diff case %d: dh ffdhe2048 public key", c);
+        test_check(
+            dh_shared_secret(a, &A, &Y) == 0 && memcmp(a, y, size) == 0, what
+        );
+
+        bigint_import_bytes(&Y, &one, 1);
+        sprintf(what, "diff case %d: dh ffdhe2048 peers 1 and p - 1", c);
+        test_check(
+            dh_shared_secret(a, &A, &Y) == 1 &&
+                dh_shared_secret(a, &A, &G->p1) == 1,
+            what
+        );
+    }
+}
+
+static void test_bigint(int cases)
+{
+    struct bigint_t      A;
+    struct bigint_t      B;
+    struct bigint_t      R;
+    struct bigint_t      P;
+    struct bigint_t      Q;
+    struct bigint_t      T;
+    struct bigint_mont_t C;
+    char                 what[128];
+    int                  c;
+    int                  k;
+
+    for (c = 0; c < cases; ++c)
+    {
+        test_bigint_rand(&A, 1 + test_rand_int(TEST_BIGINT_BYTES / 2));
+        test_bigint_rand(&B, 1 + test_rand_int(TEST_BIGINT_BYTES / 2));
+
+        /* Commutativity, and squares */
+        bigint_mul(&P, &A, &B);
+        bigint_mul(&T, &B, &A);
+        sprintf(what, "bigint case %d: a * b != b * a", c);
+        test_check(bigint_cmp(&P, &T) == 0, what);
+
+        bigint_mul(&T, &A, &A);
+        bigint_square(&Q, &A);
+        sprintf(what, "bigint case %d: a^2 != a * a", c);
+        test_check(bigint_cmp(&Q, &T) == 0, what);
+
+        /* (a * b + r) / b = a and (a * b + r) mod b = r, for r < b */
+        test_bigint_rand(&R, 1 + test_rand_int(TEST_BIGINT_BYTES / 2));
+        bigint_mod(&R, &R, &B);
+        bigint_sum(&T, &P, &R);
+
+        bigint_quotient(&Q, &T, &B);
+        sprintf(what, "bigint case %d: (a * b + r) / b != a", c);
+        test_check(bigint_cmp(&Q, &A) == 0, what);
+
+        bigint_mod(&Q, &T, &B);
+        sprintf(what, "bigint case %d: (a * b + r) mod b != r", c);
+        test_check(bigint_cmp(&Q, &R) == 0, what);
+
+        /* (a + b) - b = a */
+        bigint_sum(&T, &A, &B);
+        bigint_sub(&T, &T, &B);
+        sprintf(what, "bigint case %d: (a + b) - b != a", c);
+        test_check(bigint_cmp(&T, &A) == 0, what);
+
+        /* a << k = a * 2^k, and back */
+        k = test_rand_int(64);
+        bigint_init(&T);
+        bigint_setbit(&T, k, 1);
+        bigint_mul(&P, &A, &T);
+        bigint_shiftl(&Q, &A, k);
+        sprintf(what, "bigint case %d: a << %d != a * 2^%d", c, k, k);
+        test_check(bigint_cmp(&Q, &P) == 0, what);
+
+        bigint_shiftr(&Q, &Q, k);
+        sprintf(what, "bigint case %d: (a << %d) >> %d != a", c, k, k);
+        test_check(bigint_cmp(&Q, &A) == 0, what);
+
+        /* Montgomery exponentiation modulo an odd m, against square and
+         * multiply modulo 2m (even: no Montgomery context), reduced mod m */
+        if (c % 8 == 0)
+        {
+            test_bigint_rand(&B, 1 + test_rand_int(TEST_BIGINT_BYTES / 4));
+            bigint_setbit(&B, 0, 1);
+            test_bigint_rand(&R, 1 + test_rand_int(16));
+            bigint_mod(&A, &A, &B);
+
+            if (!bigint_mont_init(&C, &B))
+                continue;
+            bigint_mont_exp(&P, &A, &R, &C);
+
+            bigint_shiftl(&T, &B, 1);
+            bigint_exp_mod(&Q, &A, &R, &T);
+            bigint_mod(&Q, &Q, &B);
+
+            sprintf(what, "bigint case %d: mont_exp != exp_mod", c);
+            test_check(bigint_cmp(&P, &Q) == 0, what);
+        }
+    }
+}
+
+static void test_bigint_rand(bigint_p N, int bytes)
+{
+    byte buf[BIGINT_MAX];
+
+    do
+    {
+        test_rand_bytes(buf, (size_t)bytes);
+        bigint_import_bytes(N, buf, bytes);
+    } while (bigint_iszero(N));
+}
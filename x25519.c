@@ -0,0 +1,103 @@
+#include <string.h>
+
+#include "fe25519.h"
+#include "random.h"
+#include "x25519.h"
+
+/* (A - 2) / 4, for the doubling of the ladder (RFC 7748, section 5) */
+#define X25519_A24 121665
+
+/* --- IMPL */
+
+int x25519(byte* dst, const byte* scalar, const byte* u)
+{
+    byte      k[X25519_SIZE];
+    fe25519_t x1;
+    fe25519_t x2;
+    fe25519_t z2;
+    fe25519_t x3;
+    fe25519_t z3;
+    fe25519_t a;
+    fe25519_t aa;
+    fe25519_t b;
+    fe25519_t bb;
+    fe25519_t e;
+    fe25519_t c;
+    fe25519_t d;
+    uint64_t  swap = 0;
+    uint64_t  bit;
+    byte      acc  = 0;
+    int       t;
+    int       i;
+
+    memcpy(k, scalar, X25519_SIZE);
+    k[0] &= 248;
+    k[31] &= 127;
+    k[31] |= 64;
+
+    fe25519_frombytes(x1, u);
+    fe25519_one(x2);
+    fe25519_zero(z2);
+    fe25519_copy(x3, x1);
+    fe25519_one(z3);
+
+    /* (x2 : z2) = k' * P and (x3 : z3) = (k' + 1) * P, k' being the bits of
+     * the scalar read so far; swaps are deferred until the bit changes */
+    for (t = 254; t >= 0; --t)
+    {
+        bit = (uint64_t)(k[t / 8] >> (t % 8) & 1);
+        swap ^= bit;
+        fe25519_cswap(x2, x3, 0 - swap);
+        fe25519_cswap(z2, z3, 0 - swap);
+        swap = bit;
+
+        fe25519_add(a, x2, z2);
+        fe25519_sqr(aa, a);
+        fe25519_sub(b, x2, z2);
+        fe25519_sqr(bb, b);
+        fe25519_sub(e, aa, bb);
+        fe25519_add(c, x3, z3);
+        fe25519_sub(d, x3, z3);
+        fe25519_mul(d, d, a);  /* DA */
+        fe25519_mul(c, c, b);  /* CB */
+        fe25519_add(a, d, c);  /* DA + CB */
+        fe25519_sub(b, d, c);  /* DA - CB */
+        fe25519_sqr(x3, a);
+        fe25519_sqr(b, b);
+        fe25519_mul(z3, x1, b);
+        fe25519_mul(x2, aa, bb);
+        fe25519_mul_small(a, e, X25519_A24);
+        fe25519_add(a, aa, a);
+        fe25519_mul(z2, e, a);
+    }
+
+    fe25519_cswap(x2, x3, 0 - swap);
+    fe25519_cswap(z2, z3, 0 - swap);
+
+    fe25519_invert(z2, z2);
+    fe25519_mul(x2, x2, z2);
+    fe25519_tobytes(dst, x2);
+
+    memset(k, 0, sizeof(k));
+
+    for (i = 0; i < X25519_SIZE; ++i)
+        acc |= dst[i];
+
+    return acc == 0;
+}
+
+void x25519_base(byte* dst, const byte* scalar)
+{
+    byte u[X25519_SIZE];
+
+    memset(u, 0, sizeof(u));
+    u[0] = 9;
+
+    x25519(dst, scalar, u);
+}
+
+void x25519_keypair(byte* pub, byte* priv)
+{
+    random_get_buffer((char*)priv, X25519_SIZE);
+    x25519_base(pub, priv);
+}
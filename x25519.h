@@ -0,0 +1,33 @@
+#ifndef CMC_CRYPTO_X25519_INCLUDED
+#define CMC_CRYPTO_X25519_INCLUDED
+
+#include "types.h"
+
+/* Bytes of private keys, public keys and shared secrets */
+#define X25519_SIZE 32
+
+/* X25519 (RFC 7748): dst <- the u-coordinate of scalar * (u, ...) on
+ * Curve25519, all of them X25519_SIZE bytes little-endian. The scalar is
+ * clamped (and it is not modified), the top bit of u is ignored.
+ *
+ * Field elements are 5 limbs of 51 bits (see fe25519_t), and the scalar
+ * multiplication is a Montgomery ladder, in constant time: the sequence of
+ * operations and memory accesses does not depend on the scalar.
+ *
+ * The shared secret of a key exchange is x25519(dst, own private key, peer
+ * public key); it should go through a KDF (e.g. HKDF) before use.
+ *
+ * RETURN
+ * 0 -> dst is the result;
+ * 1 -> dst is all zeros: u is a point of small order, and dst must not be used
+ *      as a secret (RFC 7748, section 6.1).
+ */
+extern int x25519(byte* dst, const byte* scalar, const byte* u);
+
+/* dst <- public key of scalar, that is x25519 with the base point u = 9 */
+extern void x25519_base(byte* dst, const byte* scalar);
+
+/* New key pair: priv is random, pub = x25519_base(priv) */
+extern void x25519_keypair(byte* pub, byte* priv);
+
+#endif /* CMC_CRYPTO_X25519_INCLUDED */